@@ -1042,24 +1042,22 @@ static bool app_update( app_o* self ) {
 	// If they reach zero, they must be removed.
 
 	{
-		std::vector<EntityId> entity_kill_list;
-
 		self->ecs.system_set_method(
 		    self->sysUpdateTimeLimited, []( LE_ECS_WRITE_ONLY_PARAMS, void* user_data ) {
-			    auto p         = LE_ECS_GET_WRITE_PARAM( 0, TimeLimitedComponent );
-			    auto kill_list = static_cast<std::vector<EntityId>*>( user_data );
+			    auto p   = LE_ECS_GET_WRITE_PARAM( 0, TimeLimitedComponent );
+			    auto app = static_cast<app_o*>( user_data );
 			    if ( p->age < 1 ) {
-				    kill_list->push_back( entity );
+				    // We must not remove entities while the system iterates over them -
+				    // but we may record their removal, which gets applied on flush.
+				    app->ecs.deferred_remove_entity( entity );
 			    }
 			    p->age--;
 		    } );
 
-		self->ecs.update_system( self->sysUpdateTimeLimited, &entity_kill_list );
+		self->ecs.update_system( self->sysUpdateTimeLimited, self );
 
-		// remove projectile entities from ecs which have been marked as inactive
-		for ( auto& e : entity_kill_list ) {
-			self->ecs.remove_entity( e );
-		}
+		// remove entities which have been marked as inactive
+		self->ecs.flush_deferred();
 	}
 
 	// Update physics system
@@ -1074,7 +1072,9 @@ static bool app_update( app_o* self ) {
 		    pos->pos = glm::mod( pos->pos + glm::vec2( 320, 240 ), screen_dims ) - glm::vec2( 320, 240 );
 	    } );
 
-	self->ecs.update_system( self->sysPhysics, self );
+	// Physics only touches the components of the entity it is called on - which
+	// means that we may safely process entities in parallel.
+	self->ecs.update_system_parallel( self->sysPhysics, self );
 
 	// Apply collision detection
 
@@ -1131,7 +1131,6 @@ static bool app_update( app_o* self ) {
 
 		    data.spaceship_data.push_back( { pos->pos, collider->radius, entity, false } );
 	    } );
-	self->ecs.update_system( self->sysFetchSpaceships, &collide_data );
 
 	// Fetch projectiles into collide_data
 	self->ecs.system_set_method(
@@ -1142,8 +1141,14 @@ static bool app_update( app_o* self ) {
 
 		    data.projectile_data.push_back( { pos->pos, collider->radius, entity } );
 	    } );
-	self->ecs.update_system( self->sysFetchProjectiles,
-	                         &collide_data );
+
+	// Both fetch systems only read components, and write to separate vectors
+	// in collide_data, which means that they may run at the same time.
+	{
+		LeEcsSystemId fetch_systems[]   = { self->sysFetchSpaceships, self->sysFetchProjectiles };
+		void*         fetch_user_data[] = { &collide_data, &collide_data };
+		self->ecs.update_systems( fetch_systems, fetch_user_data, 2 );
+	}
 
 	// Now, we have data for all projectiles in projectile_data.
 	// We now test all projectiles against all asterisks.
@@ -0,0 +1,37 @@
+#include "test_ecs_app/test_ecs_app.h"
+
+// ----------------------------------------------------------------------
+
+int main( int argc, char const* argv[] ) {
+
+	TestEcsApp::initialize();
+
+	uint32_t num_failures = 0;
+
+	{
+		// We instantiate TestEcsApp in its own scope - so that
+		// it will be destroyed before TestEcsApp::terminate
+		// is called.
+
+		TestEcsApp testEcsApp{};
+
+		for ( ;; ) {
+
+#ifdef PLUGINS_DYNAMIC
+			le_core_poll_for_module_reloads();
+#endif
+			auto result = testEcsApp.update();
+
+			if ( !result ) {
+				break;
+			}
+		}
+
+		num_failures = testEcsApp.getNumFailures();
+	}
+
+	// Must only be called once last TestEcsApp is destroyed
+	TestEcsApp::terminate();
+
+	return num_failures ? 1 : 0;
+}
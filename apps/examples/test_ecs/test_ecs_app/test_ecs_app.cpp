@@ -0,0 +1,726 @@
+#include "test_ecs_app.h"
+#include "le_log.h"
+#include "le_hash_util.h" // for hash_64_fnv1a_const, which le_ecs.h uses
+#include "le_ecs.h"
+#include "le_jobs.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iterator> // for std::size
+#include <thread>
+#include <vector>
+
+struct test_ecs_app_o {
+	size_t   current_test = 0; // index of next test to run
+	uint32_t num_failures = 0;
+};
+
+typedef test_ecs_app_o app_o;
+
+static auto logger = LeLog( "test_ecs" );
+
+using bench_clock = std::chrono::steady_clock;
+
+// ----------------------------------------------------------------------
+
+static double ms_since( bench_clock::time_point t0 ) {
+	return std::chrono::duration<double, std::milli>( bench_clock::now() - t0 ).count();
+}
+
+// clang-format off
+LE_ECS_COMPONENT( PositionComponent );
+	float x;
+	float y;
+	float z;
+LE_ECS_COMPONENT_CLOSE();
+
+LE_ECS_COMPONENT( VelocityComponent );
+	float x;
+	float y;
+	float z;
+LE_ECS_COMPONENT_CLOSE();
+
+LE_ECS_COMPONENT( HealthComponent );
+	float value;
+LE_ECS_COMPONENT_CLOSE();
+
+LE_ECS_FLAG_COMPONENT( TagComponent );
+// clang-format on
+
+// ----------------------------------------------------------------------
+// Archetype storage, with one million entities.
+//
+// We time structural changes - creating entities, adding and removing components,
+// removing entities - and a system pass (Position += Velocity), once via a per-entity
+// system method, once via a chunk method, and once via a typed query.
+
+constexpr static uint32_t MANY_ENTITIES_COUNT = 1000000;
+
+static void physics_fn( EntityId, void const** read_c, void** write_c, void* ) {
+	auto vel = LE_ECS_GET_READ_PARAM( 0, VelocityComponent );
+	auto pos = LE_ECS_GET_WRITE_PARAM( 0, PositionComponent );
+	pos->x += vel->x;
+	pos->y += vel->y;
+	pos->z += vel->z;
+}
+
+static void physics_chunk_fn( uint32_t count, EntityId const*, void const** read_c, void** write_c, void* ) {
+	auto vel = LE_ECS_GET_READ_PARAM( 0, VelocityComponent );
+	auto pos = LE_ECS_GET_WRITE_PARAM( 0, PositionComponent );
+	for ( uint32_t i = 0; i != count; i++ ) {
+		pos[ i ].x += vel[ i ].x;
+		pos[ i ].y += vel[ i ].y;
+		pos[ i ].z += vel[ i ].z;
+	}
+}
+
+// Sum of all x positions, and number of entities which have a position.
+static double sum_positions( LeEcs& ecs, uint32_t* count ) {
+	LeEcsQuery<le_ecs::Read<PositionComponent>, le_ecs::Write<>> query( ecs );
+
+	double sum = 0;
+	*count     = 0;
+	query.for_each( [ & ]( EntityId, PositionComponent const& pos ) {
+		sum += pos.x;
+		( *count )++;
+	} );
+	return sum;
+}
+
+static bool test_many_entities() {
+
+	bool passed = true;
+
+	logger.info( "%u entities - ms, system passes best of 5", MANY_ENTITIES_COUNT );
+
+	LeEcs                 ecs;
+	std::vector<EntityId> entities( MANY_ENTITIES_COUNT );
+
+	auto t0 = bench_clock::now();
+
+	for ( uint32_t i = 0; i != MANY_ENTITIES_COUNT; i++ ) {
+		entities[ i ] = ecs.entity()
+		                    .add_component( PositionComponent{ 0, 0, 0 } )
+		                    .add_component( VelocityComponent{ float( i & 7 ), 1, 0 } )
+		                    .build();
+	}
+
+	logger.info( "%-40s %10.1f", "create, with 2 components each", ms_since( t0 ) );
+
+	t0 = bench_clock::now();
+
+	for ( uint32_t i = 0; i < MANY_ENTITIES_COUNT; i += 2 ) {
+		ecs.entity_add_component( entities[ i ], TagComponent{} );
+	}
+
+	logger.info( "%-40s %10.1f", "add flag component to every other", ms_since( t0 ) );
+
+	// System passes - each of these adds the velocity once.
+
+	LeEcsSystemId physics_system = ecs.system()
+	                                   .add_read_components<VelocityComponent>()
+	                                   .add_write_components<PositionComponent>()
+	                                   .build();
+
+	LeEcsSystemId physics_chunk_system = ecs.system()
+	                                         .add_read_components<VelocityComponent>()
+	                                         .add_write_components<PositionComponent>()
+	                                         .build();
+
+	ecs.system_set_method( physics_system, physics_fn );
+	ecs.system_set_chunk_method( physics_chunk_system, physics_chunk_fn );
+
+	LeEcsQuery<le_ecs::Read<VelocityComponent>, le_ecs::Write<PositionComponent>> physics_query( ecs );
+
+	double best_ms[ 3 ] = { 1e9, 1e9, 1e9 };
+
+	for ( int repeat = 0; repeat != 5; repeat++ ) {
+
+		t0 = bench_clock::now();
+		ecs.update_system( physics_system, nullptr );
+		best_ms[ 0 ] = std::min( best_ms[ 0 ], ms_since( t0 ) );
+
+		t0 = bench_clock::now();
+		ecs.update_system( physics_chunk_system, nullptr );
+		best_ms[ 1 ] = std::min( best_ms[ 1 ], ms_since( t0 ) );
+
+		t0 = bench_clock::now();
+		physics_query.for_each( []( EntityId, VelocityComponent const& vel, PositionComponent& pos ) {
+			pos.x += vel.x;
+			pos.y += vel.y;
+			pos.z += vel.z;
+		} );
+		best_ms[ 2 ] = std::min( best_ms[ 2 ], ms_since( t0 ) );
+	}
+
+	logger.info( "%-40s %10.2f", "system pass, per-entity method", best_ms[ 0 ] );
+	logger.info( "%-40s %10.2f", "system pass, chunk method", best_ms[ 1 ] );
+	logger.info( "%-40s %10.2f", "system pass, typed query", best_ms[ 2 ] );
+
+	{
+		// 15 passes in total, each adds (i & 7) to x: sum over i of 15 * (i & 7).
+		double expected = 15.0 * 3.5 * MANY_ENTITIES_COUNT;
+
+		uint32_t count;
+		double   sum = sum_positions( ecs, &count );
+
+		if ( count != MANY_ENTITIES_COUNT || sum != expected ) {
+			logger.error( "Expected %u entities with position sum %f, got %u, and %f", MANY_ENTITIES_COUNT, expected, count, sum );
+			passed = false;
+		}
+	}
+
+	t0 = bench_clock::now();
+
+	for ( uint32_t i = 0; i < MANY_ENTITIES_COUNT; i += 2 ) {
+		ecs.entity_remove_component<TagComponent>( entities[ i ] );
+	}
+
+	logger.info( "%-40s %10.1f", "remove flag component from every other", ms_since( t0 ) );
+
+	t0 = bench_clock::now();
+
+	for ( uint32_t i = 0; i < MANY_ENTITIES_COUNT; i += 4 ) {
+		ecs.remove_entity( entities[ i ] );
+	}
+
+	logger.info( "%-40s %10.1f", "remove every fourth entity", ms_since( t0 ) );
+
+	{
+		uint32_t count;
+		sum_positions( ecs, &count );
+
+		if ( count != MANY_ENTITIES_COUNT - MANY_ENTITIES_COUNT / 4 ) {
+			logger.error( "Expected %u entities after removal, got %u", MANY_ENTITIES_COUNT - MANY_ENTITIES_COUNT / 4, count );
+			passed = false;
+		}
+	}
+
+	return passed;
+}
+
+// ----------------------------------------------------------------------
+// Queries own a system, which they must release when they go out of scope - so
+// that queries may be created per frame without adding up systems in the ecs.
+//
+// A new query re-uses the slot of the query destroyed before it, and must not
+// inherit any of its state, e.g. its filters.
+
+static bool test_query_lifetime() {
+
+	bool passed = true;
+
+	LeEcs ecs;
+
+	for ( uint32_t i = 0; i != 100; i++ ) {
+		ecs.entity().add_component( PositionComponent{ 1, 0, 0 } ).build();
+	}
+
+	LeEcsSystemId first_id;
+	{
+		// Filtered query: once it has run, it won't see entities again until they change.
+		LeEcsQuery<le_ecs::Read<PositionComponent>, le_ecs::Write<>> query( ecs );
+		query.changed<PositionComponent>();
+		query.for_each( []( EntityId, PositionComponent const& ) {} );
+		first_id = query.system_id();
+	}
+
+	for ( uint32_t frame = 0; frame != 1000; frame++ ) {
+
+		LeEcsQuery<le_ecs::Read<PositionComponent>, le_ecs::Write<>> query( ecs );
+
+		uint32_t count = 0;
+		query.for_each( [ &count ]( EntityId, PositionComponent const& ) { count++; } );
+
+		if ( query.system_id() != first_id || count != 100 ) {
+			logger.error( "Frame %u: query got system %p (expected %p), and visited %u entities (expected 100)",
+			              frame, ( void* )query.system_id(), ( void* )first_id, count );
+			passed = false;
+			break;
+		}
+	}
+
+	return passed;
+}
+
+// ----------------------------------------------------------------------
+// Parallel system execution must give the same results as serial execution - with, and
+// without le_jobs running - and should scale with the number of worker threads.
+//
+// Each frame runs three systems: `physics` (Position += Velocity), `heal`, which writes
+// to Health only, and `damp`, which writes to Velocity, and must therefore run after
+// `physics`. `heal` may run concurrently with either.
+
+constexpr static uint32_t PARALLEL_ENTITIES_COUNT = 250000;
+constexpr static uint32_t PARALLEL_FRAMES_COUNT   = 5;
+
+static void heal_fn( EntityId, void const**, void** write_c, void* ) {
+	auto health = LE_ECS_GET_WRITE_PARAM( 0, HealthComponent );
+	health->value += 1;
+}
+
+static void damp_fn( EntityId, void const**, void** write_c, void* ) {
+	auto vel = LE_ECS_GET_WRITE_PARAM( 0, VelocityComponent );
+	vel->x   = vel->x * 0.5f + 1;
+}
+
+enum class ExecutionMode {
+	eSerial,         // update_system, one system after another
+	eSystemParallel, // update_system_parallel, one system after another
+	eSystems,        // update_systems, all systems in one call
+};
+
+static char const* execution_mode_name( ExecutionMode mode ) {
+	switch ( mode ) {
+	case ExecutionMode::eSerial:
+		return "update_system";
+	case ExecutionMode::eSystemParallel:
+		return "update_system_parallel";
+	case ExecutionMode::eSystems:
+		return "update_systems";
+	}
+	return "";
+}
+
+// Runs PARALLEL_FRAMES_COUNT frames on a fresh world, returns the best frame time
+// in ms, and a checksum over all components.
+static double run_parallel_frames( ExecutionMode mode, double* checksum ) {
+
+	LeEcs ecs;
+
+	for ( uint32_t i = 0; i != PARALLEL_ENTITIES_COUNT; i++ ) {
+		ecs.entity()
+		    .add_component( PositionComponent{ 0, 0, 0 } )
+		    .add_component( VelocityComponent{ float( i & 7 ), 1, 0 } )
+		    .add_component( HealthComponent{ float( i & 3 ) } )
+		    .build();
+	}
+
+	LeEcsSystemId systems[ 3 ];
+
+	systems[ 0 ] = ecs.system()
+	                   .add_read_components<VelocityComponent>()
+	                   .add_write_components<PositionComponent>()
+	                   .build();
+	systems[ 1 ] = ecs.system()
+	                   .add_write_components<HealthComponent>()
+	                   .build();
+	systems[ 2 ] = ecs.system()
+	                   .add_write_components<VelocityComponent>()
+	                   .build();
+
+	ecs.system_set_method( systems[ 0 ], physics_fn );
+	ecs.system_set_method( systems[ 1 ], heal_fn );
+	ecs.system_set_method( systems[ 2 ], damp_fn );
+
+	double best_ms = 1e9;
+
+	for ( uint32_t frame = 0; frame != PARALLEL_FRAMES_COUNT; frame++ ) {
+
+		auto t0 = bench_clock::now();
+
+		switch ( mode ) {
+		case ExecutionMode::eSerial:
+			for ( auto s : systems ) {
+				ecs.update_system( s, nullptr );
+			}
+			break;
+		case ExecutionMode::eSystemParallel:
+			for ( auto s : systems ) {
+				ecs.update_system_parallel( s, nullptr );
+			}
+			break;
+		case ExecutionMode::eSystems:
+			ecs.update_systems( systems, nullptr, uint32_t( std::size( systems ) ) );
+			break;
+		}
+
+		best_ms = std::min( best_ms, ms_since( t0 ) );
+	}
+
+	LeEcsQuery<le_ecs::Read<PositionComponent, VelocityComponent, HealthComponent>, le_ecs::Write<>> query( ecs );
+
+	*checksum = 0;
+	query.for_each( [ & ]( EntityId, PositionComponent const& pos, VelocityComponent const& vel, HealthComponent const& health ) {
+		*checksum += double( pos.x ) + double( vel.x ) + double( health.value );
+	} );
+
+	return best_ms;
+}
+
+static bool test_parallel_systems() {
+
+	bool passed = true;
+
+	double expected_checksum;
+	double serial_ms = run_parallel_frames( ExecutionMode::eSerial, &expected_checksum );
+
+	logger.info( "%u entities, 3 systems - best frame of %u, ms", PARALLEL_ENTITIES_COUNT, PARALLEL_FRAMES_COUNT );
+	logger.info( "%-40s %10.2f", "update_system, serial", serial_ms );
+
+	auto check = [ & ]( ExecutionMode mode, uint32_t num_workers, double checksum ) {
+		if ( checksum != expected_checksum ) {
+			logger.error( "%s with %u workers: checksum %f, expected %f", execution_mode_name( mode ), num_workers, checksum, expected_checksum );
+			passed = false;
+		}
+	};
+
+	// Without le_jobs, parallel methods must fall back to running on the calling thread.
+
+	for ( auto mode : { ExecutionMode::eSystemParallel, ExecutionMode::eSystems } ) {
+		double checksum;
+		run_parallel_frames( mode, &checksum );
+		check( mode, 0, checksum );
+	}
+
+	uint32_t const max_workers = std::max( 2u, std::thread::hardware_concurrency() );
+
+	for ( uint32_t num_workers = 1; num_workers <= max_workers; num_workers *= 2 ) {
+
+		le_jobs_settings_t settings{};
+		settings.worker_thread_count = num_workers;
+		le_jobs::initialize( &settings );
+
+		for ( auto mode : { ExecutionMode::eSystemParallel, ExecutionMode::eSystems } ) {
+			double checksum;
+			double ms = run_parallel_frames( mode, &checksum );
+			check( mode, num_workers, checksum );
+
+			logger.info( "%-24s %2u workers %12.2f (%.2fx)", execution_mode_name( mode ), num_workers, ms, serial_ms / ms );
+		}
+
+		le_jobs::terminate();
+	}
+
+	return passed;
+}
+
+// ----------------------------------------------------------------------
+// Snapshots: writing one million entities, and loading them again, compared with
+// building the same world entity by entity.
+//
+// Loading a corrupted snapshot must fail, and leave the ecs empty - so that a
+// valid snapshot may still be loaded into it.
+
+static std::string snapshot_temp_path( char const* name ) {
+	return ( std::filesystem::temp_directory_path() / name ).string();
+}
+
+static void build_snapshot_world( LeEcs& ecs, uint32_t num_entities ) {
+	for ( uint32_t i = 0; i != num_entities; i++ ) {
+		EntityId entity = ecs.entity()
+		                      .add_component( PositionComponent{ float( i ), 0, 0 } )
+		                      .add_component( VelocityComponent{ float( i & 7 ), 1, 0 } )
+		                      .build();
+		if ( i & 1 ) {
+			ecs.entity_add_component( entity, TagComponent{} );
+		}
+	}
+}
+
+static bool test_snapshot_benchmark() {
+
+	bool passed = true;
+
+	std::string path = snapshot_temp_path( "test_ecs_snapshot.bin" );
+
+	logger.info( "%u entities - ms", MANY_ENTITIES_COUNT );
+
+	double expected_sum;
+	{
+		LeEcs ecs;
+
+		auto t0 = bench_clock::now();
+		build_snapshot_world( ecs, MANY_ENTITIES_COUNT );
+		logger.info( "%-40s %10.1f", "build via entity_component_at", ms_since( t0 ) );
+
+		uint32_t count;
+		expected_sum = sum_positions( ecs, &count );
+
+		t0 = bench_clock::now();
+		if ( !ecs.write_snapshot( path.c_str() ) ) {
+			logger.error( "Could not write snapshot to '%s'", path.c_str() );
+			return false;
+		}
+		logger.info( "%-40s %10.1f", "write snapshot", ms_since( t0 ) );
+	}
+
+	{
+		LeEcs ecs;
+
+		auto t0 = bench_clock::now();
+		if ( !ecs.load_snapshot( path.c_str() ) ) {
+			logger.error( "Could not load snapshot from '%s'", path.c_str() );
+			return false;
+		}
+		logger.info( "%-40s %10.1f", "load snapshot", ms_since( t0 ) );
+
+		// The first pass over loaded components pays for the pages which it touches.
+
+		uint32_t count;
+		t0         = bench_clock::now();
+		double sum = sum_positions( ecs, &count );
+		logger.info( "%-40s %10.1f", "first read pass after load", ms_since( t0 ) );
+
+		if ( count != MANY_ENTITIES_COUNT || sum != expected_sum ) {
+			logger.error( "Expected %u entities with position sum %f after load, got %u, and %f", MANY_ENTITIES_COUNT, expected_sum, count, sum );
+			passed = false;
+		}
+	}
+
+	std::filesystem::remove( path );
+
+	return passed;
+}
+
+// ----------------------------------------------------------------------
+// Field offsets in the snapshot file - these mirror the layout documented in le_ecs.cpp.
+
+struct SnapshotLayout {
+	size_t   types;            // offset of first component type
+	size_t   archetypes;       // offset of first archetype
+	size_t   archetype_words;  // offset of first archetype word
+	size_t   entities;         // offset of first entity
+	uint32_t num_types;
+	uint32_t type_names_size;
+	uint32_t num_archetypes;
+	uint64_t num_chunks;
+};
+
+constexpr static size_t SNAPSHOT_HEADER_SIZE         = 56;
+constexpr static size_t SNAPSHOT_COMPONENT_TYPE_SIZE = 16;
+constexpr static size_t SNAPSHOT_ARCHETYPE_SIZE      = 24;
+constexpr static size_t SNAPSHOT_ENTITY_SIZE         = 12;
+
+template <typename T>
+static T snapshot_get( std::vector<char> const& file, size_t offset ) {
+	T value;
+	memcpy( &value, file.data() + offset, sizeof( T ) );
+	return value;
+}
+
+template <typename T>
+static void snapshot_set( std::vector<char>& file, size_t offset, T value ) {
+	memcpy( file.data() + offset, &value, sizeof( T ) );
+}
+
+static SnapshotLayout snapshot_get_layout( std::vector<char> const& file ) {
+	SnapshotLayout layout{};
+	layout.num_types       = snapshot_get<uint32_t>( file, 16 );
+	layout.type_names_size = snapshot_get<uint32_t>( file, 20 );
+	layout.num_archetypes  = snapshot_get<uint32_t>( file, 24 );
+	layout.num_chunks      = snapshot_get<uint64_t>( file, 40 );
+	layout.types           = SNAPSHOT_HEADER_SIZE;
+	layout.archetypes      = layout.types + SNAPSHOT_COMPONENT_TYPE_SIZE * layout.num_types + layout.type_names_size;
+	layout.archetype_words = layout.archetypes + SNAPSHOT_ARCHETYPE_SIZE * layout.num_archetypes;
+	layout.entities        = layout.archetype_words + sizeof( uint32_t ) * snapshot_get<uint32_t>( file, 28 );
+	return layout;
+}
+
+// Offset of the first archetype which holds entities, and of its first archetype word.
+static void snapshot_find_archetype( std::vector<char> const& file, SnapshotLayout const& layout, size_t* archetype, size_t* words ) {
+	*words = layout.archetype_words;
+	for ( uint32_t a = 0; a != layout.num_archetypes; a++ ) {
+		*archetype              = layout.archetypes + SNAPSHOT_ARCHETYPE_SIZE * a;
+		uint32_t num_components = snapshot_get<uint32_t>( file, *archetype );
+		if ( snapshot_get<uint32_t>( file, *archetype + 12 ) ) {
+			return;
+		}
+		*words += sizeof( uint32_t ) * ( num_components + snapshot_get<uint32_t>( file, *archetype + 4 ) );
+	}
+}
+
+struct snapshot_corruption_t {
+	char const* name;
+	std::function<void( std::vector<char>& file, SnapshotLayout const& layout )> apply;
+};
+
+static bool test_snapshot_validation() {
+
+	bool passed = true;
+
+	std::string path           = snapshot_temp_path( "test_ecs_snapshot_valid.bin" );
+	std::string corrupted_path = snapshot_temp_path( "test_ecs_snapshot_corrupted.bin" );
+
+	{
+		LeEcs ecs;
+		build_snapshot_world( ecs, 100 );
+		ecs.remove_entity( ecs.entity().add_component( PositionComponent{} ).build() ); // so that there is a free entity slot
+		if ( !ecs.write_snapshot( path.c_str() ) ) {
+			logger.error( "Could not write snapshot to '%s'", path.c_str() );
+			return false;
+		}
+	}
+
+	std::vector<char> valid_file;
+	{
+		std::ifstream f( path, std::ios::binary );
+		valid_file.assign( std::istreambuf_iterator<char>( f ), std::istreambuf_iterator<char>() );
+	}
+
+	static snapshot_corruption_t const corruptions[] = {
+	    { "truncated", []( std::vector<char>& file, SnapshotLayout const& ) { file.resize( file.size() - 100 ); } },
+	    { "num_chunks * chunk size wraps around", []( std::vector<char>& file, SnapshotLayout const& ) { snapshot_set<uint64_t>( file, 40, 1ull << 50 ); } },
+	    { "chunks_offset beyond end of file", []( std::vector<char>& file, SnapshotLayout const& ) { snapshot_set<uint64_t>( file, 48, ~uint64_t( 16 * 1024 - 1 ) ); } },
+	    { "sections overlap chunks", []( std::vector<char>& file, SnapshotLayout const& ) { snapshot_set<uint32_t>( file, 32, 0x10000000 ); } },
+	    { "type name offset", []( std::vector<char>& file, SnapshotLayout const& layout ) {
+		     snapshot_set<uint32_t>( file, layout.types + 12, layout.type_names_size );
+	     } },
+	    { "component type index", []( std::vector<char>& file, SnapshotLayout const& layout ) {
+		     size_t archetype, words;
+		     snapshot_find_archetype( file, layout, &archetype, &words );
+		     snapshot_set<uint32_t>( file, words, layout.num_types );
+	     } },
+	    { "archetype words", []( std::vector<char>& file, SnapshotLayout const& layout ) {
+		     size_t archetype, words;
+		     snapshot_find_archetype( file, layout, &archetype, &words );
+		     snapshot_set<uint32_t>( file, archetype, 0xfffffff0 );
+	     } },
+	    { "column offset", []( std::vector<char>& file, SnapshotLayout const& layout ) {
+		     size_t archetype, words;
+		     snapshot_find_archetype( file, layout, &archetype, &words );
+		     uint32_t num_components = snapshot_get<uint32_t>( file, archetype );
+		     snapshot_set<uint32_t>( file, words + sizeof( uint32_t ) * num_components, 16 * 1024 - 4 );
+	     } },
+	    { "first chunk", []( std::vector<char>& file, SnapshotLayout const& layout ) {
+		     size_t archetype, words;
+		     snapshot_find_archetype( file, layout, &archetype, &words );
+		     snapshot_set<uint32_t>( file, archetype + 20, uint32_t( layout.num_chunks ) );
+	     } },
+	    { "archetype entity count", []( std::vector<char>& file, SnapshotLayout const& layout ) {
+		     size_t archetype, words;
+		     snapshot_find_archetype( file, layout, &archetype, &words );
+		     snapshot_set<uint32_t>( file, archetype + 12, 0x10000000 );
+	     } },
+	    { "entity archetype", []( std::vector<char>& file, SnapshotLayout const& layout ) {
+		     snapshot_set<uint32_t>( file, layout.entities + 4, layout.num_archetypes );
+	     } },
+	    { "entity row", []( std::vector<char>& file, SnapshotLayout const& layout ) {
+		     snapshot_set<uint32_t>( file, layout.entities + 8, 1000 );
+	     } },
+	};
+
+	LeEcs ecs;
+
+	for ( auto const& corruption : corruptions ) {
+
+		std::vector<char> file = valid_file;
+		corruption.apply( file, snapshot_get_layout( file ) );
+
+		{
+			std::ofstream f( corrupted_path, std::ios::binary );
+			f.write( file.data(), std::streamsize( file.size() ) );
+		}
+
+		if ( ecs.load_snapshot( corrupted_path.c_str() ) ) {
+			logger.error( "Loaded snapshot with corrupted %s", corruption.name );
+			passed = false;
+			break; // ecs is no longer empty
+		}
+	}
+
+	if ( passed ) {
+		uint32_t count = 0;
+		if ( !ecs.load_snapshot( path.c_str() ) ) {
+			logger.error( "Could not load valid snapshot after failed loads" );
+			passed = false;
+		} else if ( sum_positions( ecs, &count ), count != 100 ) {
+			logger.error( "Expected 100 entities after load, got %u", count );
+			passed = false;
+		}
+	}
+
+	std::filesystem::remove( path );
+	std::filesystem::remove( corrupted_path );
+
+	return passed;
+}
+
+// ----------------------------------------------------------------------
+
+struct test_t {
+	char const* name;
+	bool ( *fn )();
+};
+
+static test_t const tests[] = {
+    { "one million entities", test_many_entities },
+    { "query lifetime", test_query_lifetime },
+    { "parallel systems", test_parallel_systems },
+    { "snapshot benchmark", test_snapshot_benchmark },
+    { "snapshot validation", test_snapshot_validation },
+};
+
+// ----------------------------------------------------------------------
+
+static void app_initialize(){};
+
+// ----------------------------------------------------------------------
+
+static void app_terminate(){};
+
+// ----------------------------------------------------------------------
+
+static test_ecs_app_o* test_ecs_app_create() {
+	auto app = new ( test_ecs_app_o );
+	return app;
+}
+
+// ----------------------------------------------------------------------
+
+static bool test_ecs_app_update( test_ecs_app_o* self ) {
+
+	if ( self->current_test == std::size( tests ) ) {
+		if ( self->num_failures ) {
+			logger.error( "%u of %zu tests failed.", self->num_failures, std::size( tests ) );
+		} else {
+			logger.info( "All %zu tests passed.", std::size( tests ) );
+		}
+		return false;
+	}
+
+	test_t const& test = tests[ self->current_test++ ];
+
+	logger.info( "Running: %s", test.name );
+
+	if ( test.fn() ) {
+		logger.info( "Passed: %s", test.name );
+	} else {
+		logger.error( "FAILED: %s", test.name );
+		self->num_failures++;
+	}
+
+	return true; // keep app alive
+}
+
+// ----------------------------------------------------------------------
+
+static uint32_t test_ecs_app_get_num_failures( test_ecs_app_o* self ) {
+	return self->num_failures;
+}
+
+// ----------------------------------------------------------------------
+
+static void test_ecs_app_destroy( test_ecs_app_o* self ) {
+	delete ( self );
+}
+
+// ----------------------------------------------------------------------
+
+LE_MODULE_REGISTER_IMPL( test_ecs_app, api ) {
+
+	auto  test_ecs_app_api_i = static_cast<test_ecs_app_api*>( api );
+	auto& test_ecs_app_i     = test_ecs_app_api_i->test_ecs_app_i;
+
+	test_ecs_app_i.initialize = app_initialize;
+	test_ecs_app_i.terminate  = app_terminate;
+
+	test_ecs_app_i.create           = test_ecs_app_create;
+	test_ecs_app_i.destroy          = test_ecs_app_destroy;
+	test_ecs_app_i.update           = test_ecs_app_update;
+	test_ecs_app_i.get_num_failures = test_ecs_app_get_num_failures;
+}
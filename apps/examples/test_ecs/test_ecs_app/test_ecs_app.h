@@ -0,0 +1,68 @@
+#ifndef GUARD_test_ecs_app_H
+#define GUARD_test_ecs_app_H
+#endif
+
+#include "le_core.h"
+
+// Runs checks, and benchmarks for le_ecs - one test per call to update.
+// Results are logged, update returns false once all tests have run.
+
+struct test_ecs_app_o;
+
+// clang-format off
+struct test_ecs_app_api {
+
+	struct test_ecs_app_interface_t {
+		test_ecs_app_o * ( *create               )();
+		void         ( *destroy                  )( test_ecs_app_o *self );
+		bool         ( *update                   )( test_ecs_app_o *self );
+		uint32_t     ( *get_num_failures         )( test_ecs_app_o *self );
+		void         ( *initialize               )(); // static methods
+		void         ( *terminate                )(); // static methods
+	};
+
+	test_ecs_app_interface_t test_ecs_app_i;
+};
+// clang-format on
+
+LE_MODULE( test_ecs_app );
+LE_MODULE_LOAD_DEFAULT( test_ecs_app );
+
+#ifdef __cplusplus
+
+namespace test_ecs_app {
+static const auto& api             = test_ecs_app_api_i;
+static const auto& test_ecs_app_i = api -> test_ecs_app_i;
+} // namespace test_ecs_app
+
+class TestEcsApp : NoCopy, NoMove {
+
+	test_ecs_app_o* self;
+
+  public:
+	TestEcsApp()
+	    : self( test_ecs_app::test_ecs_app_i.create() ) {
+	}
+
+	bool update() {
+		return test_ecs_app::test_ecs_app_i.update( self );
+	}
+
+	uint32_t getNumFailures() {
+		return test_ecs_app::test_ecs_app_i.get_num_failures( self );
+	}
+
+	~TestEcsApp() {
+		test_ecs_app::test_ecs_app_i.destroy( self );
+	}
+
+	static void initialize() {
+		test_ecs_app::test_ecs_app_i.initialize();
+	}
+
+	static void terminate() {
+		test_ecs_app::test_ecs_app_i.terminate();
+	}
+};
+
+#endif
@@ -0,0 +1,37 @@
+#include "test_jobs_app/test_jobs_app.h"
+
+// ----------------------------------------------------------------------
+
+int main( int argc, char const* argv[] ) {
+
+	TestJobsApp::initialize();
+
+	uint32_t num_failures = 0;
+
+	{
+		// We instantiate TestJobsApp in its own scope - so that
+		// it will be destroyed before TestJobsApp::terminate
+		// is called.
+
+		TestJobsApp testJobsApp{};
+
+		for ( ;; ) {
+
+#ifdef PLUGINS_DYNAMIC
+			le_core_poll_for_module_reloads();
+#endif
+			auto result = testJobsApp.update();
+
+			if ( !result ) {
+				break;
+			}
+		}
+
+		num_failures = testJobsApp.getNumFailures();
+	}
+
+	// Must only be called once last TestJobsApp is destroyed
+	TestJobsApp::terminate();
+
+	return num_failures ? 1 : 0;
+}
@@ -0,0 +1,573 @@
+#include "test_jobs_app.h"
+#include "le_log.h"
+#include "le_jobs.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iterator> // for std::size
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#	include <sys/resource.h> // for getrusage
+#endif
+
+struct test_jobs_app_o {
+	size_t   current_test = 0; // index of next test to run
+	uint32_t num_failures = 0;
+};
+
+typedef test_jobs_app_o app_o;
+
+static auto logger = LeLog( "test_jobs" );
+
+using bench_clock = std::chrono::steady_clock;
+
+// ----------------------------------------------------------------------
+
+static double seconds_since( bench_clock::time_point t0 ) {
+	return std::chrono::duration<double>( bench_clock::now() - t0 ).count();
+}
+
+// ----------------------------------------------------------------------
+// Benchmarks run for 1, 2, 4, ... worker threads, up to the number of hardware
+// threads - but always for at least two workers, so that workers may steal.
+static std::vector<uint32_t> get_worker_counts() {
+	uint32_t const max_workers = std::max( 2u, std::thread::hardware_concurrency() );
+
+	std::vector<uint32_t> counts;
+	for ( uint32_t n = 1; n <= max_workers; n *= 2 ) {
+		counts.push_back( n );
+	}
+	return counts;
+}
+
+// ----------------------------------------------------------------------
+
+static void jobs_initialize( uint32_t num_workers ) {
+	le_jobs_settings_t settings{};
+	settings.worker_thread_count = num_workers;
+	le_jobs::initialize( &settings );
+}
+
+// ----------------------------------------------------------------------
+// Fan-out/fan-in: issue a batch of tiny jobs, wait for all of them, repeat.
+//
+// Batches are issued either from the main thread - these jobs go through the
+// global job queue - or from inside a job - these jobs go onto the issuing
+// worker's deque, from where idle workers steal them.
+
+constexpr static uint32_t FAN_OUT_BATCH_SIZE  = 512; // must fit into a worker's deque
+constexpr static uint32_t FAN_OUT_NUM_BATCHES = 400;
+
+static void tiny_job( void* param ) {
+	++*static_cast<uint32_t*>( param );
+}
+
+static void fan_out( uint32_t* slots ) {
+
+	le_jobs::job_t jobs[ FAN_OUT_BATCH_SIZE ];
+
+	for ( uint32_t i = 0; i != FAN_OUT_BATCH_SIZE; i++ ) {
+		jobs[ i ] = { tiny_job, slots + i };
+	}
+
+	for ( uint32_t i = 0; i != FAN_OUT_NUM_BATCHES; i++ ) {
+		le_jobs::counter_t* counter;
+		le_jobs::run_jobs( jobs, FAN_OUT_BATCH_SIZE, &counter );
+		le_jobs::wait_for_counter_and_free( counter, 0 );
+	}
+}
+
+static void fan_out_job( void* param ) {
+	fan_out( static_cast<uint32_t*>( param ) );
+}
+
+static bool test_fan_out_fan_in() {
+
+	bool passed = true;
+
+	logger.info( "Fan-out/fan-in, batches of %u tiny jobs - million jobs/s, best of 3", FAN_OUT_BATCH_SIZE );
+	logger.info( "%8s %14s %14s", "workers", "global queue", "worker deque" );
+
+	for ( uint32_t num_workers : get_worker_counts() ) {
+
+		jobs_initialize( num_workers );
+
+		double rate[ 2 ] = {}; // [0]: issued from main thread, [1]: issued from inside a job
+
+		for ( int from_job = 0; from_job != 2; from_job++ ) {
+			for ( int repeat = 0; repeat != 3; repeat++ ) {
+
+				std::vector<uint32_t> slots( FAN_OUT_BATCH_SIZE, 0 );
+
+				auto t0 = bench_clock::now();
+
+				if ( from_job ) {
+					le_jobs::job_t      job{ fan_out_job, slots.data() };
+					le_jobs::counter_t* counter;
+					le_jobs::run_jobs( &job, 1, &counter );
+					le_jobs::wait_for_counter_and_free( counter, 0 );
+				} else {
+					fan_out( slots.data() );
+				}
+
+				double seconds = seconds_since( t0 );
+
+				rate[ from_job ] = std::max( rate[ from_job ], FAN_OUT_BATCH_SIZE * FAN_OUT_NUM_BATCHES / seconds / 1e6 );
+
+				for ( auto s : slots ) {
+					// Each job must have run exactly once per batch.
+					passed &= ( s == FAN_OUT_NUM_BATCHES );
+				}
+			}
+		}
+
+		le_jobs::terminate();
+
+		logger.info( "%8u %14.2f %14.2f", num_workers, rate[ 0 ], rate[ 1 ] );
+	}
+
+	return passed;
+}
+
+// ----------------------------------------------------------------------
+// Parking: idle workers must not burn cpu time, and must wake up quickly once
+// there is work for them.
+//
+// We measure process cpu time while the main thread sleeps, and the time from
+// issuing a job until the job starts running - both with workers parked, and
+// with workers busy with a stream of other jobs.
+
+constexpr static uint32_t WAKE_UP_NUM_SAMPLES = 1000;
+
+// Returns cpu time which this process has used so far, in seconds, or a negative
+// number if we can't tell.
+static double get_process_cpu_seconds() {
+#ifndef _WIN32
+	rusage usage{};
+	getrusage( RUSAGE_SELF, &usage );
+	return double( usage.ru_utime.tv_sec + usage.ru_stime.tv_sec ) +
+	       double( usage.ru_utime.tv_usec + usage.ru_stime.tv_usec ) * 1e-6;
+#else
+	return -1;
+#endif
+}
+
+static void record_start_time_job( void* param ) {
+	*static_cast<bench_clock::time_point*>( param ) = bench_clock::now();
+}
+
+// Returns median, and 99th percentile of wake-up latency in microseconds.
+static void measure_wake_up_latency( bool parked, double* median, double* p99 ) {
+
+	std::vector<double> latencies( WAKE_UP_NUM_SAMPLES );
+
+	for ( auto& latency : latencies ) {
+
+		if ( parked ) {
+			// Give workers enough time to give up spinning, and park.
+			std::this_thread::sleep_for( std::chrono::milliseconds( 2 ) );
+		} else {
+			// Keep workers busy with jobs which they have to pick up right before ours.
+			le_jobs::job_t      busy_jobs[ 64 ];
+			uint32_t            busy_slots[ 64 ]{};
+			le_jobs::counter_t* busy_counter;
+			for ( uint32_t i = 0; i != 64; i++ ) {
+				busy_jobs[ i ] = { tiny_job, busy_slots + i };
+			}
+			le_jobs::run_jobs( busy_jobs, 64, &busy_counter );
+			le_jobs::wait_for_counter_and_free( busy_counter, 0 );
+		}
+
+		bench_clock::time_point t_start;
+		le_jobs::job_t          job{ record_start_time_job, &t_start };
+		le_jobs::counter_t*     counter;
+
+		auto t0 = bench_clock::now();
+		le_jobs::run_jobs( &job, 1, &counter );
+		le_jobs::wait_for_counter_and_free( counter, 0 );
+
+		latency = std::chrono::duration<double, std::micro>( t_start - t0 ).count();
+	}
+
+	std::sort( latencies.begin(), latencies.end() );
+	*median = latencies[ latencies.size() / 2 ];
+	*p99    = latencies[ latencies.size() * 99 / 100 ];
+}
+
+static bool test_parking() {
+
+	bool passed = true;
+
+	logger.info( "Parking - cpu use while idle, and job wake-up latency in microseconds" );
+	logger.info( "%8s %10s %14s %14s %14s %14s", "workers", "idle cpu", "parked median", "parked p99", "busy median", "busy p99" );
+
+	for ( uint32_t num_workers : get_worker_counts() ) {
+
+		jobs_initialize( num_workers );
+
+		// Let workers find that there is nothing to do, and park.
+		std::this_thread::sleep_for( std::chrono::milliseconds( 50 ) );
+
+		double cpu_t0  = get_process_cpu_seconds();
+		auto   wall_t0 = bench_clock::now();
+
+		std::this_thread::sleep_for( std::chrono::milliseconds( 500 ) );
+
+		double idle_cpu = ( get_process_cpu_seconds() - cpu_t0 ) / seconds_since( wall_t0 );
+
+		double latency[ 4 ];
+		measure_wake_up_latency( true, &latency[ 0 ], &latency[ 1 ] );
+		measure_wake_up_latency( false, &latency[ 2 ], &latency[ 3 ] );
+
+		le_jobs::terminate();
+
+		if ( cpu_t0 < 0 ) {
+			logger.info( "%8u %10s %14.1f %14.1f %14.1f %14.1f", num_workers, "n/a", latency[ 0 ], latency[ 1 ], latency[ 2 ], latency[ 3 ] );
+		} else {
+			logger.info( "%8u %9.2f%% %14.1f %14.1f %14.1f %14.1f", num_workers, idle_cpu * 100, latency[ 0 ], latency[ 1 ], latency[ 2 ], latency[ 3 ] );
+
+			// Parked workers should use next to no cpu time - we allow for 5% of one
+			// core, as the main thread and the operating system also use some.
+			if ( idle_cpu > 0.05 ) {
+				logger.error( "Idle workers used %.2f%% cpu", idle_cpu * 100 );
+				passed = false;
+			}
+		}
+	}
+
+	return passed;
+}
+
+// ----------------------------------------------------------------------
+// Submit 100k tiny jobs with a single call to run_jobs, and wait for them.
+//
+// This measures per-job overhead in the job system: taking a job slot,
+// queueing it, and handing it to a fiber.
+
+constexpr static uint32_t MANY_JOBS_COUNT = 100000;
+
+static bool test_many_tiny_jobs() {
+
+	bool passed = true;
+
+	logger.info( "%u tiny jobs via one call to run_jobs - ms, and ns per job, best of 5", MANY_JOBS_COUNT );
+	logger.info( "%8s %10s %10s", "workers", "ms", "ns/job" );
+
+	std::vector<le_jobs::job_t> jobs( MANY_JOBS_COUNT );
+	std::vector<uint32_t>       slots( MANY_JOBS_COUNT );
+
+	for ( uint32_t i = 0; i != MANY_JOBS_COUNT; i++ ) {
+		jobs[ i ] = { tiny_job, &slots[ i ] };
+	}
+
+	for ( uint32_t num_workers : get_worker_counts() ) {
+
+		jobs_initialize( num_workers );
+
+		double best_seconds = 1e9;
+
+		for ( int repeat = 0; repeat != 5; repeat++ ) {
+
+			std::fill( slots.begin(), slots.end(), 0 );
+
+			auto t0 = bench_clock::now();
+
+			le_jobs::counter_t* counter;
+			le_jobs::run_jobs( jobs.data(), MANY_JOBS_COUNT, &counter );
+			le_jobs::wait_for_counter_and_free( counter, 0 );
+
+			best_seconds = std::min( best_seconds, seconds_since( t0 ) );
+
+			for ( auto s : slots ) {
+				passed &= ( s == 1 );
+			}
+		}
+
+		le_jobs::terminate();
+
+		logger.info( "%8u %10.2f %10.1f", num_workers, best_seconds * 1e3, best_seconds * 1e9 / MANY_JOBS_COUNT );
+	}
+
+	return passed;
+}
+
+// ----------------------------------------------------------------------
+// Priorities: frame-critical jobs must not be starved by background jobs, and
+// the first worker must never run background jobs.
+//
+// We saturate the pool with long-running background jobs, and meanwhile measure
+// how long frame-critical jobs take to start. Background jobs sleep, rather than
+// spin, so that they occupy their worker, but not the cpu.
+
+constexpr static uint32_t BACKGROUND_JOB_MS      = 20;  // how long each background job keeps its worker busy
+constexpr static uint32_t PRIORITY_NUM_SAMPLES   = 100; //
+constexpr static double   MAX_FRAME_JOB_DELAY_MS = 10;  // must be well below BACKGROUND_JOB_MS
+
+struct background_jobs_state_t {
+	std::atomic<uint32_t> num_complete{ 0 };
+	std::atomic<uint32_t> num_on_worker_0{ 0 }; // must stay at 0
+};
+
+static void background_job( void* param ) {
+	auto state = static_cast<background_jobs_state_t*>( param );
+	if ( 0 == le_jobs::get_current_worker_id() ) {
+		++state->num_on_worker_0;
+	}
+	std::this_thread::sleep_for( std::chrono::milliseconds( BACKGROUND_JOB_MS ) );
+	++state->num_complete;
+}
+
+static bool test_priorities() {
+
+	bool passed = true;
+
+	logger.info( "Frame-critical job start latency while background jobs saturate the pool - microseconds" );
+	logger.info( "%8s %10s %10s %10s %22s", "workers", "median", "p99", "max", "background on worker 0" );
+
+	for ( uint32_t num_workers : get_worker_counts() ) {
+
+		if ( num_workers < 2 ) {
+			// With only one worker there is no low-latency lane.
+			continue;
+		}
+
+		jobs_initialize( num_workers );
+
+		// Issue enough background jobs to keep all workers which may run them
+		// busy for longer than it takes us to take our samples.
+		uint32_t const num_background_jobs = num_workers * 10;
+
+		background_jobs_state_t     background_state;
+		std::vector<le_jobs::job_t> background_jobs( num_background_jobs );
+		for ( auto& job : background_jobs ) {
+			job = { background_job, &background_state, nullptr, le_jobs::Priority::eBackground };
+		}
+
+		le_jobs::counter_t* background_counter;
+		le_jobs::run_jobs( background_jobs.data(), num_background_jobs, &background_counter );
+
+		std::vector<double> latencies( PRIORITY_NUM_SAMPLES );
+
+		for ( auto& latency : latencies ) {
+
+			std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+
+			bench_clock::time_point t_start;
+			le_jobs::job_t          job{ record_start_time_job, &t_start, nullptr, le_jobs::Priority::eFrameCritical };
+			le_jobs::counter_t*     counter;
+
+			auto t0 = bench_clock::now();
+			le_jobs::run_jobs( &job, 1, &counter );
+			le_jobs::wait_for_counter_and_free( counter, 0 );
+
+			latency = std::chrono::duration<double, std::micro>( t_start - t0 ).count();
+		}
+
+		bool const was_saturated = background_state.num_complete < num_background_jobs;
+
+		le_jobs::wait_for_counter_and_free( background_counter, 0 );
+		le_jobs::terminate();
+
+		std::sort( latencies.begin(), latencies.end() );
+
+		double const max_latency = latencies.back();
+
+		logger.info( "%8u %10.1f %10.1f %10.1f %22u", num_workers,
+		             latencies[ latencies.size() / 2 ], latencies[ latencies.size() * 99 / 100 ], max_latency,
+		             background_state.num_on_worker_0.load() );
+
+		if ( !was_saturated ) {
+			logger.warn( "Background jobs completed before all samples were taken - latencies may be too optimistic." );
+		}
+
+		if ( background_state.num_on_worker_0 ) {
+			logger.error( "Worker 0 ran %u background jobs", background_state.num_on_worker_0.load() );
+			passed = false;
+		}
+
+		if ( max_latency > MAX_FRAME_JOB_DELAY_MS * 1000 ) {
+			logger.error( "Frame-critical job waited %.1f ms for a worker", max_latency / 1000 );
+			passed = false;
+		}
+	}
+
+	return passed;
+}
+
+// ----------------------------------------------------------------------
+// Current worker lookup: command buffer encoders find their allocator by
+// calling get_current_worker_id for each allocation. This must not get slower
+// as the number of workers grows.
+//
+// We mimic the encoder's allocation path: look up the current worker's linear
+// allocator, and bump its offset. Worker counts go beyond the number of cpus on
+// purpose - the cost of the lookup must depend on neither.
+//
+// A lookup may be cheaper for some workers than for others (a linear search
+// finds the first worker first) - which is why we report the slowest worker.
+
+constexpr static uint32_t LOOKUP_NUM_ALLOCATIONS = 100000;
+constexpr static uint32_t LOOKUP_WORKER_COUNTS[] = { 1, 4, 16, 64 };
+
+struct alignas( 64 ) linear_allocator_t {
+	uint64_t offset = 0;
+};
+
+struct lookup_job_params_t {
+	linear_allocator_t* allocators;        // one per worker
+	int32_t             worker_id;         // set by job
+	double              ns_per_allocation; // set by job
+};
+
+static void lookup_job( void* param ) {
+	auto p  = static_cast<lookup_job_params_t*>( param );
+	auto t0 = bench_clock::now();
+	for ( uint32_t i = 0; i != LOOKUP_NUM_ALLOCATIONS; i++ ) {
+		p->allocators[ le_jobs::get_current_worker_id() ].offset += 16;
+	}
+	p->ns_per_allocation = std::chrono::duration<double, std::nano>( bench_clock::now() - t0 ).count() / LOOKUP_NUM_ALLOCATIONS;
+	p->worker_id         = le_jobs::get_current_worker_id();
+}
+
+static bool test_worker_lookup() {
+
+	bool passed = true;
+
+	logger.info( "Per-worker allocation via get_current_worker_id - ns per allocation, best job of the slowest worker" );
+	logger.info( "%8s %10s %16s", "workers", "ns", "slowest worker" );
+
+	for ( uint32_t num_workers : LOOKUP_WORKER_COUNTS ) {
+
+		jobs_initialize( num_workers );
+
+		uint32_t const                   num_jobs = num_workers * 8;
+		std::vector<linear_allocator_t>  allocators( num_workers );
+		std::vector<lookup_job_params_t> params( num_jobs, { allocators.data(), -1, 0 } );
+		std::vector<le_jobs::job_t>      jobs( num_jobs );
+
+		for ( uint32_t i = 0; i != num_jobs; i++ ) {
+			jobs[ i ] = { lookup_job, &params[ i ] };
+		}
+
+		le_jobs::counter_t* counter;
+		le_jobs::run_jobs( jobs.data(), num_jobs, &counter );
+		le_jobs::wait_for_counter_and_free( counter, 0 );
+
+		le_jobs::terminate();
+
+		// Best time per worker - so that we don't measure jobs which got preempted.
+		std::vector<double> best_ns( num_workers, 0 );
+
+		for ( auto const& p : params ) {
+			if ( p.worker_id < 0 || uint32_t( p.worker_id ) >= num_workers ) {
+				passed = false;
+				continue;
+			}
+			double& best = best_ns[ p.worker_id ];
+			best         = ( best == 0 ) ? p.ns_per_allocation : std::min( best, p.ns_per_allocation );
+		}
+
+		uint64_t total_offset = 0;
+
+		for ( auto const& a : allocators ) {
+			total_offset += a.offset;
+		}
+
+		// Each allocation must have gone to a valid allocator.
+		passed &= ( total_offset == uint64_t( num_jobs ) * LOOKUP_NUM_ALLOCATIONS * 16 );
+
+		auto slowest = std::max_element( best_ns.begin(), best_ns.end() );
+
+		logger.info( "%8u %10.2f %16zu", num_workers, *slowest, size_t( slowest - best_ns.begin() ) );
+	}
+
+	return passed;
+}
+
+// ----------------------------------------------------------------------
+
+struct test_t {
+	char const* name;
+	bool ( *fn )();
+};
+
+static test_t const tests[] = {
+    { "fan-out/fan-in throughput", test_fan_out_fan_in },
+    { "parking", test_parking },
+    { "100k tiny jobs", test_many_tiny_jobs },
+    { "priorities", test_priorities },
+    { "current worker lookup", test_worker_lookup },
+};
+
+// ----------------------------------------------------------------------
+
+static void app_initialize(){};
+
+// ----------------------------------------------------------------------
+
+static void app_terminate(){};
+
+// ----------------------------------------------------------------------
+
+static test_jobs_app_o* test_jobs_app_create() {
+	auto app = new ( test_jobs_app_o );
+	return app;
+}
+
+// ----------------------------------------------------------------------
+
+static bool test_jobs_app_update( test_jobs_app_o* self ) {
+
+	if ( self->current_test == std::size( tests ) ) {
+		if ( self->num_failures ) {
+			logger.error( "%u of %zu tests failed.", self->num_failures, std::size( tests ) );
+		} else {
+			logger.info( "All %zu tests passed.", std::size( tests ) );
+		}
+		return false;
+	}
+
+	test_t const& test = tests[ self->current_test++ ];
+
+	logger.info( "Running: %s", test.name );
+
+	if ( test.fn() ) {
+		logger.info( "Passed: %s", test.name );
+	} else {
+		logger.error( "FAILED: %s", test.name );
+		self->num_failures++;
+	}
+
+	return true; // keep app alive
+}
+
+// ----------------------------------------------------------------------
+
+static uint32_t test_jobs_app_get_num_failures( test_jobs_app_o* self ) {
+	return self->num_failures;
+}
+
+// ----------------------------------------------------------------------
+
+static void test_jobs_app_destroy( test_jobs_app_o* self ) {
+	delete ( self );
+}
+
+// ----------------------------------------------------------------------
+
+LE_MODULE_REGISTER_IMPL( test_jobs_app, api ) {
+
+	auto  test_jobs_app_api_i = static_cast<test_jobs_app_api*>( api );
+	auto& test_jobs_app_i     = test_jobs_app_api_i->test_jobs_app_i;
+
+	test_jobs_app_i.initialize = app_initialize;
+	test_jobs_app_i.terminate  = app_terminate;
+
+	test_jobs_app_i.create           = test_jobs_app_create;
+	test_jobs_app_i.destroy          = test_jobs_app_destroy;
+	test_jobs_app_i.update           = test_jobs_app_update;
+	test_jobs_app_i.get_num_failures = test_jobs_app_get_num_failures;
+}
@@ -0,0 +1,68 @@
+#ifndef GUARD_test_jobs_app_H
+#define GUARD_test_jobs_app_H
+#endif
+
+#include "le_core.h"
+
+// Runs checks, and benchmarks for le_jobs - one test per call to update.
+// Results are logged, update returns false once all tests have run.
+
+struct test_jobs_app_o;
+
+// clang-format off
+struct test_jobs_app_api {
+
+	struct test_jobs_app_interface_t {
+		test_jobs_app_o * ( *create               )();
+		void         ( *destroy                  )( test_jobs_app_o *self );
+		bool         ( *update                   )( test_jobs_app_o *self );
+		uint32_t     ( *get_num_failures         )( test_jobs_app_o *self );
+		void         ( *initialize               )(); // static methods
+		void         ( *terminate                )(); // static methods
+	};
+
+	test_jobs_app_interface_t test_jobs_app_i;
+};
+// clang-format on
+
+LE_MODULE( test_jobs_app );
+LE_MODULE_LOAD_DEFAULT( test_jobs_app );
+
+#ifdef __cplusplus
+
+namespace test_jobs_app {
+static const auto& api             = test_jobs_app_api_i;
+static const auto& test_jobs_app_i = api -> test_jobs_app_i;
+} // namespace test_jobs_app
+
+class TestJobsApp : NoCopy, NoMove {
+
+	test_jobs_app_o* self;
+
+  public:
+	TestJobsApp()
+	    : self( test_jobs_app::test_jobs_app_i.create() ) {
+	}
+
+	bool update() {
+		return test_jobs_app::test_jobs_app_i.update( self );
+	}
+
+	uint32_t getNumFailures() {
+		return test_jobs_app::test_jobs_app_i.get_num_failures( self );
+	}
+
+	~TestJobsApp() {
+		test_jobs_app::test_jobs_app_i.destroy( self );
+	}
+
+	static void initialize() {
+		test_jobs_app::test_jobs_app_i.initialize();
+	}
+
+	static void terminate() {
+		test_jobs_app::test_jobs_app_i.terminate();
+	}
+};
+
+#endif
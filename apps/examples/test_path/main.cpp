@@ -0,0 +1,37 @@
+#include "test_path_app/test_path_app.h"
+
+// ----------------------------------------------------------------------
+
+int main( int argc, char const* argv[] ) {
+
+	TestPathApp::initialize();
+
+	uint32_t num_failures = 0;
+
+	{
+		// We instantiate TestPathApp in its own scope - so that
+		// it will be destroyed before TestPathApp::terminate
+		// is called.
+
+		TestPathApp testPathApp{};
+
+		for ( ;; ) {
+
+#ifdef PLUGINS_DYNAMIC
+			le_core_poll_for_module_reloads();
+#endif
+			auto result = testPathApp.update();
+
+			if ( !result ) {
+				break;
+			}
+		}
+
+		num_failures = testPathApp.getNumFailures();
+	}
+
+	// Must only be called once last TestPathApp is destroyed
+	TestPathApp::terminate();
+
+	return num_failures ? 1 : 0;
+}
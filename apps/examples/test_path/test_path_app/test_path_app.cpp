@@ -0,0 +1,1338 @@
+#include "test_path_app.h"
+#include "le_log.h"
+#include "le_path.h"
+#include "le_jobs.h"
+#include "glm/glm.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator> // for std::size
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct test_path_app_o {
+	size_t   current_test = 0; // index of next test to run
+	uint32_t num_failures = 0;
+};
+
+typedef test_path_app_o app_o;
+
+static auto logger = LeLog( "test_path" );
+
+using bench_clock = std::chrono::steady_clock;
+
+// ----------------------------------------------------------------------
+// Counts calls to global operator new, so that we can check that le_path does not
+// allocate in steady state. This replaces operator new for the whole executable,
+// which only works if modules are linked statically - with dynamic plugins, each
+// module has its own view of operator new, and we don't count allocations.
+
+#ifndef PLUGINS_DYNAMIC
+static std::atomic<uint64_t> num_allocations{ 0 };
+
+void* operator new( size_t size ) {
+	num_allocations.fetch_add( 1, std::memory_order_relaxed );
+	if ( void* p = malloc( size ? size : 1 ) ) {
+		return p;
+	}
+	throw std::bad_alloc();
+}
+
+void* operator new( size_t size, std::align_val_t alignment ) {
+	num_allocations.fetch_add( 1, std::memory_order_relaxed );
+	size_t a = size_t( alignment );
+	if ( void* p = aligned_alloc( a, ( size + a - 1 ) / a * a ) ) {
+		return p;
+	}
+	throw std::bad_alloc();
+}
+
+void operator delete( void* p ) noexcept {
+	free( p );
+}
+
+void operator delete( void* p, size_t ) noexcept {
+	free( p );
+}
+
+void operator delete( void* p, std::align_val_t ) noexcept {
+	free( p );
+}
+
+void operator delete( void* p, size_t, std::align_val_t ) noexcept {
+	free( p );
+}
+#endif
+
+// ----------------------------------------------------------------------
+
+static double ms_since( bench_clock::time_point t0 ) {
+	return std::chrono::duration<double, std::milli>( bench_clock::now() - t0 ).count();
+}
+
+// ----------------------------------------------------------------------
+// Deterministic pseudo-random numbers, so that benchmarks see the same paths on each run.
+
+struct random_t {
+	uint32_t state = 12345;
+
+	float operator()( float lo, float hi ) {
+		state = state * 1664525u + 1013904223u;
+		return lo + ( hi - lo ) * float( state >> 8 ) / float( 1 << 24 );
+	}
+};
+
+// ----------------------------------------------------------------------
+// Name of the flattener which le_path uses - this mirrors the selection in le_path.cpp,
+// which sees the same compile options as this app.
+
+static char const* flatten_variant_name() {
+#if defined( __AVX__ ) && !defined( LE_PATH_FLATTEN_SCALAR )
+	return "AVX";
+#elif ( defined( __x86_64 ) || defined( _M_X64 ) ) && !defined( LE_PATH_FLATTEN_SCALAR )
+	return "SSE";
+#else
+	return "scalar";
+#endif
+}
+
+// ----------------------------------------------------------------------
+
+static std::vector<glm::vec2> get_polyline( le_path_o* path, size_t polyline_index ) {
+	auto const& le_path_i = le_path::le_path_i;
+
+	size_t num_vertices = 0;
+	le_path_i.get_vertices_for_polyline( path, polyline_index, nullptr, &num_vertices );
+
+	std::vector<glm::vec2> vertices( num_vertices );
+	le_path_i.get_vertices_for_polyline( path, polyline_index, vertices.data(), &num_vertices );
+
+	return vertices;
+}
+
+// ----------------------------------------------------------------------
+// Reference flattener: this is how le_path flattened a monotonous cubic bezier
+// segment before it flattened segments in SIMD batches - one step at a time.
+//
+// Each step finds the largest parameter `t` at which the segment may be cut while
+// respecting tolerance, emits the point at `t`, and continues with the remainder.
+
+static void reference_flatten_cubic_bezier( glm::vec2 p0, glm::vec2 c1, glm::vec2 c2, glm::vec2 p1, float tolerance, std::vector<glm::vec2>& vertices ) {
+
+	vertices.push_back( p0 );
+
+	for ( int i = 0; i != 1000; i++ ) {
+
+		// Coordinate basis built on the first point, and the first control point.
+		glm::vec2 r  = glm::normalize( c1 - p0 );
+		glm::vec2 d  = c2 - p0;
+		float     s2 = r.y * d.x - r.x * d.y;
+
+		float t = std::min<float>( 1.f, sqrtf( tolerance / ( 3 * fabsf( s2 ) ) ) );
+
+		// Subdivide at `t`, and keep the second part.
+		glm::vec2 b2_   = c2 + t * ( p1 - c2 );
+		glm::vec2 b0_   = p0 + t * ( c1 - p0 );
+		glm::vec2 b1_   = c1 + t * ( c2 - c1 );
+		glm::vec2 b0__  = b0_ + t * ( b1_ - b0_ );
+		glm::vec2 b1__  = b1_ + t * ( b2_ - b1_ );
+		glm::vec2 b0___ = b0__ + t * ( b1__ - b0__ );
+
+		p0 = b0___;
+		c1 = b1__;
+		c2 = b2_;
+
+		vertices.push_back( p0 );
+
+		if ( t >= 1.f ) {
+			break;
+		}
+	}
+}
+
+// ----------------------------------------------------------------------
+// Flattened curves must match the reference flattener.
+//
+// We use quadratic bezier curves, which le_path flattens as cubic bezier curves, without
+// splitting them into sub-segments - so that we can compare vertex by vertex. Each path
+// holds a chain of curves of different sizes, which means that the batched flattener
+// needs to refill lanes while others are still busy. Depending on compile options, this
+// checks le_path's AVX, SSE, or scalar flattener.
+
+constexpr static uint32_t REFERENCE_PATHS_COUNT  = 1000;
+constexpr static uint32_t REFERENCE_CURVES_COUNT = 37; // per path - not a multiple of any lane count
+constexpr static float    FLATTEN_TOLERANCE      = 0.25f;
+constexpr static float    MAX_VERTEX_DIFFERENCE  = 1e-3f; // glm::normalize may differ in the last bits from what le_path uses
+
+struct cubic_bezier_t {
+	glm::vec2 p0;
+	glm::vec2 c1;
+	glm::vec2 c2;
+	glm::vec2 p1;
+};
+
+// Adds a contour of REFERENCE_CURVES_COUNT quadratic bezier curves to `path`, and
+// appends the cubic bezier curve which le_path flattens for each of them to `curves`.
+static void add_quad_bezier_chain( le_path_o* path, random_t& random, std::vector<cubic_bezier_t>& curves ) {
+
+	auto const& le_path_i = le_path::le_path_i;
+
+	glm::vec2 p0{ floorf( random( 0, 512 ) ), floorf( random( 0, 512 ) ) };
+
+	le_path_i.move_to( path, &p0 );
+
+	for ( uint32_t j = 0; j != REFERENCE_CURVES_COUNT; j++ ) {
+		// Control points are a multiple of 3 away from end points, so that converting
+		// to cubic bezier curves is exact. Otherwise, rounding may make le_path find
+		// inflection points, and split curves.
+		float     size = random( 0, 1 ) < 0.3f ? 1.f : 60.f; // small curves need only a few steps
+		glm::vec2 c    = p0 + 3.f * glm::vec2( floorf( random( -size, size ) ), floorf( random( -size, size ) ) );
+		glm::vec2 p1   = c + 3.f * glm::vec2( floorf( random( -size, size ) ), floorf( random( -size, size ) ) );
+
+		le_path_i.quad_bezier_to( path, &p1, &c );
+
+		curves.push_back( { p0, p0 + 2 / 3.f * ( c - p0 ), p1 + 2 / 3.f * ( c - p1 ), p1 } );
+
+		p0 = p1;
+	}
+}
+
+// Flattens a chain of curves, as added by add_quad_bezier_chain, with the reference flattener.
+static void reference_flatten_chain( cubic_bezier_t const* curves, size_t num_curves, float tolerance, std::vector<glm::vec2>& vertices ) {
+	for ( size_t j = 0; j != num_curves; j++ ) {
+		if ( j != 0 ) {
+			vertices.pop_back(); // start point of this curve is the end point of the previous one
+		}
+		auto const& b = curves[ j ];
+		reference_flatten_cubic_bezier( b.p0, b.c1, b.c2, b.p1, tolerance, vertices );
+	}
+}
+
+static bool test_flatten_reference() {
+
+	bool passed = true;
+
+	auto const& le_path_i = le_path::le_path_i;
+
+	random_t                    random;
+	std::vector<cubic_bezier_t> curves;
+	std::vector<glm::vec2>      expected;
+	size_t                      num_vertices   = 0;
+	float                       max_difference = 0;
+
+	le_path_o* path = le_path_i.create();
+
+	for ( uint32_t i = 0; i != REFERENCE_PATHS_COUNT && passed; i++ ) {
+
+		le_path_i.clear( path );
+		curves.clear();
+		add_quad_bezier_chain( path, random, curves );
+
+		expected.clear();
+		reference_flatten_chain( curves.data(), curves.size(), FLATTEN_TOLERANCE, expected );
+
+		le_path_i.flatten( path, FLATTEN_TOLERANCE );
+
+		std::vector<glm::vec2> vertices = get_polyline( path, 0 );
+		num_vertices += vertices.size();
+
+		if ( vertices.size() != expected.size() ) {
+			logger.error( "Path %u: flattened to %zu vertices, expected %zu", i, vertices.size(), expected.size() );
+			passed = false;
+			break;
+		}
+
+		for ( size_t j = 0; j != vertices.size(); j++ ) {
+			max_difference = std::max( max_difference, glm::distance( vertices[ j ], expected[ j ] ) );
+		}
+
+		if ( max_difference > MAX_VERTEX_DIFFERENCE ) {
+			logger.error( "Path %u: vertices differ from reference by %f", i, max_difference );
+			passed = false;
+		}
+	}
+
+	le_path_i.destroy( path );
+
+	logger.info( "%s flattener: %u paths, %zu vertices, max difference from reference: %g",
+	             flatten_variant_name(), REFERENCE_PATHS_COUNT, num_vertices, max_difference );
+
+	return passed;
+}
+
+// ----------------------------------------------------------------------
+// Flatten a synthetic icon corpus: many paths, with several contours each, mostly curves.
+//
+// This only uses the public le_path api, so that it can also be built against older
+// versions of le_path, to compare flatteners.
+
+constexpr static uint32_t CORPUS_PATHS_COUNT    = 2000;
+constexpr static uint32_t CORPUS_CONTOURS_COUNT = 4;
+constexpr static uint32_t CORPUS_COMMANDS_COUNT = 12; // per contour
+
+static void create_corpus( std::vector<le_path_o*>& paths, uint32_t num_paths ) {
+
+	auto const& le_path_i = le_path::le_path_i;
+
+	random_t random;
+
+	for ( uint32_t i = 0; i != num_paths; i++ ) {
+
+		le_path_o* path = le_path_i.create();
+
+		for ( uint32_t c = 0; c != CORPUS_CONTOURS_COUNT; c++ ) {
+
+			glm::vec2 p0{ random( 0, 512 ), random( 0, 512 ) };
+			le_path_i.move_to( path, &p0 );
+
+			for ( uint32_t j = 0; j != CORPUS_COMMANDS_COUNT; j++ ) {
+
+				glm::vec2 p{ random( 0, 512 ), random( 0, 512 ) };
+				glm::vec2 c1{ random( 0, 512 ), random( 0, 512 ) };
+				glm::vec2 c2{ random( 0, 512 ), random( 0, 512 ) };
+				float     kind = random( 0, 1 );
+
+				if ( kind < 0.6f ) {
+					le_path_i.cubic_bezier_to( path, &p, &c1, &c2 );
+				} else if ( kind < 0.8f ) {
+					le_path_i.quad_bezier_to( path, &p, &c1 );
+				} else if ( kind < 0.9f ) {
+					le_path_i.line_to( path, &p );
+				} else {
+					glm::vec2 radii{ random( 10, 200 ), random( 10, 200 ) };
+					le_path_i.arc_to( path, &p, &radii, random( 0, 90 ), kind < 0.95f, kind < 0.93f );
+				}
+			}
+
+			le_path_i.close( path );
+		}
+
+		paths.push_back( path );
+	}
+}
+
+static bool test_flatten_benchmark() {
+
+	auto const& le_path_i = le_path::le_path_i;
+
+	// le_path keeps polylines if a path gets flattened again with the same tolerance -
+	// we alternate between two tolerances, so that each repeat flattens all curves.
+	float const tolerances[ 2 ] = { FLATTEN_TOLERANCE, std::nextafter( FLATTEN_TOLERANCE, 1.f ) };
+
+	auto count_vertices = [ & ]( std::vector<le_path_o*> const& paths ) {
+		size_t num_vertices = 0;
+		for ( auto path : paths ) {
+			size_t num_polylines = le_path_i.get_num_polylines( path );
+			for ( size_t j = 0; j != num_polylines; j++ ) {
+				size_t count = 0;
+				le_path_i.get_vertices_for_polyline( path, j, nullptr, &count );
+				num_vertices += count;
+			}
+		}
+		return num_vertices;
+	};
+
+	// Icon corpus: all kinds of commands.
+	{
+		std::vector<le_path_o*> paths;
+		create_corpus( paths, CORPUS_PATHS_COUNT );
+
+		double best_ms = 1e9;
+
+		for ( int repeat = 0; repeat != 10; repeat++ ) {
+			auto t0 = bench_clock::now();
+			for ( auto path : paths ) {
+				le_path_i.flatten( path, tolerances[ repeat % 2 ] );
+			}
+			best_ms = std::min( best_ms, ms_since( t0 ) );
+		}
+
+		size_t num_vertices = count_vertices( paths );
+
+		for ( auto path : paths ) {
+			le_path_i.destroy( path );
+		}
+
+		logger.info( "%s flattener: %u paths, %u commands, %zu vertices - best of 10: %.1f ms, %.1f M vertices/s",
+		             flatten_variant_name(), CORPUS_PATHS_COUNT, CORPUS_PATHS_COUNT * CORPUS_CONTOURS_COUNT * CORPUS_COMMANDS_COUNT,
+		             num_vertices, best_ms, num_vertices / best_ms / 1000 );
+	}
+
+	// Curve corpus: chains of curves which both le_path, and the reference flattener - the
+	// scalar loop which le_path used before batching - flatten to the same vertices. The
+	// reference only counts the flattening loop: it skips splitting curves, and storing
+	// tangents, so that its time is a lower bound for the previous implementation.
+	{
+		random_t                    random;
+		std::vector<le_path_o*>     paths;
+		std::vector<cubic_bezier_t> curves;
+
+		for ( uint32_t i = 0; i != REFERENCE_PATHS_COUNT; i++ ) {
+			paths.push_back( le_path_i.create() );
+			add_quad_bezier_chain( paths.back(), random, curves );
+		}
+
+		double best_ms = 1e9;
+
+		for ( int repeat = 0; repeat != 10; repeat++ ) {
+			auto t0 = bench_clock::now();
+			for ( auto path : paths ) {
+				le_path_i.flatten( path, tolerances[ repeat % 2 ] );
+			}
+			best_ms = std::min( best_ms, ms_since( t0 ) );
+		}
+
+		double                 best_reference_ms = 1e9;
+		size_t                 num_reference_vertices;
+		std::vector<glm::vec2> vertices;
+
+		for ( int repeat = 0; repeat != 10; repeat++ ) {
+			num_reference_vertices = 0;
+			auto t0                = bench_clock::now();
+			for ( uint32_t i = 0; i != REFERENCE_PATHS_COUNT; i++ ) {
+				vertices.clear();
+				reference_flatten_chain( curves.data() + i * REFERENCE_CURVES_COUNT, REFERENCE_CURVES_COUNT, tolerances[ repeat % 2 ], vertices );
+				num_reference_vertices += vertices.size();
+			}
+			best_reference_ms = std::min( best_reference_ms, ms_since( t0 ) );
+		}
+
+		size_t num_vertices = count_vertices( paths );
+
+		for ( auto path : paths ) {
+			le_path_i.destroy( path );
+		}
+
+		logger.info( "%zu curves, %zu vertices - best of 10, ms", curves.size(), num_vertices );
+		logger.info( "%-32s %10.1f", "reference flattener", best_reference_ms );
+		logger.info( "%-32s %10.1f (%.2fx)", flatten_variant_name(), best_ms, best_reference_ms / best_ms );
+
+		if ( num_vertices != num_reference_vertices ) {
+			logger.error( "le_path gave %zu vertices, reference flattener gave %zu", num_vertices, num_reference_vertices );
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// ----------------------------------------------------------------------
+// Polyline cache: rebuilding a path each frame must give the same polylines as building a
+// fresh path - whichever contours were edited, inserted, removed, or swapped, and whatever
+// changed about the parameter for trace, flatten, or resample.
+//
+// Coordinates are integers, as in most svg, and glyph data.
+
+struct test_command_t {
+	enum Type : uint32_t {
+		eLine,
+		eQuad,
+		eCubic,
+		eArc,
+	};
+	Type      type;
+	glm::vec2 p;
+	glm::vec2 c1;
+	glm::vec2 c2; // radii, for arcs
+};
+
+struct test_contour_t {
+	glm::vec2                   start;
+	std::vector<test_command_t> commands;
+	bool                        closed;
+};
+
+static glm::vec2 random_point( random_t& random ) {
+	return { floorf( random( 0, 512 ) ), floorf( random( 0, 512 ) ) };
+}
+
+// If `same_commands` is set, all contours have the same sequence of commands, as glyphs often do.
+static test_contour_t create_test_contour( random_t& random, bool same_commands = false ) {
+	test_contour_t contour{ random_point( random ), {}, same_commands || random( 0, 1 ) < 0.7f };
+	for ( int i = 0; i != 6; i++ ) {
+		test_command_t::Type type  = test_command_t::Type( same_commands ? i % 4 : uint32_t( random( 0, 4 ) ) % 4 );
+		glm::vec2            radii = { floorf( random( 10, 200 ) ), floorf( random( 10, 200 ) ) };
+		glm::vec2            c2    = type == test_command_t::eArc ? radii : random_point( random );
+		test_command_t       cmd   = { type, random_point( random ), random_point( random ), c2 };
+		contour.commands.push_back( cmd );
+	}
+	return contour;
+}
+
+static void add_test_contour( le_path_o* path, test_contour_t const& contour ) {
+	auto const& le_path_i = le_path::le_path_i;
+
+	le_path_i.move_to( path, &contour.start );
+
+	for ( auto const& cmd : contour.commands ) {
+		switch ( cmd.type ) {
+		case test_command_t::eLine:
+			le_path_i.line_to( path, &cmd.p );
+			break;
+		case test_command_t::eQuad:
+			le_path_i.quad_bezier_to( path, &cmd.p, &cmd.c1 );
+			break;
+		case test_command_t::eCubic:
+			le_path_i.cubic_bezier_to( path, &cmd.p, &cmd.c1, &cmd.c2 );
+			break;
+		case test_command_t::eArc:
+			le_path_i.arc_to( path, &cmd.p, &cmd.c2, 0, false, true );
+			break;
+		}
+	}
+
+	if ( contour.closed ) {
+		le_path_i.close( path );
+	}
+}
+
+static void build_test_path( le_path_o* path, std::vector<test_contour_t> const& contours ) {
+	le_path::le_path_i.clear( path );
+	for ( auto const& c : contours ) {
+		add_test_contour( path, c );
+	}
+}
+
+// Returns true if both paths hold the same polylines, bit for bit.
+static bool polylines_equal( le_path_o* a, le_path_o* b ) {
+
+	auto const& le_path_i = le_path::le_path_i;
+
+	size_t num_polylines = le_path_i.get_num_polylines( a );
+
+	if ( num_polylines != le_path_i.get_num_polylines( b ) ) {
+		return false;
+	}
+
+	for ( size_t j = 0; j != num_polylines; j++ ) {
+
+		std::vector<glm::vec2> vertices_a = get_polyline( a, j );
+		std::vector<glm::vec2> vertices_b = get_polyline( b, j );
+
+		if ( vertices_a.size() != vertices_b.size() ||
+		     0 != memcmp( vertices_a.data(), vertices_b.data(), sizeof( glm::vec2 ) * vertices_a.size() ) ) {
+			return false;
+		}
+
+		size_t num_tangents_a = 0;
+		size_t num_tangents_b = 0;
+		le_path_i.get_tangents_for_polyline( a, j, nullptr, &num_tangents_a );
+		le_path_i.get_tangents_for_polyline( b, j, nullptr, &num_tangents_b );
+
+		std::vector<glm::vec2> tangents_a( num_tangents_a );
+		std::vector<glm::vec2> tangents_b( num_tangents_b );
+		le_path_i.get_tangents_for_polyline( a, j, tangents_a.data(), &num_tangents_a );
+		le_path_i.get_tangents_for_polyline( b, j, tangents_b.data(), &num_tangents_b );
+
+		if ( num_tangents_a != num_tangents_b ||
+		     0 != memcmp( tangents_a.data(), tangents_b.data(), sizeof( glm::vec2 ) * num_tangents_a ) ) {
+			return false;
+		}
+
+		// Position along the polyline depends on distances, which are not accessible otherwise.
+		glm::vec2 at_a, at_b;
+		le_path_i.get_polyline_at_pos_interpolated( a, j, 0.5f, &at_a );
+		le_path_i.get_polyline_at_pos_interpolated( b, j, 0.5f, &at_b );
+
+		if ( 0 != memcmp( &at_a, &at_b, sizeof( glm::vec2 ) ) ) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+constexpr static uint32_t CACHE_FRAMES_COUNT        = 400;
+constexpr static uint32_t CACHE_CONTOURS_COUNT      = 12; // initial number of contours
+constexpr static uint32_t ANIMATED_CONTOURS_COUNT   = 4000;
+constexpr static uint32_t ANIMATED_FRAMES_COUNT     = 20;
+constexpr static size_t   ANIMATED_TRACE_RESOLUTION = 12;
+
+// Generates polylines for `path` with one of trace, flatten, or resample - as given by `method`.
+static void generate_polylines( le_path_o* path, uint32_t method, uint32_t parameter ) {
+	auto const& le_path_i = le_path::le_path_i;
+
+	switch ( method ) {
+	case 0:
+		le_path_i.trace( path, 4 + 4 * parameter );
+		break;
+	case 1:
+		le_path_i.flatten( path, 0.25f * float( 1 + parameter ) );
+		break;
+	case 2:
+		le_path_i.flatten( path, 0.25f * float( 1 + parameter ) );
+		le_path_i.resample( path, 5.f * float( 1 + parameter ) );
+		break;
+	}
+}
+
+static bool test_polyline_cache() {
+
+	bool passed = true;
+
+	auto const& le_path_i = le_path::le_path_i;
+
+	random_t                    random;
+	std::vector<test_contour_t> contours;
+
+	for ( uint32_t i = 0; i != CACHE_CONTOURS_COUNT; i++ ) {
+		contours.push_back( create_test_contour( random ) );
+	}
+
+	le_path_o* path = le_path_i.create();
+
+	for ( uint32_t frame = 0; frame != CACHE_FRAMES_COUNT && passed; frame++ ) {
+
+		size_t index = size_t( random( 0, float( contours.size() ) ) ) % contours.size();
+
+		switch ( uint32_t( random( 0, 5 ) ) % 5 ) {
+		case 0: {
+			// Edit one command of one contour.
+			auto& cmd = contours[ index ].commands[ size_t( random( 0, 6 ) ) % 6 ];
+			cmd.p += glm::vec2( floorf( random( -8, 8 ) ), floorf( random( -8, 8 ) ) );
+		} break;
+		case 1:
+			contours.insert( contours.begin() + index, create_test_contour( random ) );
+			break;
+		case 2:
+			if ( contours.size() > 1 ) {
+				contours.erase( contours.begin() + index );
+			}
+			break;
+		case 3:
+			std::swap( contours[ index ], contours[ size_t( random( 0, float( contours.size() ) ) ) % contours.size() ] );
+			break;
+		default:
+			// No change: all contours may re-use their polylines.
+			break;
+		}
+
+		uint32_t method    = uint32_t( random( 0, 3 ) ) % 3;
+		uint32_t parameter = uint32_t( random( 0, 2 ) ) % 2;
+
+		build_test_path( path, contours );
+		generate_polylines( path, method, parameter );
+
+		le_path_o* fresh = le_path_i.create();
+		build_test_path( fresh, contours );
+		generate_polylines( fresh, method, parameter );
+
+		if ( !polylines_equal( path, fresh ) ) {
+			logger.error( "Frame %u: polylines differ from a freshly built path (method %u, %zu contours)", frame, method, contours.size() );
+			passed = false;
+		}
+
+		le_path_i.destroy( fresh );
+	}
+
+	le_path_i.destroy( path );
+
+	logger.info( "%u frames: polylines match freshly built paths", CACHE_FRAMES_COUNT );
+
+	// Timings: one path with many contours gets rebuilt each frame. We compare re-tracing the
+	// path with tracing the same contours on a fresh path, which can't re-use any polylines.
+
+	contours.clear();
+	for ( uint32_t i = 0; i != ANIMATED_CONTOURS_COUNT; i++ ) {
+		contours.push_back( create_test_contour( random, true ) );
+	}
+
+	path = le_path_i.create();
+	build_test_path( path, contours );
+	le_path_i.trace( path, ANIMATED_TRACE_RESOLUTION );
+
+	le_path_o* fresh = le_path_i.create();
+
+	// Time for tracing all contours of a fresh path.
+	double fresh_ms = 1e9;
+	for ( uint32_t frame = 0; frame != ANIMATED_FRAMES_COUNT; frame++ ) {
+		le_path_i.destroy( fresh );
+		fresh = le_path_i.create();
+		build_test_path( fresh, contours );
+		auto t0 = bench_clock::now();
+		le_path_i.trace( fresh, ANIMATED_TRACE_RESOLUTION );
+		fresh_ms = std::min( fresh_ms, ms_since( t0 ) );
+	}
+
+	// Runs `frame_fn` before each frame, then rebuilds, and traces `path`; returns best time for tracing.
+	auto time_frames = [ & ]( auto frame_fn ) {
+		double best_ms = 1e9;
+		for ( uint32_t frame = 0; frame != ANIMATED_FRAMES_COUNT && passed; frame++ ) {
+			size_t resolution = frame_fn( frame );
+			build_test_path( path, contours );
+			auto t0 = bench_clock::now();
+			le_path_i.trace( path, resolution );
+			best_ms = std::min( best_ms, ms_since( t0 ) );
+		}
+		build_test_path( fresh, contours );
+		le_path_i.trace( fresh, ANIMATED_TRACE_RESOLUTION );
+		if ( !polylines_equal( path, fresh ) ) {
+			logger.error( "Polylines differ from a freshly built path" );
+			passed = false;
+		}
+		return best_ms;
+	};
+
+	double animated_ms = time_frames( [ & ]( uint32_t frame ) {
+		auto& cmd = contours[ ( frame * 7919 ) % contours.size() ].commands[ 0 ];
+		cmd.p.x += 1;
+		return ANIMATED_TRACE_RESOLUTION;
+	} );
+
+	double rotated_ms = time_frames( [ & ]( uint32_t ) {
+		std::rotate( contours.begin(), contours.end() - 1, contours.end() ); // every contour moves
+		return ANIMATED_TRACE_RESOLUTION;
+	} );
+
+	double resolution_ms = time_frames( [ & ]( uint32_t frame ) {
+		// Alternating resolution means no polyline can be re-used; all must be looked up, though.
+		return frame % 2 ? ANIMATED_TRACE_RESOLUTION : ANIMATED_TRACE_RESOLUTION + 1;
+	} );
+
+	le_path_i.destroy( fresh );
+	le_path_i.destroy( path );
+
+	logger.info( "%u contours, rebuilt, and traced per frame - best of %u, ms", ANIMATED_CONTOURS_COUNT, ANIMATED_FRAMES_COUNT );
+	logger.info( "%-32s %10.2f", "fresh path", fresh_ms );
+	logger.info( "%-32s %10.2f (%.1fx)", "one contour animated", animated_ms, fresh_ms / animated_ms );
+	logger.info( "%-32s %10.2f (%.1fx)", "all contours moved by one", rotated_ms, fresh_ms / rotated_ms );
+	logger.info( "%-32s %10.2f (%.1fx)", "new resolution", resolution_ms, fresh_ms / resolution_ms );
+
+	return passed;
+}
+
+// ----------------------------------------------------------------------
+// Once a path has been built, and its polylines generated a few times, rebuilding the
+// path, and generating polylines again must re-use memory: no allocations at all.
+//
+// Some contours change each frame, cycling through a few shapes, so that their polylines
+// are generated anew, while other contours re-use cached polylines.
+
+constexpr static uint32_t STEADY_STATE_WARMUP_FRAMES = 3;
+constexpr static uint32_t STEADY_STATE_FRAMES        = 12;
+
+static bool test_steady_state_allocations() {
+
+#ifdef PLUGINS_DYNAMIC
+	logger.warn( "Allocations are only counted if modules are linked statically - skipping." );
+	return true;
+#else
+
+	bool passed = true;
+
+	auto const& le_path_i = le_path::le_path_i;
+
+	random_t                    random;
+	std::vector<test_contour_t> contours;
+
+	for ( uint32_t i = 0; i != 24; i++ ) {
+		contours.push_back( create_test_contour( random ) );
+	}
+
+	// Shapes for animated contours - we build these up front, as building them allocates.
+	std::vector<test_contour_t> shapes[ 3 ];
+
+	for ( uint32_t s = 0; s != 3; s++ ) {
+		shapes[ s ] = contours;
+		for ( size_t i = 0; i < shapes[ s ].size(); i += 4 ) {
+			shapes[ s ][ i ].commands[ 0 ].p += glm::vec2( 10.f * s, 5.f * s );
+		}
+	}
+
+	static char const svg_path_data[] = "M10,10 C 20,20 40,20 50,10 S 80,0 90,10 Q 100,50 120,10 T 150,10 a20 20 0 0 1 -30 10 Z";
+
+	le_path_o* path = le_path_i.create();
+
+	for ( uint32_t frame = 0; frame != STEADY_STATE_WARMUP_FRAMES + STEADY_STATE_FRAMES; frame++ ) {
+
+		uint64_t allocations_before = num_allocations.load( std::memory_order_relaxed );
+
+		build_test_path( path, shapes[ frame % 3 ] );
+		le_path_i.add_from_svg_path_data( path, svg_path_data, sizeof( svg_path_data ) - 1 );
+
+		le_path_i.flatten( path, FLATTEN_TOLERANCE );
+		le_path_i.trace( path, 16 );
+		le_path_i.resample( path, 3.f );
+
+		uint64_t allocations = num_allocations.load( std::memory_order_relaxed ) - allocations_before;
+
+		if ( frame >= STEADY_STATE_WARMUP_FRAMES && allocations != 0 ) {
+			logger.error( "Frame %u: %llu allocations for clear, rebuild, flatten, trace, and resample", frame, ( unsigned long long )allocations );
+			passed = false;
+		}
+	}
+
+	le_path_i.destroy( path );
+
+	if ( passed ) {
+		logger.info( "%u frames after %u warm-up frames: no allocations", STEADY_STATE_FRAMES, STEADY_STATE_WARMUP_FRAMES );
+	}
+
+	return passed;
+#endif
+}
+
+// ----------------------------------------------------------------------
+// Stroke batches must give the same triangles as tessellating contours one by one -
+// with, and without le_jobs running - and should scale with the number of workers.
+
+using stroke_attribute_t = le_path_api::stroke_attribute_t;
+using stroke_contour_t   = le_path_api::stroke_contour_t;
+
+constexpr static uint32_t STROKE_PATHS_COUNT = 500;
+
+// Tessellates all `contours` via a stroke batch; returns false if vertices differ from `expected`.
+// Adds the time spent tessellating to `ms`.
+static bool stroke_batch_check( le_path_stroke_batch_o* batch, std::vector<stroke_contour_t> const& contours, std::vector<glm::vec2> const& expected, std::vector<uint32_t> const& expected_offsets, double* ms ) {
+
+	auto const& le_path_stroke_batch_i = le_path::le_path_stroke_batch_i;
+
+	auto t0 = bench_clock::now();
+	le_path_stroke_batch_i.tessellate( batch, contours.data(), contours.size() );
+	*ms = ms_since( t0 );
+
+	size_t                 num_vertices = le_path_stroke_batch_i.get_num_vertices( batch );
+	std::vector<glm::vec2> vertices( num_vertices );
+	std::vector<uint32_t>  offsets( contours.size() + 1 );
+
+	if ( !le_path_stroke_batch_i.get_vertices( batch, vertices.data(), &num_vertices, offsets.data() ) ) {
+		logger.error( "Could not get vertices from stroke batch" );
+		return false;
+	}
+
+	if ( vertices.size() != expected.size() || offsets != expected_offsets ||
+	     0 != memcmp( vertices.data(), expected.data(), sizeof( glm::vec2 ) * vertices.size() ) ) {
+		logger.error( "Stroke batch gave %zu vertices, expected %zu - or vertices, or offsets differ", vertices.size(), expected.size() );
+		return false;
+	}
+
+	return true;
+}
+
+static bool test_stroke_batch() {
+
+	bool passed = true;
+
+	auto const& le_path_i              = le_path::le_path_i;
+	auto const& le_path_stroke_batch_i = le_path::le_path_stroke_batch_i;
+
+	std::vector<le_path_o*> paths;
+	create_corpus( paths, STROKE_PATHS_COUNT );
+
+	stroke_attribute_t stroke_attributes{};
+	stroke_attributes.tolerance      = FLATTEN_TOLERANCE;
+	stroke_attributes.width          = 3.f;
+	stroke_attributes.line_join_type = stroke_attribute_t::eLineJoinRound;
+	stroke_attributes.line_cap_type  = stroke_attribute_t::eLineCapRound;
+
+	std::vector<stroke_contour_t> contours;
+
+	for ( auto path : paths ) {
+		for ( uint32_t c = 0; c != le_path_i.get_num_contours( path ); c++ ) {
+			contours.push_back( { path, c, &stroke_attributes } );
+		}
+	}
+
+	// Reference: tessellate contours one by one.
+
+	std::vector<glm::vec2> expected;
+	std::vector<uint32_t>  expected_offsets;
+
+	double serial_ms;
+	{
+		auto t0 = bench_clock::now();
+		for ( auto const& c : contours ) {
+			size_t num_vertices = 0;
+			le_path_i.tessellate_thick_contour( const_cast<le_path_o*>( c.path ), c.contour_index, c.stroke_attributes, nullptr, &num_vertices );
+			expected_offsets.push_back( uint32_t( expected.size() ) );
+			expected.resize( expected.size() + num_vertices );
+			le_path_i.tessellate_thick_contour( const_cast<le_path_o*>( c.path ), c.contour_index, c.stroke_attributes, expected.data() + expected_offsets.back(), &num_vertices );
+		}
+		expected_offsets.push_back( uint32_t( expected.size() ) );
+		serial_ms = ms_since( t0 );
+	}
+
+	le_path_stroke_batch_o* batch = le_path_stroke_batch_i.create();
+
+	// Without le_jobs, the batch must tessellate on the calling thread.
+
+	double batch_ms;
+	passed &= stroke_batch_check( batch, contours, expected, expected_offsets, &batch_ms );
+
+	logger.info( "%zu contours, %zu vertices - ms", contours.size(), expected.size() );
+	logger.info( "%-32s %10.1f", "tessellate_thick_contour, serial", serial_ms );
+	logger.info( "%-32s %10.1f", "stroke batch, without le_jobs", batch_ms );
+
+	uint32_t const max_workers = std::max( 2u, std::thread::hardware_concurrency() );
+
+	for ( uint32_t num_workers = 1; num_workers <= max_workers && passed; num_workers *= 2 ) {
+
+		le_jobs_settings_t settings{};
+		settings.worker_thread_count = num_workers;
+		le_jobs::initialize( &settings );
+
+		double best_ms = 1e9;
+
+		for ( int repeat = 0; repeat != 3 && passed; repeat++ ) {
+			double ms;
+			passed &= stroke_batch_check( batch, contours, expected, expected_offsets, &ms );
+			best_ms = std::min( best_ms, ms );
+		}
+
+		le_jobs::terminate();
+
+		logger.info( "stroke batch, %2u workers %17.1f (%.2fx)", num_workers, best_ms, batch_ms / best_ms );
+	}
+
+	le_path_stroke_batch_i.destroy( batch );
+
+	for ( auto path : paths ) {
+		le_path_i.destroy( path );
+	}
+
+	return passed;
+}
+
+// ----------------------------------------------------------------------
+// Svg path data must parse the same as its long form - this covers syntax which
+// minifiers emit: compact numbers, packed arc flags, implicitly repeated commands,
+// and commands which depend on the previous command, or on the start of the subpath.
+
+// Contour count, and traced vertices for `data`; sets `ok` to what the parser returned.
+static std::vector<float> svg_path_data_snapshot( char const* data, bool* ok ) {
+
+	auto const& le_path_i = le_path::le_path_i;
+
+	le_path_o* path = le_path_i.create();
+	*ok             = le_path_i.add_from_svg_path_data( path, data, strlen( data ) );
+
+	std::vector<float> result;
+	result.push_back( float( le_path_i.get_num_contours( path ) ) );
+
+	le_path_i.trace( path, 4 );
+
+	for ( size_t j = 0; j != le_path_i.get_num_polylines( path ); j++ ) {
+		std::vector<glm::vec2> vertices = get_polyline( path, j );
+		result.push_back( float( vertices.size() ) );
+		for ( auto const& v : vertices ) {
+			result.push_back( v.x );
+			result.push_back( v.y );
+		}
+	}
+
+	le_path_i.destroy( path );
+
+	return result;
+}
+
+static bool test_svg_path_data() {
+
+	bool passed = true;
+
+	struct equivalent_t {
+		char const* data;
+		char const* expected; // long form of `data`
+	};
+
+	static equivalent_t const equivalents[] = {
+	    { "M10 20L30 40", "M 10,20 L 30,40" },
+	    { "M10 20 30 40 50 60", "M10 20 L30 40 L50 60" }, // implicit lineto after moveto
+	    { "m10 20 30 40 5 5", "M10 20 L40 60 L45 65" },   // implicit relative lineto after relative moveto
+	    { "M0 0 1 1Z", "M0 0 L1 1 Z" },
+	    { "M0 0L1.5.5", "M0 0L1.5 0.5" }, // second decimal point starts a new number
+	    { "M0 0L-1-2", "M0 0L-1 -2" },    // minus sign starts a new number
+	    { "M0 0L1e1 2E-1", "M0 0L10 0.2" },
+	    { "M0 0L+1 +.5", "M0 0L1 0.5" },
+	    { "\n\tM 0 0\r\n L 1 1 \f", "M0 0L1 1" },
+	    { "M0 0 h10 v10 h-10 z", "M0 0 H10 V10 H0 Z" },
+	    { "M0 0 H10 20 30", "M0 0 H10 H20 H30" },
+	    { "M0 0 c1 2 3 4 5 6 1 1 2 2 3 3", "M0 0 C1 2 3 4 5 6 C6 7 7 8 8 9" },
+	    { "M0 0 C10 0 20 10 20 20 S30 40 40 40", "M0 0 C10 0 20 10 20 20 C20 30 30 40 40 40" }, // reflected control point
+	    { "M0 0 S10 10 20 0", "M0 0 C0 0 10 10 20 0" },                                         // nothing to reflect
+	    { "M0 0 Q10 10 20 0 T40 0", "M0 0 Q10 10 20 0 Q30 -10 40 0" },
+	    { "M0 0 q10 10 20 0 t20 0", "M0 0 Q10 10 20 0 Q30 -10 40 0" },
+	    { "M0 0 T20 0", "M0 0 Q0 0 20 0" },
+	    { "M0 0 Q10 10 20 0 L30 0 T40 0", "M0 0 Q10 10 20 0 L30 0 Q30 0 40 0" }, // previous command was no quad
+	    { "M0 0 a10 10 0 0 1 20 0", "M0 0 A10 10 0 0 1 20 0" },
+	    { "M0 0 a10 10 0 0120 0", "M0 0 A10 10 0 0 1 20 0" }, // packed arc flags
+	    { "M0 0 a10 10 0 1020 0", "M0 0 A10 10 0 1 0 20 0" },
+	    { "M0 0 a10,10,0,1,0,20,0", "M0 0 A10 10 0 1 0 20 0" },
+	    { "M0 0 A-10 -10 0 0 1 20 0", "M0 0 A10 10 0 0 1 20 0" }, // radii are absolute
+	    { "M0 0 A0 10 0 0 1 20 0", "M0 0 L20 0" },                // zero radius is a line
+	    { "M0 0 A10 10 0 0 1 0 0 L5 5", "M0 0 L5 5" },            // arc to start point is omitted
+	    { "M10 10 L20 10 z l5 5", "M10 10 L20 10 Z M10 10 L15 15" }, // after close, continue from start of subpath
+	    { "M10 10 L20 10 z m5 5 l1 1", "M10 10 L20 10 Z M15 15 L16 16" },
+	    { "M0 0 L10 0 M20 20 L30 20", "M0 0 L10 0 m10 20 l10 0" },
+	};
+
+	for ( auto const& e : equivalents ) {
+		bool ok_data, ok_expected;
+		auto snapshot          = svg_path_data_snapshot( e.data, &ok_data );
+		auto expected_snapshot = svg_path_data_snapshot( e.expected, &ok_expected );
+
+		bool equal = ok_data && ok_expected && snapshot.size() == expected_snapshot.size();
+		for ( size_t i = 0; equal && i != snapshot.size(); i++ ) {
+			equal = fabsf( snapshot[ i ] - expected_snapshot[ i ] ) < MAX_VERTEX_DIFFERENCE;
+		}
+
+		if ( !equal ) {
+			logger.error( "'%s' does not parse the same as '%s'", e.data, e.expected );
+			passed = false;
+		}
+	}
+
+	struct malformed_t {
+		char const* data;
+		size_t      num_contours; // contours which are kept up to the error
+	};
+
+	static malformed_t const malformed[] = {
+	    { "L10 10", 0 }, // must start with moveto
+	    { "M 1 2 M", 1 },
+	    { "M0 0 L10", 1 },
+	    { "M0,0,L10,10", 1 },
+	    { "M0 0 L10 10 X 5", 1 },
+	    { "M0 0 Z 10 10", 1 }, // close takes no parameters
+	    { "M0 0 L1..", 1 },
+	    { "M0 0 L+-1 2", 1 },
+	    { "M0 0 Linf 1", 1 },
+	    { "M0 0 A10 10 0 2 1 5 5", 1 }, // flags must be 0, or 1
+	};
+
+	for ( auto const& m : malformed ) {
+		bool ok;
+		auto snapshot = svg_path_data_snapshot( m.data, &ok );
+		if ( ok || size_t( snapshot[ 0 ] ) != m.num_contours ) {
+			logger.error( "'%s' should fail with %zu contours, returned %s with %zu contours",
+			              m.data, m.num_contours, ok ? "true" : "false", size_t( snapshot[ 0 ] ) );
+			passed = false;
+		}
+	}
+
+	// Path data is bounded by its length, not by a terminating null.
+	{
+		auto const& le_path_i = le_path::le_path_i;
+
+		char const data[] = { 'M', '1', ' ', '2', 'L', '3', ' ', '4', '5' };
+		le_path_o* path   = le_path_i.create();
+		bool       ok     = le_path_i.add_from_svg_path_data( path, data, sizeof( data ) - 1 );
+
+		le_path_i.trace( path, 4 );
+		std::vector<glm::vec2> vertices = get_polyline( path, 0 );
+
+		if ( !ok || vertices.size() != 2 || vertices[ 1 ] != glm::vec2( 3, 4 ) ) {
+			logger.error( "Path data read past its length" );
+			passed = false;
+		}
+
+		le_path_i.destroy( path );
+	}
+
+	// Only `d` attributes of `<path>` elements outside of comments create paths.
+	{
+		char const* document =
+		    "<?xml version=\"1.0\"?>\n<svg xmlns=\"http://www.w3.org/2000/svg\">\n"
+		    "<!-- <path d=\"M0 0 L1 1\"/> -->\n"
+		    "<path id=\"a\" data-d=\"x\" d=\"M0 0 L10 10\" fill=\"red\"/>\n"
+		    "<pathology d=\"M0 0\"/>\n"
+		    "<g><path\n  fill='none'\n  d = 'M5 5 h10 v10 z'/></g>\n"
+		    "<path fill=\"none\"/>\n"
+		    "<path d=\"M0 0 L\"/>\n"
+		    "</svg>";
+
+		std::vector<le_path_o*> paths;
+		size_t                  num_paths = le_path::le_path_i.create_from_svg(
+            document, strlen( document ), []( void* user_data, le_path_o* path ) {
+                static_cast<std::vector<le_path_o*>*>( user_data )->push_back( path );
+            },
+            &paths );
+
+		std::vector<size_t> num_contours;
+		for ( auto path : paths ) {
+			num_contours.push_back( le_path::le_path_i.get_num_contours( path ) );
+			le_path::le_path_i.destroy( path );
+		}
+
+		if ( num_paths != 3 || num_contours != std::vector<size_t>{ 1, 1, 1 } ) {
+			logger.error( "Svg document gave %zu paths, expected 3", num_paths );
+			passed = false;
+		}
+	}
+
+	return passed;
+}
+
+// ----------------------------------------------------------------------
+// Parse throughput for svg path data, in the two forms found in icon sets: long form,
+// with absolute commands, and minified, with relative commands, implicit repeats and
+// compact numbers. `create_from_svg_file` also includes scanning the document, and
+// creating paths.
+
+constexpr static size_t SVG_BENCHMARK_BYTES = 16 << 20; // path data per form
+
+static std::string create_svg_path_data( random_t& random, bool minified ) {
+
+	char        buf[ 256 ];
+	std::string data;
+
+	// Appends a number in its shortest form: no leading zero, and no separator before a minus sign.
+	auto add_number = [ & ]( float lo, float hi ) {
+		snprintf( buf, sizeof( buf ), "%.2f", random( lo, hi ) );
+		char const* number = buf;
+		if ( number[ 0 ] == '0' && number[ 1 ] == '.' ) {
+			number++;
+		} else if ( number[ 0 ] == '-' && number[ 1 ] == '0' ) {
+			buf[ 1 ] = '-';
+			number++;
+		}
+		if ( number[ 0 ] != '-' && !data.empty() && strchr( "0123456789.", data.back() ) ) {
+			data += ' ';
+		}
+		data += number;
+	};
+
+	if ( minified ) {
+		data += 'M';
+		add_number( 0, 24 );
+		add_number( 0, 24 );
+		for ( int k = 0; k != 24; k++ ) {
+			switch ( k % 4 ) {
+			case 0:
+				data += 'c';
+				for ( int i = 0; i != 12; i++ ) add_number( -2, 2 ); // two curves, second one implicit
+				break;
+			case 1:
+				data += 'l';
+				add_number( -2, 2 );
+				add_number( -2, 2 );
+				break;
+			case 2:
+				data += 'h';
+				add_number( -2, 2 );
+				data += 'v';
+				add_number( -2, 2 );
+				break;
+			case 3:
+				data += 's';
+				for ( int i = 0; i != 4; i++ ) add_number( -2, 2 );
+				break;
+			}
+		}
+		data += 'z';
+	} else {
+		snprintf( buf, sizeof( buf ), "M %.3f,%.3f ", random( 0, 512 ), random( 0, 512 ) );
+		data += buf;
+		for ( int k = 0; k != 24; k++ ) {
+			switch ( k % 4 ) {
+			case 0:
+				snprintf( buf, sizeof( buf ), "C %.3f,%.3f %.3f,%.3f %.3f,%.3f ", random( 0, 512 ), random( 0, 512 ), random( 0, 512 ), random( 0, 512 ), random( 0, 512 ), random( 0, 512 ) );
+				break;
+			case 1:
+				snprintf( buf, sizeof( buf ), "L %.3f,%.3f ", random( 0, 512 ), random( 0, 512 ) );
+				break;
+			case 2:
+				snprintf( buf, sizeof( buf ), "Q %.3f,%.3f %.3f,%.3f ", random( 0, 512 ), random( 0, 512 ), random( 0, 512 ), random( 0, 512 ) );
+				break;
+			case 3:
+				snprintf( buf, sizeof( buf ), "A %.3f,%.3f 0 0 1 %.3f,%.3f ", random( 5, 50 ), random( 5, 50 ), random( 0, 512 ), random( 0, 512 ) );
+				break;
+			}
+			data += buf;
+		}
+		data += 'Z';
+	}
+
+	return data;
+}
+
+static bool test_svg_benchmark() {
+
+	bool passed = true;
+
+	auto const& le_path_i = le_path::le_path_i;
+
+	auto mb_per_s = []( size_t num_bytes, double ms ) {
+		return double( num_bytes ) / ( 1 << 20 ) / ( ms / 1000. );
+	};
+
+	random_t random;
+
+	for ( bool minified : { false, true } ) {
+
+		std::vector<std::string> path_data;
+		std::string              document = "<svg xmlns=\"http://www.w3.org/2000/svg\">\n";
+		size_t                   num_bytes = 0;
+
+		while ( num_bytes < SVG_BENCHMARK_BYTES ) {
+			path_data.push_back( create_svg_path_data( random, minified ) );
+			num_bytes += path_data.back().size();
+			document += "<symbol id=\"i" + std::to_string( path_data.size() ) + "\" viewBox=\"0 0 24 24\"><path fill=\"none\" d=\"" + path_data.back() + "\"/></symbol>\n";
+		}
+
+		document += "</svg>\n";
+
+		std::vector<le_path_o*> paths( path_data.size() );
+		for ( auto& path : paths ) {
+			path = le_path_i.create();
+		}
+
+		double best_data_ms = 1e9;
+
+		for ( int repeat = 0; repeat != 5 && passed; repeat++ ) {
+			for ( auto path : paths ) {
+				le_path_i.clear( path );
+			}
+			auto t0 = bench_clock::now();
+			for ( size_t i = 0; i != path_data.size(); i++ ) {
+				passed &= le_path_i.add_from_svg_path_data( paths[ i ], path_data[ i ].data(), path_data[ i ].size() );
+			}
+			best_data_ms = std::min( best_data_ms, ms_since( t0 ) );
+		}
+
+		for ( auto path : paths ) {
+			le_path_i.destroy( path );
+		}
+
+		if ( !passed ) {
+			logger.error( "Could not parse generated path data" );
+			break;
+		}
+
+		// Parse the same paths from an svg file.
+
+		std::filesystem::path file_path = std::filesystem::temp_directory_path() / "test_path_icons.svg";
+		{
+			std::ofstream file( file_path, std::ios::binary );
+			file.write( document.data(), std::streamsize( document.size() ) );
+		}
+
+		double best_file_ms = 1e9;
+		size_t num_paths    = 0;
+
+		for ( int repeat = 0; repeat != 5 && passed; repeat++ ) {
+			std::vector<le_path_o*> created;
+			created.reserve( path_data.size() );
+
+			auto t0 = bench_clock::now();
+			passed &= le_path_i.create_from_svg_file(
+			    file_path.string().c_str(), []( void* user_data, le_path_o* path ) {
+				    static_cast<std::vector<le_path_o*>*>( user_data )->push_back( path );
+			    },
+			    &created, &num_paths );
+			best_file_ms = std::min( best_file_ms, ms_since( t0 ) );
+
+			for ( auto path : created ) {
+				le_path_i.destroy( path );
+			}
+		}
+
+		std::filesystem::remove( file_path );
+
+		if ( !passed || num_paths != path_data.size() ) {
+			logger.error( "Svg file gave %zu paths, expected %zu", num_paths, path_data.size() );
+			passed = false;
+			break;
+		}
+
+		logger.info( "%s: %zu paths, %.1f MB path data - best of 5, MB/s", minified ? "minified" : "long form", path_data.size(), num_bytes / double( 1 << 20 ) );
+		logger.info( "%-32s %10.0f", "add_from_svg_path_data", mb_per_s( num_bytes, best_data_ms ) );
+		logger.info( "%-32s %10.0f (%.1f MB document)", "create_from_svg_file", mb_per_s( document.size(), best_file_ms ), document.size() / double( 1 << 20 ) );
+	}
+
+	return passed;
+}
+
+// ----------------------------------------------------------------------
+
+struct test_t {
+	char const* name;
+	bool ( *fn )();
+};
+
+static test_t const tests[] = {
+    { "flatten matches reference", test_flatten_reference },
+    { "flatten benchmark", test_flatten_benchmark },
+    { "polyline cache", test_polyline_cache },
+    { "steady state allocations", test_steady_state_allocations },
+    { "stroke batch", test_stroke_batch },
+    { "svg path data", test_svg_path_data },
+    { "svg benchmark", test_svg_benchmark },
+};
+
+// ----------------------------------------------------------------------
+
+static void app_initialize(){};
+
+// ----------------------------------------------------------------------
+
+static void app_terminate(){};
+
+// ----------------------------------------------------------------------
+
+static test_path_app_o* test_path_app_create() {
+	auto app = new ( test_path_app_o );
+	return app;
+}
+
+// ----------------------------------------------------------------------
+
+static bool test_path_app_update( test_path_app_o* self ) {
+
+	if ( self->current_test == std::size( tests ) ) {
+		if ( self->num_failures ) {
+			logger.error( "%u of %zu tests failed.", self->num_failures, std::size( tests ) );
+		} else {
+			logger.info( "All %zu tests passed.", std::size( tests ) );
+		}
+		return false;
+	}
+
+	test_t const& test = tests[ self->current_test++ ];
+
+	logger.info( "Running: %s", test.name );
+
+	if ( test.fn() ) {
+		logger.info( "Passed: %s", test.name );
+	} else {
+		logger.error( "FAILED: %s", test.name );
+		self->num_failures++;
+	}
+
+	return true; // keep app alive
+}
+
+// ----------------------------------------------------------------------
+
+static uint32_t test_path_app_get_num_failures( test_path_app_o* self ) {
+	return self->num_failures;
+}
+
+// ----------------------------------------------------------------------
+
+static void test_path_app_destroy( test_path_app_o* self ) {
+	delete ( self );
+}
+
+// ----------------------------------------------------------------------
+
+LE_MODULE_REGISTER_IMPL( test_path_app, api ) {
+
+	auto  test_path_app_api_i = static_cast<test_path_app_api*>( api );
+	auto& test_path_app_i     = test_path_app_api_i->test_path_app_i;
+
+	test_path_app_i.initialize = app_initialize;
+	test_path_app_i.terminate  = app_terminate;
+
+	test_path_app_i.create           = test_path_app_create;
+	test_path_app_i.destroy          = test_path_app_destroy;
+	test_path_app_i.update           = test_path_app_update;
+	test_path_app_i.get_num_failures = test_path_app_get_num_failures;
+}
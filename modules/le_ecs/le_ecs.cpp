@@ -1,22 +1,75 @@
 #include "le_ecs.h"
 #include "le_core.h"
 #include "le_hash_util.h"
+#include "le_jobs.h"
 
 #include <array>
 #include <vector>
-#include <bitset>
+#include <new>
+#include <string.h> // for memcpy, memset
+#include <unordered_map>
+#include <atomic>
 #include "assert.h"
 #include <algorithm>
+#include <stdio.h>
+
+#ifndef _WIN32
+#	include <fcntl.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <unistd.h>
+#endif
 
 /* Note
  *
- * Because we don't use sparse storage for our component data, we must iterate
- * over all entities previous to the entity which we want to access (seek).
+ * We store component data by archetype: all entities which have the exact same
+ * set of components share an archetype. Each archetype keeps its entities in
+ * fixed-size chunks of memory, and each chunk holds one tightly packed column per
+ * component type of its archetype, plus one column with the ids of the entities
+ * stored in the chunk (struct-of-arrays).
+ *
+ * Within an archetype, entities are densely packed: all chunks but the last one
+ * are full. If an entity leaves an archetype, the last entity of the archetype
+ * moves into the hole that it leaves behind.
+ *
+ * Adding a component to, or removing a component from an entity moves the entity
+ * into another archetype, which costs one copy per component of the entity.
+ *
+ * Component types are identified by dense ids, in the order in which they were first
+ * seen - there is no upper limit to the number of component types. Archetypes keep a
+ * sorted list of their component type ids, and cache which archetype to move an
+ * entity to when a component is added or removed (archetype edges).
+ *
+ * Systems iterate over the chunks of all archetypes which provide the components
+ * that they need - entities which don't match are never touched.
+ *
+ * For change detection, each chunk keeps two ticks per component type: the tick at
+ * which component data was last written to, and the tick at which the component was
+ * last added to any of the chunk's entities. A system run which has write access to a
+ * component marks it as changed in every chunk that the run visits; structural changes,
+ * and entity_component_at, mark changes too. Systems may filter on ticks which are newer
+ * than the tick of their last run, and skip whole chunks that way. Ticks are conservative:
+ * if an entity moves into another chunk, it takes its ticks along, so that a chunk may
+ * report changes which only applied to some of its entities.
+ *
+ * Entities which lose a component type which some system tracks get recorded in a
+ * removal log per component type, which is trimmed once all tracking systems have seen it.
+ *
+ * Snapshots store chunks verbatim, at CHUNK_SIZE-aligned file offsets. Loading a snapshot
+ * maps the file copy-on-write, and archetypes use chunks inside the mapping directly;
+ * these chunks are released together with the mapping, and never individually.
  *
- * Generally, this is not all too bad, as systems will iterate over entities in sequence.
+ * Structural changes (creating or removing entities, adding or removing components)
+ * may move entities between chunks, and must not happen while systems iterate. Systems
+ * may instead record these changes as deferred commands. Each le_jobs worker thread
+ * records into its own command buffer, so that recording needs no locks. Commands are
+ * played back on the controlling thread, via flush_deferred.
  *
- * But removing entities becomes rather costly, as each entity removal operation means
- * a seek for each component data type affected, plus one or more vector erase operations.
+ * An EntityId is a handle which combines the index of an entity slot with the
+ * generation of that slot. Entity slots map entities to their rows in their
+ * archetype. When an entity is removed, its slot's generation is increased, and the
+ * slot is put on a free list for re-use: any handle to a removed entity becomes
+ * stale, and we can tell that it is stale by comparing generations.
  *
  *
  * CAVEAT:
@@ -31,482 +84,2036 @@
  *
  */
 
-struct ComponentStorage {
-	std::vector<uint8_t> storage; // raw data
+static constexpr uint32_t CHUNK_SIZE       = 16 * 1024; // number of bytes per chunk
+static constexpr uint32_t COLUMN_ALIGNMENT = 64;        // columns start at cache line boundaries within a chunk
+
+using system_fn       = le_ecs_api::system_fn;
+using system_chunk_fn = le_ecs_api::system_chunk_fn;
+using QueryIterator   = le_ecs_api::QueryIterator;
+using ComponentType   = le_ecs_api::ComponentType;
+using ComponentSet    = std::vector<uint32_t>; // sorted list of component type ids - a component type id is an index into le_ecs_o::component_types
+
+struct ComponentSetHash {
+	size_t operator()( ComponentSet const& set ) const noexcept {
+		uint64_t hash = FNV1A_VAL_64_CONST;
+		for ( uint32_t id : set ) {
+			hash = ( hash ^ id ) * FNV1A_PRIME_64_CONST;
+		}
+		return size_t( hash );
+	}
 };
 
-static constexpr size_t MAX_COMPONENT_TYPES = 128;
+static_assert( sizeof( EntityId ) == sizeof( uint64_t ), "entity handles are stored in chunks as uint64_t" );
 
-using system_fn       = le_ecs_api::system_fn;
-using ComponentType   = le_ecs_api::ComponentType;        //
-using ComponentFilter = std::bitset<MAX_COMPONENT_TYPES>; // each bit corresponds to a component type and an index in le_ecs_o::components
-// if bit is set this means that entity has-a component of this type
+static constexpr uint32_t NO_ARCHETYPE            = ~0u;                                 // marks an entity slot which is not in use
+static constexpr uint32_t MAX_GENERATION          = 0x7fffffff;                          // so that the highest bit of a handle is free for DEFERRED_ENTITY_FLAG
+static constexpr uint64_t DEFERRED_ENTITY_FLAG    = 1ull << 63;                          // marks handles of entities which were created via a command buffer
+static constexpr size_t   MAX_COMMAND_BUFFERS     = LE_JOBS_MAX_WORKER_THREAD_COUNT + 1; // one per le_jobs worker thread, plus one for the controlling thread
+static constexpr size_t   COMMAND_DATA_BLOCK_SIZE = 64 * 1024;                           // component data for deferred commands is allocated in blocks of this size
 
 struct Entity {
-	uint64_t        id; // unique id
-	ComponentFilter filter;
+	uint32_t generation; // increased each time this slot is freed; a handle is valid only if its generation matches
+	uint32_t archetype;  // index into le_ecs_o::archetypes, NO_ARCHETYPE if slot is free
+	uint32_t row;        // index of entity within its archetype
+};
+
+// Cached transitions from one archetype to another.
+struct ArchetypeEdge {
+	uint32_t component;                        // component type id
+	uint32_t with_component    = NO_ARCHETYPE; // archetype which has the same components, plus `component`
+	uint32_t without_component = NO_ARCHETYPE; // archetype which has the same components, minus `component`
+};
+
+struct Archetype {
+	ComponentSet          components;        // all component types of this archetype, including flag-only component types
+	std::vector<uint32_t> component_indices; // component type index per column, sorted; flag-only component types don't have a column
+	std::vector<uint32_t> column_offsets;    // byte offset of column within chunk
+	std::vector<uint32_t> column_strides;    // number of bytes per element of column
+	uint32_t              chunk_capacity;    // number of entities per chunk
+	uint32_t              entity_count;      // number of entities in this archetype; all chunks but the last one are full
+	std::vector<uint8_t*> chunks;            // each chunk is CHUNK_SIZE bytes; entity handles are stored at the start of each chunk
+	std::vector<uint32_t> changed_ticks;     // per chunk, per component: tick of last write; index is chunk * components.size() + position in components
+	std::vector<uint32_t> added_ticks;       // per chunk, per component: tick at which component was last added to an entity in chunk; same layout
+
+	std::vector<ArchetypeEdge> edges; // transitions which have been taken so far, in no particular order
 };
 
 struct System {
-	ComponentFilter readComponents;  // read always before write
-	ComponentFilter writeComponents; //
+	ComponentSet readComponents;     // read always before write
+	ComponentSet writeComponents;    //
+	ComponentSet requiredComponents; // union of read, write, and filter components
+	ComponentSet changedFilter;      // only visit chunks in which these components changed since last run
+	ComponentSet addedFilter;        // only visit chunks in which these components were added since last run
+	ComponentSet removedTracking;    // component types for which this system may query removals
+
+	std::vector<size_t>   read_component_indices;  // indices into component storage/component type
+	std::vector<size_t>   write_component_indices; // indices into component storage/component type
+	std::vector<uint32_t> read_strides;            // number of bytes per read component
+	std::vector<uint32_t> write_strides;           // number of bytes per write component
+
+	std::vector<uint32_t> matching_archetypes;      // indices of archetypes which provide all components which this system requires
+	size_t                num_archetypes_seen = 0; // number of archetypes which have been tested for matching_archetypes
+
+	uint32_t last_run_tick = 0; // tick at which the most recent complete run started
+	uint32_t run_tick      = 0; // tick of current run
+
+	system_fn       fn;       // we must cast params back to struct of entities' components
+	system_chunk_fn chunk_fn; // if set, this is called once per span of entities, instead of fn once per entity
+};
+
+// Entities which lost a component of a tracked type, in the order in which they lost it.
+struct RemovedLog {
+	std::vector<uint64_t> entities; // entity handles; these may be stale
+	std::vector<uint32_t> ticks;    // tick per entity
+};
 
-	std::vector<size_t> read_component_indices;  // indices into component storage/component type
-	std::vector<size_t> write_component_indices; // indices into component storage/component type
+enum class CommandType : uint32_t {
+	eCreateEntity,
+	eRemoveEntity,
+	eAddComponent,
+	eRemoveComponent,
+};
+
+struct DeferredCommand {
+	CommandType   type;
+	uint64_t      entity;         // entity handle - may be a handle to an entity created via a command buffer
+	ComponentType component_type; // eAddComponent, eRemoveComponent only
+	void*         data;           // eAddComponent only: component data, nullptr for flag-only components
+};
 
-	system_fn fn; // we must cast params back to struct of entities' components
+// Deferred entity handles have DEFERRED_ENTITY_FLAG set, then the index of the command buffer
+// in the upper half, and the index of the entity within the command buffer in the lower half.
+struct CommandBuffer {
+	std::vector<DeferredCommand> commands;
+	std::vector<uint64_t>        created_entities;  // handles of entities created by this buffer, filled in during flush
+	std::vector<uint32_t>        created_pending;   // index into pending entities per created entity, used during flush
+	uint32_t                     num_created;       // number of eCreateEntity commands
+	std::vector<uint8_t*>        data_blocks;       // each COMMAND_DATA_BLOCK_SIZE bytes; kept across flushes
+	size_t                       data_block_index;  // current data block
+	size_t                       data_block_offset; // number of bytes used in current data block
 };
 
 struct le_ecs_o {
-	uint64_t                      next_entity_id = 0; // next available entity index (internal)
-	std::vector<ComponentType>    component_types;    // index corresponds to ComponentFilter[index]
-	std::vector<ComponentStorage> component_storage;  // one store per component type
-	std::vector<Entity>           entities;           // each entity may be different, index corresponds to entity ID, sorted by entity.id
-	std::vector<System>           systems;
+	std::vector<ComponentType>                                   component_types;       // index is component type id
+	std::unordered_map<uint64_t, uint32_t>                       component_type_lookup; // type_hash -> component type id
+	std::vector<Archetype>                                       archetypes;            // archetype at index 0 has no components
+	std::unordered_map<ComponentSet, uint32_t, ComponentSetHash> archetype_lookup;      // set of components -> index into archetypes
+	std::vector<Entity>                                          entities;              // entity slots, index corresponds to index part of EntityId
+	std::vector<uint32_t>                                        free_entity_slots;     // indices of entity slots which may be re-used
+	std::vector<System>                                          systems;               // index corresponds to LeEcsSystemId
+	std::vector<uint32_t>                                        free_system_slots;     // indices of systems which may be re-used
+	std::unordered_map<uint32_t, RemovedLog>                     removed_logs;          // component type id -> log, only for types which a system tracks
+	std::atomic<uint32_t>                                        change_tick{ 0 };      // increases with each system run
+	std::array<CommandBuffer*, MAX_COMMAND_BUFFERS>              command_buffers{};     // index is le_jobs worker id + 1; created on first use
+	uint8_t*                                                     snapshot_memory{};     // memory of loaded snapshot, if any - chunks may point into it
+	size_t                                                       snapshot_size{};       // number of bytes of snapshot_memory
 };
 
 // ----------------------------------------------------------------------
 
-static le_ecs_o* le_ecs_create() {
-	auto self = new le_ecs_o();
-	return self;
+static inline uint64_t entity_handle( uint32_t index, uint32_t generation ) {
+	return ( uint64_t( generation ) << 32 ) | index;
 }
 
 // ----------------------------------------------------------------------
 
-static void le_ecs_destroy( le_ecs_o* self ) {
-	delete self;
+static inline uint32_t entity_handle_get_index( uint64_t handle ) {
+	return uint32_t( handle );
 }
 
 // ----------------------------------------------------------------------
 
-static inline size_t get_index_from_entity_id( le_ecs_o const* self, EntityId id ) {
-	Entity search_entity;
-	search_entity.id = reinterpret_cast<size_t>( id );
+static inline uint32_t entity_handle_get_generation( uint64_t handle ) {
+	return uint32_t( handle >> 32 );
+}
 
-	auto found_element = std::lower_bound(
-	    self->entities.begin(), self->entities.end(), search_entity,
-	    []( Entity const& lhs, Entity const& rhs )
-	        -> bool { return lhs.id < rhs.id; } );
+// ----------------------------------------------------------------------
+// Return entity slot for given entity id, or nullptr if entity id is stale or invalid.
+static inline Entity* le_ecs_lookup_entity( le_ecs_o* self, EntityId entity_id ) {
 
-	// index is pointer diff found_element - start
+	uint64_t handle = reinterpret_cast<uint64_t>( entity_id );
+	uint32_t index  = entity_handle_get_index( handle );
 
-	return ( found_element - self->entities.begin() );
-}
+	if ( index >= self->entities.size() ) {
+		return nullptr;
+	}
 
-// ----------------------------------------------------------------------
+	Entity* entity = &self->entities[ index ];
+
+	if ( entity->generation != entity_handle_get_generation( handle ) || entity->archetype == NO_ARCHETYPE ) {
+		return nullptr;
+	}
 
-static inline EntityId entity_get_entity_id( Entity const& e ) {
-	return reinterpret_cast<EntityId>( e.id );
+	return entity;
 }
 
 // ----------------------------------------------------------------------
 
-static size_t get_index_from_sytem_id( LeEcsSystemId id ) {
-	return reinterpret_cast<size_t>( id );
-}
-
-static LeEcsSystemId get_system_id_from_index( size_t idx ) {
-	return reinterpret_cast<LeEcsSystemId>( idx );
+static inline bool component_set_contains( ComponentSet const& set, uint32_t id ) {
+	return std::binary_search( set.begin(), set.end(), id );
 }
 
-size_t le_ecs_find_component_type_index( le_ecs_o const* self, ComponentType const& component_type ) {
-	// Find component storage index
-	size_t     storage_index       = 0;
-	auto const component_types_end = self->component_types.data() + self->component_types.size();
-	for ( auto s_type = self->component_types.data(); s_type != component_types_end; storage_index++, s_type++ ) {
-		if ( s_type->type_hash == component_type.type_hash ) {
-			break;
-		}
+// ----------------------------------------------------------------------
+// Insert id into sorted set, unless it is already contained. Returns false if it was already contained.
+static bool component_set_insert( ComponentSet& set, uint32_t id ) {
+	auto it = std::lower_bound( set.begin(), set.end(), id );
+	if ( it != set.end() && *it == id ) {
+		return false;
 	}
-	return storage_index;
+	set.insert( it, id );
+	return true;
 }
 
 // ----------------------------------------------------------------------
-// Iterate over all entities, accumulating offset for component at storage_index
-inline uint32_t seek_offset( std::vector<Entity> const& entities, size_t e_idx, size_t storage_index, uint32_t stride ) {
 
-	uint32_t offset = 0;
-
-	for ( size_t i = 0; i != e_idx; ++i ) {
-		if ( entities[ i ].filter.test( storage_index ) ) {
-			offset += stride;
+static bool component_sets_intersect( ComponentSet const& lhs, ComponentSet const& rhs ) {
+	for ( auto l = lhs.begin(), r = rhs.begin(); l != lhs.end() && r != rhs.end(); ) {
+		if ( *l < *r ) {
+			l++;
+		} else if ( *r < *l ) {
+			r++;
+		} else {
+			return true;
 		}
 	}
-
-	return offset;
+	return false;
 }
 
 // ----------------------------------------------------------------------
+// Return index of archetype for given set of components; create archetype if it does not yet exist.
+static uint32_t le_ecs_produce_archetype( le_ecs_o* self, ComponentSet const& components ) {
 
-static size_t le_ecs_produce_component_type_index( le_ecs_o* self, ComponentType const& component_type ) {
+	auto found = self->archetype_lookup.find( components );
 
-	size_t storage_index = le_ecs_find_component_type_index( self, component_type );
+	if ( found != self->archetype_lookup.end() ) {
+		return found->second;
+	}
 
-	if ( storage_index == self->component_types.size() ) {
+	// ----------| Invariant: archetype does not exist yet
 
-		// Component storage for this component type does not yet exist, we must add it
+	Archetype archetype{};
+	archetype.components = components;
 
-		self->component_types.push_back( component_type );
-		self->component_storage.push_back( {} );
+	uint32_t row_size = sizeof( uint64_t ); // every row holds an entity id
 
-		if ( component_type.num_bytes > 0 ) {
-			self->component_storage.back().storage.reserve( 4096 ); // reserve 1 page of memory, just in case.
+	for ( uint32_t id : components ) {
+		if ( self->component_types[ id ].num_bytes > 0 ) {
+			archetype.component_indices.push_back( id );
+			archetype.column_strides.push_back( self->component_types[ id ].num_bytes );
+			row_size += self->component_types[ id ].num_bytes;
 		}
 	}
-	return storage_index;
-}
 
-// ----------------------------------------------------------------------
-// access component storage for entity based on component type
-// if entity doesn't yet have storage for given component type, storage is created.
-// if component type is not yet known to ecs the component type is added to list of known component types.
-static void* le_ecs_entity_component_at( le_ecs_o* self, EntityId entity_id, ComponentType const& component_type ) {
+	archetype.column_offsets.resize( archetype.component_indices.size() );
 
-	// Find if entity exists
-	size_t e_idx = get_index_from_entity_id( self, entity_id );
+	// Find the largest number of rows for which all columns, including alignment
+	// padding between columns, fit into a chunk.
 
-	if ( e_idx >= self->entities.size() ) {
-		// ERROR: entity does not exist.
-		return nullptr;
-	}
+	for ( archetype.chunk_capacity = CHUNK_SIZE / row_size; archetype.chunk_capacity > 0; archetype.chunk_capacity-- ) {
 
-	auto& entity = self->entities.at( e_idx );
+		uint32_t offset = sizeof( uint64_t ) * archetype.chunk_capacity; // entity ids come first
 
-	// -- Does component of this type already exist in component storage?
-	size_t component_type_index = le_ecs_produce_component_type_index( self, component_type );
+		for ( size_t c = 0; c != archetype.column_offsets.size(); c++ ) {
+			offset                       = ( offset + COLUMN_ALIGNMENT - 1 ) & ~( COLUMN_ALIGNMENT - 1 );
+			archetype.column_offsets[ c ] = offset;
+			offset += archetype.column_strides[ c ] * archetype.chunk_capacity;
+		}
 
-	if ( 0 == component_type.num_bytes ) {
-		// If component type is empty (a flag-only component), then we set the flag and return early.
-		entity.filter[ component_type_index ] = true;
-		return nullptr; // signal that no memory has been allocated.
+		if ( offset <= CHUNK_SIZE ) {
+			break;
+		}
 	}
 
-	// ----------| Invariant: Component is not flag-only
+	assert( archetype.chunk_capacity > 0 && "components of archetype must fit into a chunk" );
 
-	bool     needs_search     = true;
-	bool     needs_allocation = true;
-	uint32_t offset           = 0;
+	uint32_t archetype_index = uint32_t( self->archetypes.size() );
 
-	if ( entity.filter.test( component_type_index ) ) {
-		// A component of this type was already present - we must return
-		// the current memory address for the component, and make sure
-		// not to allocate any more memory.
-		needs_search     = true;
-		needs_allocation = false;
-	} else {
-		entity.filter[ component_type_index ] = true;
-		needs_allocation                      = true;
-	}
+	self->archetypes.emplace_back( std::move( archetype ) );
+	self->archetype_lookup[ components ] = archetype_index;
 
-	// If our entity is the last entity in the list of entities,
-	// our component memory will also be at the end of the corresponding
-	// component storage. This means in that case we don't have to search.
+	return archetype_index;
+}
 
-	if ( e_idx == self->entities.size() - 1 ) {
-		needs_search = false;
+// ----------------------------------------------------------------------
+// Most archetypes only ever see a handful of transitions, which is why we search linearly.
+static ArchetypeEdge& archetype_edge( Archetype& archetype, uint32_t id ) {
+	for ( auto& edge : archetype.edges ) {
+		if ( edge.component == id ) {
+			return edge;
+		}
 	}
+	archetype.edges.push_back( { id } );
+	return archetype.edges.back();
+}
 
-	auto& component_storage = self->component_storage[ component_type_index ].storage;
+// ----------------------------------------------------------------------
+// Return index of archetype which has all components of archetype at `archetype_index`, plus
+// (or minus, if `add` is false) component type `id`. Transitions are cached as archetype edges,
+// so that we only need to build a set of components when we take a transition for the first time.
+static uint32_t archetype_transition( le_ecs_o* self, uint32_t archetype_index, uint32_t id, bool add ) {
 
-	if ( needs_search == false ) {
-		offset = uint32_t( component_storage.size() );
-	} else {
-		offset = seek_offset( self->entities, e_idx, component_type_index, self->component_types[ component_type_index ].num_bytes );
+	if ( component_set_contains( self->archetypes[ archetype_index ].components, id ) == add ) {
+		return archetype_index; // nothing to do
 	}
 
-	if ( needs_allocation ) {
-		component_storage.insert( component_storage.begin() + offset, component_type.num_bytes, 0 ); // zero-initialize data
+	{
+		ArchetypeEdge const& edge   = archetype_edge( self->archetypes[ archetype_index ], id );
+		uint32_t             cached = add ? edge.with_component : edge.without_component;
+		if ( cached != NO_ARCHETYPE ) {
+			return cached;
+		}
 	}
 
-	return &component_storage[ offset ];
-}
+	ComponentSet components = self->archetypes[ archetype_index ].components;
 
-// ----------------------------------------------------------------------
+	if ( add ) {
+		component_set_insert( components, id );
+	} else {
+		components.erase( std::lower_bound( components.begin(), components.end(), id ) );
+	}
 
-static void entity_at_index_remove_component( le_ecs_o* self, size_t e_idx, ComponentType const& component_type ) {
-	// Find component storage index
-	size_t storage_index = le_ecs_find_component_type_index( self, component_type );
+	uint32_t target_index = le_ecs_produce_archetype( self, components ); // note: this may invalidate references to archetypes
 
-	if ( storage_index == self->component_types.size() ) {
-		// component does not exist
-		return;
+	if ( add ) {
+		archetype_edge( self->archetypes[ archetype_index ], id ).with_component  = target_index;
+		archetype_edge( self->archetypes[ target_index ], id ).without_component = archetype_index;
+	} else {
+		archetype_edge( self->archetypes[ archetype_index ], id ).without_component = target_index;
+		archetype_edge( self->archetypes[ target_index ], id ).with_component    = archetype_index;
 	}
 
-	auto& entity = self->entities.at( e_idx );
+	return target_index;
+}
 
-	if ( false == entity.filter[ storage_index ] ) {
-		return;
+// ----------------------------------------------------------------------
+// Return index of column for component type in archetype, or -1 if archetype has no column for this component type.
+static int32_t archetype_find_column( Archetype const& archetype, size_t component_type_index ) {
+	auto found = std::lower_bound( archetype.component_indices.begin(), archetype.component_indices.end(), uint32_t( component_type_index ) );
+	if ( found == archetype.component_indices.end() || *found != component_type_index ) {
+		return -1;
 	}
+	return int32_t( found - archetype.component_indices.begin() );
+}
 
-	// ----------| Invariant: entity does not have such a component.
-
-	if ( 0 != component_type.num_bytes ) {
+// ----------------------------------------------------------------------
 
-		// -- If component has allocated storage, we must find it, and free it.
-		// We must iterate through all entities up until our current entity.
-		// If any entity has a component of our type, we must add to offset
-		// so that we may skip over it when deleting the data for our component.
-		uint32_t stride = component_type.num_bytes;
+static inline uint64_t* archetype_id_at( Archetype const& archetype, uint32_t row ) {
+	uint8_t* chunk = archetype.chunks[ row / archetype.chunk_capacity ];
+	return reinterpret_cast<uint64_t*>( chunk ) + ( row % archetype.chunk_capacity );
+}
 
-		uint32_t offset = seek_offset( self->entities, e_idx, storage_index, stride );
+// ----------------------------------------------------------------------
 
-		auto& storage = self->component_storage[ storage_index ].storage;
-		storage.erase( storage.begin() + offset, storage.begin() + offset + stride );
-	}
+static inline uint8_t* archetype_data_at( Archetype const& archetype, size_t column, uint32_t row ) {
+	uint8_t* chunk = archetype.chunks[ row / archetype.chunk_capacity ];
+	return chunk + archetype.column_offsets[ column ] + archetype.column_strides[ column ] * ( row % archetype.chunk_capacity );
+}
 
-	// -- Remove flag which indicates that component is part of entity
-	entity.filter[ storage_index ] = false;
+// ----------------------------------------------------------------------
+// Tick which marks structural changes, and writes outside of systems: this is newer
+// than the tick of any system run which has started so far.
+static inline uint32_t le_ecs_structural_tick( le_ecs_o const* self ) {
+	return self->change_tick.load( std::memory_order_relaxed ) + 1;
 }
 
 // ----------------------------------------------------------------------
-// removes component from entity.
-static void le_ecs_entity_remove_component( le_ecs_o* self, EntityId entity_id, ComponentType const& component_type ) {
+// Ticks wrap around - we compare them in a way which is correct as long as they are
+// less than 2^31 ticks apart.
+static inline bool tick_is_newer( uint32_t tick, uint32_t than ) {
+	return int32_t( tick - than ) > 0;
+}
 
-	// Find if entity exists
-	size_t e_idx = get_index_from_entity_id( self, entity_id );
+// ----------------------------------------------------------------------
 
-	if ( e_idx >= self->entities.size() ) {
-		// ERROR: entity does not exist.
-		return;
+static inline void tick_update( uint32_t& tick, uint32_t other ) {
+	if ( tick_is_newer( other, tick ) ) {
+		tick = other;
 	}
-
-	entity_at_index_remove_component( self, e_idx, component_type );
 }
 
 // ----------------------------------------------------------------------
-// create a new, empty entity
-static EntityId le_ecs_entity_create( le_ecs_o* self ) {
-	size_t this_entity_id = self->next_entity_id;
-	self->next_entity_id++;
-	Entity new_entity{};
-	new_entity.id = this_entity_id;
-	self->entities.emplace_back( new_entity ); // add a new, empty entity
-	return reinterpret_cast<EntityId>( this_entity_id );
+// Return position of component type in archetype's components, or -1.
+static inline int32_t archetype_find_component( Archetype const& archetype, uint32_t component_type_index ) {
+	auto found = std::lower_bound( archetype.components.begin(), archetype.components.end(), component_type_index );
+	if ( found == archetype.components.end() || *found != component_type_index ) {
+		return -1;
+	}
+	return int32_t( found - archetype.components.begin() );
 }
 
 // ----------------------------------------------------------------------
-// Remove entity from ecs.
-// this first removes any components, then the entity entry.
-static void le_ecs_entity_remove( le_ecs_o* self, EntityId entity_id ) {
-	// Find if entity exists
-	size_t e_idx = get_index_from_entity_id( self, entity_id );
-
-	if ( e_idx >= self->entities.size() ) {
-		// ERROR: entity does not exist.
+// Free chunk, unless it is part of a loaded snapshot.
+static void le_ecs_free_chunk( le_ecs_o* self, uint8_t* chunk ) {
+	if ( chunk >= self->snapshot_memory && chunk < self->snapshot_memory + self->snapshot_size ) {
 		return;
 	}
+	::operator delete( chunk, std::align_val_t( COLUMN_ALIGNMENT ) );
+}
 
-	auto const& entity = self->entities.at( e_idx );
+// ----------------------------------------------------------------------
+// Append a row for entity with given handle to archetype, with zero-initialised component data.
+// Returns index of new row.
+static uint32_t archetype_push_row( Archetype& archetype, uint64_t entity_handle ) {
 
-	// -- iterate to correct position at all components which use this entity
+	uint32_t row = archetype.entity_count;
 
-	for ( uint32_t i = 0; i != MAX_COMPONENT_TYPES; ++i ) {
-		if ( entity.filter[ i ] ) {
-			entity_at_index_remove_component( self, e_idx, self->component_types[ i ] );
-		}
-		if ( entity.filter.none() ) {
-			break;
-		}
+	if ( row == archetype.chunks.size() * archetype.chunk_capacity ) {
+		archetype.chunks.push_back( static_cast<uint8_t*>( ::operator new( CHUNK_SIZE, std::align_val_t( COLUMN_ALIGNMENT ) ) ) );
+		archetype.changed_ticks.resize( archetype.chunks.size() * archetype.components.size(), 0 );
+		archetype.added_ticks.resize( archetype.chunks.size() * archetype.components.size(), 0 );
 	}
 
-	assert( entity.filter.none() && "entity must have no components left" );
+	archetype.entity_count++;
 
-	self->entities.erase( self->entities.begin() + uint32_t( e_idx ) );
-}
+	*archetype_id_at( archetype, row ) = entity_handle;
 
-// ----------------------------------------------------------------------
+	for ( size_t c = 0; c != archetype.column_offsets.size(); c++ ) {
+		memset( archetype_data_at( archetype, c, row ), 0, archetype.column_strides[ c ] );
+	}
 
-static LeEcsSystemId le_ecs_system_create( le_ecs_o* self ) {
-	self->systems.push_back( {
-	    0,
-	    0,
-	    {},
-	    {},
-	    {},
-	} );
-	return get_system_id_from_index( self->systems.size() - 1 );
+	return row;
 }
 
 // ----------------------------------------------------------------------
 
-static void le_ecs_system_set_method( le_ecs_o* self, LeEcsSystemId system_id, system_fn fn ) {
-
-	size_t system_index = get_index_from_sytem_id( system_id );
-
-	assert( system_index < self->systems.size() );
-
-	// --------| invariant: system with this index exists.
-
-	auto& system = self->systems[ system_index ];
+// Remove row from archetype - the last row of the archetype moves into its place.
+static void archetype_remove_row( le_ecs_o* self, uint32_t archetype_index, uint32_t row ) {
 
-	system.fn = fn;
-}
+	Archetype& archetype = self->archetypes[ archetype_index ];
 
-// ----------------------------------------------------------------------
+	uint32_t last_row = archetype.entity_count - 1;
 
-// adds a component type as a read parameter to system
-static bool le_ecs_system_add_read_component( le_ecs_o* self, LeEcsSystemId system_id, ComponentType const& component_type ) {
+	if ( row != last_row ) {
+		uint64_t moved_handle = *archetype_id_at( archetype, last_row );
 
-	// check if component type exists as a type in ecs - we do this by finding it's index.
+		*archetype_id_at( archetype, row ) = moved_handle;
 
-	size_t storage_index = le_ecs_produce_component_type_index( self, component_type );
+		for ( size_t c = 0; c != archetype.column_offsets.size(); c++ ) {
+			memcpy( archetype_data_at( archetype, c, row ), archetype_data_at( archetype, c, last_row ), archetype.column_strides[ c ] );
+		}
 
-	// --------| invariant: storage type was found
+		// The moved entity takes its ticks along into its new chunk.
+		size_t dst_chunk = row / archetype.chunk_capacity;
+		size_t src_chunk = last_row / archetype.chunk_capacity;
 
-	size_t system_index = get_index_from_sytem_id( system_id );
+		if ( dst_chunk != src_chunk ) {
+			size_t num_components = archetype.components.size();
+			for ( size_t k = 0; k != num_components; k++ ) {
+				tick_update( archetype.changed_ticks[ dst_chunk * num_components + k ], archetype.changed_ticks[ src_chunk * num_components + k ] );
+				tick_update( archetype.added_ticks[ dst_chunk * num_components + k ], archetype.added_ticks[ src_chunk * num_components + k ] );
+			}
+		}
 
-	if ( system_index >= self->systems.size() ) {
-		return false;
+		self->entities[ entity_handle_get_index( moved_handle ) ].row = row;
 	}
 
-	// --------| invariant: system with this index exists.
-
-	auto& system = self->systems[ system_index ];
+	archetype.entity_count--;
 
-	// we mark the the component to be used.
+	// Free empty chunks - but keep one spare chunk, so that an entity which moves back and
+	// forth across a chunk boundary doesn't cause a chunk to be allocated and freed every time.
 
-	system.readComponents[ storage_index ] = true;
-	system.read_component_indices.push_back( storage_index );
+	size_t chunks_needed = ( archetype.entity_count + archetype.chunk_capacity - 1 ) / archetype.chunk_capacity;
 
-	return true;
+	while ( archetype.chunks.size() > chunks_needed + 1 ) {
+		le_ecs_free_chunk( self, archetype.chunks.back() );
+		archetype.chunks.pop_back();
+		archetype.changed_ticks.resize( archetype.chunks.size() * archetype.components.size() );
+		archetype.added_ticks.resize( archetype.chunks.size() * archetype.components.size() );
+	}
 }
 
 // ----------------------------------------------------------------------
+// Record entity in the removal log of each tracked component type which is in archetype
+// `src_index`, but not in archetype `dst_index` (or NO_ARCHETYPE, if entity gets removed).
+static void le_ecs_record_removed_components( le_ecs_o* self, uint64_t entity_handle, uint32_t src_index, uint32_t dst_index ) {
 
-// adds a component type as a write parameter to system
-static bool le_ecs_system_add_write_component( le_ecs_o* self, LeEcsSystemId system_id, ComponentType const& component_type ) {
-
-	// check if component type exists as a type in ecs - we do this by finding it's index.
-
-	size_t storage_index = le_ecs_produce_component_type_index( self, component_type );
+	if ( self->removed_logs.empty() ) {
+		return;
+	}
 
-	// --------| invariant: storage type was found
+	uint32_t tick = le_ecs_structural_tick( self );
 
-	size_t system_index = get_index_from_sytem_id( system_id );
+	for ( uint32_t id : self->archetypes[ src_index ].components ) {
 
-	if ( system_index >= self->systems.size() ) {
-		return false;
-	}
+		if ( dst_index != NO_ARCHETYPE && component_set_contains( self->archetypes[ dst_index ].components, id ) ) {
+			continue;
+		}
 
-	// --------| invariant: system with this index exists.
+		auto found = self->removed_logs.find( id );
 
-	auto& system = self->systems[ system_index ];
+		if ( found == self->removed_logs.end() ) {
+			continue;
+		}
 
-	// we mark the the component to be used.
+		RemovedLog& log = found->second;
 
-	system.writeComponents[ storage_index ] = true;
-	system.write_component_indices.push_back( storage_index );
+		if ( log.entities.size() == log.entities.capacity() ) {
+			// Before the log grows, drop entries which all tracking systems have seen.
+			uint32_t oldest_run_tick = tick;
+			for ( auto const& system : self->systems ) {
+				if ( component_set_contains( system.removedTracking, id ) && tick_is_newer( oldest_run_tick, system.last_run_tick ) ) {
+					oldest_run_tick = system.last_run_tick;
+				}
+			}
+			size_t num_seen = 0;
+			while ( num_seen != log.ticks.size() && !tick_is_newer( log.ticks[ num_seen ], oldest_run_tick ) ) {
+				num_seen++;
+			}
+			log.entities.erase( log.entities.begin(), log.entities.begin() + num_seen );
+			log.ticks.erase( log.ticks.begin(), log.ticks.begin() + num_seen );
+		}
 
-	return true;
+		log.entities.push_back( entity_handle );
+		log.ticks.push_back( tick );
+	}
 }
 
 // ----------------------------------------------------------------------
+// Move entity into archetype with given index, keeping data for all components which both archetypes share.
+static void entity_move_to_archetype( le_ecs_o* self, Entity& entity, uint32_t dst_index ) {
 
-static void le_ecs_execute_system( le_ecs_o* self, LeEcsSystemId system_id, void* user_data = nullptr ) {
+	uint32_t src_index = entity.archetype;
+	uint32_t src_row   = entity.row;
 
-	// Filter all entities - we only want those which provide all the component types which our system
-	// cares about.
+	Archetype& dst = self->archetypes[ dst_index ];
+	Archetype& src = self->archetypes[ src_index ];
 
-	// The System's function is called on matching components which together form part of an entity.
-	// Function call happens repeatedly over all matching entities.
+	uint64_t handle  = *archetype_id_at( src, src_row );
+	uint32_t dst_row = archetype_push_row( dst, handle );
 
-	auto& system = self->systems.at( get_index_from_sytem_id( system_id ) );
+	// Both lists of columns are sorted by component type index - we can walk them in lockstep.
 
-	if ( system.fn == nullptr ) {
-		// if system does not define callable function there is
-		// we can return early.
-		return;
+	for ( size_t d = 0, s = 0; d != dst.component_indices.size() && s != src.component_indices.size(); ) {
+		if ( dst.component_indices[ d ] < src.component_indices[ s ] ) {
+			d++;
+		} else if ( src.component_indices[ s ] < dst.component_indices[ d ] ) {
+			s++;
+		} else {
+			memcpy( archetype_data_at( dst, d, dst_row ), archetype_data_at( src, s, src_row ), dst.column_strides[ d ] );
+			d++;
+			s++;
+		}
 	}
 
-	// --------| invariant: system provides callable function
+	// Components which the entity brings along keep their ticks; components which
+	// are new to the entity count as added, and changed.
 
-	const size_t types_count = self->component_types.size(); // total number of types/component stores inside this ecs.
+	{
+		uint32_t tick      = le_ecs_structural_tick( self );
+		size_t   dst_chunk = dst_row / dst.chunk_capacity;
+		size_t   src_chunk = src_row / src.chunk_capacity;
+		size_t   dst_count = dst.components.size();
+		size_t   src_count = src.components.size();
 
-	auto required_components = ( system.readComponents | system.writeComponents );
+		for ( size_t d = 0, s = 0; d != dst_count; d++ ) {
+			while ( s != src_count && src.components[ s ] < dst.components[ d ] ) {
+				s++;
+			}
+			uint32_t& changed_tick = dst.changed_ticks[ dst_chunk * dst_count + d ];
+			uint32_t& added_tick   = dst.added_ticks[ dst_chunk * dst_count + d ];
+			if ( s != src_count && src.components[ s ] == dst.components[ d ] ) {
+				tick_update( changed_tick, src.changed_ticks[ src_chunk * src_count + s ] );
+				tick_update( added_tick, src.added_ticks[ src_chunk * src_count + s ] );
+			} else {
+				tick_update( changed_tick, tick );
+				tick_update( added_tick, tick );
+			}
+		}
+	}
 
-	// Find indices for required components
+	le_ecs_record_removed_components( self, handle, src_index, dst_index );
 
-	std::array<size_t, MAX_COMPONENT_TYPES>      component_iterators; // current offset as object counts into component storage at index
-	std::array<void const*, MAX_COMPONENT_TYPES> read_containers;
-	std::array<void*, MAX_COMPONENT_TYPES>       write_containers;
+	entity.archetype = dst_index;
+	entity.row       = dst_row;
 
-	component_iterators.fill( 0 );
-	read_containers.fill( nullptr );
-	write_containers.fill( nullptr );
+	archetype_remove_row( self, src_index, src_row );
+}
 
-	for ( auto& e : self->entities ) {
+// ----------------------------------------------------------------------
 
-		// We must test if all required components are present in current entity.
+static void le_ecs_release_snapshot_memory( le_ecs_o* self ) {
+	if ( nullptr == self->snapshot_memory ) {
+		return;
+	}
+#ifdef _WIN32
+	::operator delete( self->snapshot_memory, std::align_val_t( COLUMN_ALIGNMENT ) );
+#else
+	munmap( self->snapshot_memory, self->snapshot_size );
+#endif
+	self->snapshot_memory = nullptr;
+	self->snapshot_size   = 0;
+}
 
-		auto matching_components = ( e.filter & ( required_components ) );
+// ----------------------------------------------------------------------
 
-		if ( matching_components == 0 ) {
-			// if no needed components are present, we can safely jump over this entity.
-			continue;
+static le_ecs_o* le_ecs_create() {
+	auto self = new le_ecs_o();
+	le_ecs_produce_archetype( self, {} ); // archetype for entities without components
+	return self;
+}
+
+// ----------------------------------------------------------------------
+
+static void le_ecs_destroy( le_ecs_o* self ) {
+	for ( auto& archetype : self->archetypes ) {
+		for ( auto& chunk : archetype.chunks ) {
+			le_ecs_free_chunk( self, chunk );
+		}
+	}
+	le_ecs_release_snapshot_memory( self );
+	for ( auto& buffer : self->command_buffers ) {
+		if ( buffer ) {
+			for ( auto& block : buffer->data_blocks ) {
+				delete[] block;
+			}
+			delete buffer;
 		}
+	}
+	delete self;
+}
 
-		if ( matching_components != required_components ) {
+// ----------------------------------------------------------------------
 
-			// If some but not all are present, we must make sure that the ones which were
-			// present do get iterated over, otherwise successive components of that type
-			// won't match up with their respective entity.
-			//
-			// This is only because we use sparse storage for our components, meaning we
-			// don't leave holes in our component storage, just because an entity doesn't
-			// use a specific type of component.
+static size_t get_index_from_sytem_id( LeEcsSystemId id ) {
+	return reinterpret_cast<size_t>( id );
+}
 
-			// -- find out which components were present
-			// -- increase component_iterators for these components by 1
+static LeEcsSystemId get_system_id_from_index( size_t idx ) {
+	return reinterpret_cast<LeEcsSystemId>( idx );
+}
 
-			for ( size_t i = 0; i != types_count; ++i ) {
-				if ( matching_components[ i ] ) {
-					component_iterators[ i ]++;
-				}
-			}
-			continue;
-		}
+// Returns component type id, or number of component types if component type is not known.
+size_t le_ecs_find_component_type_index( le_ecs_o const* self, ComponentType const& component_type ) {
+	auto found = self->component_type_lookup.find( component_type.type_hash );
+	if ( found == self->component_type_lookup.end() ) {
+		return self->component_types.size();
+	}
+	return found->second;
+}
 
-		// ---------| Invariant: all required components are present
+// ----------------------------------------------------------------------
 
-		// group relevant components into structure which may be used
-		size_t read_containter_count  = 0;
-		size_t write_containter_count = 0;
+static size_t le_ecs_produce_component_type_index( le_ecs_o* self, ComponentType const& component_type ) {
 
-		for ( auto& read_component : system.read_component_indices ) {
-			read_containers[ read_containter_count++ ] =
-			    ( self->component_storage[ read_component ].storage.data() +
-			      self->component_types[ read_component ].num_bytes *
-			          component_iterators[ read_component ] );
-		}
-		for ( auto& write_component : system.write_component_indices ) {
-			write_containers[ write_containter_count++ ] =
-			    ( self->component_storage[ write_component ].storage.data() +
-			      self->component_types[ write_component ].num_bytes *
-			          component_iterators[ write_component ] );
-		}
+	size_t storage_index = le_ecs_find_component_type_index( self, component_type );
 
-		// this is where we call the function
-		system.fn( entity_get_entity_id( e ), read_containers.data(), write_containers.data(), user_data );
+	if ( storage_index == self->component_types.size() ) {
 
-		// now we must increase component iterators for all elements which were
-		// named in required_components
+		// Component type does not yet exist, we must add it
 
-		for ( size_t i = 0; i != types_count; ++i ) {
-			if ( matching_components[ i ] ) {
-				component_iterators[ i ]++;
-			}
-		}
+		self->component_types.push_back( component_type );
+		self->component_type_lookup[ component_type.type_hash ] = uint32_t( storage_index );
 	}
+	return storage_index;
 }
 
 // ----------------------------------------------------------------------
+// access component storage for entity based on component type
+// if entity doesn't yet have storage for given component type, entity moves to an archetype which has it.
+// if component type is not yet known to ecs the component type is added to list of known component types.
+static void* le_ecs_entity_component_at( le_ecs_o* self, EntityId entity_id, ComponentType const& component_type ) {
 
-LE_MODULE_REGISTER_IMPL( le_ecs, api ) {
-	auto& le_ecs_i = static_cast<le_ecs_api*>( api )->le_ecs_i;
+	// Find if entity exists
+	Entity* entity = le_ecs_lookup_entity( self, entity_id );
 
-	le_ecs_i.create  = le_ecs_create;
-	le_ecs_i.destroy = le_ecs_destroy;
+	if ( nullptr == entity ) {
+		// ERROR: entity does not exist.
+		return nullptr;
+	}
+
+	// -- Does component of this type already exist in component storage?
+	size_t component_type_index = le_ecs_produce_component_type_index( self, component_type );
+
+	uint32_t target_archetype = archetype_transition( self, entity->archetype, uint32_t( component_type_index ), true );
+
+	if ( target_archetype != entity->archetype ) {
+		// Entity does not have a component of this type yet - we must move it to an
+		// archetype which has. Note that this may have added an archetype.
+		entity_move_to_archetype( self, *entity, target_archetype );
+	}
+
+	if ( 0 == component_type.num_bytes ) {
+		// If component type is empty (a flag-only component), there is no memory to return.
+		return nullptr; // signal that no memory has been allocated.
+	}
+
+	// ----------| Invariant: Component is not flag-only
+
+	Archetype& archetype = self->archetypes[ entity->archetype ];
+
+	// Caller may write through the pointer which we return - this counts as a change.
+	size_t chunk = entity->row / archetype.chunk_capacity;
+	tick_update( archetype.changed_ticks[ chunk * archetype.components.size() + archetype_find_component( archetype, uint32_t( component_type_index ) ) ],
+	             le_ecs_structural_tick( self ) );
+
+	return archetype_data_at( archetype, archetype_find_column( archetype, component_type_index ), entity->row );
+}
+
+// ----------------------------------------------------------------------
+// removes component from entity.
+static void le_ecs_entity_remove_component( le_ecs_o* self, EntityId entity_id, ComponentType const& component_type ) {
+
+	// Find if entity exists
+	Entity* entity = le_ecs_lookup_entity( self, entity_id );
+
+	if ( nullptr == entity ) {
+		// ERROR: entity does not exist.
+		return;
+	}
+
+	size_t component_type_index = le_ecs_find_component_type_index( self, component_type );
+
+	if ( component_type_index == self->component_types.size() ) {
+		// component type does not exist
+		return;
+	}
+
+	uint32_t target_archetype = archetype_transition( self, entity->archetype, uint32_t( component_type_index ), false );
+
+	if ( target_archetype == entity->archetype ) {
+		return; // entity does not have a component of this type.
+	}
+
+	// ----------| Invariant: entity has a component of this type.
+
+	entity_move_to_archetype( self, *entity, target_archetype );
+}
+
+// ----------------------------------------------------------------------
+// create a new, empty entity
+static EntityId le_ecs_entity_create( le_ecs_o* self ) {
+
+	uint32_t index;
+
+	if ( self->free_entity_slots.empty() ) {
+		index = uint32_t( self->entities.size() );
+		self->entities.push_back( { 1, NO_ARCHETYPE, 0 } ); // generations start at 1, so that no handle is ever 0
+	} else {
+		index = self->free_entity_slots.back();
+		self->free_entity_slots.pop_back();
+	}
+
+	Entity&  entity = self->entities[ index ];
+	uint64_t handle = entity_handle( index, entity.generation );
+
+	entity.archetype = 0; // add a new, empty entity
+	entity.row       = archetype_push_row( self->archetypes[ 0 ], handle );
+
+	return reinterpret_cast<EntityId>( handle );
+}
+
+// ----------------------------------------------------------------------
+// Remove entity from ecs.
+// this first removes the entity's row from its archetype, then frees the entity's slot.
+static void le_ecs_entity_remove( le_ecs_o* self, EntityId entity_id ) {
+	// Find if entity exists
+	Entity* entity = le_ecs_lookup_entity( self, entity_id );
+
+	if ( nullptr == entity ) {
+		// ERROR: entity does not exist.
+		return;
+	}
+
+	le_ecs_record_removed_components( self, reinterpret_cast<uint64_t>( entity_id ), entity->archetype, NO_ARCHETYPE );
+
+	archetype_remove_row( self, entity->archetype, entity->row );
+
+	// Invalidate all handles to this entity.
+	entity->generation = ( entity->generation % MAX_GENERATION ) + 1;
+	entity->archetype = NO_ARCHETYPE;
+
+	self->free_entity_slots.push_back( entity_handle_get_index( reinterpret_cast<uint64_t>( entity_id ) ) );
+}
+
+// ----------------------------------------------------------------------
+
+static LeEcsSystemId le_ecs_system_create( le_ecs_o* self ) {
+
+	if ( !self->free_system_slots.empty() ) {
+		uint32_t system_index = self->free_system_slots.back();
+		self->free_system_slots.pop_back();
+		return get_system_id_from_index( system_index );
+	}
+
+	self->systems.push_back( {} );
+	return get_system_id_from_index( self->systems.size() - 1 );
+}
+
+// ----------------------------------------------------------------------
+// Reset system, and make its slot available to the next system_create.
+static void le_ecs_system_destroy( le_ecs_o* self, LeEcsSystemId system_id ) {
+
+	size_t system_index = get_index_from_sytem_id( system_id );
+
+	assert( system_index < self->systems.size() );
+	assert( std::find( self->free_system_slots.begin(), self->free_system_slots.end(), system_index ) == self->free_system_slots.end() && "system destroyed twice" );
+
+	// --------| invariant: system with this index exists.
+
+	self->systems[ system_index ] = {};
+	self->free_system_slots.push_back( uint32_t( system_index ) );
+}
+
+// ----------------------------------------------------------------------
+
+static void le_ecs_system_set_method( le_ecs_o* self, LeEcsSystemId system_id, system_fn fn ) {
+
+	size_t system_index = get_index_from_sytem_id( system_id );
+
+	assert( system_index < self->systems.size() );
+
+	// --------| invariant: system with this index exists.
+
+	auto& system = self->systems[ system_index ];
+
+	system.fn = fn;
+}
+
+// ----------------------------------------------------------------------
+
+// adds a component type as a read parameter to system
+static bool le_ecs_system_add_read_component( le_ecs_o* self, LeEcsSystemId system_id, ComponentType const& component_type ) {
+
+	// check if component type exists as a type in ecs - we do this by finding it's index.
+
+	size_t storage_index = le_ecs_produce_component_type_index( self, component_type );
+
+	// --------| invariant: storage type was found
+
+	size_t system_index = get_index_from_sytem_id( system_id );
+
+	if ( system_index >= self->systems.size() ) {
+		return false;
+	}
+
+	// --------| invariant: system with this index exists.
+
+	auto& system = self->systems[ system_index ];
+
+	// we mark the the component to be used.
+
+	component_set_insert( system.readComponents, uint32_t( storage_index ) );
+	component_set_insert( system.requiredComponents, uint32_t( storage_index ) );
+	system.read_component_indices.push_back( storage_index );
+	system.read_strides.push_back( component_type.num_bytes );
+
+	// requirements have changed - we must test all archetypes again.
+	system.matching_archetypes.clear();
+	system.num_archetypes_seen = 0;
+
+	return true;
+}
+
+// ----------------------------------------------------------------------
+
+// adds a component type as a write parameter to system
+static bool le_ecs_system_add_write_component( le_ecs_o* self, LeEcsSystemId system_id, ComponentType const& component_type ) {
+
+	// check if component type exists as a type in ecs - we do this by finding it's index.
+
+	size_t storage_index = le_ecs_produce_component_type_index( self, component_type );
+
+	// --------| invariant: storage type was found
+
+	size_t system_index = get_index_from_sytem_id( system_id );
+
+	if ( system_index >= self->systems.size() ) {
+		return false;
+	}
+
+	// --------| invariant: system with this index exists.
+
+	auto& system = self->systems[ system_index ];
+
+	// we mark the the component to be used.
+
+	component_set_insert( system.writeComponents, uint32_t( storage_index ) );
+	component_set_insert( system.requiredComponents, uint32_t( storage_index ) );
+	system.write_component_indices.push_back( storage_index );
+	system.write_strides.push_back( component_type.num_bytes );
+
+	// requirements have changed - we must test all archetypes again.
+	system.matching_archetypes.clear();
+	system.num_archetypes_seen = 0;
+
+	return true;
+}
+
+// ----------------------------------------------------------------------
+
+static void le_ecs_system_set_chunk_method( le_ecs_o* self, LeEcsSystemId system_id, system_chunk_fn fn ) {
+
+	size_t system_index = get_index_from_sytem_id( system_id );
+
+	assert( system_index < self->systems.size() );
+
+	// --------| invariant: system with this index exists.
+
+	auto& system = self->systems[ system_index ];
+
+	system.chunk_fn = fn;
+}
+
+// ----------------------------------------------------------------------
+
+enum class SystemFilter : uint32_t {
+	eChanged,
+	eAdded,
+	eRemoved,
+};
+
+// ----------------------------------------------------------------------
+// Filter components don't need to be read or written by the system, but entities must
+// have them to match - this means that a filter counts as a read access.
+static bool le_ecs_system_add_filter( le_ecs_o* self, LeEcsSystemId system_id, ComponentType const& component_type, SystemFilter filter ) {
+
+	size_t storage_index = le_ecs_produce_component_type_index( self, component_type );
+	size_t system_index  = get_index_from_sytem_id( system_id );
+
+	if ( system_index >= self->systems.size() ) {
+		return false;
+	}
+
+	// --------| invariant: system with this index exists.
+
+	auto& system = self->systems[ system_index ];
+
+	switch ( filter ) {
+	case SystemFilter::eChanged:
+		component_set_insert( system.changedFilter, uint32_t( storage_index ) );
+		break;
+	case SystemFilter::eAdded:
+		component_set_insert( system.addedFilter, uint32_t( storage_index ) );
+		break;
+	case SystemFilter::eRemoved:
+		// Removals don't restrict which entities match - we only start a log.
+		component_set_insert( system.removedTracking, uint32_t( storage_index ) );
+		self->removed_logs.try_emplace( uint32_t( storage_index ) );
+		return true;
+	}
+
+	component_set_insert( system.requiredComponents, uint32_t( storage_index ) );
+
+	// requirements have changed - we must test all archetypes again.
+	system.matching_archetypes.clear();
+	system.num_archetypes_seen = 0;
+
+	return true;
+}
+
+// ----------------------------------------------------------------------
+
+static bool le_ecs_system_add_changed_filter( le_ecs_o* self, LeEcsSystemId system_id, ComponentType const& component_type ) {
+	return le_ecs_system_add_filter( self, system_id, component_type, SystemFilter::eChanged );
+}
+
+// ----------------------------------------------------------------------
+
+static bool le_ecs_system_add_added_filter( le_ecs_o* self, LeEcsSystemId system_id, ComponentType const& component_type ) {
+	return le_ecs_system_add_filter( self, system_id, component_type, SystemFilter::eAdded );
+}
+
+// ----------------------------------------------------------------------
+
+static bool le_ecs_system_track_removed_component( le_ecs_o* self, LeEcsSystemId system_id, ComponentType const& component_type ) {
+	return le_ecs_system_add_filter( self, system_id, component_type, SystemFilter::eRemoved );
+}
+
+// ----------------------------------------------------------------------
+// Return number of entities which lost a component of given type since the system's
+// last complete run; `entities` receives a pointer to their (possibly stale) handles.
+static uint32_t le_ecs_system_get_removed( le_ecs_o* self, LeEcsSystemId system_id, ComponentType const& component_type, EntityId const** entities ) {
+
+	auto const& system = self->systems.at( get_index_from_sytem_id( system_id ) );
+
+	size_t component_type_index = le_ecs_find_component_type_index( self, component_type );
+
+	*entities = nullptr;
+
+	if ( !component_set_contains( system.removedTracking, uint32_t( component_type_index ) ) ) {
+		assert( false && "system must track removals for this component type" );
+		return 0;
+	}
+
+	RemovedLog const& log = self->removed_logs.at( uint32_t( component_type_index ) );
+
+	// Entries are sorted by tick - find the first one which is newer than the last run.
+	auto first = std::partition_point( log.ticks.begin(), log.ticks.end(), [ &system ]( uint32_t tick ) {
+		return !tick_is_newer( tick, system.last_run_tick );
+	} );
+
+	size_t first_index = size_t( first - log.ticks.begin() );
+
+	*entities = reinterpret_cast<EntityId const*>( log.entities.data() + first_index );
+
+	return uint32_t( log.entities.size() - first_index );
+}
+
+// ----------------------------------------------------------------------
+// Return true if chunk passes all of the system's change filters.
+static bool system_chunk_passes_filters( System const& system, Archetype const& archetype, size_t chunk ) {
+
+	size_t num_components = archetype.components.size();
+
+	for ( uint32_t id : system.changedFilter ) {
+		if ( !tick_is_newer( archetype.changed_ticks[ chunk * num_components + archetype_find_component( archetype, id ) ], system.last_run_tick ) ) {
+			return false;
+		}
+	}
+	for ( uint32_t id : system.addedFilter ) {
+		if ( !tick_is_newer( archetype.added_ticks[ chunk * num_components + archetype_find_component( archetype, id ) ], system.last_run_tick ) ) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// ----------------------------------------------------------------------
+// Archetypes are never removed, so we only need to test archetypes which were
+// added since we last looked.
+static void system_update_matching_archetypes( le_ecs_o const* self, System& system ) {
+
+	for ( ; system.num_archetypes_seen != self->archetypes.size(); system.num_archetypes_seen++ ) {
+		ComponentSet const& components = self->archetypes[ system.num_archetypes_seen ].components;
+		if ( std::includes( components.begin(), components.end(), system.requiredComponents.begin(), system.requiredComponents.end() ) ) {
+			system.matching_archetypes.push_back( uint32_t( system.num_archetypes_seen ) );
+		}
+	}
+}
+
+// ----------------------------------------------------------------------
+// Fetch next span of entities which provide all components which the system requires.
+// A span is the part of a chunk which is in use - within a span, components of the same
+// type are tightly packed, and `read_params`/`write_params` receive a pointer to the first
+// component of each type, or nullptr for flag-only component types.
+//
+// The first call (with a zero-initialised iterator) starts a new run of the system: chunks
+// which don't pass the system's change filters are skipped, and chunks which the run
+// visits count as changed for all of the system's write components. Once all spans have
+// been visited, the run is complete, and later runs only see changes which happen after
+// this run started.
+// Returns false once there are no more spans.
+static bool le_ecs_system_query_next( le_ecs_o* self, LeEcsSystemId system_id, QueryIterator* it, void const** read_params, void** write_params ) {
+
+	auto& system = self->systems.at( get_index_from_sytem_id( system_id ) );
+
+	if ( system.requiredComponents.empty() ) {
+		// a system which requires no components does not match any entities.
+		return false;
+	}
+
+	if ( it->next_archetype == 0 && it->next_chunk == 0 ) {
+		system_update_matching_archetypes( self, system );
+		system.run_tick = self->change_tick.fetch_add( 1, std::memory_order_relaxed ) + 1;
+	}
+
+	bool has_filters = !( system.changedFilter.empty() && system.addedFilter.empty() );
+
+	while ( it->next_archetype < system.matching_archetypes.size() ) {
+
+		Archetype& archetype = self->archetypes[ system.matching_archetypes[ it->next_archetype ] ];
+
+		uint32_t first_row = it->next_chunk * archetype.chunk_capacity;
+
+		if ( first_row >= archetype.entity_count ) {
+			it->next_archetype++;
+			it->next_chunk = 0;
+			continue;
+		}
+
+		// ----------| Invariant: chunk holds at least one entity
+
+		if ( has_filters && !system_chunk_passes_filters( system, archetype, it->next_chunk ) ) {
+			it->next_chunk++;
+			continue;
+		}
+
+		uint8_t* chunk = archetype.chunks[ it->next_chunk ];
+
+		it->count    = std::min( archetype.chunk_capacity, archetype.entity_count - first_row );
+		it->entities = reinterpret_cast<EntityId const*>( chunk );
+
+		for ( size_t i = 0; i != system.read_component_indices.size(); i++ ) {
+			int32_t column    = archetype_find_column( archetype, system.read_component_indices[ i ] );
+			read_params[ i ] = column >= 0 ? chunk + archetype.column_offsets[ column ] : nullptr;
+		}
+		for ( size_t i = 0; i != system.write_component_indices.size(); i++ ) {
+			int32_t column     = archetype_find_column( archetype, system.write_component_indices[ i ] );
+			write_params[ i ] = column >= 0 ? chunk + archetype.column_offsets[ column ] : nullptr;
+		}
+
+		// Write access counts as a change. Note that concurrent systems never write
+		// to the same component type, and therefore never to the same tick.
+		for ( uint32_t id : system.writeComponents ) {
+			archetype.changed_ticks[ it->next_chunk * archetype.components.size() + archetype_find_component( archetype, id ) ] = system.run_tick;
+		}
+
+		it->next_chunk++;
+
+		return true;
+	}
+
+	system.last_run_tick = system.run_tick;
+
+	return false;
+}
+
+// ----------------------------------------------------------------------
+// Call system method(s) for one span of entities.
+//
+// `row_params` is scratch space for per-entity parameters: it must hold one pointer per
+// read and write component of the system, and is only used if the system has no chunk method.
+static void system_process_span( System const& system, QueryIterator const& it, void const** read_spans, void** write_spans, void** row_params, void* user_data ) {
+
+	if ( system.chunk_fn ) {
+		system.chunk_fn( it.count, it.entities, read_spans, write_spans, user_data );
+		return;
+	}
+
+	const size_t num_read_components  = system.read_component_indices.size();
+	const size_t num_write_components = system.write_component_indices.size();
+
+	void const** read_containers  = const_cast<void const**>( row_params );
+	void**       write_containers = row_params + num_read_components;
+
+	uint32_t const* read_strides  = system.read_strides.data();
+	uint32_t const* write_strides = system.write_strides.data();
+
+	for ( uint32_t row = 0; row != it.count; row++ ) {
+
+		// group relevant components into structure which may be used
+
+		for ( size_t i = 0; i != num_read_components; i++ ) {
+			read_containers[ i ] = read_spans[ i ] ? static_cast<uint8_t const*>( read_spans[ i ] ) + read_strides[ i ] * row : nullptr;
+		}
+		for ( size_t i = 0; i != num_write_components; i++ ) {
+			write_containers[ i ] = write_spans[ i ] ? static_cast<uint8_t*>( write_spans[ i ] ) + write_strides[ i ] * row : nullptr;
+		}
+
+		// this is where we call the function
+		system.fn( it.entities[ row ], read_containers, write_containers, user_data );
+	}
+}
+
+// ----------------------------------------------------------------------
+
+static void le_ecs_execute_system( le_ecs_o* self, LeEcsSystemId system_id, void* user_data = nullptr ) {
+
+	// We only want entities which provide all the component types which our system
+	// cares about - we get these as spans of tightly packed components.
+
+	// If the system has a chunk method, this is called once per span; otherwise the
+	// system's function is called repeatedly over all matching entities.
+
+	auto& system = self->systems.at( get_index_from_sytem_id( system_id ) );
+
+	if ( system.fn == nullptr && system.chunk_fn == nullptr ) {
+		// if system does not define callable function there is
+		// we can return early.
+		return;
+	}
+
+	// --------| invariant: system provides callable function
+
+	std::vector<void const*> read_spans( system.read_component_indices.size() ); // first component per read component type in current span
+	std::vector<void*>       write_spans( system.write_component_indices.size() );
+	std::vector<void*>       row_params( read_spans.size() + write_spans.size() );
+
+	QueryIterator it{};
+
+	while ( le_ecs_system_query_next( self, system_id, &it, read_spans.data(), write_spans.data() ) ) {
+		system_process_span( system, it, read_spans.data(), write_spans.data(), row_params.data(), user_data );
+	}
+}
+
+// ----------------------------------------------------------------------
+
+struct ParallelSystemSpans {
+	System const*              system;
+	void*                      user_data;
+	size_t                     num_params;  // number of read params + number of write params per span
+	std::vector<QueryIterator> spans;       // one entry per span
+	std::vector<void*>         span_params; // num_params per span: read params, then write params
+	std::vector<void*>         row_params;  // num_params per le_jobs worker id + 1, scratch for system_process_span
+};
+
+// ----------------------------------------------------------------------
+
+static void parallel_system_process_spans( uint64_t range_begin, uint64_t range_end, void* user_data ) {
+
+	auto&  ctx             = *static_cast<ParallelSystemSpans*>( user_data );
+	size_t num_read_params = ctx.system->read_component_indices.size();
+	void** row_params      = ctx.row_params.data() + size_t( le_jobs::get_current_worker_id() + 1 ) * ctx.num_params;
+
+	for ( uint64_t i = range_begin; i != range_end; i++ ) {
+		void** params = ctx.span_params.data() + i * ctx.num_params;
+		system_process_span( *ctx.system, ctx.spans[ i ], const_cast<void const**>( params ), params + num_read_params, row_params, ctx.user_data );
+	}
+}
+
+// ----------------------------------------------------------------------
+// Like execute_system, but spans get processed in parallel, on le_jobs worker threads.
+//
+// Falls back to execute_system if the job system is not running.
+static void le_ecs_execute_system_parallel( le_ecs_o* self, LeEcsSystemId system_id, void* user_data ) {
+
+	if ( !le_jobs::is_initialized() ) {
+		le_ecs_execute_system( self, system_id, user_data );
+		return;
+	}
+
+	auto& system = self->systems.at( get_index_from_sytem_id( system_id ) );
+
+	if ( system.fn == nullptr && system.chunk_fn == nullptr ) {
+		return;
+	}
+
+	// --------| invariant: system provides callable function
+
+	// First collect all spans, so that workers can pick them up by index.
+
+	ParallelSystemSpans ctx{};
+	ctx.system     = &system;
+	ctx.user_data  = user_data;
+	ctx.num_params = system.read_component_indices.size() + system.write_component_indices.size();
+
+	size_t num_read_params = system.read_component_indices.size();
+
+	QueryIterator it{};
+
+	for ( ;; ) {
+		size_t params_offset = ctx.span_params.size();
+		ctx.span_params.resize( params_offset + ctx.num_params );
+
+		void** params = ctx.span_params.data() + params_offset;
+
+		if ( !le_ecs_system_query_next( self, system_id, &it, const_cast<void const**>( params ), params + num_read_params ) ) {
+			ctx.span_params.resize( params_offset );
+			break;
+		}
+
+		ctx.spans.push_back( it );
+	}
+
+	if ( system.chunk_fn == nullptr ) {
+		// Worker ids are bounded in the same way as command buffer indices.
+		ctx.row_params.resize( MAX_COMMAND_BUFFERS * ctx.num_params );
+	}
+
+	if ( ctx.spans.size() == 1 ) {
+		// Not worth the trip to the job system.
+		parallel_system_process_spans( 0, 1, &ctx );
+	} else if ( !ctx.spans.empty() ) {
+		le_jobs::parallel_for( 0, ctx.spans.size(), 1, parallel_system_process_spans, &ctx );
+	}
+}
+
+// ----------------------------------------------------------------------
+// Two systems conflict if one of them writes to a component which the other reads, writes,
+// or filters on.
+static bool systems_conflict( System const& lhs, System const& rhs ) {
+	return component_sets_intersect( lhs.writeComponents, rhs.requiredComponents ) ||
+	       component_sets_intersect( rhs.writeComponents, lhs.requiredComponents );
+}
+
+// ----------------------------------------------------------------------
+
+struct ScheduledSystem {
+	le_ecs_o*     ecs;
+	LeEcsSystemId system_id;
+	void*         user_data;
+};
+
+// ----------------------------------------------------------------------
+
+static void scheduled_system_execute( void* param ) {
+	auto s = static_cast<ScheduledSystem*>( param );
+	le_ecs_execute_system( s->ecs, s->system_id, s->user_data );
+}
+
+// ----------------------------------------------------------------------
+// Execute a list of systems, running systems which don't conflict concurrently.
+//
+// We place each system into the first wave after all waves which hold earlier systems
+// that it conflicts with. Systems within a wave run concurrently, as jobs; waves run
+// one after another. This way, any two conflicting systems run in the order in which
+// they were given.
+//
+// If the job system is not running, systems run one after another, in the order given.
+static void le_ecs_execute_systems( le_ecs_o* self, LeEcsSystemId const* system_ids, void* const* user_data, uint32_t num_systems ) {
+
+	if ( !le_jobs::is_initialized() ) {
+		for ( uint32_t j = 0; j != num_systems; j++ ) {
+			le_ecs_execute_system( self, system_ids[ j ], user_data ? user_data[ j ] : nullptr );
+		}
+		return;
+	}
+
+	std::vector<uint32_t> waves( num_systems, 0 ); // wave index per system
+	uint32_t              num_waves = 0;
+
+	for ( uint32_t j = 0; j != num_systems; j++ ) {
+		System const& system = self->systems.at( get_index_from_sytem_id( system_ids[ j ] ) );
+		for ( uint32_t i = 0; i != j; i++ ) {
+			if ( waves[ i ] >= waves[ j ] && systems_conflict( self->systems[ get_index_from_sytem_id( system_ids[ i ] ) ], system ) ) {
+				waves[ j ] = waves[ i ] + 1;
+			}
+		}
+		num_waves = std::max( num_waves, waves[ j ] + 1 );
+	}
+
+	std::vector<ScheduledSystem> scheduled;
+	std::vector<le_jobs::job_t>  jobs;
+
+	scheduled.reserve( num_systems );
+	jobs.reserve( num_systems );
+
+	for ( uint32_t wave = 0; wave != num_waves; wave++ ) {
+
+		scheduled.clear();
+		jobs.clear();
+
+		for ( uint32_t j = 0; j != num_systems; j++ ) {
+			if ( waves[ j ] == wave ) {
+				scheduled.push_back( { self, system_ids[ j ], user_data ? user_data[ j ] : nullptr } );
+			}
+		}
+
+		if ( scheduled.size() == 1 ) {
+			scheduled_system_execute( &scheduled[ 0 ] );
+			continue;
+		}
+
+		for ( auto& s : scheduled ) {
+			le_jobs::job_t job{};
+			job.fun_ptr   = scheduled_system_execute;
+			job.fun_param = &s;
+			jobs.push_back( job );
+		}
+
+		le_jobs::counter_t* counter;
+		le_jobs::run_jobs( jobs.data(), uint32_t( jobs.size() ), &counter );
+		le_jobs::wait_for_counter_and_free( counter, 0 );
+	}
+}
+
+// ----------------------------------------------------------------------
+// Return command buffer for the calling thread - creates the buffer if needed.
+//
+// Each le_jobs worker thread owns one command buffer; all threads outside the job system
+// share one buffer, which is why only one thread outside the job system may record.
+static CommandBuffer* le_ecs_get_command_buffer( le_ecs_o* self, uint32_t* buffer_index ) {
+
+	*buffer_index = uint32_t( le_jobs::get_current_worker_id() + 1 );
+
+	assert( *buffer_index < MAX_COMMAND_BUFFERS );
+
+	CommandBuffer*& buffer = self->command_buffers[ *buffer_index ];
+
+	if ( nullptr == buffer ) {
+		buffer = new CommandBuffer{};
+	}
+
+	return buffer;
+}
+
+// ----------------------------------------------------------------------
+// Allocate memory for component data from command buffer - this memory stays valid until the next flush.
+static void* command_buffer_allocate_data( CommandBuffer* buffer, uint32_t num_bytes ) {
+
+	assert( num_bytes <= COMMAND_DATA_BLOCK_SIZE );
+
+	size_t offset = ( buffer->data_block_offset + 15 ) & ~size_t( 15 );
+
+	if ( buffer->data_blocks.empty() || offset + num_bytes > COMMAND_DATA_BLOCK_SIZE ) {
+		if ( !buffer->data_blocks.empty() ) {
+			buffer->data_block_index++;
+		}
+		if ( buffer->data_block_index == buffer->data_blocks.size() ) {
+			buffer->data_blocks.push_back( new uint8_t[ COMMAND_DATA_BLOCK_SIZE ] );
+		}
+		offset = 0;
+	}
+
+	buffer->data_block_offset = offset + num_bytes;
+
+	void* data = buffer->data_blocks[ buffer->data_block_index ] + offset;
+	memset( data, 0, num_bytes );
+	return data;
+}
+
+// ----------------------------------------------------------------------
+// Record creation of a new entity. The returned handle may only be used with other
+// deferred methods until the next flush_deferred.
+static EntityId le_ecs_deferred_entity_create( le_ecs_o* self ) {
+	uint32_t       buffer_index;
+	CommandBuffer* buffer = le_ecs_get_command_buffer( self, &buffer_index );
+
+	uint64_t handle = DEFERRED_ENTITY_FLAG | ( uint64_t( buffer_index ) << 32 ) | buffer->num_created;
+	buffer->num_created++;
+
+	buffer->commands.push_back( { CommandType::eCreateEntity, handle, {}, nullptr } );
+
+	return reinterpret_cast<EntityId>( handle );
+}
+
+// ----------------------------------------------------------------------
+
+static void le_ecs_deferred_entity_remove( le_ecs_o* self, EntityId entity_id ) {
+	uint32_t       buffer_index;
+	CommandBuffer* buffer = le_ecs_get_command_buffer( self, &buffer_index );
+	buffer->commands.push_back( { CommandType::eRemoveEntity, reinterpret_cast<uint64_t>( entity_id ), {}, nullptr } );
+}
+
+// ----------------------------------------------------------------------
+// Record adding a component to an entity; returns memory into which to write component data,
+// or nullptr for flag-only components. Component data gets copied into the ecs on flush.
+static void* le_ecs_deferred_entity_component_at( le_ecs_o* self, EntityId entity_id, ComponentType const& component_type ) {
+	uint32_t       buffer_index;
+	CommandBuffer* buffer = le_ecs_get_command_buffer( self, &buffer_index );
+
+	void* data = component_type.num_bytes ? command_buffer_allocate_data( buffer, component_type.num_bytes ) : nullptr;
+
+	buffer->commands.push_back( { CommandType::eAddComponent, reinterpret_cast<uint64_t>( entity_id ), component_type, data } );
+
+	return data;
+}
+
+// ----------------------------------------------------------------------
+
+static void le_ecs_deferred_entity_remove_component( le_ecs_o* self, EntityId entity_id, ComponentType const& component_type ) {
+	uint32_t       buffer_index;
+	CommandBuffer* buffer = le_ecs_get_command_buffer( self, &buffer_index );
+	buffer->commands.push_back( { CommandType::eRemoveComponent, reinterpret_cast<uint64_t>( entity_id ), component_type, nullptr } );
+}
+
+// ----------------------------------------------------------------------
+// Map handles of entities which were created via a command buffer to their actual handles.
+static uint64_t le_ecs_resolve_deferred_handle( le_ecs_o const* self, uint64_t handle ) {
+	if ( 0 == ( handle & DEFERRED_ENTITY_FLAG ) ) {
+		return handle;
+	}
+	CommandBuffer const* buffer = self->command_buffers[ ( handle & ~DEFERRED_ENTITY_FLAG ) >> 32 ];
+	return buffer->created_entities[ uint32_t( handle ) ];
+}
+
+// ----------------------------------------------------------------------
+// Play back all commands which were recorded since the last flush.
+//
+// We don't apply commands one by one: instead, we first collect the final set of components
+// for each entity which is touched by any command, so that each entity moves at most once,
+// and we then move entities in order of their source and target archetypes.
+//
+// Must not be called while systems execute.
+static void le_ecs_flush_deferred( le_ecs_o* self ) {
+
+	// -- Create all entities first, so that any other command may refer to them.
+
+	for ( auto buffer : self->command_buffers ) {
+		if ( nullptr == buffer ) {
+			continue;
+		}
+		buffer->created_entities.resize( buffer->num_created );
+		buffer->created_pending.assign( buffer->num_created, ~0u );
+		for ( auto const& cmd : buffer->commands ) {
+			if ( cmd.type == CommandType::eCreateEntity ) {
+				buffer->created_entities[ uint32_t( cmd.entity ) ] = reinterpret_cast<uint64_t>( le_ecs_entity_create( self ) );
+			}
+		}
+	}
+
+	// -- Accumulate changes per entity.
+
+	struct PendingEntity {
+		uint64_t handle;
+		Entity*  entity;
+		uint32_t target_archetype; // archetype which entity will have once all commands are applied
+		bool     removed;
+	};
+
+	struct PendingWrite {
+		uint32_t    pending_index;
+		uint32_t    component_type_index;
+		void const* data;
+	};
+
+	std::vector<PendingEntity>             pending;
+	std::vector<PendingWrite>              writes;
+	std::unordered_map<uint64_t, uint32_t> pending_lookup; // handle -> index into pending, for entities which existed before flush
+
+	// Commands tend to come in batches of similar entities - we cache the most recent
+	// component type lookup, and the most recent archetype transition.
+	uint64_t cached_type_hash       = 0;
+	uint32_t cached_type_index      = ~0u;
+	uint32_t cached_transition_from = NO_ARCHETYPE;
+	uint32_t cached_transition_to   = NO_ARCHETYPE;
+	uint32_t cached_transition_type = 0;
+	bool     cached_transition_add  = false;
+
+	auto transition = [ & ]( uint32_t from, uint32_t component_type_index, bool add ) -> uint32_t {
+		if ( from != cached_transition_from || component_type_index != cached_transition_type || add != cached_transition_add ) {
+			cached_transition_from = from;
+			cached_transition_type = component_type_index;
+			cached_transition_add  = add;
+			cached_transition_to   = archetype_transition( self, from, component_type_index, add );
+		}
+		return cached_transition_to;
+	};
+
+	for ( auto buffer : self->command_buffers ) {
+		if ( nullptr == buffer ) {
+			continue;
+		}
+		for ( auto const& cmd : buffer->commands ) {
+
+			if ( cmd.type == CommandType::eCreateEntity ) {
+				continue;
+			}
+
+			uint64_t handle = le_ecs_resolve_deferred_handle( self, cmd.entity );
+			Entity*  entity = le_ecs_lookup_entity( self, reinterpret_cast<EntityId>( handle ) );
+
+			if ( nullptr == entity ) {
+				continue; // entity does not exist (anymore)
+			}
+
+			// Entities which were created by a command buffer don't need a hash lookup.
+			uint32_t* pending_index;
+
+			if ( cmd.entity & DEFERRED_ENTITY_FLAG ) {
+				pending_index = &self->command_buffers[ ( cmd.entity & ~DEFERRED_ENTITY_FLAG ) >> 32 ]->created_pending[ uint32_t( cmd.entity ) ];
+			} else {
+				pending_index = &pending_lookup.try_emplace( handle, ~0u ).first->second;
+			}
+
+			if ( *pending_index == ~0u ) {
+				*pending_index = uint32_t( pending.size() );
+				pending.push_back( { handle, entity, entity->archetype, false } );
+			}
+
+			PendingEntity& p = pending[ *pending_index ];
+
+			switch ( cmd.type ) {
+			case CommandType::eRemoveEntity:
+				p.removed = true;
+				break;
+			case CommandType::eAddComponent: {
+				if ( cached_type_index == ~0u || cmd.component_type.type_hash != cached_type_hash ) {
+					cached_type_hash  = cmd.component_type.type_hash;
+					cached_type_index = uint32_t( le_ecs_produce_component_type_index( self, cmd.component_type ) );
+				}
+				p.target_archetype = transition( p.target_archetype, cached_type_index, true );
+				if ( cmd.data ) {
+					writes.push_back( { *pending_index, cached_type_index, cmd.data } );
+				}
+			} break;
+			case CommandType::eRemoveComponent: {
+				size_t component_type_index = le_ecs_find_component_type_index( self, cmd.component_type );
+				if ( component_type_index != self->component_types.size() ) {
+					p.target_archetype = transition( p.target_archetype, uint32_t( component_type_index ), false );
+				}
+			} break;
+			default:
+				break;
+			}
+		}
+	}
+
+	// -- Move entities - sorted by source and target archetype, so that we touch one pair
+	// of archetypes after the other.
+
+	for ( auto& p : pending ) {
+		if ( p.removed ) {
+			p.target_archetype = NO_ARCHETYPE;
+		}
+	}
+
+	std::vector<uint32_t> order( pending.size() );
+
+	for ( uint32_t i = 0; i != order.size(); i++ ) {
+		order[ i ] = i;
+	}
+
+	auto archetype_order = [ &pending ]( uint32_t lhs, uint32_t rhs ) {
+		if ( pending[ lhs ].entity->archetype != pending[ rhs ].entity->archetype ) {
+			return pending[ lhs ].entity->archetype < pending[ rhs ].entity->archetype;
+		}
+		return pending[ lhs ].target_archetype < pending[ rhs ].target_archetype;
+	};
+
+	if ( !std::is_sorted( order.begin(), order.end(), archetype_order ) ) {
+		std::sort( order.begin(), order.end(), archetype_order );
+	}
+
+	for ( uint32_t i : order ) {
+		PendingEntity& p = pending[ i ];
+		if ( p.removed ) {
+			le_ecs_entity_remove( self, reinterpret_cast<EntityId>( p.handle ) );
+		} else if ( p.target_archetype != p.entity->archetype ) {
+			entity_move_to_archetype( self, *p.entity, p.target_archetype );
+		}
+	}
+
+	// -- Copy component data, in the order in which it was recorded - a later write
+	// to the same component wins.
+
+	uint32_t cached_archetype = NO_ARCHETYPE; // we cache the column for the most recent archetype and component type
+	uint32_t cached_component = 0;
+	int32_t  cached_column    = -1;
+	int32_t  cached_position  = -1; // position of component type within archetype's components
+	uint32_t tick             = le_ecs_structural_tick( self );
+
+	for ( auto const& w : writes ) {
+		PendingEntity const& p = pending[ w.pending_index ];
+		if ( p.removed || !component_set_contains( self->archetypes[ p.target_archetype ].components, w.component_type_index ) ) {
+			continue;
+		}
+		Archetype& archetype = self->archetypes[ p.entity->archetype ];
+		if ( p.entity->archetype != cached_archetype || w.component_type_index != cached_component ) {
+			cached_archetype = p.entity->archetype;
+			cached_component = w.component_type_index;
+			cached_column    = archetype_find_column( archetype, w.component_type_index );
+			cached_position  = archetype_find_component( archetype, w.component_type_index );
+		}
+		memcpy( archetype_data_at( archetype, cached_column, p.entity->row ),
+		        w.data, self->component_types[ w.component_type_index ].num_bytes );
+		tick_update( archetype.changed_ticks[ ( p.entity->row / archetype.chunk_capacity ) * archetype.components.size() + cached_position ], tick );
+	}
+
+	// -- Reset command buffers - we keep their memory for the next round of commands.
+
+	for ( auto buffer : self->command_buffers ) {
+		if ( buffer ) {
+			buffer->commands.clear();
+			buffer->created_entities.clear();
+			buffer->created_pending.clear();
+			buffer->num_created       = 0;
+			buffer->data_block_index  = 0;
+			buffer->data_block_offset = 0;
+		}
+	}
+}
+
+// ----------------------------------------------------------------------
+// Snapshot file layout - all offsets are in bytes from the start of the file:
+//
+// 	SnapshotHeader
+// 	SnapshotComponentType[ num_component_types ]
+// 	char[ type_names_size ]                  // null-terminated type_id strings
+// 	SnapshotArchetype[ num_archetypes ]
+// 	uint32_t[ num_archetype_words ]          // per archetype: component type indices, then column offsets
+// 	Entity[ num_entities ]
+// 	uint32_t[ num_free_entity_slots ]
+// 	(padding)
+// 	chunks, CHUNK_SIZE bytes each, starting at chunks_offset, which is a multiple of CHUNK_SIZE
+//
+static constexpr char     SNAPSHOT_MAGIC[ 8 ] = { 'L', 'E', '_', 'E', 'C', 'S', '0', '1' };
+static constexpr uint32_t SNAPSHOT_VERSION    = 1;
+
+struct SnapshotHeader {
+	char     magic[ 8 ];
+	uint32_t version;
+	uint32_t chunk_size;
+	uint32_t num_component_types;
+	uint32_t type_names_size;
+	uint32_t num_archetypes;
+	uint32_t num_archetype_words;
+	uint32_t num_entities;
+	uint32_t num_free_entity_slots;
+	uint64_t num_chunks;
+	uint64_t chunks_offset;
+};
+
+struct SnapshotComponentType {
+	uint64_t type_hash;
+	uint32_t num_bytes;
+	uint32_t name_offset; // offset into type names
+};
+
+struct SnapshotArchetype {
+	uint32_t num_components; // component types, including flag-only component types
+	uint32_t num_columns;
+	uint32_t chunk_capacity;
+	uint32_t entity_count;
+	uint32_t num_chunks;
+	uint32_t first_chunk; // index of first chunk of this archetype in chunk area
+};
+
+// ----------------------------------------------------------------------
+// Write all entities, and their components, to a file at `path`. Systems and their state
+// are not part of a snapshot. Deferred changes must have been flushed.
+static bool le_ecs_snapshot_write( le_ecs_o const* self, char const* path ) {
+
+	for ( auto buffer : self->command_buffers ) {
+		assert( ( nullptr == buffer || buffer->commands.empty() ) && "deferred changes must be flushed before writing a snapshot" );
+	}
+
+	SnapshotHeader header{};
+	memcpy( header.magic, SNAPSHOT_MAGIC, sizeof( header.magic ) );
+	header.version               = SNAPSHOT_VERSION;
+	header.chunk_size            = CHUNK_SIZE;
+	header.num_component_types   = uint32_t( self->component_types.size() );
+	header.num_archetypes        = uint32_t( self->archetypes.size() );
+	header.num_entities          = uint32_t( self->entities.size() );
+	header.num_free_entity_slots = uint32_t( self->free_entity_slots.size() );
+
+	std::vector<SnapshotComponentType> types;
+	std::vector<char>                  type_names;
+
+	for ( auto const& type : self->component_types ) {
+		types.push_back( { type.type_hash, type.num_bytes, uint32_t( type_names.size() ) } );
+		type_names.insert( type_names.end(), type.type_id, type.type_id + strlen( type.type_id ) + 1 );
+	}
+
+	header.type_names_size = uint32_t( type_names.size() );
+
+	std::vector<SnapshotArchetype> archetypes;
+	std::vector<uint32_t>          archetype_words;
+
+	for ( auto const& archetype : self->archetypes ) {
+		SnapshotArchetype a{};
+		a.num_components = uint32_t( archetype.components.size() );
+		a.num_columns    = uint32_t( archetype.column_offsets.size() );
+		a.chunk_capacity = archetype.chunk_capacity;
+		a.entity_count   = archetype.entity_count;
+		a.num_chunks     = ( archetype.entity_count + archetype.chunk_capacity - 1 ) / archetype.chunk_capacity; // spare chunks are not saved
+		a.first_chunk    = uint32_t( header.num_chunks );
+		header.num_chunks += a.num_chunks;
+		archetypes.push_back( a );
+		archetype_words.insert( archetype_words.end(), archetype.components.begin(), archetype.components.end() );
+		archetype_words.insert( archetype_words.end(), archetype.column_offsets.begin(), archetype.column_offsets.end() );
+	}
+
+	header.num_archetype_words = uint32_t( archetype_words.size() );
+
+	uint64_t offset = sizeof( SnapshotHeader ) +
+	                  sizeof( SnapshotComponentType ) * types.size() +
+	                  type_names.size() +
+	                  sizeof( SnapshotArchetype ) * archetypes.size() +
+	                  sizeof( uint32_t ) * archetype_words.size() +
+	                  sizeof( Entity ) * self->entities.size() +
+	                  sizeof( uint32_t ) * self->free_entity_slots.size();
+
+	header.chunks_offset = ( offset + CHUNK_SIZE - 1 ) / CHUNK_SIZE * CHUNK_SIZE;
+
+	FILE* f = fopen( path, "wb" );
+
+	if ( nullptr == f ) {
+		return false;
+	}
+
+	fwrite( &header, sizeof( header ), 1, f );
+	fwrite( types.data(), sizeof( SnapshotComponentType ), types.size(), f );
+	fwrite( type_names.data(), 1, type_names.size(), f );
+	fwrite( archetypes.data(), sizeof( SnapshotArchetype ), archetypes.size(), f );
+	fwrite( archetype_words.data(), sizeof( uint32_t ), archetype_words.size(), f );
+	fwrite( self->entities.data(), sizeof( Entity ), self->entities.size(), f );
+	fwrite( self->free_entity_slots.data(), sizeof( uint32_t ), self->free_entity_slots.size(), f );
+
+	static const uint8_t padding[ CHUNK_SIZE ] = {};
+	fwrite( padding, 1, header.chunks_offset - offset, f );
+
+	for ( size_t i = 0; i != archetypes.size(); i++ ) {
+		for ( uint32_t c = 0; c != archetypes[ i ].num_chunks; c++ ) {
+			fwrite( self->archetypes[ i ].chunks[ c ], CHUNK_SIZE, 1, f );
+		}
+	}
+
+	bool success = ( 0 == ferror( f ) );
+
+	fclose( f );
+
+	return success;
+}
+
+// ----------------------------------------------------------------------
+// Make the contents of the file at `path` available in memory, copy-on-write.
+static uint8_t* snapshot_map_file( char const* path, size_t* size ) {
+#ifdef _WIN32
+	// No mapping here - we read the file into memory instead.
+	FILE* f = fopen( path, "rb" );
+	if ( nullptr == f ) {
+		return nullptr;
+	}
+	fseek( f, 0, SEEK_END );
+	*size = size_t( ftell( f ) );
+	fseek( f, 0, SEEK_SET );
+	uint8_t* memory = static_cast<uint8_t*>( ::operator new( *size, std::align_val_t( COLUMN_ALIGNMENT ) ) );
+	if ( 1 != fread( memory, *size, 1, f ) ) {
+		::operator delete( memory, std::align_val_t( COLUMN_ALIGNMENT ) );
+		memory = nullptr;
+	}
+	fclose( f );
+	return memory;
+#else
+	int fd = open( path, O_RDONLY );
+	if ( fd < 0 ) {
+		return nullptr;
+	}
+	struct stat st;
+	void*       memory = MAP_FAILED;
+	if ( 0 == fstat( fd, &st ) && st.st_size > 0 ) {
+		*size  = size_t( st.st_size );
+		memory = mmap( nullptr, *size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0 );
+	}
+	close( fd ); // the mapping keeps the file alive
+	return memory == MAP_FAILED ? nullptr : static_cast<uint8_t*>( memory );
+#endif
+}
+
+// ----------------------------------------------------------------------
+// Check that everything which snapshot_load reads from a snapshot of `size` bytes stays
+// within the snapshot, and that all indices into snapshot sections are in range.
+//
+// Chunk contents, apart from column placement, are not checked.
+static bool snapshot_is_valid( uint8_t const* memory, size_t size ) {
+
+	if ( size < sizeof( SnapshotHeader ) ) {
+		return false;
+	}
+
+	SnapshotHeader const* header = reinterpret_cast<SnapshotHeader const*>( memory );
+
+	if ( 0 != memcmp( header->magic, SNAPSHOT_MAGIC, sizeof( header->magic ) ) ||
+	     header->version != SNAPSHOT_VERSION ||
+	     header->chunk_size != CHUNK_SIZE ||
+	     header->chunks_offset % CHUNK_SIZE != 0 ||
+	     header->chunks_offset > size ||
+	     header->num_chunks > ( size - header->chunks_offset ) / CHUNK_SIZE ) {
+		return false;
+	}
+
+	// All counts are 32 bit, so that section sizes can't overflow 64 bit offsets.
+
+	uint64_t sections_size = sizeof( SnapshotHeader ) +
+	                         sizeof( SnapshotComponentType ) * uint64_t( header->num_component_types ) +
+	                         header->type_names_size +
+	                         sizeof( SnapshotArchetype ) * uint64_t( header->num_archetypes ) +
+	                         sizeof( uint32_t ) * uint64_t( header->num_archetype_words ) +
+	                         sizeof( Entity ) * uint64_t( header->num_entities ) +
+	                         sizeof( uint32_t ) * uint64_t( header->num_free_entity_slots );
+
+	if ( sections_size > header->chunks_offset ) {
+		return false;
+	}
+
+	auto types           = reinterpret_cast<SnapshotComponentType const*>( header + 1 );
+	auto type_names      = reinterpret_cast<char const*>( types + header->num_component_types );
+	auto archetypes      = reinterpret_cast<SnapshotArchetype const*>( type_names + header->type_names_size );
+	auto archetype_words = reinterpret_cast<uint32_t const*>( archetypes + header->num_archetypes );
+	auto entities        = reinterpret_cast<Entity const*>( archetype_words + header->num_archetype_words );
+	auto free_slots      = reinterpret_cast<uint32_t const*>( entities + header->num_entities );
+
+	// Type names must be null-terminated - it's enough to check the last one, as long as
+	// all names start within the names section.
+
+	if ( header->type_names_size && type_names[ header->type_names_size - 1 ] != '\0' ) {
+		return false;
+	}
+
+	for ( uint32_t i = 0; i != header->num_component_types; i++ ) {
+		if ( types[ i ].name_offset >= header->type_names_size ) {
+			return false;
+		}
+	}
+
+	uint64_t num_words = 0;
+
+	for ( uint32_t a = 0; a != header->num_archetypes; a++ ) {
+
+		SnapshotArchetype const& src = archetypes[ a ];
+
+		num_words += uint64_t( src.num_components ) + src.num_columns;
+
+		if ( num_words > header->num_archetype_words ||
+		     src.chunk_capacity == 0 ||
+		     uint64_t( src.chunk_capacity ) * sizeof( uint64_t ) > CHUNK_SIZE || // entity ids come first
+		     uint64_t( src.first_chunk ) + src.num_chunks > header->num_chunks ||
+		     src.entity_count > uint64_t( src.num_chunks ) * src.chunk_capacity ) {
+			return false;
+		}
+
+		uint32_t const* src_components = archetype_words + num_words - src.num_components - src.num_columns;
+		uint32_t const* src_offsets    = src_components + src.num_components;
+		uint32_t        column         = 0;
+
+		for ( uint32_t k = 0; k != src.num_components; k++ ) {
+			if ( src_components[ k ] >= header->num_component_types ) {
+				return false;
+			}
+			uint32_t num_bytes = types[ src_components[ k ] ].num_bytes;
+			if ( num_bytes > 0 ) {
+				if ( column == src.num_columns ||
+				     src_offsets[ column ] + uint64_t( num_bytes ) * src.chunk_capacity > CHUNK_SIZE ) {
+					return false;
+				}
+				column++;
+			}
+		}
+
+		if ( column != src.num_columns ) {
+			return false;
+		}
+	}
+
+	for ( uint32_t i = 0; i != header->num_entities; i++ ) {
+		if ( entities[ i ].archetype != NO_ARCHETYPE &&
+		     ( entities[ i ].archetype >= header->num_archetypes ||
+		       entities[ i ].row >= archetypes[ entities[ i ].archetype ].entity_count ) ) {
+			return false;
+		}
+	}
+
+	for ( uint32_t i = 0; i != header->num_free_entity_slots; i++ ) {
+		if ( free_slots[ i ] >= header->num_entities || entities[ free_slots[ i ] ].archetype != NO_ARCHETYPE ) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// ----------------------------------------------------------------------
+// Load a snapshot into an ecs which does not hold any entities yet. Chunks point into the
+// snapshot file, which we map copy-on-write: pages only get copied once they are written to.
+//
+// Component types which the ecs already knows (e.g. because systems use them) must have
+// the same size as in the snapshot. If the layout of an archetype differs from the snapshot
+// (this may happen if component type ids differ) we fall back to copying its components.
+static bool le_ecs_snapshot_load( le_ecs_o* self, char const* path ) {
+
+	if ( !self->entities.empty() || self->snapshot_memory ) {
+		assert( false && "snapshots may only be loaded into an empty ecs" );
+		return false;
+	}
+
+	size_t   size   = 0;
+	uint8_t* memory = snapshot_map_file( path, &size );
+
+	if ( nullptr == memory ) {
+		return false;
+	}
+
+	self->snapshot_memory = memory;
+	self->snapshot_size   = size;
+
+	if ( !snapshot_is_valid( memory, size ) ) {
+		le_ecs_release_snapshot_memory( self );
+		return false;
+	}
+
+	SnapshotHeader const* header = reinterpret_cast<SnapshotHeader const*>( memory );
+
+	auto types           = reinterpret_cast<SnapshotComponentType const*>( header + 1 );
+	auto type_names      = reinterpret_cast<char const*>( types + header->num_component_types );
+	auto archetypes      = reinterpret_cast<SnapshotArchetype const*>( type_names + header->type_names_size );
+	auto archetype_words = reinterpret_cast<uint32_t const*>( archetypes + header->num_archetypes );
+	auto entities        = reinterpret_cast<Entity const*>( archetype_words + header->num_archetype_words );
+	auto free_slots      = reinterpret_cast<uint32_t const*>( entities + header->num_entities );
+
+	for ( uint32_t i = 0; i != header->num_component_types; i++ ) {
+		size_t index = le_ecs_find_component_type_index( self, { types[ i ].type_hash, nullptr, 0 } );
+		if ( index != self->component_types.size() && self->component_types[ index ].num_bytes != types[ i ].num_bytes ) {
+			assert( false && "component type size in snapshot does not match" );
+			le_ecs_release_snapshot_memory( self );
+			return false;
+		}
+	}
+
+	// ----------| Invariant: snapshot is consistent with this ecs - from here on we don't fail.
+
+	// Component type names live in the snapshot memory, which stays mapped for as long as the ecs.
+
+	std::vector<uint32_t> type_map( header->num_component_types ); // snapshot component type index -> component type index
+
+	for ( uint32_t i = 0; i != header->num_component_types; i++ ) {
+		type_map[ i ] = uint32_t( le_ecs_produce_component_type_index( self, { types[ i ].type_hash, type_names + types[ i ].name_offset, types[ i ].num_bytes } ) );
+	}
+
+	std::vector<uint32_t> archetype_map( header->num_archetypes ); // snapshot archetype index -> archetype index
+	bool                  archetypes_keep_indices = true;
+	uint32_t              tick                    = le_ecs_structural_tick( self );
+
+	uint8_t* const chunks = memory + header->chunks_offset;
+
+	for ( uint32_t a = 0; a != header->num_archetypes; a++ ) {
+
+		SnapshotArchetype const& src            = archetypes[ a ];
+		uint32_t const*          src_components = archetype_words;
+		uint32_t const*          src_offsets    = archetype_words + src.num_components;
+
+		archetype_words += src.num_components + src.num_columns;
+
+		ComponentSet components;
+		for ( uint32_t k = 0; k != src.num_components; k++ ) {
+			component_set_insert( components, type_map[ src_components[ k ] ] );
+		}
+
+		archetype_map[ a ] = le_ecs_produce_archetype( self, components );
+		archetypes_keep_indices &= ( archetype_map[ a ] == a );
+
+		Archetype& dst = self->archetypes[ archetype_map[ a ] ];
+
+		// Chunks may be used in place if all columns are where we expect them.
+
+		bool same_layout = ( dst.chunks.empty() && dst.chunk_capacity == src.chunk_capacity && dst.column_offsets.size() == src.num_columns );
+
+		for ( uint32_t k = 0, column = 0; same_layout && k != src.num_components; k++ ) {
+			if ( types[ src_components[ k ] ].num_bytes > 0 ) {
+				same_layout = ( src_offsets[ column ] == dst.column_offsets[ archetype_find_column( dst, type_map[ src_components[ k ] ] ) ] );
+				column++;
+			}
+		}
+
+		if ( same_layout ) {
+			for ( uint32_t c = 0; c != src.num_chunks; c++ ) {
+				dst.chunks.push_back( chunks + size_t( src.first_chunk + c ) * CHUNK_SIZE );
+			}
+			dst.entity_count = src.entity_count;
+			dst.changed_ticks.assign( dst.chunks.size() * dst.components.size(), tick );
+			dst.added_ticks.assign( dst.chunks.size() * dst.components.size(), tick );
+		} else {
+			// Slow path: copy row by row. Rows keep their indices, as dst is empty.
+			for ( uint32_t row = 0; row != src.entity_count; row++ ) {
+				uint8_t const* src_chunk = chunks + size_t( src.first_chunk + row / src.chunk_capacity ) * CHUNK_SIZE;
+				uint32_t       src_row   = row % src.chunk_capacity;
+				uint32_t       dst_row   = archetype_push_row( dst, reinterpret_cast<uint64_t const*>( src_chunk )[ src_row ] );
+				for ( uint32_t k = 0, column = 0; k != src.num_components; k++ ) {
+					uint32_t num_bytes = types[ src_components[ k ] ].num_bytes;
+					if ( num_bytes > 0 ) {
+						memcpy( archetype_data_at( dst, archetype_find_column( dst, type_map[ src_components[ k ] ] ), dst_row ),
+						        src_chunk + src_offsets[ column ] + num_bytes * src_row, num_bytes );
+						column++;
+					}
+				}
+			}
+			std::fill( dst.changed_ticks.begin(), dst.changed_ticks.end(), tick );
+			std::fill( dst.added_ticks.begin(), dst.added_ticks.end(), tick );
+		}
+	}
+
+	self->entities.assign( entities, entities + header->num_entities );
+	self->free_entity_slots.assign( free_slots, free_slots + header->num_free_entity_slots );
+
+	if ( !archetypes_keep_indices ) {
+		for ( auto& entity : self->entities ) {
+			if ( entity.archetype != NO_ARCHETYPE ) {
+				entity.archetype = archetype_map[ entity.archetype ];
+			}
+		}
+	}
+
+	return true;
+}
+
+// ----------------------------------------------------------------------
+
+LE_MODULE_REGISTER_IMPL( le_ecs, api ) {
+	auto& le_ecs_i = static_cast<le_ecs_api*>( api )->le_ecs_i;
+
+	le_ecs_i.create  = le_ecs_create;
+	le_ecs_i.destroy = le_ecs_destroy;
 
 	le_ecs_i.entity_create           = le_ecs_entity_create;
 	le_ecs_i.entity_remove           = le_ecs_entity_remove;
@@ -514,9 +2121,29 @@ LE_MODULE_REGISTER_IMPL( le_ecs, api ) {
 	le_ecs_i.entity_remove_component = le_ecs_entity_remove_component;
 
 	le_ecs_i.system_create              = le_ecs_system_create;
+	le_ecs_i.system_destroy             = le_ecs_system_destroy;
 	le_ecs_i.system_add_read_component  = le_ecs_system_add_read_component;
 	le_ecs_i.system_set_method          = le_ecs_system_set_method;
 	le_ecs_i.system_add_write_component = le_ecs_system_add_write_component;
 
-	le_ecs_i.execute_system = le_ecs_execute_system;
+	le_ecs_i.system_set_chunk_method = le_ecs_system_set_chunk_method;
+	le_ecs_i.system_query_next       = le_ecs_system_query_next;
+
+	le_ecs_i.system_add_changed_filter      = le_ecs_system_add_changed_filter;
+	le_ecs_i.system_add_added_filter        = le_ecs_system_add_added_filter;
+	le_ecs_i.system_track_removed_component = le_ecs_system_track_removed_component;
+	le_ecs_i.system_get_removed             = le_ecs_system_get_removed;
+
+	le_ecs_i.deferred_entity_create           = le_ecs_deferred_entity_create;
+	le_ecs_i.deferred_entity_remove           = le_ecs_deferred_entity_remove;
+	le_ecs_i.deferred_entity_component_at     = le_ecs_deferred_entity_component_at;
+	le_ecs_i.deferred_entity_remove_component = le_ecs_deferred_entity_remove_component;
+	le_ecs_i.flush_deferred                   = le_ecs_flush_deferred;
+
+	le_ecs_i.execute_system          = le_ecs_execute_system;
+	le_ecs_i.execute_system_parallel = le_ecs_execute_system_parallel;
+	le_ecs_i.execute_systems         = le_ecs_execute_systems;
+
+	le_ecs_i.snapshot_write = le_ecs_snapshot_write;
+	le_ecs_i.snapshot_load  = le_ecs_snapshot_load;
 }
@@ -5,7 +5,7 @@
 #include "assert.h" // FIXME: we shouldn't include this here.
 
 struct le_ecs_o;
-typedef struct EntityId_T* EntityId;
+typedef struct EntityId_T* EntityId; // opaque handle; becomes stale once its entity has been removed
 typedef struct SystemId_T* LeEcsSystemId;
 
 // clang-format off
@@ -19,6 +19,18 @@ struct le_ecs_api {
 
 	typedef void ( *system_fn )( EntityId entity, void const **read_params, void **write_params, void* user_data );
 
+	// Called once per span of `count` entities; params point to the first component of each
+	// type in the span, and components of the same type are tightly packed.
+	typedef void ( *system_chunk_fn )( uint32_t count, EntityId const * entities, void const **read_params, void **write_params, void* user_data );
+
+	// Zero-initialise before first call to system_query_next.
+	struct QueryIterator {
+		uint32_t        next_archetype; // internal
+		uint32_t        next_chunk;     // internal
+		uint32_t        count;          // number of entities in current span
+		EntityId const* entities;       // entity ids for current span
+	};
+
 	struct le_ecs_interface_t {
 
 		le_ecs_o * ( * create            ) ( );
@@ -34,6 +46,8 @@ struct le_ecs_api {
 		void  ( *entity_remove_component   )( le_ecs_o *self, EntityId entity_id, ComponentType const & component_type );
 
 		LeEcsSystemId  ( *system_create    )( le_ecs_o *self );
+		// Frees a system - its id may be handed out again by system_create, and must not be used anymore.
+		void           ( *system_destroy   )( le_ecs_o *self, LeEcsSystemId system_id );
 
 		void (* system_set_method          )( le_ecs_o*self, LeEcsSystemId system_id, system_fn fn);
 		bool (* system_add_write_component )( le_ecs_o *self, LeEcsSystemId system_id, ComponentType const &component_type );
@@ -42,8 +56,68 @@ struct le_ecs_api {
 		// TODO: we should probaly name all write components read/write components,
 		// as it appears that write implies read.
 
+		void ( *system_set_chunk_method    )( le_ecs_o *self, LeEcsSystemId system_id, system_chunk_fn fn );
+
+		// Iterate over spans of entities which match the system's components. Each call
+		// fills `read_params` and `write_params` with one pointer per read or write component,
+		// in the order in which they were added to the system (nullptr for flag components).
+		// Returns false once all spans have been visited.
+		bool ( *system_query_next          )( le_ecs_o *self, LeEcsSystemId system_id, QueryIterator* it, void const ** read_params, void ** write_params );
+
+		// Change detection - a system run starts with the first call to system_query_next, and
+		// any write access by a run counts as a change to all entities in a span. Changes are
+		// tracked per chunk, which means that a filter may let through some unchanged entities.
+		//
+		// Filters restrict a system to entities whose component of the given type was changed
+		// (or added) since the system's last complete run. Entities must have the component.
+		bool ( *system_add_changed_filter      )( le_ecs_o *self, LeEcsSystemId system_id, ComponentType const &component_type );
+		bool ( *system_add_added_filter        )( le_ecs_o *self, LeEcsSystemId system_id, ComponentType const &component_type );
+
+		// Start tracking entities which lose a component of the given type, or which get removed.
+		// system_get_removed then returns the number of entities which lost the component since
+		// the system's last complete run; `entities` receives their handles, which may be stale.
+		bool     ( *system_track_removed_component )( le_ecs_o *self, LeEcsSystemId system_id, ComponentType const &component_type );
+		uint32_t ( *system_get_removed             )( le_ecs_o *self, LeEcsSystemId system_id, ComponentType const &component_type, EntityId const ** entities );
+
+		// Deferred structural changes - use these from within systems. Changes are recorded into
+		// a per-thread command buffer, and only applied once you call flush_deferred. Handles
+		// returned by deferred_entity_create may only be used with deferred methods until then.
+		// deferred_entity_component_at returns memory into which to write component data.
+		//
+		// Outside of le_jobs worker threads, only one thread may record deferred changes.
+		EntityId ( *deferred_entity_create           )( le_ecs_o *self );
+		void     ( *deferred_entity_remove           )( le_ecs_o *self, EntityId entity_id );
+		void*    ( *deferred_entity_component_at     )( le_ecs_o *self, EntityId entity_id, ComponentType const & component_type );
+		void     ( *deferred_entity_remove_component )( le_ecs_o *self, EntityId entity_id, ComponentType const & component_type );
+
+		// Apply all deferred changes - must not be called while systems execute.
+		void     ( *flush_deferred                   )( le_ecs_o *self );
+
 		void ( *execute_system             )( le_ecs_o *self, LeEcsSystemId system_id, void* user_data ) ;
 
+		// Like execute_system, but spans of entities are processed in parallel, on le_jobs worker
+		// threads. System methods must be safe to call concurrently, including any access to
+		// `user_data`. Runs on the calling thread, as execute_system, if le_jobs is not initialised.
+		void ( *execute_system_parallel    )( le_ecs_o *self, LeEcsSystemId system_id, void* user_data ) ;
+
+		// Execute `num_systems` systems, each with its own `user_data` (which may be nullptr).
+		// Systems which don't write to components which another system reads or writes run
+		// concurrently, as le_jobs jobs; conflicting systems run in the order in which they
+		// are given. Returns once all systems have completed. If le_jobs is not initialised,
+		// systems run one after another on the calling thread, in the order in which they are given.
+		void ( *execute_systems            )( le_ecs_o *self, LeEcsSystemId const* system_ids, void* const* user_data, uint32_t num_systems );
+
+		// Snapshots hold all entities and their components, but no systems. Component data is
+		// stored verbatim, which means that snapshots can only be loaded by builds which use
+		// the same component types, on machines with the same byte order.
+		//
+		// Deferred changes must be flushed before writing a snapshot. A snapshot may only be loaded
+		// into an ecs which has no entities yet: loading maps the snapshot file copy-on-write,
+		// and entities' components stay in the mapped file until they are written to. Loading
+		// returns false, and leaves the ecs empty, if the file is not a valid snapshot.
+		bool ( *snapshot_write             )( le_ecs_o const *self, char const *path );
+		bool ( *snapshot_load              )( le_ecs_o *self, char const *path );
+
 		
 	};
 
@@ -56,6 +130,9 @@ LE_MODULE_LOAD_DEFAULT( le_ecs );
 
 #ifdef __cplusplus
 
+#	include <utility>     // for std::index_sequence
+#	include <type_traits> // for std::remove_const_t
+
 #	define LE_ECS_FLAG_COMPONENT( TypeName )          \
 		struct TypeName {                              \
 			static constexpr auto type_id = #TypeName; \
@@ -84,6 +161,34 @@ LE_MODULE_LOAD_DEFAULT( le_ecs );
 namespace le_ecs {
 static const auto& api      = le_ecs_api_i;
 static const auto& le_ecs_i = api -> le_ecs_i;
+
+// Tightly packed range of components of type T, as handed out by queries.
+template <typename T>
+struct Span {
+	T*       data;
+	uint32_t count;
+
+	T& operator[]( uint32_t i ) const {
+		return data[ i ];
+	}
+	T* begin() const {
+		return data;
+	}
+	T* end() const {
+		return data + count;
+	}
+	uint32_t size() const {
+		return count;
+	}
+};
+
+// Use these to list the component types which a LeEcsQuery reads or writes.
+template <typename... T>
+struct Read {};
+
+template <typename... T>
+struct Write {};
+
 } // namespace le_ecs
 
 class LeEcs : NoCopy, NoMove {
@@ -140,11 +245,26 @@ class LeEcs : NoCopy, NoMove {
 	template <typename T>
 	T& entity_component_get( EntityId entity_id );
 
+	// -- deferred changes: safe to use from within systems; applied on flush_deferred()
+
+	inline EntityId deferred_create_entity();
+	inline void     deferred_remove_entity( EntityId entity );
+
+	template <typename T>
+	inline void deferred_add_component( EntityId entity_id, const T&& component );
+
+	template <typename T>
+	inline void deferred_remove_component( EntityId entity_id );
+
+	inline void flush_deferred();
+
 	// -- systems
 
 	inline LeEcsSystemId create_system();
+	inline void          destroy_system( LeEcsSystemId system_id );
 
 	inline void system_set_method( LeEcsSystemId system_id, le_ecs_api::system_fn fn );
+	inline void system_set_chunk_method( LeEcsSystemId system_id, le_ecs_api::system_chunk_fn fn );
 
 	template <typename T>
 	inline bool system_add_read_component( LeEcsSystemId system_id );
@@ -158,7 +278,27 @@ class LeEcs : NoCopy, NoMove {
 	template <typename R, typename S, typename... T>
 	inline bool system_add_write_component( LeEcsSystemId system_id );
 
+	template <typename T>
+	inline bool system_add_changed_filter( LeEcsSystemId system_id );
+
+	template <typename T>
+	inline bool system_add_added_filter( LeEcsSystemId system_id );
+
+	template <typename T>
+	inline bool system_track_removed_component( LeEcsSystemId system_id );
+
+	// Entities which lost component T since the system last ran; handles may be stale.
+	template <typename T>
+	inline le_ecs::Span<EntityId const> system_get_removed( LeEcsSystemId system_id );
+
 	inline void update_system( LeEcsSystemId system_id, void* user_data );
+	inline void update_system_parallel( LeEcsSystemId system_id, void* user_data );
+	inline void update_systems( LeEcsSystemId const* system_ids, void* const* user_data, uint32_t num_systems );
+
+	// -- snapshots
+
+	inline bool write_snapshot( char const* path ) const;
+	inline bool load_snapshot( char const* path );
 
 	class SystemBuilder {
 		LeEcs&        parent;
@@ -196,6 +336,24 @@ class LeEcs : NoCopy, NoMove {
 			return *this;
 		}
 
+		template <typename T>
+		SystemBuilder& add_changed_filter() {
+			parent.system_add_changed_filter<T>( id );
+			return *this;
+		}
+
+		template <typename T>
+		SystemBuilder& add_added_filter() {
+			parent.system_add_added_filter<T>( id );
+			return *this;
+		}
+
+		template <typename T>
+		SystemBuilder& track_removed_component() {
+			parent.system_track_removed_component<T>( id );
+			return *this;
+		}
+
 		LeEcsSystemId build() {
 			return id;
 		}
@@ -230,6 +388,102 @@ constexpr le_ecs_api::ComponentType const le_ecs_get_component_type() {
 	constexpr le_ecs_api::ComponentType ct{ hash_64_fnv1a_const( T::type_id ), T::type_id, component_size };
 	return static_cast<le_ecs_api::ComponentType const>( ct );
 }
+// ----------------------------------------------------------------------
+// Typed query over all entities which have components R... and W...;
+// components R... are read-only, components W... are writable.
+//
+// 	LeEcsQuery<le_ecs::Read<Velocity>, le_ecs::Write<Position>> physics( ecs );
+//
+// 	physics.for_each_span( []( le_ecs::Span<EntityId const> entities,
+// 	                           le_ecs::Span<Velocity const> vel,
+// 	                           le_ecs::Span<Position>       pos ) {
+// 		for ( uint32_t i = 0; i != entities.size(); i++ ) {
+// 			pos[ i ].pos += vel[ i ].vel;
+// 		}
+// 	} );
+//
+// Spans for flag components have a `data` pointer of nullptr.
+//
+// Each query owns a system, which it destroys along with itself - queries may be
+// short-lived, but filters (`changed`, `added`) only make sense for a query which
+// lives across runs, as they compare against the query's previous run.
+//
+template <typename Reads, typename Writes>
+class LeEcsQuery;
+
+template <typename... R, typename... W>
+class LeEcsQuery<le_ecs::Read<R...>, le_ecs::Write<W...>> : NoCopy, NoMove {
+	LeEcs&        ecs;
+	LeEcsSystemId id;
+
+	template <typename Fn, size_t... I, size_t... J>
+	static void call( Fn& fn, le_ecs_api::QueryIterator const& it, void const** read_params, void** write_params, std::index_sequence<I...>, std::index_sequence<J...> ) {
+		fn( le_ecs::Span<EntityId const>{ it.entities, it.count },
+		    le_ecs::Span<R const>{ static_cast<R const*>( read_params[ I ] ), it.count }...,
+		    le_ecs::Span<W>{ static_cast<W*>( write_params[ J ] ), it.count }... );
+	}
+
+	template <typename T>
+	static T& element( T* data, uint32_t i ) {
+		if constexpr ( le_ecs_get_component_type<std::remove_const_t<T>>().num_bytes == 0 ) {
+			static std::remove_const_t<T> flag{}; // flag components have no storage
+			return flag;
+		} else {
+			return data[ i ];
+		}
+	}
+
+  public:
+	LeEcsQuery( LeEcs& ecs_ )
+	    : ecs( ecs_ )
+	    , id( ecs_.create_system() ) {
+		( ecs.system_add_read_component<R>( id ), ... );
+		( ecs.system_add_write_component<W>( id ), ... );
+	}
+
+	~LeEcsQuery() {
+		ecs.destroy_system( id );
+	}
+
+	// Calls fn( Span<EntityId const>, Span<R const>..., Span<W>... ) once per span of matching entities.
+	template <typename Fn>
+	void for_each_span( Fn&& fn ) {
+		le_ecs_api::QueryIterator it{};
+		void const*               read_params[ sizeof...( R ) + 1 ];
+		void*                     write_params[ sizeof...( W ) + 1 ];
+		while ( le_ecs::le_ecs_i.system_query_next( ecs, id, &it, read_params, write_params ) ) {
+			call( fn, it, read_params, write_params, std::index_sequence_for<R...>{}, std::index_sequence_for<W...>{} );
+		}
+	}
+
+	// Calls fn( EntityId, R const&..., W&... ) once per matching entity.
+	template <typename Fn>
+	void for_each( Fn&& fn ) {
+		for_each_span( [ &fn ]( le_ecs::Span<EntityId const> entities, le_ecs::Span<R const>... r, le_ecs::Span<W>... w ) {
+			for ( uint32_t i = 0; i != entities.count; i++ ) {
+				fn( entities.data[ i ], element( r.data, i )..., element( w.data, i )... );
+			}
+		} );
+	}
+
+	// Only visit entities whose component T changed, or was added, since the query last ran.
+	template <typename T>
+	LeEcsQuery& changed() {
+		ecs.system_add_changed_filter<T>( id );
+		return *this;
+	}
+
+	template <typename T>
+	LeEcsQuery& added() {
+		ecs.system_add_added_filter<T>( id );
+		return *this;
+	}
+
+	LeEcsSystemId system_id() const {
+		return id;
+	}
+};
+
 // ----------------------------------------------------------------------
 
 EntityId LeEcs::create_entity() {
@@ -248,24 +502,97 @@ T& LeEcs::entity_component_get( EntityId entity_id ) {
 };
 // ----------------------------------------------------------------------
 
+EntityId LeEcs::deferred_create_entity() {
+	return le_ecs::le_ecs_i.deferred_entity_create( self );
+}
+
+// ----------------------------------------------------------------------
+
+void LeEcs::deferred_remove_entity( EntityId entity ) {
+	le_ecs::le_ecs_i.deferred_entity_remove( self, entity );
+}
+
+// ----------------------------------------------------------------------
+
+template <typename T>
+void LeEcs::deferred_add_component( EntityId entity_id, const T&& component ) {
+	constexpr auto ct  = le_ecs_get_component_type<T>();
+	void*          mem = le_ecs::le_ecs_i.deferred_entity_component_at( self, entity_id, ct );
+	if ( ct.num_bytes != 0 ) {
+		new ( mem )( T ){ component }; // placement new
+	}
+}
+
+// ----------------------------------------------------------------------
+
+template <typename T>
+void LeEcs::deferred_remove_component( EntityId entity_id ) {
+	constexpr auto ct = le_ecs_get_component_type<T>();
+	le_ecs::le_ecs_i.deferred_entity_remove_component( self, entity_id, ct );
+}
+
+// ----------------------------------------------------------------------
+
+void LeEcs::flush_deferred() {
+	le_ecs::le_ecs_i.flush_deferred( self );
+}
+
+// ----------------------------------------------------------------------
+
 LeEcsSystemId LeEcs::create_system() {
 	return le_ecs::le_ecs_i.system_create( self );
 }
 
 // ----------------------------------------------------------------------
 
+void LeEcs::destroy_system( LeEcsSystemId system_id ) {
+	le_ecs::le_ecs_i.system_destroy( self, system_id );
+}
+
+// ----------------------------------------------------------------------
+
 void LeEcs::system_set_method( LeEcsSystemId system_id, le_ecs_api::system_fn fn ) {
 	le_ecs::le_ecs_i.system_set_method( self, system_id, fn );
 }
 
 // ----------------------------------------------------------------------
 
+void LeEcs::system_set_chunk_method( LeEcsSystemId system_id, le_ecs_api::system_chunk_fn fn ) {
+	le_ecs::le_ecs_i.system_set_chunk_method( self, system_id, fn );
+}
+
+// ----------------------------------------------------------------------
+
 void LeEcs::update_system( LeEcsSystemId system_id, void* user_data ) {
 	le_ecs::le_ecs_i.execute_system( self, system_id, user_data );
 }
 
 // ----------------------------------------------------------------------
 
+void LeEcs::update_system_parallel( LeEcsSystemId system_id, void* user_data ) {
+	le_ecs::le_ecs_i.execute_system_parallel( self, system_id, user_data );
+}
+
+// ----------------------------------------------------------------------
+
+void LeEcs::update_systems( LeEcsSystemId const* system_ids, void* const* user_data, uint32_t num_systems ) {
+	le_ecs::le_ecs_i.execute_systems( self, system_ids, user_data, num_systems );
+}
+
+// ----------------------------------------------------------------------
+
+bool LeEcs::write_snapshot( char const* path ) const {
+	return le_ecs::le_ecs_i.snapshot_write( self, path );
+}
+
+// ----------------------------------------------------------------------
+
+bool LeEcs::load_snapshot( char const* path ) {
+	return le_ecs::le_ecs_i.snapshot_load( self, path );
+}
+
+// ----------------------------------------------------------------------
+
 template <typename R, typename S, typename... T>
 bool LeEcs::system_add_write_component( LeEcsSystemId system_id ) {
 	bool result = true;
@@ -302,6 +629,40 @@ bool LeEcs::system_add_write_component( LeEcsSystemId system_id ) {
 
 // ----------------------------------------------------------------------
 
+template <typename T>
+bool LeEcs::system_add_changed_filter( LeEcsSystemId system_id ) {
+	constexpr auto ct = le_ecs_get_component_type<T>();
+	return le_ecs::le_ecs_i.system_add_changed_filter( self, system_id, ct );
+}
+
+// ----------------------------------------------------------------------
+
+template <typename T>
+bool LeEcs::system_add_added_filter( LeEcsSystemId system_id ) {
+	constexpr auto ct = le_ecs_get_component_type<T>();
+	return le_ecs::le_ecs_i.system_add_added_filter( self, system_id, ct );
+}
+
+// ----------------------------------------------------------------------
+
+template <typename T>
+bool LeEcs::system_track_removed_component( LeEcsSystemId system_id ) {
+	constexpr auto ct = le_ecs_get_component_type<T>();
+	return le_ecs::le_ecs_i.system_track_removed_component( self, system_id, ct );
+}
+
+// ----------------------------------------------------------------------
+
+template <typename T>
+le_ecs::Span<EntityId const> LeEcs::system_get_removed( LeEcsSystemId system_id ) {
+	constexpr auto  ct       = le_ecs_get_component_type<T>();
+	EntityId const* entities = nullptr;
+	uint32_t        count    = le_ecs::le_ecs_i.system_get_removed( self, system_id, ct, &entities );
+	return { entities, count };
+}
+
+// ----------------------------------------------------------------------
+
 template <typename T>
 bool LeEcs::entity_add_component( EntityId entity_id, const T&& component ) {
 
@@ -1,15 +1,37 @@
 #include "le_jobs.h"
 #include "le_core.h"
+#include "le_log.h"
 
 #include <atomic>
-#include <mutex>
-#include <forward_list>
-#include <list>
 #include <cstdlib> // for malloc
+#include <cstring> // for memcpy
 #include <thread>
+#include <algorithm>
 #include "assert.h"
 
+#if defined( __x86_64 ) || defined( _M_X64 )
+#	include <immintrin.h> // for _mm_pause
+#endif
+
+#ifdef _WIN32
+#	define WIN32_LEAN_AND_MEAN
+#	include <windows.h> // for VirtualAlloc
+#else
+#	include <sys/mman.h> // for mmap
+#	include <unistd.h>   // for sysconf
+#endif
+
+#ifdef __linux__
+#	include <sys/syscall.h>    // for SYS_mbind
+#	include <linux/mempolicy.h> // for MPOL_PREFERRED
+#endif
+
 #include "private/lockfree_ring_buffer.h"
+#include "private/chase_lev_deque.h"
+#include "private/le_jobs_trace.h"
+#include "private/le_cpu_topology.h"
+
+static auto logger = le::Log( "le_jobs" );
 
 struct le_fiber_o;
 struct le_worker_thread_o;
@@ -18,12 +40,37 @@ extern "C" void asm_call_fiber_exit( void );
 extern "C" int  asm_switch( le_fiber_o* to, le_fiber_o* from, int switch_to_guest );
 extern "C" void asm_fetch_default_control_words( uint64_t* );
 
-struct le_jobs_api::counter_t {
-	std::atomic<uint32_t> data{ 0 };
+struct le_continuation_o;
+
+// Something which waits for a counter to reach zero: either a fiber, which must be
+// resumed, or a continuation, whose jobs must be issued.
+struct le_counter_waiter_o {
+	le_counter_waiter_o* next         = nullptr; // intrusive list
+	le_fiber_o*          fiber        = nullptr; // set if waiter is a fiber
+	le_continuation_o*   continuation = nullptr; // set if waiter is a continuation
+};
+
+// Counters live in a pool owned by the job manager - each counter takes up its own
+// cache line so that updating one counter does not invalidate its neighbours.
+//
+// Fibers and continuations which wait for a counter add themselves to the counter's
+// list of waiters. Whoever brings the counter to zero closes this list, hands each
+// waiting fiber back to the worker thread which hosts it, and issues each waiting
+// continuation.
+struct alignas( 64 ) le_jobs_api::counter_t {
+	std::atomic<uint32_t>             data{ 0 };
+	std::atomic<le_counter_waiter_o*> waiters{ nullptr }; // intrusive list of waiters, or COUNTER_CLOSED once counter has reached zero
 };
 
+// Marks the list of waiters for a counter as closed: the counter has reached
+// zero, and nobody may wait for it anymore.
+static le_counter_waiter_o* const COUNTER_CLOSED = reinterpret_cast<le_counter_waiter_o*>( uintptr_t( 1 ) );
+
 using counter_t = le_jobs_api::counter_t;
 using le_job_o  = le_jobs_api::le_job_o;
+using Priority  = le_jobs_api::Priority;
+
+constexpr static size_t NUM_PRIORITIES = size_t( Priority::eBackground ) + 1;
 
 /* NOTE - consider appropriate stack size.
  *
@@ -34,15 +81,40 @@ using le_job_o  = le_jobs_api::le_job_o;
  * trace using data-breakpoints. If heap memory is magically overwritten by another thread
  * - without you wanting it - this is a symptom of stack spill.
  *
- * We keep the stack size at 8 MB, which seems to be standard on linux. Don't worry about the
- * potentially large size, memory overcommitting makes sure that physical memory only gets
+ * We keep the default stack size at 8 MB, which seems to be standard on linux. Don't worry
+ * about the potentially large size, stacks are mapped so that physical memory only gets
  * allocated if you really need it.
  *
+ * To catch stack spill early, we place a guard page below each stack: writing to it
+ * triggers an access violation right where the spill happens.
+ *
+ * Stack sizes and fiber counts are set via le_jobs_settings_t.
+ *
  */
 
-constexpr static size_t FIBER_POOL_SIZE         = 128;     // Number of available fibers, each with their own stack
-constexpr static size_t FIBER_STACK_SIZE        = 1 << 23; // 2^23 == 8 MB
-constexpr static size_t MAX_WORKER_THREAD_COUNT = 16;      // Maximum number of possible, but not necessarily requested worker threads.
+constexpr static size_t MAX_WORKER_THREAD_COUNT = LE_JOBS_MAX_WORKER_THREAD_COUNT; // Maximum number of possible, but not necessarily requested worker threads.
+constexpr static size_t MAX_CPU_COUNT           = 1024;                            // Maximum number of logical CPUs which we consider for placing worker threads.
+constexpr static size_t WORKER_DEQUE_SIZE_LOG2  = 10;                              // Capacity of each worker's local job deque, as a power of 2 (10 == 1024 jobs).
+constexpr static size_t COUNTER_POOL_SIZE       = 1024;                            // Maximum number of counters which may be in use at the same time.
+constexpr static size_t JOB_POOL_SIZE           = 1 << 14;                         // Maximum number of jobs which may be queued at the same time.
+constexpr static size_t JOB_SLOT_CACHE_SIZE     = 64;                              // Number of free job slots which each worker may keep for itself.
+constexpr static size_t RANGE_POOL_SIZE         = 1024;                            // Maximum number of parallel_for sub-ranges which may be queued at the same time.
+constexpr static size_t CONTINUATION_POOL_SIZE  = 1024;                            // Maximum number of continuations which may wait for their predecessor at the same time.
+constexpr static size_t CONTINUATION_LOCAL_JOBS = 4;                               // Number of jobs which a continuation can hold without allocating.
+constexpr static size_t WORKER_SPIN_COUNT_MIN   = 16;                              // Lower bound for how many times an idle worker polls for work before it parks
+constexpr static size_t WORKER_SPIN_COUNT_MAX   = 4096;                            // Upper bound for how many times an idle worker polls for work before it parks
+
+enum class WORKER_PARK_STATE : uint32_t {
+	eRunning = 0,
+	eParked  = 1, // worker is asleep, or about to go to sleep - set back to eRunning to wake it up
+};
+
+enum class FIBER_CLASS : uint32_t {
+	eDefault    = 0, // fibers with default-sized stacks
+	eSmallStack = 1, // fibers with small stacks, for leaf jobs
+};
+
+constexpr static size_t NUM_FIBER_CLASSES = 2;
 
 enum class FIBER_STATUS : uint64_t {
 	eIdle       = 0,
@@ -66,22 +138,99 @@ enum class FIBER_STATUS : uint64_t {
 struct le_fiber_o {
 	void**                    stack                = nullptr;             // pointer to address of current stack
 	void*                     job_param            = nullptr;             // parameter pointer for job
-	void*                     stack_bottom         = nullptr;             // allocation address so that it may be freed
-	counter_t*                fiber_await_counter  = nullptr;             // owned by le_job_manager, must be nullptr, or counter->data must be zero for fiber to start/resume
+	void*                     stack_bottom         = nullptr;             // lowest address of stack - the guard page sits just below
+	size_t                    stack_size           = 0;                   // size of stack in bytes, not including guard page
+	uint32_t                  node                 = 0;                   // NUMA node on which this fiber's stack lives
+	counter_t*                fiber_await_counter  = nullptr;             // counter which this fiber waits for - while set, the fiber is owned by the counter's list of waiters
+	le_counter_waiter_o       counter_waiter       = {};                  // links this fiber into the list of waiters of fiber_await_counter
+	le_worker_thread_o*       owner_worker         = nullptr;             // worker thread hosting this fiber while it waits - it must resume on this worker
 	counter_t*                job_complete_counter = nullptr;             // owned by le_job_manager
+	Priority                  job_priority         = Priority::eNormal;   // priority of current job, inherited by any sub-range jobs it issues
 	uint64_t                  job_complete         = 0;                   // flag whether job was completed.
 	std::atomic<FIBER_STATUS> fiber_status         = FIBER_STATUS::eIdle; // flag whether fiber is currently active
 	le_fiber_o*               list_prev            = nullptr;             // intrusive list
 	le_fiber_o*               list_next            = nullptr;             // intrusive list
+	uint64_t                  trace_job_id         = 0;                   // id of current job, only set while tracing
+	uint64_t                  trace_job_fun_ptr    = 0;                   // function of current job, only set while tracing
 	constexpr static size_t   NUM_REGISTERS        = 6;                   // must save RBX, RBP, and R12..R15
 };
 
+/* Lock-free stack of indices into a pool of preallocated objects (a Treiber stack).
+ *
+ * The head holds the index of the first free element in its lower 32 bits, and
+ * a tag in its upper 32 bits. The tag is incremented with every pop, so that
+ * a pop which raced against a pop-push sequence of the same index fails its CAS
+ * (this is how we guard against the ABA problem).
+ */
+struct le_index_free_list_t {
+	constexpr static uint32_t END = ~uint32_t( 0 ); // index which marks end of list
+
+	std::atomic<uint64_t>  head{ END };
+	std::atomic<uint32_t>* next = nullptr; // next[ i ] holds index of the free element following element i
+};
+
+/* Shared state for all sub-ranges of one call to parallel_for, or parallel_reduce.
+ * This lives on the stack of the caller, which waits until all sub-ranges have completed.
+ */
+struct le_parallel_task_t {
+	le_jobs_api::range_fun_ptr_t  range_fn           = nullptr; // set for parallel_for
+	le_jobs_api::reduce_fun_ptr_t reduce_fn          = nullptr; // set for parallel_reduce
+	void*                         user_data          = nullptr; //
+	uint64_t                      grain              = 1;       // upper bound for number of elements passed to range_fn/reduce_fn at once
+	counter_t*                    counter            = nullptr; // number of outstanding sub-range jobs
+	Priority                      priority           = Priority::eNormal;
+	char*                         accumulators       = nullptr; // parallel_reduce only: one accumulator per worker
+	size_t                        accumulator_stride = 0;       // parallel_reduce only: distance in bytes between accumulators
+};
+
+// A sub-range of a parallel task - this is what range jobs get as their parameter.
+// Owned by the job manager, which keeps these in a pool.
+struct le_parallel_range_o {
+	le_parallel_task_t* task;
+	uint64_t            begin;
+	uint64_t            end;
+};
+
+// Jobs which get issued once their predecessor counter reaches zero.
+// Owned by the job manager, which keeps these in a pool.
+struct le_continuation_o {
+	le_counter_waiter_o waiter      = {};      // links continuation into the list of waiters of predecessor
+	counter_t*          predecessor = nullptr; // owned by continuation - freed once continuation gets issued
+	counter_t*          counter     = nullptr; // counter for jobs of this continuation
+	le_job_o*           jobs        = nullptr; // points to local_jobs, or to heap memory if there are more jobs than fit into local_jobs
+	uint32_t            num_jobs    = 0;       //
+	le_job_o            local_jobs[ CONTINUATION_LOCAL_JOBS ];
+};
+
+struct le_fiber_pool_t {
+	le_fiber_o** fibers     = nullptr; // fibers of this pool, each with their own stack
+	size_t       count      = 0;       // number of fibers in this pool
+	size_t       stack_size = 0;       // stack size for all fibers in this pool
+};
+
 struct le_job_manager_o {
-	std::mutex                    counters_mtx;                // mutex protecting counters list
-	std::forward_list<counter_t*> counters;                    // storage for counters, list.
-	le_fiber_o*                   fibers[ FIBER_POOL_SIZE ]{}; // pool of available fibers
-	lockfree_ring_buffer_t*       job_queue;                   // queue onto which to push jobs
-	size_t                        worker_thread_count = 0;     // actual number of initialised worker threads
+	counter_t*              counter_pool = nullptr;           // preallocated counters, COUNTER_POOL_SIZE elements
+	le_index_free_list_t    counter_free_list;                // indices of counters in counter_pool which are available
+	le_job_o*               job_pool = nullptr;               // preallocated job slots, JOB_POOL_SIZE elements - job queues point into this
+	le_index_free_list_t    job_free_list;                    // indices of job slots in job_pool which are available
+	le_parallel_range_o*    range_pool = nullptr;             // preallocated sub-ranges for parallel_for, RANGE_POOL_SIZE elements
+	le_index_free_list_t    range_free_list;                  // indices of sub-ranges in range_pool which are available
+	le_continuation_o*      continuation_pool = nullptr;      // preallocated continuations, CONTINUATION_POOL_SIZE elements
+	le_index_free_list_t    continuation_free_list;           // indices of continuations in continuation_pool which are available
+	le_fiber_pool_t         fiber_pools[ NUM_FIBER_CLASSES ]; // pools of available fibers, one per FIBER_CLASS
+	lockfree_ring_buffer_t* job_queue[ NUM_PRIORITIES ];      // global queues for jobs issued from outside the job system, or overflowing a worker's deque
+	size_t                  worker_thread_count = 0;          // actual number of initialised worker threads
+	uint32_t                node_count          = 1;          // number of NUMA nodes which host worker threads
+
+	std::atomic<uint32_t> parked_worker_count{ 0 };   // number of worker threads which are currently parked
+	std::atomic<uint32_t> external_waiter_count{ 0 }; // number of threads outside the job system waiting for a counter
+	std::atomic<uint32_t> counter_epoch{ 0 };         // incremented when a counter reaches zero while there are external waiters
+
+	std::atomic<bool> tracing_enabled{ false };       // whether workers currently record trace events
+	uint32_t          trace_buffer_size_log2 = 0;       // capacity of per-worker trace buffers, 0 if tracing is not available
+	uint64_t*         job_enqueue_time       = nullptr; // per job slot: timestamp at which job was issued, only allocated if tracing is available
+	uint64_t          tracing_start_time     = 0;       // timestamp at which tracing was last enabled
+	uint64_t          tracing_stop_time      = 0;       // timestamp at which tracing was last disabled, 0 while tracing is enabled
 };
 
 struct le_fiber_list_t {
@@ -92,29 +241,125 @@ struct le_fiber_list_t {
 /*
  * A worker thread is the motor providing execution power for fibers.
  *
- * Worker threads are pinned to CPUs.
+ * Worker threads are pinned to CPUs, following the placement policy given
+ * in le_jobs_settings_t.
  *
  * Worker threads pull in fibers so that that they can execute jobs.
- * If a fiber yields within a worker thread,
- * it is put on the worker thread's wait_list. If a fiber is ready to
- * resume, it is taken from the wait_list and put on the ready_list.
+ *
+ * Each worker thread owns a deque of jobs per priority. Jobs which are issued
+ * from a fiber running on a worker thread are pushed onto that worker's deque,
+ * from which the worker pops in LIFO order. Workers which run out of work
+ * first look at the global job queue, then try to steal jobs from the
+ * top of a randomly chosen victim's deque. Jobs of a higher priority are
+ * always looked for before jobs of a lower priority.
+ *
+ * A worker which can't find any work spins for a while, and then parks
+ * itself until it gets woken up by one of: new jobs being issued, a counter
+ * which one of its fibers waits for reaching zero, or the job system
+ * terminating.
+ *
+ * If a fiber yields because it waits for a counter, it is put on that
+ * counter's list of waiting fibers. Once the counter reaches zero, the fiber
+ * is pushed onto its worker thread's resume_inbox, from where the worker moves
+ * it to its ready_list. Scheduling cost is therefore independent of how many
+ * fibers are waiting.
  *
  */
 struct le_worker_thread_o {
 	le_fiber_o      host_fiber{};          // Host context which does the switching
 	le_fiber_o*     guest_fiber = nullptr; // current fiber executing inside this worker thread
 	std::thread     thread      = {};      //
-	std::thread::id thread_id   = {};      //
-	le_fiber_list_t wait_list   = {};      // list of fibers which need checking their condition
+	int32_t         worker_id   = -1;      // index of this worker in static_worker_threads
 	le_fiber_list_t ready_list  = {};      // list of fibers ready to resume after yield
+
+	std::atomic<le_fiber_o*> resume_inbox{ nullptr }; // fibers which became ready, pushed by any thread - linked via list_next
 	uint64_t        stop_thread = 0;       // flag, value `1` tells worker to join
+
+	chase_lev_deque_t* job_deque[ NUM_PRIORITIES ]{};             // local jobs - only this worker may push/pop, other workers may steal
+	Priority           lowest_priority = Priority::eBackground; // lowest priority of jobs which this worker may run
+	uint64_t           rng_state       = 0;                     // state for xorshift random number generator, used to pick steal victims
+
+	uint32_t  cpu                      = ~0u;     // logical cpu to which this worker is pinned, ~0u if not pinned
+	uint32_t  cache                    = 0;       // last-level cache which this worker's cpu uses
+	uint32_t  node                     = 0;       // NUMA node of this worker's cpu
+	uint32_t* steal_victims            = nullptr; // indices of all other workers, ordered by distance: same cache, then same node, then all others
+	uint32_t  steal_victims_same_cache = 0;       // number of steal victims which share our last-level cache
+	uint32_t  steal_victims_same_node  = 0;       // number of steal victims which share our cache, or our NUMA node
+
+	std::atomic<WORKER_PARK_STATE> park_state = WORKER_PARK_STATE::eRunning; // futex word for parking this worker
+	uint32_t                       spin_count = WORKER_SPIN_COUNT_MIN;       // adaptive: how many times to poll for work before parking
+
+	uint32_t job_slot_cache[ JOB_SLOT_CACHE_SIZE ]; // indices of free job slots which this worker may use without touching the shared free list
+	uint32_t job_slot_cache_count = 0;              // number of valid entries in job_slot_cache
+
+	le_jobs_trace_buffer_t* trace_buffer    = nullptr; // events recorded by this worker, only allocated if tracing is available
+	uint64_t                trace_job_count = 0;       // number of jobs which this worker started while tracing, used to generate job ids
+	std::atomic<uint64_t>   trace_jobs_run{ 0 };       // statistics - only written by this worker, while tracing
+	std::atomic<uint64_t>   trace_steals{ 0 };         //
+	std::atomic<uint64_t>   trace_busy_ns{ 0 };        //
+	std::atomic<uint64_t>   trace_parked_ns{ 0 };      //
+	le_jobs_worker_stats_t  trace_stats_baseline{};    // statistics at the time at which tracing was last enabled
 };
 
-static le_worker_thread_o* static_worker_threads[ MAX_WORKER_THREAD_COUNT ]{};
+static le_worker_thread_o* static_worker_threads[ MAX_WORKER_THREAD_COUNT + 1 ]{}; // nullptr-terminated
 static le_job_manager_o*   job_manager = nullptr; ///< job manager singleton, must be initialised via initialise(), and terminated via terminate().
 
+// Worker which owns the current thread, or nullptr if the current thread is not a worker thread.
+// Set once when a worker thread starts - since fibers never migrate between worker threads,
+// this stays valid for any fiber which runs on the current thread.
+static thread_local le_worker_thread_o* current_worker_thread = nullptr;
+
 static uint64_t DEFAULT_CONTROL_WORDS = 0; // storage for default control words (must be 8 byte, == 2 words)
 
+// ----------------------------------------------------------------------
+// Initialises free list so that all `count` elements are available.
+static void le_index_free_list_init( le_index_free_list_t* list, uint32_t count ) {
+	list->next = new std::atomic<uint32_t>[ count ];
+	for ( uint32_t i = 0; i != count; i++ ) {
+		list->next[ i ] = ( i + 1 == count ) ? le_index_free_list_t::END : i + 1;
+	}
+	list->head = count ? 0 : le_index_free_list_t::END;
+}
+
+// ----------------------------------------------------------------------
+
+static void le_index_free_list_destroy( le_index_free_list_t* list ) {
+	delete[] list->next;
+	list->next = nullptr;
+	list->head = le_index_free_list_t::END;
+}
+
+// ----------------------------------------------------------------------
+// Returns index of an available element, or le_index_free_list_t::END if
+// no more elements are available.
+static uint32_t le_index_free_list_pop( le_index_free_list_t* list ) {
+	uint64_t head = list->head.load( std::memory_order_acquire );
+	for ( ;; ) {
+		uint32_t index = uint32_t( head );
+		if ( index == le_index_free_list_t::END ) {
+			return index;
+		}
+		uint64_t tag      = ( head >> 32 ) + 1;
+		uint64_t new_head = ( tag << 32 ) | list->next[ index ].load( std::memory_order_relaxed );
+		if ( list->head.compare_exchange_weak( head, new_head, std::memory_order_acquire, std::memory_order_acquire ) ) {
+			return index;
+		}
+	}
+}
+
+// ----------------------------------------------------------------------
+// Marks element at index as available.
+static void le_index_free_list_push( le_index_free_list_t* list, uint32_t index ) {
+	uint64_t head = list->head.load( std::memory_order_relaxed );
+	for ( ;; ) {
+		list->next[ index ].store( uint32_t( head ), std::memory_order_relaxed );
+		uint64_t new_head = ( head & ~uint64_t( 0xffffffff ) ) | index;
+		if ( list->head.compare_exchange_weak( head, new_head, std::memory_order_release, std::memory_order_relaxed ) ) {
+			return;
+		}
+	}
+}
+
 // ----------------------------------------------------------------------
 void fiber_list_push_back( le_fiber_list_t* list, le_fiber_o* element ) {
 
@@ -174,18 +419,87 @@ void fiber_list_remove_element( le_fiber_list_t* list, le_fiber_o* element ) {
 }
 
 // ----------------------------------------------------------------------
-// Creates a fiber object, and allocates memory for this fiber
-static le_fiber_o* le_fiber_create() {
 
-	le_fiber_o* fiber = new le_fiber_o();
+static size_t get_page_size() {
+#ifdef _WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo( &info );
+	return size_t( info.dwPageSize );
+#else
+	return size_t( sysconf( _SC_PAGESIZE ) );
+#endif
+}
 
-	/* Create a 16-byte aligned stack */
-	static_assert( FIBER_STACK_SIZE % 16 == 0, "stack size must be 16 byte-aligned." );
+// ----------------------------------------------------------------------
+// Reserve address space for a stack of `stack_size` bytes, plus one guard
+// page below it. On Linux, the mapping is not charged against the commit limit,
+// and physical memory only gets backed once a page is touched. On Windows, the
+// whole stack gets committed up front - our fibers switch stacks by hand, so we
+// can't rely on the OS growing a reserved stack via its guard page mechanism.
+// If `node` is not ~0u, physical memory preferably comes from this NUMA node.
+// Returns lowest usable address of the stack, or nullptr on failure.
+static void* le_fiber_stack_allocate( size_t stack_size, size_t page_size, uint32_t node ) {
+	size_t const mapping_size = stack_size + page_size;
+#ifdef _WIN32
+	char* mapping = static_cast<char*>( VirtualAlloc( nullptr, mapping_size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE ) );
+	if ( mapping == nullptr ) {
+		return nullptr;
+	}
+	DWORD old_protect;
+	if ( !VirtualProtect( mapping, page_size, PAGE_NOACCESS, &old_protect ) ) {
+		VirtualFree( mapping, 0, MEM_RELEASE );
+		return nullptr;
+	}
+#else
+	char* mapping = static_cast<char*>( mmap( nullptr, mapping_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0 ) );
+	if ( mapping == MAP_FAILED ) {
+		return nullptr;
+	}
+	// Stacks grow downwards - the guard page must therefore sit at the lowest address.
+	if ( 0 != mprotect( mapping, page_size, PROT_NONE ) ) {
+		munmap( mapping, mapping_size );
+		return nullptr;
+	}
+#	ifdef __linux__
+	if ( node < 64 ) {
+		// This is only a hint - if it fails, memory comes from wherever the first touch happens.
+		unsigned long node_mask = 1ul << node;
+		syscall( SYS_mbind, mapping + page_size, stack_size, MPOL_PREFERRED, &node_mask, sizeof( node_mask ) * 8, 0 );
+	}
+#	endif
+#endif
+	return mapping + page_size;
+}
+
+// ----------------------------------------------------------------------
+
+static void le_fiber_stack_free( void* stack_bottom, size_t stack_size, size_t page_size ) {
+	char* mapping = static_cast<char*>( stack_bottom ) - page_size;
+#ifdef _WIN32
+	( void )stack_size;
+	VirtualFree( mapping, 0, MEM_RELEASE );
+#else
+	munmap( mapping, stack_size + page_size );
+#endif
+}
+
+// ----------------------------------------------------------------------
+// Creates a fiber object, and allocates memory for this fiber.
+// `stack_size` must be a multiple of the page size. Pass ~0u for `node` if
+// the stack should not be bound to any NUMA node.
+static le_fiber_o* le_fiber_create( size_t stack_size, uint32_t node ) {
+
+	le_fiber_o* fiber = new le_fiber_o();
 
-	fiber->stack_bottom = malloc( FIBER_STACK_SIZE );
+	fiber->stack_bottom = le_fiber_stack_allocate( stack_size, get_page_size(), node );
+	fiber->node         = ( node == ~0u ) ? 0 : node;
 
-	if ( fiber->stack_bottom == nullptr )
+	if ( fiber->stack_bottom == nullptr ) {
+		delete fiber;
 		return nullptr;
+	}
+
+	fiber->stack_size = stack_size;
 
 	return fiber;
 }
@@ -193,7 +507,7 @@ static le_fiber_o* le_fiber_create() {
 // ----------------------------------------------------------------------
 
 static void le_fiber_destroy( le_fiber_o* fiber ) {
-	free( fiber->stack_bottom );
+	le_fiber_stack_free( fiber->stack_bottom, fiber->stack_size, get_page_size() );
 	delete ( fiber );
 }
 
@@ -201,7 +515,7 @@ static void le_fiber_destroy( le_fiber_o* fiber ) {
 // Associate a fiber with a job
 static void le_fiber_load_job( le_fiber_o* fiber, le_fiber_o* host_fiber, le_job_o* job ) {
 
-	fiber->stack = reinterpret_cast<void**>( static_cast<char*>( fiber->stack_bottom ) + FIBER_STACK_SIZE );
+	fiber->stack = reinterpret_cast<void**>( static_cast<char*>( fiber->stack_bottom ) + fiber->stack_size );
 	//
 	// We push host_fiber and guest_fiber (==fiber) onto the stack so
 	// that fiber_exit method can retrieve this information via popping
@@ -228,31 +542,140 @@ static void le_fiber_load_job( le_fiber_o* fiber, le_fiber_o* host_fiber, le_job
 	fiber->job_param            = job->fun_param;
 	fiber->job_complete         = 0;
 	fiber->job_complete_counter = job->complete_counter;
+	fiber->job_priority         = job->priority;
 	fiber->fiber_await_counter  = nullptr;
 }
 
 // ----------------------------------------------------------------------
 
 static inline int32_t get_current_worker_thread_id() {
-	int32_t result         = -1;
-	auto    this_thread_id = std::this_thread::get_id();
+	return current_worker_thread ? current_worker_thread->worker_id : -1;
+}
 
-	int i = 0;
-	for ( le_worker_thread_o** t = static_worker_threads; *t != nullptr; ++t, ++i ) {
-		if ( this_thread_id == ( *t )->thread_id ) {
-			return i;
+// ----------------------------------------------------------------------
+// return pointer to current worker thread providing context,
+// or nullptr if no current worker thread could be found.
+static inline le_worker_thread_o* get_current_thread() {
+	return current_worker_thread;
+}
+
+// ----------------------------------------------------------------------
+
+static inline void cpu_relax() {
+#if defined( __x86_64 ) || defined( _M_X64 )
+	_mm_pause();
+#endif
+}
+
+// ----------------------------------------------------------------------
+// Wake up a worker thread, if it is parked.
+static void le_worker_thread_wake( le_worker_thread_o* w ) {
+	if ( WORKER_PARK_STATE::eParked == w->park_state.exchange( WORKER_PARK_STATE::eRunning ) ) {
+		w->park_state.notify_one();
+	}
+}
+
+// ----------------------------------------------------------------------
+// Wake up one parked worker thread which may run jobs of the given priority, if there is any.
+// Returns false if there was no parked worker to wake up.
+static bool le_job_manager_wake_one_worker( Priority priority ) {
+
+	// This fence pairs with the fence in le_worker_thread_park: either we
+	// see the parked worker here, or the worker sees the work that we
+	// published before calling this method.
+	std::atomic_thread_fence( std::memory_order_seq_cst );
+
+	if ( 0 == job_manager->parked_worker_count.load( std::memory_order_relaxed ) ) {
+		return false;
+	}
+
+	for ( le_worker_thread_o** t = static_worker_threads; *t != nullptr; ++t ) {
+		if ( priority > ( *t )->lowest_priority ) {
+			continue;
+		}
+		auto expected = WORKER_PARK_STATE::eParked;
+		if ( ( *t )->park_state.compare_exchange_strong( expected, WORKER_PARK_STATE::eRunning ) ) {
+			( *t )->park_state.notify_one();
+			return true;
 		}
 	}
 
-	return result;
+	return false;
 }
 
 // ----------------------------------------------------------------------
-// return pointer to current worker thread providing context,
-// or nullptr if no current worker thread could be found.
-static le_worker_thread_o* get_current_thread() {
-	int32_t worker_thread_id = get_current_worker_thread_id();
-	return ( worker_thread_id == -1 ) ? nullptr : static_worker_threads[ worker_thread_id ];
+// Hand a fiber which has become ready back to the worker thread which hosts it.
+// May be called from any thread.
+static void le_worker_thread_push_ready_fiber( le_worker_thread_o* w, le_fiber_o* fiber ) {
+
+	le_fiber_o* head = w->resume_inbox.load( std::memory_order_relaxed );
+
+	do {
+		fiber->list_next = head;
+	} while ( !w->resume_inbox.compare_exchange_weak( head, fiber, std::memory_order_release, std::memory_order_relaxed ) );
+
+	le_worker_thread_wake( w );
+}
+
+// ----------------------------------------------------------------------
+// Add waiter to the list of waiters for counter.
+// Returns false if the counter has already reached zero, in which case there is no need to wait.
+static bool le_counter_add_waiter( counter_t* counter, le_counter_waiter_o* waiter ) {
+
+	le_counter_waiter_o* head = counter->waiters.load();
+
+	do {
+		if ( head == COUNTER_CLOSED ) {
+			return false;
+		}
+		waiter->next = head;
+	} while ( !counter->waiters.compare_exchange_weak( head, waiter ) );
+
+	return true;
+}
+
+// ----------------------------------------------------------------------
+
+static void le_continuation_issue( le_continuation_o* continuation ); // ffdecl
+
+// ----------------------------------------------------------------------
+// Close a counter which has reached zero, and wake up anyone waiting for it.
+static void le_counter_close( counter_t* counter ) {
+
+	// Close the list of waiters, hand each waiting fiber back to its worker,
+	// and issue each waiting continuation.
+	//
+	// Note that we must not touch the counter after closing it, as its waiter
+	// may free the counter as soon as it sees the counter closed.
+	le_counter_waiter_o* w = counter->waiters.exchange( COUNTER_CLOSED );
+
+	while ( w ) {
+		le_counter_waiter_o* next = w->next; // we must capture next here, as the waiter may get reused once we hand it on
+		if ( w->fiber ) {
+			le_worker_thread_push_ready_fiber( w->fiber->owner_worker, w->fiber );
+		} else {
+			le_continuation_issue( w->continuation );
+		}
+		w = next;
+	}
+
+	if ( job_manager->external_waiter_count.load() ) {
+		++job_manager->counter_epoch;
+		job_manager->counter_epoch.notify_all();
+	}
+}
+
+// ----------------------------------------------------------------------
+// Decrement counter, and wake up anyone waiting for the counter should it have reached zero.
+static void le_job_manager_counter_decrement( counter_t* counter ) {
+
+	if ( 0 != --counter->data ) {
+		return;
+	}
+
+	// --------| invariant: counter has reached zero
+
+	le_counter_close( counter );
 }
 
 // ----------------------------------------------------------------------
@@ -263,8 +686,8 @@ static void le_fiber_yield() {
 
 	// - We need to find out the thread which did yield.
 	//
-	// We do this by comparing the yielding thread's id
-	// with the stored worker thread ids.
+	// Each worker thread stores itself in the thread_local
+	// `current_worker_thread`, which get_current_thread() reads.
 	//
 	le_worker_thread_o* yielding_thread = get_current_thread();
 
@@ -290,7 +713,7 @@ static void le_fiber_yield() {
 extern "C" void ATTR_NO_RETURN fiber_exit( le_fiber_o* host_fiber, le_fiber_o* guest_fiber ) {
 
 	if ( guest_fiber->job_complete_counter ) {
-		--guest_fiber->job_complete_counter->data;
+		le_job_manager_counter_decrement( guest_fiber->job_complete_counter );
 	}
 
 	guest_fiber->job_complete = 1;
@@ -303,208 +726,781 @@ extern "C" void ATTR_NO_RETURN fiber_exit( le_fiber_o* host_fiber, le_fiber_o* g
 }
 
 // ----------------------------------------------------------------------
-
-static void le_worker_thread_dispatch( le_worker_thread_o* self ) {
-
-	// -- Check all fibers on the wait list, and add them to the ready list
-	// should their condition have become true.
-	//
-	for ( auto it_f = self->wait_list.begin; it_f != nullptr; ) {
-
-		le_fiber_o* f = it_f;            // We must capture f here,
-		it_f          = it_f->list_next; // and increase iterator, since it_f may be invalidated because of remove op
-
-		if ( nullptr == f->fiber_await_counter || 0 == f->fiber_await_counter->data ) {
-			fiber_list_remove_element( &self->wait_list, f ); // Must first remove, since list op is intrusive and will update the fiber
-			fiber_list_push_back( &self->ready_list, f );     // This will also update the fiber
-		}
-	}
-
-	// -- If there is any fiber in the ready-list, we must switch to that fiber.
-	//
-	if ( self->ready_list.begin ) {
-		self->guest_fiber = self->ready_list.begin;
-		fiber_list_remove_element( &self->ready_list, self->ready_list.begin );
-	}
-
-	if ( nullptr == self->guest_fiber ) {
-
-		// find first available idle fiber
-		size_t i = 0;
-		for ( i = 0; i != FIBER_POOL_SIZE; ++i ) {
-			auto fib_idle = FIBER_STATUS::eIdle; // < value to compare against
-
-			if ( job_manager->fibers[ i ]->fiber_status.compare_exchange_weak( fib_idle, FIBER_STATUS::eProcessing ) ) {
-				// ----------| invariant: `fiber_active` was 0, is now atomically changed to 1
-				self->guest_fiber = job_manager->fibers[ i ];
-				break;
+// Fetch an unused job slot from the job pool.
+//
+// Worker threads keep a small cache of free job slots, so that most of the time
+// they don't have to touch the shared free list. Pass nullptr for `current_worker`
+// if called from outside the job system.
+static le_job_o* le_job_manager_allocate_job( le_worker_thread_o* current_worker ) {
+
+	if ( current_worker ) {
+
+		if ( 0 == current_worker->job_slot_cache_count ) {
+			// Refill cache with up to half its capacity, so that the next few
+			// frees don't immediately overflow it again.
+			for ( size_t i = 0; i != JOB_SLOT_CACHE_SIZE / 2; i++ ) {
+				uint32_t index = le_index_free_list_pop( &job_manager->job_free_list );
+				if ( index == le_index_free_list_t::END ) {
+					break;
+				}
+				current_worker->job_slot_cache[ current_worker->job_slot_cache_count++ ] = index;
 			}
 		}
 
-		if ( i == FIBER_POOL_SIZE ) {
-			// we could not find an available fiber, we must return empty-handed.
-			return;
+		if ( current_worker->job_slot_cache_count ) {
+			return job_manager->job_pool + current_worker->job_slot_cache[ --current_worker->job_slot_cache_count ];
 		}
+	}
 
-		// Pop the job which has been waiting the longest off the job queue
+	uint32_t index;
 
-		le_job_o* job = static_cast<le_job_o*>( lockfree_ring_buffer_trypop( job_manager->job_queue ) );
+	while ( le_index_free_list_t::END == ( index = le_index_free_list_pop( &job_manager->job_free_list ) ) ) {
+		// All job slots are in use - we must wait for a job to be picked up.
+		if ( current_worker ) {
+			le_fiber_yield();
+		} else {
+			std::this_thread::yield();
+		}
+	}
 
-		if ( nullptr == job ) {
-			// We couldn't get another job from the queue - this could mean that the queue is empty.
-			// anyway, let's wait a little bit before returning...
+	return job_manager->job_pool + index;
+}
 
-			self->guest_fiber->fiber_status = FIBER_STATUS::eIdle; // return fiber to pool
-			self->guest_fiber               = nullptr;
+// ----------------------------------------------------------------------
+// Return job slot to the job pool.
+static void le_job_manager_free_job( le_worker_thread_o* current_worker, le_job_o* job ) {
 
-			std::this_thread::sleep_for( std::chrono::nanoseconds( 100 ) );
-			return;
-		} else {
+	uint32_t index = uint32_t( job - job_manager->job_pool );
 
-			le_fiber_load_job( self->guest_fiber, &self->host_fiber, job );
+	if ( current_worker ) {
 
-			// we don't need job anymore after it was passed to fiber_setup
-			// and since the ring buffer did own the job, we must delete it
-			// here.
-			delete ( job );
+		if ( current_worker->job_slot_cache_count == JOB_SLOT_CACHE_SIZE ) {
+			// Cache is full - we give back half of it to the shared free list
+			for ( size_t i = 0; i != JOB_SLOT_CACHE_SIZE / 2; i++ ) {
+				le_index_free_list_push( &job_manager->job_free_list, current_worker->job_slot_cache[ --current_worker->job_slot_cache_count ] );
+			}
 		}
-	}
-
-	// --------| invariant: current_fiber contains a fiber
-
-	// We are only allowed to switch to a fiber if its await counter is zero,
-	// or unset. Otherwise this means that child jobs of a fiber are still
-	// executing.
 
-	if ( self->guest_fiber->fiber_await_counter && self->guest_fiber->fiber_await_counter->data != 0 ) {
-		// This fiber is not ready yet, as its dependent jobs are still executing.
-		// we must not process it further, instead place this fiber on the wait list.
-		assert( false );
+		current_worker->job_slot_cache[ current_worker->job_slot_cache_count++ ] = index;
 		return;
 	}
 
-	assert( self->guest_fiber->stack ); // address of stack must not be 0
+	le_index_free_list_push( &job_manager->job_free_list, index );
+}
 
-	// switch to guest fiber
-	asm_switch( self->guest_fiber, &self->host_fiber, 1 );
+// ----------------------------------------------------------------------
 
-	// If we're back here, this means that the fiber in current_fiber has
-	// finished executing for now. This can have two reasons:
-	//
-	// 1. Fiber did complete
-	// 2. Fiber did yield
+static inline bool le_job_manager_is_tracing() {
+	return job_manager->tracing_enabled.load( std::memory_order_relaxed );
+}
 
-	if ( 1 == self->guest_fiber->job_complete ) {
-		// Fiber was completed: We must return it to the pool
-		self->guest_fiber->stack        = nullptr;             // Reset fiber stack
-		self->guest_fiber->fiber_status = FIBER_STATUS::eIdle; // return fiber to pool !! do this as the last thing, otherwise other threads will already have taken ownership of it !!
-		self->guest_fiber               = nullptr;             // reset current fiber
-	} else {
-		// Fiber has yielded: We must add it to the wait_list.
-		fiber_list_push_back( &self->wait_list, self->guest_fiber );
-		self->guest_fiber = nullptr;
+// ----------------------------------------------------------------------
+// Record a trace event for the job currently loaded into `fiber` - or, if fiber is
+// nullptr, an event which is not about any job.
+static void le_worker_thread_trace( le_worker_thread_o* self, LE_JOBS_TRACE_EVENT type, uint64_t timestamp, le_fiber_o const* fiber ) {
+	le_jobs_trace_event_t event{};
+	event.timestamp = timestamp;
+	event.type      = type;
+	if ( fiber ) {
+		event.job_id      = fiber->trace_job_id;
+		event.job_fun_ptr = fiber->trace_job_fun_ptr;
+		event.priority    = uint16_t( fiber->job_priority );
 	}
+	le_jobs_trace_buffer_record( self->trace_buffer, event );
 }
 
 // ----------------------------------------------------------------------
-// Main loop for each worker thread
-//
-static void le_worker_thread_loop( le_worker_thread_o* self ) {
-
-	self->thread_id = std::this_thread::get_id();
-
-	while ( 0 == self->stop_thread ) {
-		le_worker_thread_dispatch( self );
+// Number of jobs which are waiting to be picked up by this worker - either from
+// the global queues, or from its own deques.
+static uint32_t le_worker_thread_get_queue_depth( le_worker_thread_o const* self ) {
+	size_t depth = 0;
+	for ( size_t p = 0; p != NUM_PRIORITIES; p++ ) {
+		depth += lockfree_ring_buffer_size( job_manager->job_queue[ p ] );
+		depth += chase_lev_deque_size( self->job_deque[ p ] );
 	}
+	return uint32_t( depth );
 }
 
 // ----------------------------------------------------------------------
+// Returns a pseudo-random number - we use this to pick victims for job stealing.
+static inline uint64_t le_worker_thread_random( le_worker_thread_o* self ) {
+	// xorshift64, see: Marsaglia, "Xorshift RNGs", 2003
+	uint64_t x = self->rng_state;
+	x ^= x << 13;
+	x ^= x >> 7;
+	x ^= x << 17;
+	return ( self->rng_state = x );
+}
 
-static void le_job_manager_initialize( size_t num_threads ) {
+// ----------------------------------------------------------------------
+// Find the next job of the given priority for this worker to execute.
+//
+// We look in order of increasing cost:
+// 1. This worker's own deque (most recently pushed job first, since its data is likely to be in cache)
+// 2. The global job queue
+// 3. The deques of other workers, starting with a random victim
+//
+// Returns nullptr if no job could be found.
+static le_job_o* le_worker_thread_fetch_job_with_priority( le_worker_thread_o* self, size_t priority ) {
 
-	assert( num_threads <= MAX_WORKER_THREAD_COUNT );
-	assert( num_threads > 0 && "num_threads must be > than 0" );
+	le_job_o* job = static_cast<le_job_o*>( chase_lev_deque_pop( self->job_deque[ priority ] ) );
 
-	assert( nullptr == job_manager );
+	if ( job ) {
+		return job;
+	}
 
-	asm_fetch_default_control_words( &DEFAULT_CONTROL_WORDS );
+	job = static_cast<le_job_o*>( lockfree_ring_buffer_trypop( job_manager->job_queue[ priority ] ) );
 
-	job_manager = new le_job_manager_o();
+	if ( job ) {
+		return job;
+	}
 
-	job_manager->job_queue = lockfree_ring_buffer_create( 10 ); // note size is given as a power of 2, so "10" means 1024 elements
+	// Try to steal - we first look at workers which share our cache, then at workers
+	// on the same NUMA node, and only then at all other workers. Within each group,
+	// we start with a randomly chosen victim.
+	uint32_t const group_end[ 3 ] = {
+	    self->steal_victims_same_cache,
+	    self->steal_victims_same_node,
+	    uint32_t( job_manager->worker_thread_count - 1 ),
+	};
 
-	// Allocate a number of fibers to execute jobs in.
-	for ( size_t i = 0; i != FIBER_POOL_SIZE; ++i ) {
-		job_manager->fibers[ i ] = le_fiber_create();
-	}
+	uint32_t group_begin = 0;
 
-	// Create a number of worker threads to host fibers in
-	for ( size_t i = 0; i != num_threads; ++i ) {
+	for ( uint32_t g = 0; g != 3; group_begin = group_end[ g ], ++g ) {
 
-		le_worker_thread_o* w = new le_worker_thread_o();
+		uint32_t const group_size = group_end[ g ] - group_begin;
 
-		w->thread = std::thread( le_worker_thread_loop, w );
+		if ( 0 == group_size ) {
+			continue;
+		}
 
-		auto pthread = w->thread.native_handle();
-#ifdef _MSC_VER
+		uint32_t victim = uint32_t( le_worker_thread_random( self ) % group_size );
 
-#else
-		cpu_set_t mask;
-		CPU_ZERO( &mask );
-		CPU_SET( i + 1, &mask );
-		pthread_setaffinity_np( pthread, sizeof( mask ), &mask );
-#endif //                                         \
-    // Thread in static ledger of threads so that \
-    // we may retrieve thread-ids later.
-		static_worker_threads[ i ] = w;
+		for ( uint32_t i = 0; i != group_size; ++i, victim = ( victim + 1 ) % group_size ) {
+
+			le_worker_thread_o* w = static_worker_threads[ self->steal_victims[ group_begin + victim ] ];
+
+			job = static_cast<le_job_o*>( chase_lev_deque_steal( w->job_deque[ priority ] ) );
+
+			if ( job ) {
+				if ( le_job_manager_is_tracing() ) {
+					self->trace_steals.store( self->trace_steals.load( std::memory_order_relaxed ) + 1, std::memory_order_relaxed );
+				}
+				return job;
+			}
+		}
 	}
 
-	job_manager->worker_thread_count = num_threads;
+	return nullptr;
 }
 
 // ----------------------------------------------------------------------
+// Find the next job for this worker to execute - we always pick the job with
+// the highest priority available. Returns nullptr if no job could be found.
+static le_job_o* le_worker_thread_fetch_job( le_worker_thread_o* self ) {
+
+	for ( size_t p = 0; p <= size_t( self->lowest_priority ); p++ ) {
+		le_job_o* job = le_worker_thread_fetch_job_with_priority( self, p );
+		if ( job ) {
+			return job;
+		}
+	}
 
-static void le_job_manager_terminate() {
-
-	assert( job_manager ); // job manager must exist
+	return nullptr;
+}
 
-	// - Send termination signal to all threads.
+// ----------------------------------------------------------------------
+// Take an idle fiber from the pool for the given fiber class - we prefer fibers
+// whose stack lives on the given NUMA node, but will take any idle fiber otherwise.
+// Returns nullptr if all fibers of this class are in use.
+static le_fiber_o* le_job_manager_acquire_fiber( FIBER_CLASS fiber_class, uint32_t node ) {
 
-	for ( le_worker_thread_o** t = &static_worker_threads[ 0 ]; *t != nullptr; ++t ) {
-		( *t )->stop_thread = 1;
-	}
+	le_fiber_pool_t const& pool = job_manager->fiber_pools[ size_t( fiber_class ) ];
 
-	// - Join all worker threads
+	// If there is only one node, any fiber is as good as any other, and we may skip the first pass.
+	for ( int pass = ( job_manager->node_count > 1 ) ? 0 : 1; pass != 2; ++pass ) {
+		for ( size_t i = 0; i != pool.count; ++i ) {
 
-	for ( le_worker_thread_o** t = &static_worker_threads[ 0 ]; *t != nullptr; ++t ) {
-		( *t )->thread.join();
-		delete ( *t );
-		( *t ) = nullptr;
-	}
+			if ( pass == 0 && pool.fibers[ i ]->node != node ) {
+				continue;
+			}
 
-	for ( size_t i = 0; i != FIBER_POOL_SIZE; ++i ) {
-		le_fiber_destroy( job_manager->fibers[ i ] );
-		job_manager->fibers[ i ] = nullptr;
-	}
+			auto fib_idle = FIBER_STATUS::eIdle; // < value to compare against
 
-	// attempt to delete any leftover jobs on the job queue.
-	void* ret;
-	while ( ( ret = lockfree_ring_buffer_trypop( job_manager->job_queue ) ) ) {
-		delete ( static_cast<le_job_o*>( ret ) );
+			if ( pool.fibers[ i ]->fiber_status.compare_exchange_weak( fib_idle, FIBER_STATUS::eProcessing ) ) {
+				// ----------| invariant: `fiber_status` was idle, is now atomically changed to processing
+				return pool.fibers[ i ];
+			}
+		}
 	}
 
-	lockfree_ring_buffer_destroy( job_manager->job_queue );
+	return nullptr;
+}
 
-	{
-		std::scoped_lock lock( job_manager->counters_mtx );
-		// free all leftover counters.
-		for ( auto& c : job_manager->counters ) {
-			delete c;
-		}
+// ----------------------------------------------------------------------
 
-		// clear list of leftover counters.
-		job_manager->counters.clear();
-	}
+// Returns true if this worker did run a fiber, false if it could not find anything to do.
+static bool le_worker_thread_dispatch( le_worker_thread_o* self ) {
+
+	// -- Move all fibers which other threads have handed back to us onto the ready list.
+	//
+	// The inbox is a stack, so we reverse it to resume fibers in the order in which they
+	// became ready.
+	if ( self->resume_inbox.load( std::memory_order_relaxed ) ) {
+		le_fiber_o* f    = self->resume_inbox.exchange( nullptr, std::memory_order_acquire );
+		le_fiber_o* prev = nullptr;
+		while ( f ) {
+			le_fiber_o* next = f->list_next;
+			f->list_next     = prev;
+			prev             = f;
+			f                = next;
+		}
+		for ( f = prev; f != nullptr; ) {
+			le_fiber_o* next = f->list_next; // We must capture next here, since push_back will update the fiber
+			f->list_next     = nullptr;
+			fiber_list_push_back( &self->ready_list, f );
+			f = next;
+		}
+	}
+
+	// -- If there is any fiber in the ready-list, we must switch to that fiber.
+	//
+	bool const tracing     = le_job_manager_is_tracing();
+	uint64_t   slice_begin = 0; // timestamp at which guest fiber started/resumed, only set while tracing
+
+	if ( self->ready_list.begin ) {
+		self->guest_fiber = self->ready_list.begin;
+		fiber_list_remove_element( &self->ready_list, self->ready_list.begin );
+
+		if ( tracing ) {
+			slice_begin = le_jobs_trace_now();
+			le_worker_thread_trace( self, LE_JOBS_TRACE_EVENT::eFiberResume, slice_begin, self->guest_fiber );
+		}
+	}
+
+	if ( nullptr == self->guest_fiber ) {
+
+		le_job_o* job = le_worker_thread_fetch_job( self );
+
+		if ( nullptr == job ) {
+			// We couldn't get another job - this could mean that all queues are empty.
+			return false;
+		}
+
+		// Jobs which asked for a small stack may run on a small-stack fiber -
+		// but if there is none available, any fiber will do.
+		if ( job->small_stack ) {
+			self->guest_fiber = le_job_manager_acquire_fiber( FIBER_CLASS::eSmallStack, self->node );
+		}
+
+		if ( nullptr == self->guest_fiber ) {
+			self->guest_fiber = le_job_manager_acquire_fiber( FIBER_CLASS::eDefault, self->node );
+		}
+
+		if ( nullptr == self->guest_fiber ) {
+			// We could not find an available fiber, we must put the job back and
+			// return empty-handed.
+			if ( 0 == chase_lev_deque_push( self->job_deque[ size_t( job->priority ) ], job ) ) {
+				lockfree_ring_buffer_push( job_manager->job_queue[ size_t( job->priority ) ], job );
+			}
+			return false;
+		}
+
+		le_fiber_load_job( self->guest_fiber, &self->host_fiber, job );
+
+		if ( tracing ) {
+			le_fiber_o* fiber        = self->guest_fiber;
+			fiber->trace_job_id      = ( uint64_t( self->worker_id ) << 48 ) | ++self->trace_job_count;
+			fiber->trace_job_fun_ptr = uint64_t( job->fun_ptr );
+
+			slice_begin = le_jobs_trace_now();
+
+			le_jobs_trace_event_t event{};
+			event.timestamp    = slice_begin;
+			event.type         = LE_JOBS_TRACE_EVENT::eJobBegin;
+			event.job_id       = fiber->trace_job_id;
+			event.job_fun_ptr  = fiber->trace_job_fun_ptr;
+			event.priority     = uint16_t( job->priority );
+			event.enqueue_time = job_manager->job_enqueue_time[ job - job_manager->job_pool ];
+			event.queue_depth  = le_worker_thread_get_queue_depth( self );
+			le_jobs_trace_buffer_record( self->trace_buffer, event );
+
+			self->trace_jobs_run.store( self->trace_jobs_run.load( std::memory_order_relaxed ) + 1, std::memory_order_relaxed );
+		}
+
+		// we don't need job anymore after it was passed to fiber_setup
+		// and since the queue did own the job, we must return it to the
+		// job pool here.
+		le_job_manager_free_job( self, job );
+	}
+
+	// --------| invariant: current_fiber contains a fiber
+
+	assert( self->guest_fiber->stack ); // address of stack must not be 0
+
+	// switch to guest fiber
+	asm_switch( self->guest_fiber, &self->host_fiber, 1 );
+
+	// If we're back here, this means that the fiber in current_fiber has
+	// finished executing for now. This can have two reasons:
+	//
+	// 1. Fiber did complete
+	// 2. Fiber did yield
+
+	if ( slice_begin ) {
+		uint64_t const now = le_jobs_trace_now();
+		self->trace_busy_ns.store( self->trace_busy_ns.load( std::memory_order_relaxed ) + ( now - slice_begin ), std::memory_order_relaxed );
+		le_worker_thread_trace( self, self->guest_fiber->job_complete ? LE_JOBS_TRACE_EVENT::eJobEnd : LE_JOBS_TRACE_EVENT::eFiberSuspend, now, self->guest_fiber );
+	}
+
+	if ( 1 == self->guest_fiber->job_complete ) {
+		// Fiber was completed: We must return it to the pool
+		self->guest_fiber->stack        = nullptr;             // Reset fiber stack
+		self->guest_fiber->fiber_status = FIBER_STATUS::eIdle; // return fiber to pool !! do this as the last thing, otherwise other threads will already have taken ownership of it !!
+		self->guest_fiber               = nullptr;             // reset current fiber
+	} else if ( self->guest_fiber->fiber_await_counter ) {
+		// Fiber waits for a counter: the counter now owns the fiber, and will hand it
+		// back to us via our resume_inbox once the counter reaches zero.
+		self->guest_fiber = nullptr;
+	} else {
+		// Fiber has yielded without waiting for anything: it may resume right away.
+		fiber_list_push_back( &self->ready_list, self->guest_fiber );
+		self->guest_fiber = nullptr;
+	}
+
+	return true;
+}
+
+// ----------------------------------------------------------------------
+// Returns true if there is anything which this worker could pick up -
+// we use this to double-check just before we park.
+static bool le_worker_thread_has_work( le_worker_thread_o const* self ) {
+
+	if ( self->ready_list.begin || self->resume_inbox.load() ) {
+		return true;
+	}
+
+	for ( size_t p = 0; p <= size_t( self->lowest_priority ); p++ ) {
+
+		if ( lockfree_ring_buffer_size( job_manager->job_queue[ p ] ) ) {
+			return true;
+		}
+
+		for ( le_worker_thread_o** t = static_worker_threads; *t != nullptr; ++t ) {
+			if ( chase_lev_deque_size( ( *t )->job_deque[ p ] ) ) {
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+// ----------------------------------------------------------------------
+// Put worker thread to sleep until someone wakes it up via le_worker_thread_wake.
+static void le_worker_thread_park( le_worker_thread_o* self ) {
+
+	self->park_state.store( WORKER_PARK_STATE::eParked );
+	++job_manager->parked_worker_count;
+
+	// This fence pairs with the fence in le_job_manager_wake_one_worker.
+	std::atomic_thread_fence( std::memory_order_seq_cst );
+
+	// We must check once more whether there is any work, as work might have
+	// been published just before we announced that we're parked.
+	if ( 0 == self->stop_thread && false == le_worker_thread_has_work( self ) ) {
+
+		uint64_t const park_begin = le_job_manager_is_tracing() ? le_jobs_trace_now() : 0;
+
+		if ( park_begin ) {
+			le_worker_thread_trace( self, LE_JOBS_TRACE_EVENT::eParkBegin, park_begin, nullptr );
+		}
+
+		while ( WORKER_PARK_STATE::eParked == self->park_state.load() ) {
+			self->park_state.wait( WORKER_PARK_STATE::eParked );
+		}
+
+		if ( park_begin ) {
+			uint64_t const now = le_jobs_trace_now();
+			self->trace_parked_ns.store( self->trace_parked_ns.load( std::memory_order_relaxed ) + ( now - park_begin ), std::memory_order_relaxed );
+			le_worker_thread_trace( self, LE_JOBS_TRACE_EVENT::eParkEnd, now, nullptr );
+		}
+	}
+
+	self->park_state.store( WORKER_PARK_STATE::eRunning );
+	--job_manager->parked_worker_count;
+}
+
+// ----------------------------------------------------------------------
+// Main loop for each worker thread
+//
+static void le_worker_thread_loop( le_worker_thread_o* self ) {
+
+	current_worker_thread = self;
+
+	uint32_t idle_count = 0; // number of consecutive times that dispatch came back empty-handed
+
+	while ( 0 == self->stop_thread ) {
+
+		if ( le_worker_thread_dispatch( self ) ) {
+			if ( idle_count ) {
+				// Spinning paid off - next time, we're willing to spin a little longer.
+				self->spin_count = std::min<uint32_t>( self->spin_count * 2, WORKER_SPIN_COUNT_MAX );
+			}
+			idle_count = 0;
+			continue;
+		}
+
+		if ( ++idle_count < self->spin_count ) {
+			cpu_relax();
+			continue;
+		}
+
+		// We spun for nothing - next time, we give up a little earlier.
+		self->spin_count = std::max<uint32_t>( self->spin_count / 2, WORKER_SPIN_COUNT_MIN );
+		idle_count       = 0;
+
+		le_worker_thread_park( self );
+	}
+}
+
+// ----------------------------------------------------------------------
+// Pick cpus for worker threads according to placement policy, and store them in
+// `selected`, in the order in which workers should be placed on them.
+// Returns number of selected cpus.
+static size_t le_job_manager_select_cpus( le_jobs_placement_t placement, bool reserve_core_0, le_cpu_info_t const* cpus, size_t num_cpus, le_cpu_info_t* selected ) {
+
+	uint32_t core_0 = ~0u; // physical core hosting cpu 0
+
+	for ( size_t i = 0; i != num_cpus; i++ ) {
+		if ( cpus[ i ].cpu == 0 ) {
+			core_0 = cpus[ i ].core;
+		}
+	}
+
+	size_t num_selected = 0;
+
+	for ( size_t i = 0; i != num_cpus; i++ ) {
+		if ( reserve_core_0 && cpus[ i ].core == core_0 ) {
+			continue;
+		}
+		if ( placement == le_jobs_placement_t::ePhysicalCores && cpus[ i ].smt != 0 ) {
+			continue;
+		}
+		selected[ num_selected++ ] = cpus[ i ];
+	}
+
+	if ( 0 == num_selected && reserve_core_0 ) {
+		// There is only one core - we can't keep it free for the main thread.
+		return le_job_manager_select_cpus( placement, false, cpus, num_cpus, selected );
+	}
+
+	// Keep workers which are placed next to each other close to each other in the
+	// topology. For eFillSocket we place workers on the first hardware thread of
+	// each core of a socket first, and only then on their SMT siblings.
+	bool const smt_first = ( placement == le_jobs_placement_t::eFillSocket );
+
+	std::sort( selected, selected + num_selected, [ smt_first ]( le_cpu_info_t const& lhs, le_cpu_info_t const& rhs ) {
+		if ( lhs.package != rhs.package ) return lhs.package < rhs.package;
+		if ( smt_first && lhs.smt != rhs.smt ) return lhs.smt < rhs.smt;
+		if ( lhs.node != rhs.node ) return lhs.node < rhs.node;
+		if ( lhs.cache != rhs.cache ) return lhs.cache < rhs.cache;
+		if ( lhs.core != rhs.core ) return lhs.core < rhs.core;
+		return lhs.smt < rhs.smt;
+	} );
+
+	return num_selected;
+}
+
+// ----------------------------------------------------------------------
+// Order other workers by how close they are to worker `self` - this is the
+// order in which `self` will try to steal from them.
+static void le_worker_thread_init_steal_victims( le_worker_thread_o* self, size_t num_workers ) {
+
+	self->steal_victims = new uint32_t[ num_workers ];
+
+	uint32_t n = 0;
+
+	for ( int tier = 0; tier != 3; tier++ ) {
+		for ( uint32_t i = 0; i != num_workers; i++ ) {
+
+			le_worker_thread_o const* w = static_worker_threads[ i ];
+
+			if ( w == self ) {
+				continue;
+			}
+
+			bool const same_cache = ( w->cache == self->cache );
+			bool const same_node  = ( w->node == self->node );
+
+			if ( ( tier == 0 && same_cache ) ||
+			     ( tier == 1 && !same_cache && same_node ) ||
+			     ( tier == 2 && !same_cache && !same_node ) ) {
+				self->steal_victims[ n++ ] = i;
+			}
+		}
+
+		if ( tier == 0 ) {
+			self->steal_victims_same_cache = n;
+		} else if ( tier == 1 ) {
+			self->steal_victims_same_node = n;
+		}
+	}
+}
+
+// ----------------------------------------------------------------------
+
+static void le_job_manager_initialize( le_jobs_settings_t const* p_settings ) {
+
+	assert( nullptr == job_manager );
+
+	le_jobs_settings_t const settings = p_settings ? *p_settings : le_jobs_settings_t{};
+
+	// Find out which cpus worker threads should be pinned to.
+
+	le_cpu_info_t* selected_cpus     = nullptr;
+	size_t         num_selected_cpus = 0;
+
+	if ( settings.placement != le_jobs_placement_t::eNone ) {
+		le_cpu_info_t* cpus     = new le_cpu_info_t[ MAX_CPU_COUNT ];
+		size_t         num_cpus = std::min( le_cpu_topology_query( cpus, MAX_CPU_COUNT, "/sys/devices/system/cpu" ), MAX_CPU_COUNT );
+
+		selected_cpus     = new le_cpu_info_t[ num_cpus ];
+		num_selected_cpus = le_job_manager_select_cpus( settings.placement, settings.reserve_core_0, cpus, num_cpus, selected_cpus );
+
+		delete[] cpus;
+	}
+
+	size_t num_threads = settings.worker_thread_count;
+
+	if ( 0 == num_threads && num_selected_cpus ) {
+		num_threads = num_selected_cpus;
+	}
+
+	if ( 0 == num_threads ) {
+		// Leave one hardware thread for the main thread.
+		num_threads = std::max<size_t>( 1, size_t( std::thread::hardware_concurrency() ) ) - 1;
+		num_threads = std::max<size_t>( 1, num_threads );
+	}
+
+	num_threads = std::min( num_threads, MAX_WORKER_THREAD_COUNT );
+
+	if ( num_selected_cpus && num_threads > num_selected_cpus ) {
+		// Two workers pinned to the same cpu could only ever take turns - we rather
+		// leave any surplus workers unpinned, and let the operating system place them.
+		logger.warn( "%zu worker threads requested, but placement selects only %zu cpus - %zu workers will not be pinned.",
+		             num_threads, num_selected_cpus, num_threads - num_selected_cpus );
+	}
+
+	asm_fetch_default_control_words( &DEFAULT_CONTROL_WORDS );
+
+	job_manager = new le_job_manager_o();
+
+	for ( auto& q : job_manager->job_queue ) {
+		q = lockfree_ring_buffer_create( 10 ); // note size is given as a power of 2, so "10" means 1024 elements
+	}
+
+	job_manager->counter_pool = new counter_t[ COUNTER_POOL_SIZE ];
+	le_index_free_list_init( &job_manager->counter_free_list, COUNTER_POOL_SIZE );
+
+	job_manager->job_pool = new le_job_o[ JOB_POOL_SIZE ];
+	le_index_free_list_init( &job_manager->job_free_list, JOB_POOL_SIZE );
+
+	job_manager->range_pool = new le_parallel_range_o[ RANGE_POOL_SIZE ];
+	le_index_free_list_init( &job_manager->range_free_list, RANGE_POOL_SIZE );
+
+	job_manager->continuation_pool = new le_continuation_o[ CONTINUATION_POOL_SIZE ];
+	le_index_free_list_init( &job_manager->continuation_free_list, CONTINUATION_POOL_SIZE );
+
+	if ( settings.trace_buffer_capacity ) {
+		// Round trace buffer capacity up to the next power of two.
+		uint32_t size_log2 = 0;
+		while ( size_log2 < 31 && ( 1u << size_log2 ) < settings.trace_buffer_capacity ) {
+			size_log2++;
+		}
+		job_manager->trace_buffer_size_log2 = size_log2;
+		job_manager->job_enqueue_time       = new uint64_t[ JOB_POOL_SIZE ]{};
+	}
+
+	// Create worker thread objects first, so that all deques exist by the time
+	// that any worker starts looking for jobs to steal.
+	for ( size_t i = 0; i != num_threads; ++i ) {
+		le_worker_thread_o* w = new le_worker_thread_o();
+		for ( auto& dq : w->job_deque ) {
+			dq = chase_lev_deque_create( WORKER_DEQUE_SIZE_LOG2 );
+		}
+		w->worker_id = int32_t( i );
+
+		if ( i < num_selected_cpus ) {
+			le_cpu_info_t const& cpu = selected_cpus[ i ];
+
+			w->cpu   = cpu.cpu;
+			w->cache = cpu.cache;
+			w->node  = cpu.node;
+		}
+
+		if ( job_manager->job_enqueue_time ) {
+			w->trace_buffer = le_jobs_trace_buffer_create( job_manager->trace_buffer_size_log2 );
+		}
+		w->rng_state = 0x9e3779b97f4a7c15ull * ( i + 1 ); // xorshift state must not be zero
+
+		// The first worker is our low-latency lane: it never picks up background jobs,
+		// unless it is the only worker.
+		w->lowest_priority = ( i == 0 && num_threads > 1 ) ? Priority::eNormal : Priority::eBackground;
+
+		static_worker_threads[ i ] = w;
+	}
+
+	job_manager->worker_thread_count = num_threads;
+
+	delete[] selected_cpus;
+
+	// Find out which NUMA nodes host worker threads.
+	uint32_t worker_nodes[ MAX_WORKER_THREAD_COUNT ];
+	uint32_t node_count = 0;
+
+	for ( size_t i = 0; i != num_threads; ++i ) {
+		le_worker_thread_o* w = static_worker_threads[ i ];
+
+		le_worker_thread_init_steal_victims( w, num_threads );
+
+		if ( std::find( worker_nodes, worker_nodes + node_count, w->node ) == worker_nodes + node_count ) {
+			worker_nodes[ node_count++ ] = w->node;
+		}
+	}
+
+	job_manager->node_count = node_count;
+
+	// Allocate a number of fibers to execute jobs in.
+	//
+	// Stack sizes are rounded up to whole pages, as each stack must end on a page
+	// boundary for its guard page to work.
+	{
+		size_t const page_size = get_page_size();
+
+		size_t const fiber_counts[ NUM_FIBER_CLASSES ] = {
+		    std::max<size_t>( 1, settings.fiber_count ), // we need at least one fiber with a default stack
+		    settings.small_fiber_count,
+		};
+		size_t const stack_sizes[ NUM_FIBER_CLASSES ] = {
+		    settings.fiber_stack_size,
+		    settings.small_fiber_stack_size,
+		};
+
+		for ( size_t c = 0; c != NUM_FIBER_CLASSES; ++c ) {
+			le_fiber_pool_t& pool = job_manager->fiber_pools[ c ];
+
+			pool.stack_size = std::max( page_size, ( stack_sizes[ c ] + page_size - 1 ) / page_size * page_size );
+			pool.count      = fiber_counts[ c ];
+			pool.fibers     = new le_fiber_o*[ pool.count ];
+
+			// If workers live on more than one NUMA node, we spread fibers evenly
+			// across these nodes, and bind each fiber's stack to its node.
+			for ( size_t i = 0; i != pool.count; ++i ) {
+				uint32_t const node = ( node_count > 1 ) ? worker_nodes[ i % node_count ] : ~0u;
+				pool.fibers[ i ]    = le_fiber_create( pool.stack_size, node );
+				assert( pool.fibers[ i ] && "could not allocate fiber stack" );
+			}
+		}
+	}
+
+	// Start worker threads to host fibers in
+	for ( size_t i = 0; i != num_threads; ++i ) {
+
+		le_worker_thread_o* w = static_worker_threads[ i ];
+
+		w->thread = std::thread( le_worker_thread_loop, w );
+
+		auto pthread = w->thread.native_handle();
+#ifdef _MSC_VER
+
+#else
+		if ( w->cpu != ~0u ) {
+			cpu_set_t mask;
+			CPU_ZERO( &mask );
+			CPU_SET( w->cpu, &mask );
+			pthread_setaffinity_np( pthread, sizeof( mask ), &mask );
+		}
+#endif
+	}
+}
+
+// ----------------------------------------------------------------------
+
+static bool le_job_manager_is_initialized() {
+	return job_manager != nullptr;
+}
+
+// ----------------------------------------------------------------------
+
+static void le_job_manager_terminate() {
+
+	assert( job_manager ); // job manager must exist
+
+	// - Send termination signal to all threads.
+
+	for ( le_worker_thread_o** t = &static_worker_threads[ 0 ]; *t != nullptr; ++t ) {
+		( *t )->stop_thread = 1;
+		le_worker_thread_wake( *t );
+	}
+
+	// - Join all worker threads - we must join all threads before we may delete
+	//   any of them, as workers may still be trying to steal from each other.
+
+	for ( le_worker_thread_o** t = &static_worker_threads[ 0 ]; *t != nullptr; ++t ) {
+		( *t )->thread.join();
+	}
+
+	for ( le_worker_thread_o** t = &static_worker_threads[ 0 ]; *t != nullptr; ++t ) {
+		// Any leftover jobs on the worker's deque are owned by the job pool,
+		// which means we don't have to free them one-by-one.
+		for ( auto& dq : ( *t )->job_deque ) {
+			chase_lev_deque_destroy( dq );
+		}
+		if ( ( *t )->trace_buffer ) {
+			le_jobs_trace_buffer_destroy( ( *t )->trace_buffer );
+		}
+		delete[]( *t )->steal_victims;
+		delete ( *t );
+		( *t ) = nullptr;
+	}
+
+	job_manager->worker_thread_count = 0;
+
+	for ( auto& pool : job_manager->fiber_pools ) {
+		for ( size_t i = 0; i != pool.count; ++i ) {
+			le_fiber_destroy( pool.fibers[ i ] );
+		}
+		delete[] pool.fibers;
+		pool = {};
+	}
+
+	for ( auto& q : job_manager->job_queue ) {
+		lockfree_ring_buffer_destroy( q );
+	}
+
+	// free all job slots - this includes any leftover jobs on the job queue.
+	le_index_free_list_destroy( &job_manager->job_free_list );
+	delete[] job_manager->job_pool;
+
+	le_index_free_list_destroy( &job_manager->range_free_list );
+	delete[] job_manager->range_pool;
+
+	// free any continuations which never got issued - these may own job descriptors on the heap.
+	for ( size_t i = 0; i != CONTINUATION_POOL_SIZE; i++ ) {
+		le_continuation_o& c = job_manager->continuation_pool[ i ];
+		if ( c.jobs && c.jobs != c.local_jobs ) {
+			free( c.jobs );
+		}
+	}
+	le_index_free_list_destroy( &job_manager->continuation_free_list );
+	delete[] job_manager->continuation_pool;
+
+	delete[] job_manager->job_enqueue_time;
+
+	// free all counters - this includes any leftover counters.
+	le_index_free_list_destroy( &job_manager->counter_free_list );
+	delete[] job_manager->counter_pool;
 
 	delete job_manager;
 
@@ -512,62 +1508,131 @@ static void le_job_manager_terminate() {
 }
 
 // ----------------------------------------------------------------------
-// polls counter, and will not return until counter == target_value
+// will not return until counter has reached zero - counters may only be freed once
+// they have reached zero, which is why `target_value` must be 0.
 static void le_job_manager_wait_for_counter_and_free( counter_t* counter, uint32_t target_value ) {
 
+	assert( target_value == 0 && "counters can only be waited on until they reach zero" );
+	( void )target_value;
+
 	auto current_worker = get_current_thread();
 
 	if ( nullptr == current_worker ) {
-		for ( ; counter->data != target_value; ) {
-			// called from the main thread - we must wait until
-			// all jobs which affect the counter have completed.
-			std::this_thread::sleep_for( std::chrono::nanoseconds( 100 ) );
+		// called from the main thread - we must wait until
+		// all jobs which affect the counter have completed.
+		//
+		// We sleep on the counter epoch, which gets incremented by
+		// whoever brings a counter to zero while we're waiting.
+		//
+		// We wait for the counter to be closed, rather than for it to reach zero:
+		// only once it is closed may we free the counter.
+		++job_manager->external_waiter_count;
+		for ( ;; ) {
+			uint32_t epoch = job_manager->counter_epoch.load();
+			if ( counter->waiters.load() == COUNTER_CLOSED ) {
+				break;
+			}
+			job_manager->counter_epoch.wait( epoch );
 		}
+		--job_manager->external_waiter_count;
 	} else {
 		// This method has been issued from a job, and not from the main thread.
-		// We must issue a yield, but not before we have set the wait_counter for the
-		// current worker.
-		current_worker->guest_fiber->fiber_await_counter = counter;
-		// Switch back to current worker's host fiber
-		asm_switch( &current_worker->host_fiber, current_worker->guest_fiber, 0 );
-		// If we're back from the switch, this means that the counter has reached
-		// zero.
+		// We add the current fiber to the counter's list of waiters, and yield.
+		// The fiber gets handed back to the current worker once the counter reaches zero.
+		le_fiber_o* fiber = current_worker->guest_fiber;
+
+		fiber->fiber_await_counter = counter;
+		fiber->owner_worker        = current_worker;
+		fiber->counter_waiter      = { nullptr, fiber, nullptr };
+
+		if ( le_counter_add_waiter( counter, &fiber->counter_waiter ) ) {
+			// Switch back to current worker's host fiber
+			asm_switch( &current_worker->host_fiber, fiber, 0 );
+			// If we're back from the switch, this means that the counter has reached
+			// zero.
+		}
+
+		fiber->fiber_await_counter = nullptr;
 	}
 
 	// --------| invariant: counter must be at zero.
 	assert( counter->data == 0 );
 
-	// Remove counter from list of counters owned by job manager
-	{
-		// we must protect this using a mutex, as other threads might want to add/remove counters
-		// and this might lead to a race condition on the forward_list of counters.
-		std::scoped_lock lock( job_manager->counters_mtx );
-		job_manager->counters.remove( counter );
-		// free counter memory
-		delete counter;
+	// Return counter to the pool of available counters
+	le_index_free_list_push( &job_manager->counter_free_list, uint32_t( counter - job_manager->counter_pool ) );
+}
+
+// ----------------------------------------------------------------------
+// Fetch an unused counter from the counter pool.
+static counter_t* le_job_manager_allocate_counter() {
+
+	uint32_t index;
+
+	while ( le_index_free_list_t::END == ( index = le_index_free_list_pop( &job_manager->counter_free_list ) ) ) {
+		// All counters are in use - we must wait for a counter to be freed.
+		if ( get_current_thread() ) {
+			le_fiber_yield();
+		} else {
+			std::this_thread::yield();
+		}
+	}
+
+	counter_t* counter = job_manager->counter_pool + index;
+	counter->waiters   = nullptr;
+	return counter;
+}
+
+// ----------------------------------------------------------------------
+// Copies a single job into a job queue
+//
+// If called from within a job, the job goes onto the current worker's deque - otherwise,
+// or if the deque is full, it goes onto the global job queue.
+static void le_job_manager_enqueue_job( le_worker_thread_o* current_worker, le_jobs_api::fun_ptr_t fun_ptr, void* fun_param, counter_t* counter, Priority priority, bool small_stack ) {
+
+	// Note that we must store a pointer to counter with each job,
+	// which is why we must take a slot from the job pool for each job.
+	// Job slots are returned to the pool when they get loaded into a fiber.
+	le_job_o* job = le_job_manager_allocate_job( current_worker );
+	*job          = { fun_ptr, fun_param, counter, priority, small_stack };
+
+	if ( le_job_manager_is_tracing() ) {
+		job_manager->job_enqueue_time[ job - job_manager->job_pool ] = le_jobs_trace_now();
 	}
+
+	size_t const p = size_t( priority );
+
+	if ( false == ( current_worker && chase_lev_deque_push( current_worker->job_deque[ p ], job ) ) ) {
+		lockfree_ring_buffer_push( job_manager->job_queue[ p ], job );
+	}
+
+	// Wake up a parked worker, if any, so that it may pick up the new job.
+	//
+	// We must do this for each job as we go: pushing onto a full global job
+	// queue blocks until a worker makes some room, and workers may park at
+	// any time while we're still pushing.
+	le_job_manager_wake_one_worker( priority );
 }
 
 // ----------------------------------------------------------------------
 // copies jobs into job queue
 static void le_job_manager_run_jobs( le_job_o* jobs, uint32_t num_jobs, counter_t** p_counter ) {
 
-	auto counter  = new counter_t();
-	counter->data = num_jobs;
+	counter_t* counter = le_job_manager_allocate_counter();
+	counter->data      = num_jobs;
 
-	{
-		std::scoped_lock lock( job_manager->counters_mtx );
-		job_manager->counters.emplace_front( counter );
+	if ( 0 == num_jobs ) {
+		// Nothing will ever decrement this counter, so we must close it right away.
+		counter->waiters = COUNTER_CLOSED;
 	}
 
+	le_worker_thread_o* current_worker = get_current_thread();
+
 	le_job_o*       j        = jobs;
 	le_job_o* const jobs_end = jobs + num_jobs;
 
 	for ( ; j != jobs_end; j++ ) {
-		// Note that we must store a pointer to counter with each job,
-		// which is why we must allocate job objects for each job.
-		// Jobs are freed when
-		lockfree_ring_buffer_push( job_manager->job_queue, new le_job_o{ j->fun_ptr, j->fun_param, counter } );
+		assert( size_t( j->priority ) < NUM_PRIORITIES );
+		le_job_manager_enqueue_job( current_worker, j->fun_ptr, j->fun_param, counter, j->priority, j->small_stack );
 	}
 
 	// store address back into parameter, so that caller knows about our counter.
@@ -576,6 +1641,330 @@ static void le_job_manager_run_jobs( le_job_o* jobs, uint32_t num_jobs, counter_
 	}
 };
 
+// ----------------------------------------------------------------------
+// Issue jobs of a continuation whose predecessor has reached zero.
+static void le_continuation_issue( le_continuation_o* continuation ) {
+
+	// The predecessor is owned by the continuation, which means that nobody
+	// else waits for it - we may free it right away.
+	le_index_free_list_push( &job_manager->counter_free_list, uint32_t( continuation->predecessor - job_manager->counter_pool ) );
+
+	le_worker_thread_o* current_worker = get_current_thread();
+	counter_t*          counter        = continuation->counter;
+
+	for ( uint32_t i = 0; i != continuation->num_jobs; i++ ) {
+		le_job_o const& j = continuation->jobs[ i ];
+		le_job_manager_enqueue_job( current_worker, j.fun_ptr, j.fun_param, counter, j.priority, j.small_stack );
+	}
+
+	if ( continuation->jobs != continuation->local_jobs ) {
+		free( continuation->jobs );
+	}
+
+	uint32_t const num_jobs = continuation->num_jobs;
+
+	continuation->jobs = nullptr;
+
+	le_index_free_list_push( &job_manager->continuation_free_list, uint32_t( continuation - job_manager->continuation_pool ) );
+
+	if ( 0 == num_jobs ) {
+		// Nothing will ever decrement this counter, so we must close it here.
+		le_counter_close( counter );
+	}
+}
+
+// ----------------------------------------------------------------------
+// copies jobs into a continuation, which gets issued once predecessor reaches zero
+static void le_job_manager_run_jobs_after( counter_t* predecessor, le_job_o* jobs, uint32_t num_jobs, counter_t** p_counter ) {
+
+	assert( predecessor && "predecessor counter must be given" );
+
+	uint32_t continuation_index;
+	while ( le_index_free_list_t::END == ( continuation_index = le_index_free_list_pop( &job_manager->continuation_free_list ) ) ) {
+		// All continuations are in use - we must wait for a continuation to be issued.
+		if ( get_current_thread() ) {
+			le_fiber_yield();
+		} else {
+			std::this_thread::yield();
+		}
+	}
+
+	counter_t* counter = le_job_manager_allocate_counter();
+	counter->data      = num_jobs;
+
+	le_continuation_o* continuation = job_manager->continuation_pool + continuation_index;
+
+	continuation->waiter      = { nullptr, nullptr, continuation };
+	continuation->predecessor = predecessor;
+	continuation->counter     = counter;
+	continuation->num_jobs    = num_jobs;
+	continuation->jobs        = ( num_jobs <= CONTINUATION_LOCAL_JOBS )
+	                                ? continuation->local_jobs
+	                                : static_cast<le_job_o*>( malloc( sizeof( le_job_o ) * num_jobs ) );
+
+	for ( uint32_t i = 0; i != num_jobs; i++ ) {
+		assert( size_t( jobs[ i ].priority ) < NUM_PRIORITIES );
+		continuation->jobs[ i ] = jobs[ i ];
+	}
+
+	// store address back into parameter, so that caller knows about our counter.
+	// We must do this before we add the continuation, as it may get issued right away.
+	if ( p_counter ) {
+		*p_counter = counter;
+	}
+
+	if ( false == le_counter_add_waiter( predecessor, &continuation->waiter ) ) {
+		// Predecessor has already reached zero - we must issue the continuation ourselves.
+		le_continuation_issue( continuation );
+	}
+}
+
+// ----------------------------------------------------------------------
+
+static void le_parallel_range_job( void* param ); // ffdecl
+
+// ----------------------------------------------------------------------
+// Process sub-range [begin, end) of a parallel task, in chunks of at most `grain` elements.
+//
+// Before each chunk we check whether we should split off the upper half of the
+// remaining range as a new job - we do this only if our own deque is empty:
+// this means that whatever we pushed earlier has been stolen, which tells us that
+// other workers are hungry for work (lazy binary splitting).
+static void le_parallel_range_run( le_worker_thread_o* current_worker, le_parallel_task_t* task, uint64_t begin, uint64_t end ) {
+
+	while ( begin < end ) {
+
+		if ( end - begin > task->grain &&
+		     current_worker &&
+		     0 == chase_lev_deque_size( current_worker->job_deque[ size_t( task->priority ) ] ) ) {
+
+			uint32_t range_index = le_index_free_list_pop( &job_manager->range_free_list );
+
+			if ( range_index != le_index_free_list_t::END ) {
+
+				uint64_t mid = begin + ( end - begin ) / 2;
+
+				le_parallel_range_o* range = job_manager->range_pool + range_index;
+				*range                     = { task, mid, end };
+
+				// We must increment the counter before the new job may run, so that
+				// the counter can't reach zero while there is still work left.
+				++task->counter->data;
+				le_job_manager_enqueue_job( current_worker, le_parallel_range_job, range, task->counter, task->priority, false );
+
+				end = mid;
+				continue;
+			}
+
+			// --------| invariant: range pool exhausted - we process the range ourselves.
+		}
+
+		uint64_t chunk_end = ( end - begin > task->grain ) ? begin + task->grain : end;
+
+		if ( task->range_fn ) {
+			task->range_fn( begin, chunk_end, task->user_data );
+		} else {
+			int32_t worker_id = get_current_worker_thread_id();
+			assert( worker_id >= 0 && "parallel_reduce sub-ranges must execute on a worker thread" );
+			task->reduce_fn( begin, chunk_end, task->accumulators + worker_id * task->accumulator_stride, task->user_data );
+		}
+
+		begin = chunk_end;
+	}
+}
+
+// ----------------------------------------------------------------------
+
+static void le_parallel_range_job( void* param ) {
+
+	le_parallel_range_o* range = static_cast<le_parallel_range_o*>( param );
+	le_parallel_range_o  r     = *range;
+
+	// We have a copy of the range - we can return the original to the pool.
+	le_index_free_list_push( &job_manager->range_free_list, uint32_t( range - job_manager->range_pool ) );
+
+	le_parallel_range_run( get_current_thread(), r.task, r.begin, r.end );
+}
+
+// ----------------------------------------------------------------------
+// Process full range of task, and return once all sub-ranges have completed.
+static void le_parallel_task_run( le_parallel_task_t* task, uint64_t begin, uint64_t end ) {
+
+	if ( task->grain == 0 ) {
+		task->grain = 1;
+	}
+
+	le_worker_thread_o* current_worker = get_current_thread();
+
+	task->counter = le_job_manager_allocate_counter();
+
+	if ( current_worker ) {
+		// We are inside a job already - we may process the range on the current fiber,
+		// and wait for any sub-ranges which were split off. Sub-range jobs inherit the
+		// priority of the job which issued them.
+		//
+		// We hold on to one count of the counter ourselves while we process the range, so
+		// that the counter can only reach zero once, after all sub-ranges have completed.
+		task->priority      = current_worker->guest_fiber->job_priority;
+		task->counter->data = 1;
+		le_parallel_range_run( current_worker, task, begin, end );
+		le_job_manager_counter_decrement( task->counter );
+	} else {
+		// We are outside of the job system - we must issue a job for the full range.
+		uint32_t range_index;
+		while ( le_index_free_list_t::END == ( range_index = le_index_free_list_pop( &job_manager->range_free_list ) ) ) {
+			std::this_thread::yield();
+		}
+		le_parallel_range_o* range = job_manager->range_pool + range_index;
+		*range                     = { task, begin, end };
+		task->counter->data        = 1;
+		le_job_manager_enqueue_job( nullptr, le_parallel_range_job, range, task->counter, task->priority, false );
+	}
+
+	le_job_manager_wait_for_counter_and_free( task->counter, 0 );
+}
+
+// ----------------------------------------------------------------------
+
+static void le_job_manager_parallel_for( uint64_t begin, uint64_t end, uint64_t grain, le_jobs_api::range_fun_ptr_t fn, void* user_data ) {
+
+	if ( begin >= end ) {
+		return;
+	}
+
+	le_parallel_task_t task;
+	task.range_fn  = fn;
+	task.user_data = user_data;
+	task.grain     = grain;
+
+	le_parallel_task_run( &task, begin, end );
+}
+
+// ----------------------------------------------------------------------
+
+static void le_job_manager_parallel_reduce( uint64_t begin, uint64_t end, uint64_t grain, le_jobs_api::reduce_fun_ptr_t reduce_fn, le_jobs_api::join_fun_ptr_t join_fn, void* result, size_t result_size, void* user_data ) {
+
+	if ( begin >= end ) {
+		return;
+	}
+
+	size_t const num_workers = job_manager->worker_thread_count;
+
+	// Each worker gets its own accumulator, on its own cache line, so that
+	// workers don't invalidate each other's caches while accumulating.
+	size_t const stride = ( result_size + 63 ) & ~size_t( 63 );
+
+	alignas( 64 ) char local_storage[ 1024 ]; // use the stack if accumulators are small enough
+	char*              accumulators = ( stride * num_workers <= sizeof( local_storage ) )
+	                                      ? local_storage
+	                                      : static_cast<char*>( malloc( stride * num_workers ) );
+
+	for ( size_t i = 0; i != num_workers; i++ ) {
+		memcpy( accumulators + i * stride, result, result_size );
+	}
+
+	le_parallel_task_t task;
+	task.reduce_fn          = reduce_fn;
+	task.user_data          = user_data;
+	task.grain              = grain;
+	task.accumulators       = accumulators;
+	task.accumulator_stride = stride;
+
+	le_parallel_task_run( &task, begin, end );
+
+	// Fold accumulators into result.
+	for ( size_t i = 0; i != num_workers; i++ ) {
+		join_fn( result, accumulators + i * stride, user_data );
+	}
+
+	if ( accumulators != local_storage ) {
+		free( accumulators );
+	}
+}
+
+// ----------------------------------------------------------------------
+
+static void le_job_manager_set_tracing_enabled( bool enabled ) {
+
+	if ( nullptr == job_manager->job_enqueue_time ) {
+		// Tracing is not available - job system was initialised without trace buffers.
+		return;
+	}
+
+	if ( enabled == job_manager->tracing_enabled.load() ) {
+		return;
+	}
+
+	if ( enabled ) {
+		// Take a snapshot of current statistics, so that statistics only count
+		// from here on. Trace events before the start time will be ignored on export.
+		for ( le_worker_thread_o** t = static_worker_threads; *t != nullptr; ++t ) {
+			le_worker_thread_o* w = *t;
+
+			w->trace_stats_baseline.jobs_run  = w->trace_jobs_run.load( std::memory_order_relaxed );
+			w->trace_stats_baseline.steals    = w->trace_steals.load( std::memory_order_relaxed );
+			w->trace_stats_baseline.busy_ns   = w->trace_busy_ns.load( std::memory_order_relaxed );
+			w->trace_stats_baseline.parked_ns = w->trace_parked_ns.load( std::memory_order_relaxed );
+		}
+		job_manager->tracing_start_time = le_jobs_trace_now();
+		job_manager->tracing_stop_time  = 0;
+	} else {
+		job_manager->tracing_stop_time = le_jobs_trace_now();
+	}
+
+	job_manager->tracing_enabled.store( enabled );
+}
+
+// ----------------------------------------------------------------------
+
+static uint32_t le_job_manager_get_worker_stats( le_jobs_worker_stats_t* stats, uint32_t max_workers ) {
+
+	if ( nullptr == job_manager->job_enqueue_time ) {
+		return 0;
+	}
+
+	uint64_t const stop_time = job_manager->tracing_stop_time ? job_manager->tracing_stop_time : le_jobs_trace_now();
+	uint64_t const elapsed   = stop_time - job_manager->tracing_start_time;
+
+	uint32_t i = 0;
+
+	for ( le_worker_thread_o** t = static_worker_threads; *t != nullptr; ++t, ++i ) {
+
+		if ( i >= max_workers || nullptr == stats ) {
+			continue;
+		}
+
+		le_worker_thread_o const* w = *t;
+		le_jobs_worker_stats_t&   s = stats[ i ];
+
+		s.jobs_run    = w->trace_jobs_run.load( std::memory_order_relaxed ) - w->trace_stats_baseline.jobs_run;
+		s.steals      = w->trace_steals.load( std::memory_order_relaxed ) - w->trace_stats_baseline.steals;
+		s.busy_ns     = w->trace_busy_ns.load( std::memory_order_relaxed ) - w->trace_stats_baseline.busy_ns;
+		s.parked_ns   = w->trace_parked_ns.load( std::memory_order_relaxed ) - w->trace_stats_baseline.parked_ns;
+		s.utilisation = elapsed ? float( double( s.busy_ns ) / double( elapsed ) ) : 0.f;
+	}
+
+	return i;
+}
+
+// ----------------------------------------------------------------------
+
+static bool le_job_manager_write_chrome_trace( char const* file_path ) {
+
+	if ( nullptr == job_manager->job_enqueue_time ) {
+		return false;
+	}
+
+	le_jobs_trace_buffer_t* buffers[ MAX_WORKER_THREAD_COUNT ];
+
+	size_t num_buffers = 0;
+	for ( le_worker_thread_o** t = static_worker_threads; *t != nullptr; ++t ) {
+		buffers[ num_buffers++ ] = ( *t )->trace_buffer;
+	}
+
+	return le_jobs_trace_write_chrome_json( file_path, buffers, num_buffers, job_manager->tracing_start_time );
+}
+
 // ----------------------------------------------------------------------
 
 LE_MODULE_REGISTER_IMPL( le_jobs, api ) {
@@ -583,9 +1972,16 @@ LE_MODULE_REGISTER_IMPL( le_jobs, api ) {
 	static_cast<le_jobs_api*>( api )->yield                     = le_fiber_yield;
 	static_cast<le_jobs_api*>( api )->get_current_worker_id     = get_current_worker_thread_id;
 	static_cast<le_jobs_api*>( api )->run_jobs                  = le_job_manager_run_jobs;
+	static_cast<le_jobs_api*>( api )->run_jobs_after            = le_job_manager_run_jobs_after;
 	static_cast<le_jobs_api*>( api )->initialize                = le_job_manager_initialize;
 	static_cast<le_jobs_api*>( api )->terminate                 = le_job_manager_terminate;
+	static_cast<le_jobs_api*>( api )->is_initialized            = le_job_manager_is_initialized;
 	static_cast<le_jobs_api*>( api )->wait_for_counter_and_free = le_job_manager_wait_for_counter_and_free;
+	static_cast<le_jobs_api*>( api )->parallel_for              = le_job_manager_parallel_for;
+	static_cast<le_jobs_api*>( api )->parallel_reduce           = le_job_manager_parallel_reduce;
+	static_cast<le_jobs_api*>( api )->set_tracing_enabled       = le_job_manager_set_tracing_enabled;
+	static_cast<le_jobs_api*>( api )->get_worker_stats          = le_job_manager_get_worker_stats;
+	static_cast<le_jobs_api*>( api )->write_chrome_trace        = le_job_manager_write_chrome_trace;
 
 	//	le_core_load_library_persistently( "libpthread.so" );
 }
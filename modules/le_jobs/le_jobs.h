@@ -3,30 +3,108 @@
 
 #include "le_core.h"
 
+// Upper bound for `worker_thread_count` - worker ids are always smaller than this. Modules
+// which keep per-worker state may size their arrays by this number (plus one, for threads
+// outside of the job system).
+constexpr uint32_t LE_JOBS_MAX_WORKER_THREAD_COUNT = 256;
+
+/* How worker threads get pinned to CPUs.
+ *
+ * Placement follows the CPU topology: workers which are placed close to each other
+ * share a cache, and prefer to steal work from each other.
+ */
+enum class le_jobs_placement_t : uint32_t {
+	eNone = 0,      // don't pin worker threads - leave placement to the operating system
+	ePhysicalCores, // one worker per physical core, SMT siblings stay free - cores are filled socket by socket
+	eFillSocket,    // use all hardware threads of a socket, including SMT siblings, before moving on to the next socket
+};
+
+/* Settings for the job system - pass these to `initialize`.
+ *
+ * Fibers with small stacks are meant for leaf jobs, which don't call deeply
+ * nested functions - this allows you to have thousands of fibers without
+ * reserving thousands times the default stack size.
+ *
+ * Note that physical memory for a fiber's stack only gets allocated once it is
+ * touched, not when the fiber gets created. Below each stack
+ * sits a guard page, so that a stack overflow triggers an access violation instead
+ * of silently overwriting memory which the fiber doesn't own.
+ *
+ * On machines with more than one NUMA node, fiber stacks are spread across the
+ * nodes which host worker threads, and workers prefer fibers from their own node.
+ */
+struct le_jobs_settings_t {
+	uint32_t            worker_thread_count    = 0;                                   // number of worker threads, 0 means one per CPU which `placement` allows - workers beyond that number are not pinned
+	le_jobs_placement_t placement              = le_jobs_placement_t::ePhysicalCores; // how to pin worker threads to CPUs
+	bool                reserve_core_0         = true;                                // keep the physical core hosting CPU 0 free for the main thread
+	uint32_t            fiber_count            = 128;                                 // number of fibers with default-sized stacks
+	uint32_t            fiber_stack_size       = 1 << 23;                             // size in bytes of default-sized fiber stacks: 2^23 == 8 MB
+	uint32_t            small_fiber_count      = 0;                                   // number of fibers with small stacks, for jobs which ask for `small_stack`
+	uint32_t            small_fiber_stack_size = 1 << 16;                             // size in bytes of small fiber stacks: 2^16 == 64 KB
+	uint32_t            trace_buffer_capacity  = 0;                                   // number of trace events to keep per worker, 0 means tracing is not available - see `set_tracing_enabled`
+};
+
+/* Per-worker statistics, collected while tracing is enabled.
+ */
+struct le_jobs_worker_stats_t {
+	uint64_t jobs_run;    // number of jobs which this worker started
+	uint64_t steals;      // number of jobs which this worker stole from other workers
+	uint64_t busy_ns;     // time spent executing jobs
+	uint64_t parked_ns;   // time spent parked, waiting for work
+	float    utilisation; // busy_ns / time since tracing was enabled
+};
+
 // clang-format off
 struct le_jobs_api {
 
 	struct counter_t;
 
 	typedef void ( *fun_ptr_t )( void * );
+
+	// Callbacks for parallel_for, and parallel_reduce - these get called with a sub-range [range_begin, range_end)
+	typedef void ( *range_fun_ptr_t  )( uint64_t range_begin, uint64_t range_end, void* user_data );
+	typedef void ( *reduce_fun_ptr_t )( uint64_t range_begin, uint64_t range_end, void* accumulator, void* user_data );
+	typedef void ( *join_fun_ptr_t   )( void* accumulator, void const* other, void* user_data );
 	
+	/* Workers always pick up jobs of a higher priority before jobs of a lower priority.
+	 *
+	 * Background jobs never run on the first worker thread (as long as there is more
+	 * than one worker thread), so that there is always one worker thread available to
+	 * pick up frame-critical jobs, even if all other workers are busy with long-running
+	 * background jobs.
+	 */
+	enum class Priority : uint32_t {
+		eFrameCritical = 0, // work which the current frame waits for
+		eNormal        = 1, // default
+		eBackground    = 2, // long-running work, e.g. file i/o, or image decoding
+	};
+
 	/* A Job is a function pointer with a complete_counter which gets decreased
 	 * once the job is complete.
 	 */
 	struct le_job_o {
-		fun_ptr_t  fun_ptr          = nullptr; // function to execute
-		void *     fun_param        = nullptr; // user_data for function
-		counter_t *complete_counter = nullptr; // owned by le_job_manager, counter to decrement when job completes
+		fun_ptr_t  fun_ptr          = nullptr;           // function to execute
+		void *     fun_param        = nullptr;           // user_data for function
+		counter_t *complete_counter = nullptr;           // owned by le_job_manager, counter to decrement when job completes
+		Priority   priority         = Priority::eNormal; // jobs issued by parallel_for inherit the priority of the job which issued them
+		bool       small_stack      = false;             // leaf jobs may ask for a fiber with a small stack - falls back to a default-sized stack if none available
 	};
 
 	/* Initialise job system: This needs to be called only once,
 	 * before any other method involving the job system; 
 	 * 
-	 * `num_threads` tells us how many worker threads to initialise.
+	 * `settings` may be nullptr, in which case default settings are used.
 	 */
-	void ( * initialize                ) ( size_t num_threads );
+	void ( * initialize                ) ( le_jobs_settings_t const * settings );
 	void ( * terminate                 ) ( );
 
+	/* Returns true in-between `initialize` and `terminate`.
+	 *
+	 * Modules which optionally parallelise their work may use this to fall back
+	 * to running on the calling thread if the job system is not running.
+	 */
+	bool ( * is_initialized            ) ( );
+
 	/* Adds num_jobs to the job system queue, and immediately starts running them.
 	 * 
 	 * Allocates a counter within the job system, and initialises the counter's value
@@ -37,6 +115,20 @@ struct le_jobs_api {
 	 */
 	void ( * run_jobs                  ) ( le_job_o* jobs, uint32_t num_jobs, counter_t** counter );
 
+	/* Like run_jobs, but jobs only get issued once `predecessor` has reached zero.
+	 *
+	 * Use this to express dependencies between jobs without blocking a fiber:
+	 * `counter` may in turn be used as a predecessor, so that you can build chains
+	 * and graphs of jobs. If jobs depend on more than one job, issue these
+	 * predecessor jobs with the same call, so that they share one counter.
+	 *
+	 * Takes ownership of `predecessor`: the job system frees it once it has reached
+	 * zero - you must not wait for `predecessor`, or use it again after this call.
+	 *
+	 * `jobs` get copied, so that `jobs` may be freed once this method returns.
+	 */
+	void ( * run_jobs_after            ) ( counter_t* predecessor, le_job_o* jobs, uint32_t num_jobs, counter_t** counter );
+
 	/* Wait until counter == target value.
 	 * 
 	 * When called on the main thread, this method will spin-lock until counter is at target value.
@@ -48,11 +140,52 @@ struct le_jobs_api {
 	 */
 	void ( * wait_for_counter_and_free ) ( counter_t* counter, uint32_t target_value );
 
+	/* Call `fn` for sub-ranges of [begin, end), in parallel, and return once the full range has been processed.
+	 *
+	 * Ranges are split in half for as long as other workers run out of work, and
+	 * the remaining range is larger than `grain` - so that idle workers may steal
+	 * the upper half of a range. `fn` is called with sub-ranges of at most `grain`
+	 * elements.
+	 *
+	 * May be called from the main thread, or from within a job.
+	 */
+	void ( * parallel_for              ) ( uint64_t begin, uint64_t end, uint64_t grain, range_fun_ptr_t fn, void* user_data );
+
+	/* Like parallel_for, but each worker accumulates into its own copy of `result`.
+	 *
+	 * `result` must point to `result_size` bytes, initialised to the identity value
+	 * of the reduction (e.g. 0 for a sum). `reduce_fn` is called with sub-ranges, and
+	 * the current worker's accumulator. Once all sub-ranges have been processed,
+	 * `join_fn` gets called on the calling thread to fold each worker's accumulator
+	 * into `result`.
+	 *
+	 * `reduce_fn` must not yield, as accumulators are per-worker, and not per-fiber.
+	 */
+	void ( * parallel_reduce           ) ( uint64_t begin, uint64_t end, uint64_t grain, reduce_fun_ptr_t reduce_fn, join_fun_ptr_t join_fn, void* result, size_t result_size, void* user_data );
+
 	void (* yield                      ) ( void );
 
-	// return id of current worker thread (0..MAX_THREADS), or -1 if called from outside job system.
+	// return id of current worker thread (0..LE_JOBS_MAX_WORKER_THREAD_COUNT-1), or -1 if called from outside job system.
 	int32_t (* get_current_worker_id)(void); 
 
+	/* Tracing - only available if the job system was initialised with a non-zero
+	 * `trace_buffer_capacity`, otherwise these methods do nothing, or return 0/false.
+	 *
+	 * While tracing is enabled, each worker records when jobs get issued, start,
+	 * yield, resume, and complete, and when it parks. Enabling tracing resets
+	 * worker statistics, and discards any previously recorded events.
+	 *
+	 * `get_worker_stats` fills in up to `max_workers` entries in `stats`, and
+	 * returns the number of workers.
+	 *
+	 * `write_chrome_trace` writes the recorded events as a Chrome trace event file,
+	 * which you can open via chrome://tracing, or https://ui.perfetto.dev. For a
+	 * clean trace, call this while the job system is idle, e.g. in-between frames.
+	 */
+	void     ( * set_tracing_enabled   ) ( bool enabled );
+	uint32_t ( * get_worker_stats      ) ( le_jobs_worker_stats_t* stats, uint32_t max_workers );
+	bool     ( * write_chrome_trace    ) ( char const* file_path );
+
 };
 // clang-format on
 LE_MODULE( le_jobs );
@@ -65,15 +198,24 @@ static const auto& api = le_jobs_api_i;
 
 using counter_t = le_jobs_api::counter_t;
 using job_t     = le_jobs_api::le_job_o;
+using Priority  = le_jobs_api::Priority;
 
 static const auto& initialize                = api -> initialize;
 static const auto& terminate                 = api -> terminate;
+static const auto& is_initialized            = api -> is_initialized;
 static const auto& run_jobs                  = api -> run_jobs;
+static const auto& run_jobs_after            = api -> run_jobs_after;
 static const auto& wait_for_counter_and_free = api -> wait_for_counter_and_free;
+static const auto& parallel_for              = api -> parallel_for;
+static const auto& parallel_reduce           = api -> parallel_reduce;
 
 static const auto& yield                 = api -> yield;
 static const auto& get_current_worker_id = api -> get_current_worker_id;
 
+static const auto& set_tracing_enabled = api -> set_tracing_enabled;
+static const auto& get_worker_stats    = api -> get_worker_stats;
+static const auto& write_chrome_trace  = api -> write_chrome_trace;
+
 } // namespace le_jobs
 
 #endif // __cplusplus
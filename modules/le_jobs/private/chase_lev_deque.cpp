@@ -0,0 +1,131 @@
+#include "chase_lev_deque.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <atomic>
+
+struct chase_lev_deque_t {
+	// top is written by thieves, bottom only by the owner - we keep them
+	// on separate cache lines so that stealing does not disturb the owner.
+	std::atomic<int64_t> top;
+	char                 _cache_padding1[ 64 - sizeof( std::atomic<int64_t> ) ];
+	std::atomic<int64_t> bottom;
+	char                 _cache_padding2[ 64 - sizeof( std::atomic<int64_t> ) ];
+	uint32_t             size;
+	uint32_t             power_of_2_mod;
+	std::atomic<void*>*  buffer;
+};
+
+// ----------------------------------------------------------------------
+
+chase_lev_deque_t* chase_lev_deque_create( uint32_t power_of_2_size ) {
+	assert( power_of_2_size && power_of_2_size < 32 );
+	const uint32_t size = 1u << power_of_2_size;
+
+	chase_lev_deque_t* dq = new chase_lev_deque_t();
+
+	dq->top            = 0;
+	dq->bottom         = 0;
+	dq->size           = size;
+	dq->power_of_2_mod = size - 1;
+	dq->buffer         = new std::atomic<void*>[ size ];
+
+	for ( uint32_t i = 0; i != size; i++ ) {
+		dq->buffer[ i ].store( nullptr, std::memory_order_relaxed );
+	}
+
+	return dq;
+}
+
+// ----------------------------------------------------------------------
+
+void chase_lev_deque_destroy( chase_lev_deque_t* dq ) {
+	delete[] dq->buffer;
+	delete dq;
+}
+
+// ----------------------------------------------------------------------
+
+size_t chase_lev_deque_size( const chase_lev_deque_t* dq ) {
+	assert( dq );
+	const int64_t b = dq->bottom.load( std::memory_order_relaxed );
+	const int64_t t = dq->top.load( std::memory_order_relaxed );
+	return b > t ? size_t( b - t ) : 0;
+}
+
+// ----------------------------------------------------------------------
+
+int chase_lev_deque_push( chase_lev_deque_t* dq, void* in ) {
+	assert( dq );
+	assert( in ); // we use nullptr to signal an empty deque, so we can't store nullptr.
+
+	const int64_t b = dq->bottom.load( std::memory_order_relaxed );
+	const int64_t t = dq->top.load( std::memory_order_acquire );
+
+	if ( b - t >= int64_t( dq->size ) ) {
+		// deque is full
+		return 0;
+	}
+
+	dq->buffer[ b & dq->power_of_2_mod ].store( in, std::memory_order_relaxed );
+	std::atomic_thread_fence( std::memory_order_release );
+	dq->bottom.store( b + 1, std::memory_order_relaxed );
+
+	return 1;
+}
+
+// ----------------------------------------------------------------------
+
+void* chase_lev_deque_pop( chase_lev_deque_t* dq ) {
+	assert( dq );
+
+	const int64_t b = dq->bottom.load( std::memory_order_relaxed ) - 1;
+	dq->bottom.store( b, std::memory_order_relaxed );
+	std::atomic_thread_fence( std::memory_order_seq_cst );
+	int64_t t = dq->top.load( std::memory_order_relaxed );
+
+	if ( t > b ) {
+		// deque was empty - restore bottom
+		dq->bottom.store( b + 1, std::memory_order_relaxed );
+		return nullptr;
+	}
+
+	// --------| invariant: deque holds at least one element
+
+	void* ret = dq->buffer[ b & dq->power_of_2_mod ].load( std::memory_order_relaxed );
+
+	if ( t == b ) {
+		// This was the last element - we must race any thieves for it.
+		if ( !dq->top.compare_exchange_strong( t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed ) ) {
+			// a thief got there first
+			ret = nullptr;
+		}
+		dq->bottom.store( b + 1, std::memory_order_relaxed );
+	}
+
+	return ret;
+}
+
+// ----------------------------------------------------------------------
+
+void* chase_lev_deque_steal( chase_lev_deque_t* dq ) {
+	assert( dq );
+
+	int64_t t = dq->top.load( std::memory_order_acquire );
+	std::atomic_thread_fence( std::memory_order_seq_cst );
+	const int64_t b = dq->bottom.load( std::memory_order_acquire );
+
+	if ( t >= b ) {
+		// deque is empty
+		return nullptr;
+	}
+
+	void* ret = dq->buffer[ t & dq->power_of_2_mod ].load( std::memory_order_relaxed );
+
+	if ( !dq->top.compare_exchange_strong( t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed ) ) {
+		// we lost the race against either the owner or another thief.
+		return nullptr;
+	}
+
+	return ret;
+}
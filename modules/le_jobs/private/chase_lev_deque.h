@@ -0,0 +1,31 @@
+#ifndef GUARD_CHASE_LEV_DEQUE_H
+#define GUARD_CHASE_LEV_DEQUE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Fixed-capacity work-stealing deque, after:
+ *
+ * Chase, Lev: "Dynamic Circular Work-Stealing Deque", SPAA 2005, and
+ * Lê, Pop, Cohen, Zappa Nardelli: "Correct and Efficient Work-Stealing
+ * for Weak Memory Models", PPoPP 2013.
+ *
+ * Only the owning thread may call `push` and `pop` - these operate on the
+ * bottom end of the deque, in LIFO order. Any other thread may call `steal`,
+ * which takes elements from the top end of the deque, in FIFO order.
+ *
+ * Storage does not grow: `push` returns 0 if the deque is full, in which case
+ * the caller must find somewhere else to put the element.
+ *
+ */
+
+struct chase_lev_deque_t;
+
+chase_lev_deque_t* chase_lev_deque_create( uint32_t power_of_2_size );
+void               chase_lev_deque_destroy( chase_lev_deque_t* dq );
+size_t             chase_lev_deque_size( const chase_lev_deque_t* dq );
+int                chase_lev_deque_push( chase_lev_deque_t* dq, void* in ); // owner only
+void*              chase_lev_deque_pop( chase_lev_deque_t* dq );            // owner only
+void*              chase_lev_deque_steal( chase_lev_deque_t* dq );          // any thread
+
+#endif
@@ -0,0 +1,183 @@
+#include "le_cpu_topology.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <thread>
+
+#ifdef __linux__
+#	include <dirent.h>
+#endif
+
+// ----------------------------------------------------------------------
+// Read first line of a text file into `buf`. Returns false if file could not be read.
+static bool read_line( char const* path, char* buf, size_t buf_size ) {
+	FILE* f = fopen( path, "rb" );
+	if ( nullptr == f ) {
+		return false;
+	}
+	bool success = ( nullptr != fgets( buf, int( buf_size ), f ) );
+	fclose( f );
+	return success;
+}
+
+// ----------------------------------------------------------------------
+
+static bool read_uint( char const* path, uint32_t* result ) {
+	char buf[ 32 ];
+	if ( !read_line( path, buf, sizeof( buf ) ) ) {
+		return false;
+	}
+	*result = uint32_t( strtoul( buf, nullptr, 10 ) );
+	return true;
+}
+
+// ----------------------------------------------------------------------
+// Parse a cpu list in sysfs format, e.g. "0-3,8,10-11".
+// Calls `fn( cpu, position )` for every cpu in the list, in order, until `fn` returns false.
+template <typename Fn>
+static void parse_cpu_list( char const* str, Fn fn ) {
+	uint32_t position = 0;
+	char*    p        = const_cast<char*>( str );
+	while ( *p >= '0' && *p <= '9' ) {
+		uint32_t first = uint32_t( strtoul( p, &p, 10 ) );
+		uint32_t last  = first;
+		if ( *p == '-' ) {
+			last = uint32_t( strtoul( p + 1, &p, 10 ) );
+		}
+		for ( uint32_t cpu = first; cpu <= last; cpu++, position++ ) {
+			if ( !fn( cpu, position ) ) {
+				return;
+			}
+		}
+		if ( *p == ',' ) {
+			p++;
+		}
+	}
+}
+
+// ----------------------------------------------------------------------
+// Return first cpu in cpu list file at `path`, or `fallback` if the file can't be read.
+static uint32_t read_first_cpu_in_list( char const* path, uint32_t fallback ) {
+	char buf[ 1024 ];
+	if ( !read_line( path, buf, sizeof( buf ) ) ) {
+		return fallback;
+	}
+	uint32_t result = fallback;
+	parse_cpu_list( buf, [ & ]( uint32_t cpu, uint32_t ) {
+		result = cpu;
+		return false;
+	} );
+	return result;
+}
+
+// ----------------------------------------------------------------------
+
+static void query_cpu_info( le_cpu_info_t* info, char const* sysfs_cpu_path ) {
+
+	char path[ 512 ];
+
+	uint32_t const cpu = info->cpu;
+
+	info->core    = cpu;
+	info->smt     = 0;
+	info->package = 0;
+	info->node    = 0;
+
+	snprintf( path, sizeof( path ), "%s/cpu%u/topology/physical_package_id", sysfs_cpu_path, cpu );
+	read_uint( path, &info->package );
+
+	// Logical cpus which share a physical core are listed as thread siblings - we use
+	// the first sibling to identify the physical core, which makes core ids unique
+	// across packages.
+	{
+		char buf[ 1024 ];
+		snprintf( path, sizeof( path ), "%s/cpu%u/topology/thread_siblings_list", sysfs_cpu_path, cpu );
+		if ( read_line( path, buf, sizeof( buf ) ) ) {
+			bool is_first = true;
+			parse_cpu_list( buf, [ & ]( uint32_t sibling, uint32_t position ) {
+				if ( is_first ) {
+					info->core = sibling;
+					is_first   = false;
+				}
+				if ( sibling == cpu ) {
+					info->smt = position;
+					return false;
+				}
+				return true;
+			} );
+		}
+	}
+
+	// The last-level cache is the cache with the highest level - we identify it
+	// via the first cpu which shares it. If there is no cache information, we
+	// assume that all cpus in a package share a cache.
+	info->cache = ( 1u << 31 ) | info->package;
+	{
+		uint32_t highest_level = 0;
+		for ( uint32_t i = 0; i != 16; i++ ) {
+			uint32_t level;
+			snprintf( path, sizeof( path ), "%s/cpu%u/cache/index%u/level", sysfs_cpu_path, cpu, i );
+			if ( !read_uint( path, &level ) ) {
+				break;
+			}
+			if ( level >= highest_level ) {
+				snprintf( path, sizeof( path ), "%s/cpu%u/cache/index%u/shared_cpu_list", sysfs_cpu_path, cpu, i );
+				highest_level = level;
+				info->cache   = read_first_cpu_in_list( path, info->cache );
+			}
+		}
+	}
+
+#ifdef __linux__
+	// The NUMA node shows up as a directory entry named "node<N>".
+	snprintf( path, sizeof( path ), "%s/cpu%u", sysfs_cpu_path, cpu );
+	if ( DIR* dir = opendir( path ) ) {
+		while ( dirent* entry = readdir( dir ) ) {
+			if ( 0 == strncmp( entry->d_name, "node", 4 ) && entry->d_name[ 4 ] >= '0' && entry->d_name[ 4 ] <= '9' ) {
+				info->node = uint32_t( strtoul( entry->d_name + 4, nullptr, 10 ) );
+				break;
+			}
+		}
+		closedir( dir );
+	}
+#endif
+}
+
+// ----------------------------------------------------------------------
+
+size_t le_cpu_topology_query( le_cpu_info_t* cpus, size_t max_cpus, char const* sysfs_cpu_path ) {
+
+	size_t num_cpus = 0;
+
+	char path[ 512 ];
+	char buf[ 1024 ];
+
+	snprintf( path, sizeof( path ), "%s/online", sysfs_cpu_path );
+
+	if ( read_line( path, buf, sizeof( buf ) ) ) {
+		parse_cpu_list( buf, [ & ]( uint32_t cpu, uint32_t ) {
+			if ( num_cpus < max_cpus ) {
+				cpus[ num_cpus ]     = {};
+				cpus[ num_cpus ].cpu = cpu;
+				query_cpu_info( cpus + num_cpus, sysfs_cpu_path );
+			}
+			num_cpus++;
+			return true;
+		} );
+	}
+
+	if ( num_cpus == 0 ) {
+		// No topology information available - we assume that each logical cpu is
+		// a physical core of its own, and that all cores share one cache.
+		num_cpus = std::max<size_t>( 1, std::thread::hardware_concurrency() );
+		for ( size_t i = 0; i < num_cpus && i < max_cpus; i++ ) {
+			cpus[ i ]      = {};
+			cpus[ i ].cpu  = uint32_t( i );
+			cpus[ i ].core = uint32_t( i );
+		}
+	}
+
+	return num_cpus;
+}
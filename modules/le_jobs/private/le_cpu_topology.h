@@ -0,0 +1,30 @@
+#ifndef GUARD_LE_CPU_TOPOLOGY_H
+#define GUARD_LE_CPU_TOPOLOGY_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Query which logical CPUs share a physical core, a last-level cache,
+ * a socket, or a NUMA node.
+ *
+ * On Linux, we read this information from sysfs. On other platforms, or if
+ * sysfs can't be read, we assume that each logical CPU is a physical core
+ * of its own, and that all CPUs share one socket, one cache, and one node.
+ *
+ */
+
+struct le_cpu_info_t {
+	uint32_t cpu;     // logical cpu index, as used for setting thread affinity
+	uint32_t core;    // physical core - unique across packages; logical cpus with the same core are SMT siblings
+	uint32_t smt;     // index of this logical cpu within its physical core, 0 for the first hardware thread
+	uint32_t package; // physical package (socket)
+	uint32_t cache;   // last-level cache - logical cpus with the same cache share their last-level cache
+	uint32_t node;    // NUMA node
+};
+
+// Fill `cpus` with up to `max_cpus` entries for online logical cpus, sorted by logical
+// cpu index. Returns the number of online logical cpus (which may exceed `max_cpus`).
+// `sysfs_cpu_path` is usually "/sys/devices/system/cpu".
+size_t le_cpu_topology_query( le_cpu_info_t* cpus, size_t max_cpus, char const* sysfs_cpu_path );
+
+#endif
@@ -0,0 +1,155 @@
+#include "le_jobs_trace.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <atomic>
+#include <chrono>
+
+struct le_jobs_trace_buffer_t {
+	std::atomic<uint64_t>  write_count; // total number of events recorded - only written by owner
+	uint32_t               size;
+	uint32_t               power_of_2_mod;
+	le_jobs_trace_event_t* events;
+};
+
+// ----------------------------------------------------------------------
+
+uint64_t le_jobs_trace_now() {
+	return uint64_t( std::chrono::duration_cast<std::chrono::nanoseconds>(
+	                     std::chrono::steady_clock::now().time_since_epoch() )
+	                     .count() );
+}
+
+// ----------------------------------------------------------------------
+
+le_jobs_trace_buffer_t* le_jobs_trace_buffer_create( uint32_t power_of_2_size ) {
+	assert( power_of_2_size < 32 );
+	const uint32_t size = 1u << power_of_2_size;
+
+	le_jobs_trace_buffer_t* buffer = new le_jobs_trace_buffer_t();
+
+	buffer->write_count    = 0;
+	buffer->size           = size;
+	buffer->power_of_2_mod = size - 1;
+	buffer->events         = new le_jobs_trace_event_t[ size ]{};
+
+	return buffer;
+}
+
+// ----------------------------------------------------------------------
+
+void le_jobs_trace_buffer_destroy( le_jobs_trace_buffer_t* buffer ) {
+	delete[] buffer->events;
+	delete buffer;
+}
+
+// ----------------------------------------------------------------------
+
+void le_jobs_trace_buffer_record( le_jobs_trace_buffer_t* buffer, le_jobs_trace_event_t const& event ) {
+	const uint64_t i = buffer->write_count.load( std::memory_order_relaxed );
+
+	buffer->events[ i & buffer->power_of_2_mod ] = event;
+
+	// Publish event - readers which see the new count will also see the event.
+	buffer->write_count.store( i + 1, std::memory_order_release );
+}
+
+// ----------------------------------------------------------------------
+
+static double ns_to_us( uint64_t ns ) {
+	return double( ns ) / 1000.0;
+}
+
+// ----------------------------------------------------------------------
+// Write a complete ("X") event, which spans [begin, end) on thread `tid`.
+static void write_slice( FILE* f, bool* is_first, size_t tid, char const* name, uint64_t begin, uint64_t end ) {
+	fprintf( f, "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%zu,\"ts\":%.3f,\"dur\":%.3f",
+	         *is_first ? "" : ",", name, tid, ns_to_us( begin ), ns_to_us( end - begin ) );
+	*is_first = false;
+}
+
+// ----------------------------------------------------------------------
+
+bool le_jobs_trace_write_chrome_json( char const* path, le_jobs_trace_buffer_t* const* buffers, size_t num_buffers, uint64_t since_timestamp ) {
+
+	FILE* f = fopen( path, "wb" );
+
+	if ( nullptr == f ) {
+		return false;
+	}
+
+	bool is_first = true;
+
+	fprintf( f, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[" );
+
+	for ( size_t tid = 0; tid != num_buffers; ++tid ) {
+
+		le_jobs_trace_buffer_t const* buffer = buffers[ tid ];
+
+		fprintf( f, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%zu,\"args\":{\"name\":\"le_jobs worker %zu\"}}",
+		         is_first ? "" : ",", tid, tid );
+		is_first = false;
+
+		const uint64_t end   = buffer->write_count.load( std::memory_order_acquire );
+		const uint64_t begin = end > buffer->size ? end - buffer->size : 0;
+
+		// Start of the currently open slice, if any. Events which close a slice
+		// that was opened before the oldest event in the buffer are ignored.
+		le_jobs_trace_event_t const* slice_open = nullptr;
+		le_jobs_trace_event_t const* park_open  = nullptr;
+
+		for ( uint64_t i = begin; i != end; ++i ) {
+
+			le_jobs_trace_event_t const& e = buffer->events[ i & buffer->power_of_2_mod ];
+
+			if ( e.timestamp < since_timestamp ) {
+				continue;
+			}
+
+			switch ( e.type ) {
+			case LE_JOBS_TRACE_EVENT::eJobBegin:
+				fprintf( f, ",\n{\"name\":\"queue depth\",\"ph\":\"C\",\"pid\":0,\"tid\":%zu,\"ts\":%.3f,\"args\":{\"jobs\":%u}}",
+				         tid, ns_to_us( e.timestamp ), e.queue_depth );
+				slice_open = &e;
+				break;
+			case LE_JOBS_TRACE_EVENT::eFiberResume:
+				slice_open = &e;
+				break;
+			case LE_JOBS_TRACE_EVENT::eJobEnd:     // fall-through
+			case LE_JOBS_TRACE_EVENT::eFiberSuspend: {
+				if ( slice_open && slice_open->job_id == e.job_id ) {
+					char name[ 32 ];
+					snprintf( name, sizeof( name ), "job 0x%llx", ( unsigned long long )e.job_fun_ptr );
+					write_slice( f, &is_first, tid, name, slice_open->timestamp, e.timestamp );
+					fprintf( f, ",\"args\":{\"job\":%llu,\"priority\":%u",
+					         ( unsigned long long )e.job_id, unsigned( e.priority ) );
+					if ( slice_open->type == LE_JOBS_TRACE_EVENT::eJobBegin && slice_open->enqueue_time >= since_timestamp ) {
+						fprintf( f, ",\"queued_us\":%.3f", ns_to_us( slice_open->timestamp - slice_open->enqueue_time ) );
+					}
+					fprintf( f, ",\"%s\":true}}", e.type == LE_JOBS_TRACE_EVENT::eJobEnd ? "completed" : "yielded" );
+				}
+				slice_open = nullptr;
+				break;
+			}
+			case LE_JOBS_TRACE_EVENT::eParkBegin:
+				park_open = &e;
+				break;
+			case LE_JOBS_TRACE_EVENT::eParkEnd:
+				if ( park_open ) {
+					write_slice( f, &is_first, tid, "parked", park_open->timestamp, e.timestamp );
+					fprintf( f, "}" );
+				}
+				park_open = nullptr;
+				break;
+			}
+		}
+	}
+
+	fprintf( f, "\n]}\n" );
+
+	bool success = ( 0 == ferror( f ) );
+
+	fclose( f );
+
+	return success;
+}
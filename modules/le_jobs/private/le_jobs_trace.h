@@ -0,0 +1,52 @@
+#ifndef GUARD_LE_JOBS_TRACE_H
+#define GUARD_LE_JOBS_TRACE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Per-worker trace event buffers for le_jobs.
+ *
+ * Each worker thread owns one trace buffer, into which only this worker may
+ * record events. Buffers have a fixed capacity, and once full, new events
+ * overwrite the oldest events - so that a buffer always holds the most recent
+ * history of its worker.
+ *
+ * Reading a buffer while its worker is still recording events is allowed,
+ * but events which get overwritten while they are being read may come out
+ * garbled: for a clean trace, export while the job system is idle, e.g.
+ * in-between frames.
+ *
+ */
+
+enum class LE_JOBS_TRACE_EVENT : uint16_t {
+	eJobBegin = 0, // fiber starts executing a new job
+	eJobEnd,       // job has completed
+	eFiberSuspend, // fiber yielded, job is not complete
+	eFiberResume,  // fiber resumes a job which did yield
+	eParkBegin,    // worker parks, as it could not find any work
+	eParkEnd,      // worker was woken up
+};
+
+struct le_jobs_trace_event_t {
+	uint64_t            timestamp;    // nanoseconds, see le_jobs_trace_now()
+	uint64_t            job_id;       // unique per job, shared by all events for the same job
+	uint64_t            job_fun_ptr;  // address of job function, used as a name for the job
+	uint64_t            enqueue_time; // eJobBegin only: timestamp at which job was issued
+	uint32_t            queue_depth;  // eJobBegin only: number of jobs waiting on global queues and this worker's deques
+	uint16_t            priority;     // priority of job
+	LE_JOBS_TRACE_EVENT type;         //
+};
+
+struct le_jobs_trace_buffer_t;
+
+uint64_t                le_jobs_trace_now(); // monotonic clock, in nanoseconds
+le_jobs_trace_buffer_t* le_jobs_trace_buffer_create( uint32_t power_of_2_size );
+void                    le_jobs_trace_buffer_destroy( le_jobs_trace_buffer_t* buffer );
+void                    le_jobs_trace_buffer_record( le_jobs_trace_buffer_t* buffer, le_jobs_trace_event_t const& event ); // owner only
+
+// Write events from all buffers which were recorded at or after `since_timestamp` to
+// a file in Chrome's trace event format. Buffer `i` is shown as thread `i`.
+// Returns false if the file could not be written.
+bool le_jobs_trace_write_chrome_json( char const* path, le_jobs_trace_buffer_t* const* buffers, size_t num_buffers, uint64_t since_timestamp );
+
+#endif
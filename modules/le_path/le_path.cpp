@@ -1,20 +1,36 @@
 #include "le_path.h"
 
 #include "le_log.h"
+#include "le_jobs.h"
+#include "le_hash_util.h"
 
 #include <vector>
+#include <array>
+#include <span>
+#include <bit>
 #include <algorithm>
 
 #include <cstring>
 #include <cstdio>
 #include <cstdlib>
-#include <cctype> // for toupper
+#include <charconv> // for from_chars
 
 #include "glm/glm.hpp"
 #include "glm/gtx/vector_query.hpp"
 #include "glm/gtx/vector_angle.hpp"
 #include "glm/gtx/rotate_vector.hpp"
 
+#ifndef _WIN32
+#	include <fcntl.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <unistd.h>
+#endif
+
+#if defined( __x86_64 ) || defined( _M_X64 )
+#	include <immintrin.h> // for batched bezier flattening
+#endif
+
 
 using stroke_attribute_t = le_path_api::stroke_attribute_t;
 
@@ -75,20 +91,51 @@ struct PathCommand {
 	}
 };
 
+// A contour is a range of commands in the path's command array.
 struct Contour {
-	std::vector<PathCommand> commands; // svg-style commands+parameters creating the path
+	uint32_t commands_offset; // index of first command
+	uint32_t commands_count;
+	uint64_t hash; // hash over commands, 0 if the contour changed since its hash was last calculated
+};
+
+// Identifies what a polyline was generated from: contour contents, and
+// method+parameter. Polylines with matching keys are interchangeable.
+struct PolylineKey {
+	enum Generator : uint32_t {
+		eNone = 0, // polyline may not be re-used (e.g. it was resampled)
+		eTrace,
+		eFlatten,
+	};
+	uint64_t  contour_hash;
+	float     parameter; // resolution for trace, tolerance for flatten
+	Generator generator;
+
+	bool operator==( PolylineKey const& ) const = default;
 };
 
+// A polyline is a range of vertices, and a range of tangents in a
+// PolylineBuffer. There is one distance for each vertex.
 struct Polyline {
+	uint32_t    vertices_offset; // index of first vertex, and first distance
+	uint32_t    vertices_count;
+	uint32_t    tangents_offset; // index of first tangent
+	uint32_t    tangents_count;
+	float       total_distance;
+	PolylineKey key;
+};
+
+// Vertex data for all polylines of a path, in flat arrays, so that
+// re-tracing a path re-uses memory instead of allocating anew.
+//
+// Polylines are written one after another: trace and flatten functions
+// append to the last polyline, which is opened via `polyline_begin`, and
+// closed via `polyline_end`.
+struct PolylineBuffer {
 	std::vector<glm::vec2> vertices;
 	std::vector<glm::vec2> tangents;
 	std::vector<float>     distances;
-	float                  total_distance = 0;
-};
-
-struct le_path_o {
-	std::vector<Contour>  contours;  // an array of sub-paths, a contour must start with a moveto instruction
-	std::vector<Polyline> polylines; // an array of polylines, each corresponding to a sub-path.
+	std::vector<Polyline>  polylines;
+	float                  total_distance = 0; // running total for the polyline currently being written
 };
 
 struct CubicBezier {
@@ -107,11 +154,12 @@ struct CurveSegment {
 	enum Type : uint32_t {
 		eCubicBezier = 0,
 		eLine        = 1,
-	} const type;
+	} type;
 	union {
 		CubicBezier asCubicBezier;
 		Line        asLine;
 	};
+	CurveSegment() = default;
 	CurveSegment( CubicBezier const& cb )
 	    : type( eCubicBezier ) {
 		asCubicBezier = cb;
@@ -128,6 +176,424 @@ struct InflectionData {
 	float t_2;
 };
 
+// Monotonous sub-segments of a single cubic bezier curve. Splitting a
+// curve at its inflection points yields at most three sub-segments, so
+// we can keep these in a fixed-size array.
+struct CurveSegments {
+	CurveSegment segments[ 4 ];
+	uint32_t     count = 0;
+
+	void push_back( CurveSegment const& segment ) {
+		assert( count < 4 );
+		segments[ count++ ] = segment;
+	}
+	CurveSegment const* begin() const {
+		return segments;
+	}
+	CurveSegment const* end() const {
+		return segments + count;
+	}
+};
+
+// ----------------------------------------------------------------------
+// Lane-wide float type used by the batched bezier flattener.
+//
+// We use AVX (8 lanes) if the compiler targets it, SSE (4 lanes) on any
+// other x86-64 target, and a plain array of 4 floats everywhere else, or
+// if LE_PATH_FLATTEN_SCALAR is defined.
+//
+#if defined( __AVX__ ) && !defined( LE_PATH_FLATTEN_SCALAR )
+
+static constexpr uint32_t SIMD_WIDTH = 8;
+
+struct vfloat {
+	__m256 v;
+};
+
+// clang-format off
+static inline vfloat   vf_set1( float f )                      { return { _mm256_set1_ps( f ) }; }
+static inline vfloat   vf_load( float const* p )               { return { _mm256_loadu_ps( p ) }; }
+static inline void     vf_store( float* p, vfloat a )          { _mm256_storeu_ps( p, a.v ); }
+static inline vfloat   operator+( vfloat a, vfloat b )         { return { _mm256_add_ps( a.v, b.v ) }; }
+static inline vfloat   operator-( vfloat a, vfloat b )         { return { _mm256_sub_ps( a.v, b.v ) }; }
+static inline vfloat   operator*( vfloat a, vfloat b )         { return { _mm256_mul_ps( a.v, b.v ) }; }
+static inline vfloat   operator/( vfloat a, vfloat b )         { return { _mm256_div_ps( a.v, b.v ) }; }
+static inline vfloat   vf_sqrt( vfloat a )                     { return { _mm256_sqrt_ps( a.v ) }; }
+static inline vfloat   vf_abs( vfloat a )                      { return { _mm256_andnot_ps( _mm256_set1_ps( -0.f ), a.v ) }; }
+static inline vfloat   vf_min( vfloat a, vfloat b )            { return { _mm256_min_ps( a.v, b.v ) }; }
+static inline uint32_t vf_mask_ge( vfloat a, vfloat b )        { return uint32_t( _mm256_movemask_ps( _mm256_cmp_ps( a.v, b.v, _CMP_GE_OQ ) ) ); }
+// clang-format on
+
+#elif ( defined( __x86_64 ) || defined( _M_X64 ) ) && !defined( LE_PATH_FLATTEN_SCALAR )
+
+static constexpr uint32_t SIMD_WIDTH = 4;
+
+struct vfloat {
+	__m128 v;
+};
+
+// clang-format off
+static inline vfloat   vf_set1( float f )                      { return { _mm_set1_ps( f ) }; }
+static inline vfloat   vf_load( float const* p )               { return { _mm_loadu_ps( p ) }; }
+static inline void     vf_store( float* p, vfloat a )          { _mm_storeu_ps( p, a.v ); }
+static inline vfloat   operator+( vfloat a, vfloat b )         { return { _mm_add_ps( a.v, b.v ) }; }
+static inline vfloat   operator-( vfloat a, vfloat b )         { return { _mm_sub_ps( a.v, b.v ) }; }
+static inline vfloat   operator*( vfloat a, vfloat b )         { return { _mm_mul_ps( a.v, b.v ) }; }
+static inline vfloat   operator/( vfloat a, vfloat b )         { return { _mm_div_ps( a.v, b.v ) }; }
+static inline vfloat   vf_sqrt( vfloat a )                     { return { _mm_sqrt_ps( a.v ) }; }
+static inline vfloat   vf_abs( vfloat a )                      { return { _mm_andnot_ps( _mm_set1_ps( -0.f ), a.v ) }; }
+static inline vfloat   vf_min( vfloat a, vfloat b )            { return { _mm_min_ps( a.v, b.v ) }; }
+static inline uint32_t vf_mask_ge( vfloat a, vfloat b )        { return uint32_t( _mm_movemask_ps( _mm_cmpge_ps( a.v, b.v ) ) ); }
+// clang-format on
+
+#else
+
+static constexpr uint32_t SIMD_WIDTH = 4;
+
+struct vfloat {
+	float v[ SIMD_WIDTH ];
+};
+
+#	define VF_FOR_EACH_LANE( expr )                    \
+		vfloat r;                                      \
+		for ( uint32_t i = 0; i != SIMD_WIDTH; i++ ) { \
+			r.v[ i ] = ( expr );                       \
+		}                                              \
+		return r
+
+// clang-format off
+static inline vfloat   vf_set1( float f )                      { VF_FOR_EACH_LANE( f ); }
+static inline vfloat   vf_load( float const* p )               { VF_FOR_EACH_LANE( p[ i ] ); }
+static inline void     vf_store( float* p, vfloat a )          { memcpy( p, a.v, sizeof( a.v ) ); }
+static inline vfloat   operator+( vfloat a, vfloat b )         { VF_FOR_EACH_LANE( a.v[ i ] + b.v[ i ] ); }
+static inline vfloat   operator-( vfloat a, vfloat b )         { VF_FOR_EACH_LANE( a.v[ i ] - b.v[ i ] ); }
+static inline vfloat   operator*( vfloat a, vfloat b )         { VF_FOR_EACH_LANE( a.v[ i ] * b.v[ i ] ); }
+static inline vfloat   operator/( vfloat a, vfloat b )         { VF_FOR_EACH_LANE( a.v[ i ] / b.v[ i ] ); }
+static inline vfloat   vf_sqrt( vfloat a )                     { VF_FOR_EACH_LANE( sqrtf( a.v[ i ] ) ); }
+static inline vfloat   vf_abs( vfloat a )                      { VF_FOR_EACH_LANE( fabsf( a.v[ i ] ) ); }
+static inline vfloat   vf_min( vfloat a, vfloat b )            { VF_FOR_EACH_LANE( a.v[ i ] < b.v[ i ] ? a.v[ i ] : b.v[ i ] ); }
+// clang-format on
+
+#	undef VF_FOR_EACH_LANE
+
+static inline uint32_t vf_mask_ge( vfloat a, vfloat b ) {
+	uint32_t mask = 0;
+	for ( uint32_t i = 0; i != SIMD_WIDTH; i++ ) {
+		mask |= uint32_t( a.v[ i ] >= b.v[ i ] ) << i;
+	}
+	return mask;
+}
+
+#endif
+
+// Lane-wide 2d vector - each lane holds one vector.
+struct vfloat2 {
+	vfloat x;
+	vfloat y;
+};
+
+// clang-format off
+static inline vfloat2 operator+( vfloat2 const& a, vfloat2 const& b ) { return { a.x + b.x, a.y + b.y }; }
+static inline vfloat2 operator-( vfloat2 const& a, vfloat2 const& b ) { return { a.x - b.x, a.y - b.y }; }
+static inline vfloat2 operator*( vfloat a, vfloat2 const& b )         { return { a * b.x, a * b.y }; }
+// clang-format on
+
+// One step of the batched flattener: for each lane, one vertex with its
+// tangent, and its distance to the previous vertex.
+struct FlattenRow {
+	float p_x[ SIMD_WIDTH ];
+	float p_y[ SIMD_WIDTH ];
+	float t_x[ SIMD_WIDTH ];
+	float t_y[ SIMD_WIDTH ];
+	float dist[ SIMD_WIDTH ];
+};
+
+// Where to find the flattened vertices for a cubic bezier segment: rows
+// [row_begin, row_end) of the lane it was flattened in.
+struct FlattenRange {
+	uint32_t lane;
+	uint32_t row_begin;
+	uint32_t row_end;
+};
+
+// Scratch space for flattening all curves of a path in one batch.
+// We keep this with the path, so that re-flattening the path re-uses
+// memory instead of allocating anew.
+struct FlattenBatch {
+	std::vector<CurveSegments> splits;  // monotonous sub-segments, one entry per curve command, in command order
+	std::vector<CubicBezier>   cubics;  // all cubic sub-segments from `splits`, in order
+	std::vector<FlattenRange>  ranges;  // output range for each element of `cubics`
+	std::vector<FlattenRow>    rows;    // flattened output; only grows, never shrinks
+};
+
+// Scratch space for generating left and right outlines when tessellating strokes.
+struct StrokeScratch {
+	std::vector<glm::vec2> outline_l;
+	std::vector<glm::vec2> outline_r;
+};
+
+// Triangles from the most recent call to tessellate_thick_contour.
+struct StrokeCache {
+	uint64_t               contour_hash = 0; // 0 means: cache is empty
+	stroke_attribute_t     stroke_attributes{};
+	std::vector<glm::vec2> triangles;
+};
+
+// Outlines from the most recent call to generate_offset_outline_for_contour.
+struct OutlineCache {
+	uint64_t               contour_hash = 0; // 0 means: cache is empty
+	float                  line_weight  = 0;
+	float                  tolerance    = 0;
+	std::vector<glm::vec2> outline_l;
+	std::vector<glm::vec2> outline_r;
+};
+
+static constexpr uint32_t NO_POLYLINE = ~0u;
+
+struct le_path_o {
+	std::vector<PathCommand> commands;         // svg-style commands+parameters for all contours, one contour after another
+	std::vector<Contour>     contours;         // an array of sub-paths, a contour must start with a moveto instruction
+	PolylineBuffer           polylines;        // an array of polylines, each corresponding to a sub-path.
+	PolylineBuffer           resample_scratch; // polylines get resampled into here, and then swapped
+	FlattenBatch             flatten_batch;
+
+	// Polylines from the most recent trace or flatten. These survive `clear`, so
+	// that contours which are rebuilt unchanged don't need to be traced again.
+	PolylineBuffer        polyline_cache;
+	std::vector<uint32_t> polyline_cache_table; // open-addressing hash table: PolylineKey -> index into polyline_cache.polylines, or NO_POLYLINE
+	bool                  polyline_cache_table_valid = false;
+	std::vector<uint32_t> cached_polyline_for_contour; // scratch: per contour, index into polyline_cache.polylines, or NO_POLYLINE
+
+	StrokeScratch stroke_scratch;
+	StrokeCache   stroke_cache;
+	OutlineCache  outline_cache;
+};
+
+// ----------------------------------------------------------------------
+
+static inline std::span<PathCommand> contour_get_commands( le_path_o* self, Contour const& contour ) {
+	return { self->commands.data() + contour.commands_offset, contour.commands_count };
+}
+
+static inline std::span<PathCommand const> contour_get_commands( le_path_o const* self, Contour const& contour ) {
+	return { self->commands.data() + contour.commands_offset, contour.commands_count };
+}
+
+// ----------------------------------------------------------------------
+// Adds a command to the last contour. Commands for the last contour are
+// always at the end of the command array.
+template <typename... Args>
+static inline void contour_add_command( le_path_o* self, Args const&... args ) {
+	assert( !self->contours.empty() ); // subpath must exist
+	self->commands.emplace_back( args... );
+	self->contours.back().commands_count++;
+	self->contours.back().hash = 0; // mark contour as changed
+}
+
+// ----------------------------------------------------------------------
+
+static void polyline_buffer_clear( PolylineBuffer& buffer ) {
+	buffer.vertices.clear();
+	buffer.tangents.clear();
+	buffer.distances.clear();
+	buffer.polylines.clear();
+}
+
+// ----------------------------------------------------------------------
+
+static void polyline_begin( PolylineBuffer& buffer ) {
+	buffer.polylines.push_back( { uint32_t( buffer.vertices.size() ), 0, uint32_t( buffer.tangents.size() ), 0, 0.f, {} } );
+	buffer.total_distance = 0;
+}
+
+// ----------------------------------------------------------------------
+
+static void polyline_end( PolylineBuffer& buffer ) {
+	assert( buffer.vertices.size() == buffer.distances.size() );
+	Polyline& polyline      = buffer.polylines.back();
+	polyline.vertices_count = uint32_t( buffer.vertices.size() ) - polyline.vertices_offset;
+	polyline.tangents_count = uint32_t( buffer.tangents.size() ) - polyline.tangents_offset;
+	polyline.total_distance = buffer.total_distance;
+}
+
+// ----------------------------------------------------------------------
+// Returns whether the polyline currently being written has any vertices.
+static inline bool polyline_has_vertices( PolylineBuffer const& buffer ) {
+	return buffer.vertices.size() > buffer.polylines.back().vertices_offset;
+}
+
+// ----------------------------------------------------------------------
+// Appends a copy of `polyline`, which lives in buffer `src`, to buffer `dst`.
+static void polyline_buffer_append_copy( PolylineBuffer& dst, PolylineBuffer const& src, Polyline const& polyline ) {
+
+	Polyline copy        = polyline;
+	copy.vertices_offset = uint32_t( dst.vertices.size() );
+	copy.tangents_offset = uint32_t( dst.tangents.size() );
+	dst.polylines.push_back( copy );
+
+	auto vertices_begin = polyline.vertices_offset;
+	auto vertices_end   = polyline.vertices_offset + polyline.vertices_count;
+	auto tangents_begin = polyline.tangents_offset;
+	auto tangents_end   = polyline.tangents_offset + polyline.tangents_count;
+
+	dst.vertices.insert( dst.vertices.end(), src.vertices.begin() + vertices_begin, src.vertices.begin() + vertices_end );
+	dst.distances.insert( dst.distances.end(), src.distances.begin() + vertices_begin, src.distances.begin() + vertices_end );
+	dst.tangents.insert( dst.tangents.end(), src.tangents.begin() + tangents_begin, src.tangents.begin() + tangents_end );
+}
+
+// ----------------------------------------------------------------------
+// Returns hash over all commands of `contour`. The hash is kept with the
+// contour until any of its commands change.
+static uint64_t contour_get_hash( le_path_o* self, Contour& contour ) {
+
+	if ( contour.hash ) {
+		return contour.hash;
+	}
+
+	// ----------| invariant: contour has changed since we last calculated its hash
+
+	uint64_t hash = FNV1A_VAL_64_CONST;
+
+	auto hash_u32 = [ &hash ]( uint32_t value ) {
+		hash = ( hash ^ value ) * FNV1A_PRIME_64_CONST;
+	};
+	auto hash_vec2 = [ &hash_u32 ]( glm::vec2 const& v ) {
+		hash_u32( std::bit_cast<uint32_t>( v.x ) );
+		hash_u32( std::bit_cast<uint32_t>( v.y ) );
+	};
+
+	// Note that we may only hash fields which are in use for a command type:
+	// unused bytes of `PathCommand::data` are undefined.
+	for ( auto const& command : contour_get_commands( self, contour ) ) {
+		hash_u32( command.type );
+		hash_vec2( command.p );
+		switch ( command.type ) {
+		case PathCommand::eQuadBezierTo:
+			hash_vec2( command.data.as_quad_bezier.c1 );
+			break;
+		case PathCommand::eCubicBezierTo:
+			hash_vec2( command.data.as_cubic_bezier.c1 );
+			hash_vec2( command.data.as_cubic_bezier.c2 );
+			break;
+		case PathCommand::eArcTo:
+			hash_vec2( command.data.as_arc.radii );
+			hash_u32( std::bit_cast<uint32_t>( command.data.as_arc.phi ) );
+			hash_u32( uint32_t( command.data.as_arc.large_arc ) | uint32_t( command.data.as_arc.sweep ) << 1 );
+			break;
+		default:
+			break;
+		}
+	}
+
+	// FNV mixes each word into higher bits only - low bits of the hash depend only on
+	// low bits of the input, which are all zero for floats with integer values. The
+	// polyline cache table takes slots from low bits, so we finish with MurmurHash3's
+	// fmix64, which makes every bit of the hash depend on every bit of the input.
+	hash ^= hash >> 33;
+	hash *= 0xff51afd7ed558ccdull;
+	hash ^= hash >> 33;
+	hash *= 0xc4ceb9fe1a85ec53ull;
+	hash ^= hash >> 33;
+
+	contour.hash = hash ? hash : 1; // 0 is reserved to mean "changed"
+
+	return contour.hash;
+}
+
+// ----------------------------------------------------------------------
+
+static void polyline_cache_build_table( le_path_o* self ) {
+
+	auto const& cached = self->polyline_cache.polylines;
+	auto&       table  = self->polyline_cache_table;
+
+	// Table size is a power of two, and at least twice the number of
+	// entries, so that there is always an empty slot to end a probe.
+	size_t table_size = 16;
+	while ( table_size < 2 * cached.size() ) {
+		table_size *= 2;
+	}
+
+	table.assign( table_size, NO_POLYLINE );
+
+	size_t const mask = table_size - 1;
+
+	for ( uint32_t i = 0; i != cached.size(); i++ ) {
+		if ( cached[ i ].key.generator == PolylineKey::eNone ) {
+			continue;
+		}
+		size_t slot = cached[ i ].key.contour_hash & mask;
+		while ( table[ slot ] != NO_POLYLINE ) {
+			slot = ( slot + 1 ) & mask;
+		}
+		table[ slot ] = i;
+	}
+
+	self->polyline_cache_table_valid = true;
+}
+
+// ----------------------------------------------------------------------
+// Returns index of cached polyline with matching key, or NO_POLYLINE.
+static uint32_t polyline_cache_find( le_path_o* self, size_t contour_index, PolylineKey const& key ) {
+
+	auto const& cached = self->polyline_cache.polylines;
+
+	// Most of the time, a contour will be found where it was when we last
+	// traced the path - only if it isn't, we must look it up.
+	if ( contour_index < cached.size() && cached[ contour_index ].key == key ) {
+		return uint32_t( contour_index );
+	}
+
+	if ( !self->polyline_cache_table_valid ) {
+		polyline_cache_build_table( self );
+	}
+
+	auto const&  table = self->polyline_cache_table;
+	size_t const mask  = table.size() - 1;
+
+	for ( size_t slot = key.contour_hash & mask; table[ slot ] != NO_POLYLINE; slot = ( slot + 1 ) & mask ) {
+		if ( cached[ table[ slot ] ].key == key ) {
+			return table[ slot ];
+		}
+	}
+
+	return NO_POLYLINE;
+}
+
+// ----------------------------------------------------------------------
+// Looks up cached polylines for all contours; fills `cached_polyline_for_contour`.
+// Returns true if all contours have a cached polyline at their own index.
+static bool polyline_cache_find_all( le_path_o* self, PolylineKey::Generator generator, float parameter ) {
+
+	auto& found = self->cached_polyline_for_contour;
+	found.resize( self->contours.size() );
+
+	bool all_in_place = ( self->contours.size() == self->polyline_cache.polylines.size() );
+
+	for ( size_t i = 0; i != self->contours.size(); i++ ) {
+		PolylineKey key{ contour_get_hash( self, self->contours[ i ] ), parameter, generator };
+		found[ i ]   = polyline_cache_find( self, i, key );
+		all_in_place = all_in_place && ( found[ i ] == i );
+	}
+
+	return all_in_place;
+}
+
+// ----------------------------------------------------------------------
+// Empties the path's polyline buffer. If these polylines were traced, or
+// flattened from contours, they replace the polyline cache.
+static void le_path_retire_polylines( le_path_o* self ) {
+
+	auto const& polylines = self->polylines.polylines;
+
+	if ( !polylines.empty() && polylines.front().key.generator != PolylineKey::eNone ) {
+		std::swap( self->polylines, self->polyline_cache );
+		self->polyline_cache_table_valid = false;
+	}
+
+	polyline_buffer_clear( self->polylines );
+}
+
 // Thomas Algorithm, also known as tridiagonal matrix solver algorithm,
 // implemented based on video lecture by Prof. Dr. Edmund Weitz, see:
 // <https://www.youtube.com/watch?v=0oUo1d6PpGU>
@@ -259,15 +725,16 @@ static void le_path_destroy( le_path_o* self ) {
 // ----------------------------------------------------------------------
 
 static void le_path_clear( le_path_o* self ) {
+	self->commands.clear();
 	self->contours.clear();
-	self->polylines.clear();
+	le_path_retire_polylines( self );
 }
 
 // ----------------------------------------------------------------------
 
-static void trace_move_to( Polyline& polyline, glm::vec2 const& p ) {
-	polyline.distances.emplace_back( 0 );
-	polyline.vertices.emplace_back( p );
+static void trace_move_to( PolylineBuffer& buffer, glm::vec2 const& p ) {
+	buffer.distances.emplace_back( 0 );
+	buffer.vertices.emplace_back( p );
 	// NOTE: we dont insert a tangent here, as we need at least two
 	// points to calculate tangents. In an open path, there will be n-1
 	// tangent vectors than vertices, closed paths have same number of
@@ -276,12 +743,12 @@ static void trace_move_to( Polyline& polyline, glm::vec2 const& p ) {
 
 // ----------------------------------------------------------------------
 
-static void trace_line_to( Polyline& polyline, glm::vec2 const& p ) {
+static void trace_line_to( PolylineBuffer& buffer, glm::vec2 const& p ) {
 
 	// We must check if the current point is identical with previous point -
 	// in which case we will not add this point.
 
-	auto const& p0               = polyline.vertices.back();
+	auto const& p0               = buffer.vertices.back();
 	glm::vec2   relativeMovement = p - p0;
 
 	// Instead of using glm::distance directly, we calculate squared distance
@@ -300,24 +767,25 @@ static void trace_line_to( Polyline& polyline, glm::vec2 const& p ) {
 		return;
 	}
 
-	polyline.total_distance += sqrtf( dist2 );
-	polyline.distances.emplace_back( polyline.total_distance );
-	polyline.vertices.emplace_back( p );
-	polyline.tangents.emplace_back( relativeMovement );
+	buffer.total_distance += sqrtf( dist2 );
+	buffer.distances.emplace_back( buffer.total_distance );
+	buffer.vertices.emplace_back( p );
+	buffer.tangents.emplace_back( relativeMovement );
 }
 
 // ----------------------------------------------------------------------
 
-static void trace_close_path( Polyline& polyline ) {
+static void trace_close_path( PolylineBuffer& buffer ) {
 	// eClosePath is the same as a direct line to the very first vertex.
-	trace_line_to( polyline, polyline.vertices.front() );
+	glm::vec2 const p0 = buffer.vertices[ buffer.polylines.back().vertices_offset ];
+	trace_line_to( buffer, p0 );
 }
 
 // ----------------------------------------------------------------------
 
 // Trace a quadratic bezier curve from previous point p0 to target point p2 (p2_x,p2_y),
 // controlled by control point p1 (p1_x, p1_y), in steps iterations.
-static void trace_quad_bezier_to( Polyline&        polyline,
+static void trace_quad_bezier_to( PolylineBuffer&  buffer,
                                   glm::vec2 const& p1,        // end point
                                   glm::vec2 const& c1,        // control point
                                   size_t           resolution // number of segments
@@ -331,19 +799,16 @@ static void trace_quad_bezier_to( Polyline&        polyline,
 	if ( resolution == 1 ) {
 		// If we are to add but one segment, we may draw a
 		// direct line to target point and return.
-		trace_line_to( polyline, p1 );
+		trace_line_to( buffer, p1 );
 		return;
 	}
 
 	// --------| invariant: resolution > 1
 
-	polyline.vertices.reserve( polyline.vertices.size() + resolution );
-	polyline.distances.reserve( polyline.vertices.size() );
-
-	assert( !polyline.vertices.empty() ); // Contour vertices must not be empty.
+	assert( polyline_has_vertices( buffer ) ); // Contour vertices must not be empty.
 
-	glm::vec2 const& p0     = polyline.vertices.back(); // copy start point
-	glm::vec2        p_prev = p0;
+	glm::vec2 const p0     = buffer.vertices.back(); // copy start point
+	glm::vec2       p_prev = p0;
 
 	float delta_t = 1.f / float( resolution );
 
@@ -361,20 +826,20 @@ static void trace_quad_bezier_to( Polyline&        polyline,
 
 		glm::vec2 b = one_minus_t_sq * p0 + 2 * one_minus_t * t * c1 + t_sq * p1;
 
-		polyline.total_distance += glm::distance( b, p_prev );
-		polyline.distances.emplace_back( polyline.total_distance );
+		buffer.total_distance += glm::distance( b, p_prev );
+		buffer.distances.emplace_back( buffer.total_distance );
 		p_prev = b;
-		polyline.vertices.emplace_back( b );
+		buffer.vertices.emplace_back( b );
 
 		// First derivative with respect to t, see: https://en.m.wikipedia.org/wiki/B%C3%A9zier_curve
-		polyline.tangents.emplace_back( quad_bezier_derivative( t, p0, c1, p1 ) );
+		buffer.tangents.emplace_back( quad_bezier_derivative( t, p0, c1, p1 ) );
 	}
 }
 
 // ----------------------------------------------------------------------
 // Trace a cubic bezier curve from previous point p0 to target point p3
 // controlled by control points p1, and p2.
-static void trace_cubic_bezier_to( Polyline&        polyline,
+static void trace_cubic_bezier_to( PolylineBuffer&  buffer,
                                    glm::vec2 const& p1,        // end point
                                    glm::vec2 const& c1,        // control point 1
                                    glm::vec2 const& c2,        // control point 2
@@ -387,17 +852,15 @@ static void trace_cubic_bezier_to( Polyline&        polyline,
 
 	if ( resolution == 1 ) {
 		// If we are to add but one segment, we may directly trace to the target point and return.
-		trace_line_to( polyline, p1 );
+		trace_line_to( buffer, p1 );
 		return;
 	}
 
 	// --------| invariant: resolution > 1
 
-	polyline.vertices.reserve( polyline.vertices.size() + resolution );
-
-	assert( !polyline.vertices.empty() ); // Contour vertices must not be empty.
+	assert( polyline_has_vertices( buffer ) ); // Contour vertices must not be empty.
 
-	glm::vec2 const p0     = polyline.vertices.back(); // copy start point
+	glm::vec2 const p0     = buffer.vertices.back(); // copy start point
 	glm::vec2       p_prev = p0;
 
 	float delta_t = 1.f / float( resolution );
@@ -418,14 +881,14 @@ static void trace_cubic_bezier_to( Polyline&        polyline,
 
 		glm::vec2 b = one_minus_t_cub * p0 + 3 * one_minus_t_sq * t * c1 + 3 * one_minus_t * t_sq * c2 + t_cub * p1;
 
-		polyline.total_distance += glm::distance( b, p_prev );
-		polyline.distances.emplace_back( polyline.total_distance );
+		buffer.total_distance += glm::distance( b, p_prev );
+		buffer.distances.emplace_back( buffer.total_distance );
 		p_prev = b;
 
-		polyline.vertices.emplace_back( b );
+		buffer.vertices.emplace_back( b );
 
 		// First derivative with respect to t, see: https://en.m.wikipedia.org/wiki/B%C3%A9zier_curve
-		polyline.tangents.emplace_back( cubic_bezier_derivative( t, p0, c1, c2, p1 ) );
+		buffer.tangents.emplace_back( cubic_bezier_derivative( t, p0, c1, c2, p1 ) );
 	}
 }
 
@@ -528,7 +991,7 @@ static bool calculate_arc_details(
 }
 // ----------------------------------------------------------------------
 // translates arc into straight polylines - while respecting tolerance.
-static void trace_arc_to( Polyline&        polyline,
+static void trace_arc_to( PolylineBuffer&  buffer,
                           glm::vec2 const& p1, // end point
                           glm::vec2 const& radii,
                           float            phi,
@@ -536,19 +999,19 @@ static void trace_arc_to( Polyline&        polyline,
                           bool             sweep,
                           size_t           iterations ) {
 
-	assert( !polyline.vertices.empty() ); // Contour vertices must not be empty.
+	assert( polyline_has_vertices( buffer ) ); // Contour vertices must not be empty.
 
 	// If any or both of radii.x or radii.y is 0, then we must treat the
 	// arc as a straight line:
 	//
 	if ( fabsf( radii.x * radii.y ) <= std::numeric_limits<float>::epsilon() ) {
-		trace_line_to( polyline, p1 );
+		trace_line_to( buffer, p1 );
 		return;
 	}
 
 	// ---------| Invariant: radii.x and radii.y are not 0.
 
-	glm::vec2 const p0 = polyline.vertices.back(); // copy start point
+	glm::vec2 const p0 = buffer.vertices.back(); // copy start point
 	glm::mat2       inv_basis;
 	glm::vec2       r;
 	glm::vec2       c;
@@ -558,7 +1021,7 @@ static void trace_arc_to( Polyline&        polyline,
 	if ( calculate_arc_details( p0, p1, radii, phi, large_arc, sweep, &inv_basis, &c, &r, &theta, &theta_end ) ) {
 
 		float     theta_delta = theta_end - theta;
-		glm::vec2 prev_pt     = polyline.vertices.back();
+		glm::vec2 prev_pt     = buffer.vertices.back();
 		glm::vec2 n           = glm::vec2{ cosf( theta ), sinf( theta ) };
 
 		float angle_offset = theta_delta / float( iterations );
@@ -572,10 +1035,10 @@ static void trace_arc_to( Polyline&        polyline,
 			glm::vec2 arc_pt = r * n;
 			arc_pt           = inv_basis * arc_pt + c;
 
-			polyline.vertices.push_back( arc_pt );
-			polyline.total_distance += glm::distance( arc_pt, prev_pt );
-			polyline.distances.push_back( polyline.total_distance );
-			polyline.tangents.push_back( inv_basis * ( r * glm::vec2{ -sinf( theta ), cosf( theta ) } ) );
+			buffer.vertices.push_back( arc_pt );
+			buffer.total_distance += glm::distance( arc_pt, prev_pt );
+			buffer.distances.push_back( buffer.total_distance );
+			buffer.tangents.push_back( inv_basis * ( r * glm::vec2{ -sinf( theta ), cosf( theta ) } ) );
 			prev_pt = arc_pt;
 
 			if ( !sweep && theta <= theta_end ) {
@@ -594,34 +1057,53 @@ static void trace_arc_to( Polyline&        polyline,
 // A polyline is a list of vertices which may be thought of being
 // connected by lines.
 //
+// Contours which have not changed since the path was last traced at the
+// same resolution re-use their cached polylines.
+//
 static void le_path_trace_path( le_path_o* self, size_t resolution ) {
 
-	self->polylines.clear();
-	self->polylines.reserve( self->contours.size() );
+	PolylineBuffer& buffer = self->polylines;
+
+	le_path_retire_polylines( self );
+
+	if ( polyline_cache_find_all( self, PolylineKey::eTrace, float( resolution ) ) ) {
+		// Nothing has changed: cached polylines become our polylines.
+		std::swap( self->polylines, self->polyline_cache );
+		self->polyline_cache_table_valid = false;
+		return;
+	}
+
+	for ( size_t i = 0; i != self->contours.size(); i++ ) {
 
-	for ( auto const& s : self->contours ) {
+		Contour const& s      = self->contours[ i ];
+		uint32_t       cached = self->cached_polyline_for_contour[ i ];
+
+		if ( cached != NO_POLYLINE ) {
+			polyline_buffer_append_copy( buffer, self->polyline_cache, self->polyline_cache.polylines[ cached ] );
+			continue;
+		}
 
-		Polyline polyline;
+		polyline_begin( buffer );
 
-		for ( auto const& command : s.commands ) {
+		for ( auto const& command : contour_get_commands( self, s ) ) {
 
 			switch ( command.type ) {
 			case PathCommand::eMoveTo:
-				trace_move_to( polyline, command.p );
+				trace_move_to( buffer, command.p );
 				break;
 			case PathCommand::eLineTo:
-				trace_line_to( polyline, command.p );
+				trace_line_to( buffer, command.p );
 				break;
 			case PathCommand::eQuadBezierTo: {
 				auto& bez = command.data.as_quad_bezier;
-				trace_quad_bezier_to( polyline,
+				trace_quad_bezier_to( buffer,
 				                      command.p,
 				                      bez.c1,
 				                      resolution );
 			} break;
 			case PathCommand::eCubicBezierTo: {
 				auto& bez = command.data.as_cubic_bezier;
-				trace_cubic_bezier_to( polyline,
+				trace_cubic_bezier_to( buffer,
 				                       command.p,
 				                       bez.c1,
 				                       bez.c2,
@@ -629,7 +1111,7 @@ static void le_path_trace_path( le_path_o* self, size_t resolution ) {
 			} break;
 			case PathCommand::eArcTo: {
 				auto& arc = command.data.as_arc;
-				trace_arc_to( polyline,
+				trace_arc_to( buffer,
 				              command.p,
 				              arc.radii,
 				              arc.phi,
@@ -638,7 +1120,7 @@ static void le_path_trace_path( le_path_o* self, size_t resolution ) {
 				              resolution );
 			} break;
 			case PathCommand::eClosePath:
-				trace_close_path( polyline );
+				trace_close_path( buffer );
 				break;
 			case PathCommand::eUnknown:
 				assert( false );
@@ -646,9 +1128,8 @@ static void le_path_trace_path( le_path_o* self, size_t resolution ) {
 			}
 		}
 
-		assert( polyline.vertices.size() == polyline.distances.size() );
-
-		self->polylines.emplace_back( polyline );
+		polyline_end( buffer );
+		buffer.polylines.back().key = { s.hash, float( resolution ), PolylineKey::eTrace };
 	}
 }
 
@@ -697,6 +1178,10 @@ static bool cubic_bezier_calculate_inflection_points( CubicBezier const& b, Infl
 
 	if ( fabsf( divisor ) <= std::numeric_limits<float>::epsilon() ) {
 		// must not be zero, otherwise there are no solutions.
+		// We mark the cusp as outside of the curve, as callers will test for it.
+		infl->t_cusp = -1;
+		infl->t_1    = 0;
+		infl->t_2    = 0;
 		return false;
 	}
 
@@ -731,7 +1216,7 @@ static bool cubic_bezier_calculate_inflection_points( CubicBezier const& b, Infl
 //
 // Tolerance tells us how close to follow original curve
 // when interpolating the curve as a list of straight line segments.
-static void split_cubic_bezier_into_monotonous_sub_segments( CubicBezier& b, std::vector<CurveSegment>& curves, float tolerance ) {
+static void split_cubic_bezier_into_monotonous_sub_segments( CubicBezier& b, CurveSegments& curves, float tolerance ) {
 	// --- calculate inflection points:
 
 	InflectionData infl;
@@ -935,68 +1420,202 @@ static void split_cubic_bezier_into_monotonous_sub_segments( CubicBezier& b, std
 
 // ----------------------------------------------------------------------
 
-static void flatten_cubic_bezier_segment_to( Polyline&          polyline,
-                                             CubicBezier const& b_,
-                                             float              tolerance ) {
+// Loads cubic bezier segment `b` into `lane` of the lane-wide
+// flattener state (p0, c1, c2, p1 - x and y for each).
+static inline void flatten_batch_load_lane( float ( *state )[ SIMD_WIDTH ], uint32_t lane, CubicBezier const& b ) {
+	state[ 0 ][ lane ] = b.p0.x;
+	state[ 1 ][ lane ] = b.p0.y;
+	state[ 2 ][ lane ] = b.c1.x;
+	state[ 3 ][ lane ] = b.c1.y;
+	state[ 4 ][ lane ] = b.c2.x;
+	state[ 5 ][ lane ] = b.c2.y;
+	state[ 6 ][ lane ] = b.p1.x;
+	state[ 7 ][ lane ] = b.p1.y;
+}
 
-	CubicBezier b = b_; // fixme: not necessary.
+// ----------------------------------------------------------------------
+// Flattens all monotonous cubic bezier segments in `batch.cubics`,
+// SIMD_WIDTH segments at a time.
+//
+// Each lane flattens one segment by repeated subdivision, following
+// the same method as a single segment would be flattened: for each
+// step we find the largest parameter `t` at which the segment may be
+// cut while respecting tolerance, and then continue with the remainder.
+//
+// Segments need different numbers of steps. As soon as a lane is done
+// with its segment, we refill it with the next segment, so that lanes
+// don't idle. Each step writes one row of output for all lanes -
+// `batch.ranges` records which rows of which lane belong to which segment.
+//
+static void flatten_cubic_bezier_batch( FlattenBatch& batch, float tolerance ) {
 
-	float t = 0;
+	// Note that we limit the number of steps per segment to a maximum of 1000 -
+	// this should only ever be reached when tolerance is super small.
+	static constexpr uint32_t MAX_STEPS_PER_SEGMENT = 1000;
 
-	glm::vec2 p_prev = b.p0;
+	uint32_t const num_cubics = uint32_t( batch.cubics.size() );
 
-	// Note that we limit the number of iterations by setting a maximum of 1000 - this
-	// should only ever be reached when tolerance is super small.
-	for ( int i = 0; i != 1000; i++ ) {
+	batch.ranges.resize( num_cubics );
 
-		// create a coordinate basis based on the first point, and the first control point
-		glm::vec2 r = glm::normalize( b.c1 - b.p0 );
-		glm::vec2 s = { r.y, -r.x };
+	if ( num_cubics == 0 ) {
+		return;
+	}
 
-		// Define a coordinate basis built on the first two points, b0, and b1
-		glm::mat2 const basis = { r, s };
+	// ----------| invariant: there is at least one segment to flatten
 
-		glm::vec2 P2 = basis * ( b.c2 - b.p0 );
+	float    state[ 8 ][ SIMD_WIDTH ]{}; // p0, c1, c2, p1 for each lane; spilled only when refilling lanes
+	uint32_t lane_cubic[ SIMD_WIDTH ]{};
+	uint32_t lane_row_begin[ SIMD_WIDTH ]{};
+	uint32_t active_lanes = 0;
+	uint32_t next_cubic   = 0;
 
-		float s2 = ( P2 ).y;
+	for ( uint32_t lane = 0; lane != SIMD_WIDTH && next_cubic != num_cubics; lane++ ) {
+		flatten_batch_load_lane( state, lane, batch.cubics[ next_cubic ] );
+		lane_cubic[ lane ] = next_cubic++;
+		active_lanes |= 1u << lane;
+	}
 
-		float t_dash = sqrtf( tolerance / ( 3 * fabsf( s2 ) ) );
-		t            = std::min<float>( 1.f, t_dash );
+	vfloat2 p0 = { vf_load( state[ 0 ] ), vf_load( state[ 1 ] ) };
+	vfloat2 c1 = { vf_load( state[ 2 ] ), vf_load( state[ 3 ] ) };
+	vfloat2 c2 = { vf_load( state[ 4 ] ), vf_load( state[ 5 ] ) };
+	vfloat2 p1 = { vf_load( state[ 6 ] ), vf_load( state[ 7 ] ) };
 
-		// Apply subdivision at (t). This means that the start point of the sub-segment
-		// will be the point we can add to the polyline while respecting flatness.
-		bezier_subdivide( b, t, nullptr, &b );
+	vfloat const one   = vf_set1( 1.f );
+	vfloat const three = vf_set1( 3.f );
+	vfloat const six   = vf_set1( 6.f );
+	vfloat const tol   = vf_set1( tolerance );
+
+	uint32_t oldest_row_begin = 0; // smallest row_begin over all active lanes
+
+	for ( uint32_t row = 0; active_lanes; row++ ) {
+
+		if ( row == batch.rows.size() ) {
+			batch.rows.resize( batch.rows.size() * 2 + 64 );
+		}
+
+		// Create a coordinate basis based on the first point, and the first control point,
+		// and find the distance of the second control point from the first leg.
+		vfloat2 r       = c1 - p0;
+		vfloat  inv_len = one / vf_sqrt( r.x * r.x + r.y * r.y );
+		r               = inv_len * r;
+
+		vfloat2 d  = c2 - p0;
+		vfloat  s2 = r.y * d.x - r.x * d.y;
+
+		// Note that vf_min returns its second argument if the first is NaN,
+		// which happens when c1 == p0. We then go straight to the end point.
+		vfloat t = vf_min( vf_sqrt( tol / ( three * vf_abs( s2 ) ) ), one );
 
-		glm::vec2 pt = b.p0;
+		// Apply subdivision at (t), and keep the second part. The start point of
+		// this sub-segment is the point we can add to the polyline while respecting
+		// flatness.
+		vfloat2 b2_   = c2 + t * ( p1 - c2 );
+		vfloat2 b0_   = p0 + t * ( c1 - p0 );
+		vfloat2 b1_   = c1 + t * ( c2 - c1 );
+		vfloat2 b0__  = b0_ + t * ( b1_ - b0_ );
+		vfloat2 b1__  = b1_ + t * ( b2_ - b1_ );
+		vfloat2 b0___ = b0__ + t * ( b1__ - b0__ );
 
-		polyline.vertices.emplace_back( pt );
-		polyline.total_distance += glm::distance( pt, p_prev );
-		polyline.distances.emplace_back( polyline.total_distance );
+		vfloat2 delta = b0___ - p0;
+
+		p0 = b0___;
+		c1 = b1__;
+		c2 = b2_;
 
 		// First derivative with respect to t, see: https://en.m.wikipedia.org/wiki/B%C3%A9zier_curve
-		polyline.tangents.emplace_back( cubic_bezier_derivative( t, b.p0, b.c1, b.c2, b.p1 ) );
+		vfloat  one_minus_t = one - t;
+		vfloat2 tangent     = ( three * one_minus_t * one_minus_t ) * ( c1 - p0 ) +
+		                  ( six * one_minus_t * t ) * ( c2 - c1 ) +
+		                  ( three * t * t ) * ( p1 - c2 );
+
+		FlattenRow& out = batch.rows[ row ];
+		vf_store( out.p_x, p0.x );
+		vf_store( out.p_y, p0.y );
+		vf_store( out.t_x, tangent.x );
+		vf_store( out.t_y, tangent.y );
+		vf_store( out.dist, vf_sqrt( delta.x * delta.x + delta.y * delta.y ) );
+
+		uint32_t done_lanes = vf_mask_ge( t, one ) & active_lanes;
+
+		if ( row + 1 - oldest_row_begin >= MAX_STEPS_PER_SEGMENT ) {
+			for ( uint32_t lane = 0; lane != SIMD_WIDTH; lane++ ) {
+				if ( row + 1 - lane_row_begin[ lane ] >= MAX_STEPS_PER_SEGMENT ) {
+					done_lanes |= ( 1u << lane ) & active_lanes;
+				}
+			}
+		}
 
-		if ( t >= 1.0f )
-			break;
+		if ( done_lanes == 0 ) {
+			continue;
+		}
+
+		// ----------| invariant: at least one lane has finished its segment
+
+		vf_store( state[ 0 ], p0.x );
+		vf_store( state[ 1 ], p0.y );
+		vf_store( state[ 2 ], c1.x );
+		vf_store( state[ 3 ], c1.y );
+		vf_store( state[ 4 ], c2.x );
+		vf_store( state[ 5 ], c2.y );
+		vf_store( state[ 6 ], p1.x );
+		vf_store( state[ 7 ], p1.y );
+
+		oldest_row_begin = row + 1;
+
+		for ( uint32_t lane = 0; lane != SIMD_WIDTH; lane++ ) {
+
+			if ( done_lanes & ( 1u << lane ) ) {
+
+				batch.ranges[ lane_cubic[ lane ] ] = { lane, lane_row_begin[ lane ], row + 1 };
+
+				if ( next_cubic != num_cubics ) {
+					flatten_batch_load_lane( state, lane, batch.cubics[ next_cubic ] );
+					lane_cubic[ lane ]     = next_cubic++;
+					lane_row_begin[ lane ] = row + 1;
+				} else {
+					active_lanes &= ~( 1u << lane );
+				}
+			}
+
+			if ( active_lanes & ( 1u << lane ) ) {
+				oldest_row_begin = std::min( oldest_row_begin, lane_row_begin[ lane ] );
+			}
+		}
 
-		p_prev = pt;
+		p0 = { vf_load( state[ 0 ] ), vf_load( state[ 1 ] ) };
+		c1 = { vf_load( state[ 2 ] ), vf_load( state[ 3 ] ) };
+		c2 = { vf_load( state[ 4 ] ), vf_load( state[ 5 ] ) };
+		p1 = { vf_load( state[ 6 ] ), vf_load( state[ 7 ] ) };
 	}
 }
 
 // ----------------------------------------------------------------------
-// Flatten a cubic bezier curve from previous point p0 to target point p3
-// controlled by control points p1, and p2.
-static void flatten_cubic_bezier_to( Polyline&        polyline,
-                                     glm::vec2 const& p1,       // end point
-                                     glm::vec2 const& c1,       // control point 1
-                                     glm::vec2 const& c2,       // control point 2
-                                     float            tolerance // max distance for arc segment
-) {
+// Appends the flattened vertices for a cubic bezier segment from
+// the batch to the polyline.
+static void flatten_batch_emit_cubic( PolylineBuffer& buffer, FlattenBatch const& batch, uint32_t cubic_index ) {
 
-	assert( !polyline.vertices.empty() ); // Contour vertices must not be empty.
+	FlattenRange const& range = batch.ranges[ cubic_index ];
 
-	glm::vec2 const p0 = polyline.vertices.back(); // copy start point
+	for ( uint32_t row = range.row_begin; row != range.row_end; row++ ) {
+		FlattenRow const& r = batch.rows[ row ];
+
+		buffer.vertices.emplace_back( r.p_x[ range.lane ], r.p_y[ range.lane ] );
+		buffer.total_distance += r.dist[ range.lane ];
+		buffer.distances.emplace_back( buffer.total_distance );
+		buffer.tangents.emplace_back( r.t_x[ range.lane ], r.t_y[ range.lane ] );
+	}
+}
 
+// ----------------------------------------------------------------------
+// Splits a cubic bezier curve from p0 to p1 into monotonous sub-segments,
+// and adds these to the batch for flattening.
+static void flatten_batch_add_cubic_bezier( FlattenBatch&    batch,
+                                            glm::vec2 const& p0,       // start point
+                                            glm::vec2 const& p1,       // end point
+                                            glm::vec2 const& c1,       // control point 1
+                                            glm::vec2 const& c2,       // control point 2
+                                            float            tolerance // max distance for arc segment
+) {
 	CubicBezier b{
 	    p0,
 	    c1,
@@ -1004,21 +1623,17 @@ static void flatten_cubic_bezier_to( Polyline&        polyline,
 	    p1,
 	};
 
-	std::vector<CurveSegment> segments;
+	CurveSegments segments;
 
 	split_cubic_bezier_into_monotonous_sub_segments( b, segments, tolerance );
 
-	// ---
-	for ( auto& s : segments ) {
-		switch ( s.type ) {
-		case ( CurveSegment::Type::eCubicBezier ):
-			flatten_cubic_bezier_segment_to( polyline, s.asCubicBezier, tolerance );
-			break;
-		case ( CurveSegment::Type::eLine ):
-			trace_line_to( polyline, s.asLine.p1 );
-			break;
+	for ( auto const& s : segments ) {
+		if ( s.type == CurveSegment::Type::eCubicBezier ) {
+			batch.cubics.push_back( s.asCubicBezier );
 		}
 	}
+
+	batch.splits.push_back( segments );
 }
 
 // ----------------------------------------------------------------------
@@ -1133,7 +1748,7 @@ static glm::vec2 get_arc_tangent_at_normalised_t( glm::vec2 const& p0, // end po
 // The ellipses should face in the same direction:
 //
 // This could have something to do with x-axis rotation
-static void flatten_arc_to( Polyline&        polyline,
+static void flatten_arc_to( PolylineBuffer&  buffer,
                             glm::vec2 const& p1, // end point
                             glm::vec2 const& radii,
                             float            phi,
@@ -1141,19 +1756,19 @@ static void flatten_arc_to( Polyline&        polyline,
                             bool             sweep,
                             float            tolerance ) {
 
-	assert( !polyline.vertices.empty() ); // Contour vertices must not be empty.
+	assert( polyline_has_vertices( buffer ) ); // Contour vertices must not be empty.
 
 	// If any or both of radii.x or radii.y is 0, then we must treat the
 	// arc as a straight line:
 	//
 	if ( fabsf( radii.x * radii.y ) <= std::numeric_limits<float>::epsilon() ) {
-		trace_line_to( polyline, p1 );
+		trace_line_to( buffer, p1 );
 		return;
 	}
 
 	// ---------| Invariant: radii.x and radii.y are not 0.
 
-	glm::vec2 const p0 = polyline.vertices.back(); // copy start point
+	glm::vec2 const p0 = buffer.vertices.back(); // copy start point
 
 	glm::mat2 inv_basis;
 	glm::vec2 r;
@@ -1163,7 +1778,7 @@ static void flatten_arc_to( Polyline&        polyline,
 
 	if ( calculate_arc_details( p0, p1, radii, phi, large_arc, sweep, &inv_basis, &c, &r, &theta, &theta_end ) ) {
 
-		glm::vec2 prev_pt = polyline.vertices.back();
+		glm::vec2 prev_pt = buffer.vertices.back();
 		glm::vec2 n       = glm::vec2{ cosf( theta ), sinf( theta ) };
 
 		// We are much more likely to break ealier - but we add a counter as an upper bound
@@ -1187,10 +1802,10 @@ static void flatten_arc_to( Polyline&        polyline,
 			glm::vec2 arc_pt = r * n;
 			arc_pt           = inv_basis * arc_pt + c;
 
-			polyline.vertices.push_back( arc_pt );
-			polyline.total_distance += glm::distance( arc_pt, prev_pt );
-			polyline.distances.push_back( polyline.total_distance );
-			polyline.tangents.push_back( inv_basis * ( r * glm::vec2{ -sinf( theta ), cosf( theta ) } ) );
+			buffer.vertices.push_back( arc_pt );
+			buffer.total_distance += glm::distance( arc_pt, prev_pt );
+			buffer.distances.push_back( buffer.total_distance );
+			buffer.tangents.push_back( inv_basis * ( r * glm::vec2{ -sinf( theta ), cosf( theta ) } ) );
 			prev_pt = arc_pt;
 
 			if ( !sweep && theta <= theta_end ) {
@@ -1205,78 +1820,152 @@ static void flatten_arc_to( Polyline&        polyline,
 
 // ----------------------------------------------------------------------
 
+// Contours which have not changed since the path was last flattened with
+// the same tolerance re-use their cached polylines; only the remaining
+// contours get flattened.
 static void le_path_flatten_path( le_path_o* self, float tolerance ) {
 
-	self->polylines.clear();
-	self->polylines.reserve( self->contours.size() );
+	PolylineBuffer& buffer = self->polylines;
+	FlattenBatch&   batch  = self->flatten_batch;
+
+	le_path_retire_polylines( self );
+
+	if ( polyline_cache_find_all( self, PolylineKey::eFlatten, tolerance ) ) {
+		// Nothing has changed: cached polylines become our polylines.
+		std::swap( self->polylines, self->polyline_cache );
+		self->polyline_cache_table_valid = false;
+		return;
+	}
+
+	auto const& cached_polyline_for_contour = self->cached_polyline_for_contour;
+
+	batch.splits.clear();
+	batch.cubics.clear();
 
-	for ( auto const& s : self->contours ) {
+	// First pass: split all curves into monotonous segments, so that we can
+	// flatten all cubic segments of the path in one batch.
+
+	for ( size_t i = 0; i != self->contours.size(); i++ ) {
+
+		if ( cached_polyline_for_contour[ i ] != NO_POLYLINE ) {
+			continue;
+		}
 
-		Polyline polyline;
+		Contour const& s = self->contours[ i ];
 
-		glm::vec2 prev_point = {};
+		glm::vec2 prev_point    = {};
+		glm::vec2 contour_start = {};
 
-		for ( auto const& command : s.commands ) {
+		for ( auto const& command : contour_get_commands( self, s ) ) {
 
 			switch ( command.type ) {
 			case PathCommand::eMoveTo:
-				trace_move_to( polyline, command.p );
-				prev_point = command.p;
-				break;
-			case PathCommand::eLineTo:
-				trace_line_to( polyline, command.p );
-				prev_point = command.p;
+				contour_start = command.p;
+				prev_point    = command.p;
 				break;
 			case PathCommand::eQuadBezierTo: {
 				auto& bez = command.data.as_quad_bezier;
-				flatten_cubic_bezier_to( polyline,
-				                         command.p,
-				                         prev_point + 2 / 3.f * ( bez.c1 - prev_point ),
-				                         command.p + 2 / 3.f * ( bez.c1 - command.p ),
-				                         tolerance );
+				flatten_batch_add_cubic_bezier( batch,
+				                                prev_point,
+				                                command.p,
+				                                prev_point + 2 / 3.f * ( bez.c1 - prev_point ),
+				                                command.p + 2 / 3.f * ( bez.c1 - command.p ),
+				                                tolerance );
 				prev_point = command.p;
 			} break;
 			case PathCommand::eCubicBezierTo: {
 				auto& bez = command.data.as_cubic_bezier;
-				flatten_cubic_bezier_to( polyline,
-				                         command.p,
-				                         bez.c1,
-				                         bez.c2,
-				                         tolerance );
-				prev_point = command.p;
-			} break;
-			case PathCommand::eArcTo: {
-				auto& arc = command.data.as_arc;
-				flatten_arc_to( polyline, command.p, arc.radii, arc.phi, arc.large_arc, arc.sweep, tolerance );
+				flatten_batch_add_cubic_bezier( batch,
+				                                prev_point,
+				                                command.p,
+				                                bez.c1,
+				                                bez.c2,
+				                                tolerance );
 				prev_point = command.p;
 			} break;
 			case PathCommand::eClosePath:
-				trace_close_path( polyline );
+				prev_point = contour_start;
 				break;
-			case PathCommand::eUnknown:
-				assert( false );
+			default:
+				prev_point = command.p;
 				break;
 			}
 		}
+	}
 
-		assert( polyline.vertices.size() == polyline.distances.size() );
+	flatten_cubic_bezier_batch( batch, tolerance );
 
-		self->polylines.emplace_back( polyline );
-	}
-}
+	// Second pass: assemble polylines, taking flattened cubic segments from the batch.
 
-// ----------------------------------------------------------------------
+	auto     split       = batch.splits.cbegin();
+	uint32_t cubic_index = 0;
 
-static void generate_offset_outline_line_to( std::vector<glm::vec2>& outline, glm::vec2 const& p0, glm::vec2 const& p1, float offset ) {
+	for ( size_t i = 0; i != self->contours.size(); i++ ) {
 
-	if ( p1 == p0 ) {
-		return;
-	}
+		Contour const& s      = self->contours[ i ];
+		uint32_t       cached = cached_polyline_for_contour[ i ];
 
-	glm::vec2 r = glm::normalize( p1 - p0 );
-	glm::vec2 s = { r.y, -r.x };
+		if ( cached != NO_POLYLINE ) {
+			polyline_buffer_append_copy( buffer, self->polyline_cache, self->polyline_cache.polylines[ cached ] );
+			continue;
+		}
 
-	outline.push_back( p0 + offset * s );
+		polyline_begin( buffer );
+
+		for ( auto const& command : contour_get_commands( self, s ) ) {
+
+			switch ( command.type ) {
+			case PathCommand::eMoveTo:
+				trace_move_to( buffer, command.p );
+				break;
+			case PathCommand::eLineTo:
+				trace_line_to( buffer, command.p );
+				break;
+			case PathCommand::eQuadBezierTo: // fall-through, as quad bezier have been converted to cubic bezier
+			case PathCommand::eCubicBezierTo: {
+				assert( polyline_has_vertices( buffer ) ); // Contour vertices must not be empty.
+				for ( auto const& segment : *split ) {
+					switch ( segment.type ) {
+					case ( CurveSegment::Type::eCubicBezier ):
+						flatten_batch_emit_cubic( buffer, batch, cubic_index++ );
+						break;
+					case ( CurveSegment::Type::eLine ):
+						trace_line_to( buffer, segment.asLine.p1 );
+						break;
+					}
+				}
+				split++;
+			} break;
+			case PathCommand::eArcTo: {
+				auto& arc = command.data.as_arc;
+				flatten_arc_to( buffer, command.p, arc.radii, arc.phi, arc.large_arc, arc.sweep, tolerance );
+			} break;
+			case PathCommand::eClosePath:
+				trace_close_path( buffer );
+				break;
+			case PathCommand::eUnknown:
+				assert( false );
+				break;
+			}
+		}
+
+		polyline_end( buffer );
+		buffer.polylines.back().key = { s.hash, tolerance, PolylineKey::eFlatten };
+	}
+}
+
+// ----------------------------------------------------------------------
+
+static void generate_offset_outline_line_to( std::vector<glm::vec2>& outline, glm::vec2 const& p0, glm::vec2 const& p1, float offset ) {
+
+	if ( p1 == p0 ) {
+		return;
+	}
+
+	glm::vec2 r = glm::normalize( p1 - p0 );
+	glm::vec2 s = { r.y, -r.x };
+
+	outline.push_back( p0 + offset * s );
 
 	auto p = p1 + offset * s;
 
@@ -1426,7 +2115,7 @@ static void generate_offset_outline_cubic_bezier_to( std::vector<glm::vec2>& out
 	    p1,
 	};
 
-	std::vector<CurveSegment> curve_segments;
+	CurveSegments curve_segments;
 
 	split_cubic_bezier_into_monotonous_sub_segments( b, curve_segments, tolerance );
 
@@ -1552,33 +2241,17 @@ static void generate_offset_outline_arc_to( std::vector<glm::vec2>& outline_l,
 // paper from 2005:
 // "Fast, Precise Flattening of Cubic Bézier Segment Offset Curves"
 // <https://doi.org/10.1016/j.cag.2005.08.002>
-static bool le_path_generate_offset_outline_for_contour(
-    le_path_o* self, size_t contour_index,
-    float      line_weight,
-    float      tolerance,
-    glm::vec2* outline_l_, size_t* max_count_outline_l,
-    glm::vec2* outline_r_, size_t* max_count_outline_r ) {
-
-	// We allocate space internally to store the results of our outline generation.
-	// We do this because if we were to directly write back to the caller, we would
-	// have to bounds-check against `max_count_outline[l|r]` on every write.
-	//
-	// This way, we do the bounds-check only at the very end, and if the bounds check
-	// fails, we can at least tell the caller how many elements to reserve next time.
-
-	std::vector<glm::vec2> outline_l;
-	std::vector<glm::vec2> outline_r;
-
-	outline_l.reserve( *max_count_outline_l );
-	outline_r.reserve( *max_count_outline_r );
-
-	// Now process the commands for this contour
+// Appends left and right offset outlines for `commands` to `outline_l`, and `outline_r`.
+static void generate_offset_outline( std::span<PathCommand const> commands,
+                                     float                        line_weight,
+                                     float                        tolerance,
+                                     std::vector<glm::vec2>&      outline_l,
+                                     std::vector<glm::vec2>&      outline_r ) {
 
 	glm::vec2 prev_point  = {};
 	float     line_offset = line_weight * 0.5f;
 
-	auto& s = self->contours[ contour_index ];
-	for ( auto const& command : s.commands ) {
+	for ( auto const& command : commands ) {
 
 		switch ( command.type ) {
 		case PathCommand::eMoveTo:
@@ -1633,6 +2306,40 @@ static bool le_path_generate_offset_outline_for_contour(
 			break;
 		}
 	}
+}
+
+// ----------------------------------------------------------------------
+
+static bool le_path_generate_offset_outline_for_contour(
+    le_path_o* self, size_t contour_index,
+    float      line_weight,
+    float      tolerance,
+    glm::vec2* outline_l_, size_t* max_count_outline_l,
+    glm::vec2* outline_r_, size_t* max_count_outline_r ) {
+
+	// We generate outlines into internal storage, so that we only need to
+	// bounds-check against `max_count_outline[l|r]` once, at the very end -
+	// and if the bounds check fails, we can at least tell the caller how many
+	// elements to reserve next time.
+	//
+	// Outlines stay cached with the path, so that when the caller comes back
+	// with enough space, we don't have to generate them again.
+
+	OutlineCache& cache = self->outline_cache;
+
+	uint64_t contour_hash = contour_get_hash( self, self->contours[ contour_index ] );
+
+	if ( cache.contour_hash != contour_hash || cache.line_weight != line_weight || cache.tolerance != tolerance ) {
+		cache.outline_l.clear();
+		cache.outline_r.clear();
+		generate_offset_outline( contour_get_commands( self, self->contours[ contour_index ] ), line_weight, tolerance, cache.outline_l, cache.outline_r );
+		cache.contour_hash = contour_hash;
+		cache.line_weight  = line_weight;
+		cache.tolerance    = tolerance;
+	}
+
+	std::vector<glm::vec2> const& outline_l = cache.outline_l;
+	std::vector<glm::vec2> const& outline_r = cache.outline_r;
 
 	// Copy generated vertices back to caller
 
@@ -1850,11 +2557,11 @@ static void draw_cap_square( std::vector<glm::vec2>& triangles, glm::vec2 const&
 // update cmd_prev, cmd, cmd_next
 // Returns false if no next element.
 // TODO: Skip duplicates
-static bool path_command_iterator( std::vector<PathCommand> const& cmds,
-                                   PathCommand const**             cmd_prev,
-                                   PathCommand const**             cmd,
-                                   PathCommand const**             cmd_next,
-                                   bool*                           wasClosed ) {
+static bool path_command_iterator( std::span<PathCommand const> cmds,
+                                   PathCommand const**          cmd_prev,
+                                   PathCommand const**          cmd,
+                                   PathCommand const**          cmd_next,
+                                   bool*                        wasClosed ) {
 	auto cmds_start = cmds.data();
 	auto cmds_end   = cmds.data() + cmds.size();
 
@@ -1883,12 +2590,10 @@ static bool path_command_iterator( std::vector<PathCommand> const& cmds,
 
 	*cmd_next = ( *cmd ) + 1;
 
-	if ( ( *cmd_next )->type == PathCommand::eClosePath ) {
-		*cmd_next = cmds_start;
-	}
-
 	if ( *cmd_next == cmds_end ) {
 		*cmd_next = nullptr;
+	} else if ( ( *cmd_next )->type == PathCommand::eClosePath ) {
+		*cmd_next = cmds_start;
 	}
 
 	return true;
@@ -1897,7 +2602,7 @@ static bool path_command_iterator( std::vector<PathCommand> const& cmds,
 // ----------------------------------------------------------------------
 // Calculate tangent at path end point
 // Note: does not return anything of value if pathcommand is not endpoint.
-static bool get_path_endpoint_tangents( std::vector<PathCommand> const& commands, glm::vec2& tangent_tail, glm::vec2& tangent_head ) {
+static bool get_path_endpoint_tangents( std::span<PathCommand const> commands, glm::vec2& tangent_tail, glm::vec2& tangent_head ) {
 	auto cmds_start = commands.data();
 	auto cmds_end   = cmds_start + commands.size();
 
@@ -2005,16 +2710,14 @@ void tessellate_outline_l_r( std::vector<glm::vec2>& triangles, std::vector<glm:
 
 // ----------------------------------------------------------------------
 
-bool le_path_tessellate_thick_contour( le_path_o* self, size_t contour_index, le_path_api::stroke_attribute_t const* stroke_attributes, glm::vec2* vertices, size_t* num_vertices ) {
-	std::vector<glm::vec2> triangles;
-
-	triangles.reserve( *num_vertices );
-
-	auto& contour = self->contours[ contour_index ];
+// Appends triangles for a thick stroke along `commands` to `triangles`.
+static void tessellate_thick_contour( std::span<PathCommand const> commands,
+                                      stroke_attribute_t const*    stroke_attributes,
+                                      std::vector<glm::vec2>&      triangles,
+                                      StrokeScratch&               scratch ) {
 
-	if ( contour.commands.empty() ) {
-		*num_vertices = 0;
-		return true;
+	if ( commands.empty() ) {
+		return;
 	}
 
 	// ---------| Invariant: There are commands to render
@@ -2024,12 +2727,15 @@ bool le_path_tessellate_thick_contour( le_path_o* self, size_t contour_index, le
 	PathCommand const* command_next = nullptr;
 	bool               wasClosed    = false;
 
-	std::vector<glm::vec2> vertices_l;
-	std::vector<glm::vec2> vertices_r;
+	std::vector<glm::vec2>& vertices_l = scratch.outline_l;
+	std::vector<glm::vec2>& vertices_r = scratch.outline_r;
+
+	vertices_l.clear();
+	vertices_r.clear();
 
 	glm::vec2 tangent{};
 
-	while ( path_command_iterator( contour.commands, &command_prev, &command, &command_next, &wasClosed ) ) {
+	while ( path_command_iterator( commands, &command_prev, &command, &command_next, &wasClosed ) ) {
 
 		switch ( command->type ) {
 
@@ -2090,9 +2796,9 @@ bool le_path_tessellate_thick_contour( le_path_o* self, size_t contour_index, le
 		}
 		case PathCommand::eClosePath: {
 
-			generate_offset_outline_line_to( vertices_l, vertices_r, command_prev->p, contour.commands.front().p, stroke_attributes->width );
+			generate_offset_outline_line_to( vertices_l, vertices_r, command_prev->p, commands.front().p, stroke_attributes->width );
 
-			tangent = contour.commands.front().p - command_prev->p;
+			tangent = commands.front().p - command_prev->p;
 
 			break;
 		}
@@ -2125,7 +2831,7 @@ bool le_path_tessellate_thick_contour( le_path_o* self, size_t contour_index, le
 			tangent /= tangent_length;
 
 			tessellate_joint( triangles, stroke_attributes, tangent,
-			                  ( command->type == PathCommand::eClosePath ) ? &contour.commands.front()
+			                  ( command->type == PathCommand::eClosePath ) ? &commands.front()
 			                                                               : command,
 			                  command_next );
 		}
@@ -2134,23 +2840,23 @@ bool le_path_tessellate_thick_contour( le_path_o* self, size_t contour_index, le
 
 	// -- Draw caps if path was not closed
 
-	if ( !wasClosed && !contour.commands.empty() &&
+	if ( !wasClosed && !commands.empty() &&
 	     stroke_attributes->line_cap_type != stroke_attribute_t::LineCapType::eLineCapButt ) {
 
-		if ( contour.commands.size() == 1 ) {
+		if ( commands.size() == 1 ) {
 			// path has zero length
 			// draw ending on first point
 		} else {
 
 			// we must find out tangent into the path
 
-			PathCommand* tail = &contour.commands.front();
-			PathCommand* head = &contour.commands.back();
+			PathCommand const* tail = &commands.front();
+			PathCommand const* head = &commands.back();
 
 			glm::vec2 tangent_head{};
 			glm::vec2 tangent_tail{};
 
-			get_path_endpoint_tangents( contour.commands, tangent_tail, tangent_head );
+			get_path_endpoint_tangents( commands, tangent_tail, tangent_head );
 
 			if ( stroke_attributes->line_cap_type == stroke_attribute_t::LineCapType::eLineCapRound ) {
 				draw_cap_round( triangles, head->p, { -tangent_head.y, tangent_head.x }, stroke_attributes );
@@ -2161,8 +2867,44 @@ bool le_path_tessellate_thick_contour( le_path_o* self, size_t contour_index, le
 			}
 		}
 	}
+}
 
-	//
+// ----------------------------------------------------------------------
+
+static inline bool operator==( stroke_attribute_t const& lhs, stroke_attribute_t const& rhs ) {
+	return lhs.tolerance == rhs.tolerance &&
+	       lhs.width == rhs.width &&
+	       lhs.line_join_type == rhs.line_join_type &&
+	       lhs.line_cap_type == rhs.line_cap_type;
+}
+
+// ----------------------------------------------------------------------
+
+bool le_path_tessellate_thick_contour( le_path_o* self, size_t contour_index, le_path_api::stroke_attribute_t const* stroke_attributes, glm::vec2* vertices, size_t* num_vertices ) {
+
+	if ( self->contours[ contour_index ].commands_count == 0 ) {
+		*num_vertices = 0;
+		return true;
+	}
+
+	// ---------| Invariant: There are commands to render
+
+	// Triangles stay cached with the path, so that if the caller first asks
+	// for the number of vertices, and then comes back with enough space, we
+	// don't have to tessellate the contour again.
+
+	StrokeCache& cache = self->stroke_cache;
+
+	uint64_t contour_hash = contour_get_hash( self, self->contours[ contour_index ] );
+
+	if ( cache.contour_hash != contour_hash || cache.stroke_attributes != *stroke_attributes ) {
+		cache.triangles.clear();
+		tessellate_thick_contour( contour_get_commands( self, self->contours[ contour_index ] ), stroke_attributes, cache.triangles, self->stroke_scratch );
+		cache.contour_hash      = contour_hash;
+		cache.stroke_attributes = *stroke_attributes;
+	}
+
+	std::vector<glm::vec2> const& triangles = cache.triangles;
 
 	bool success = true;
 
@@ -2180,13 +2922,153 @@ bool le_path_tessellate_thick_contour( le_path_o* self, size_t contour_index, le
 
 // ----------------------------------------------------------------------
 
+static constexpr size_t MAX_STROKE_SCRATCH = LE_JOBS_MAX_WORKER_THREAD_COUNT + 1; // one per le_jobs worker thread, plus one for the calling thread
+static constexpr size_t STROKE_BATCH_GRAIN = 4;                                   // contours per le_jobs sub-range
+
+struct le_path_stroke_batch_o {
+	std::vector<std::vector<glm::vec2>>            triangles;             // per contour; only grows, so that vectors keep their capacity
+	std::vector<size_t>                            vertex_offsets;        // prefix sums over number of triangle vertices per contour, plus total
+	le_path_api::stroke_contour_t const*           contours    = nullptr; // only valid while tessellating
+	glm::vec2*                                     copy_target = nullptr; // only valid while copying vertices
+	std::array<StrokeScratch*, MAX_STROKE_SCRATCH> scratch{};             // index is le_jobs worker id + 1; created on first use
+};
+
+// ----------------------------------------------------------------------
+
+static le_path_stroke_batch_o* le_path_stroke_batch_create() {
+	auto self = new le_path_stroke_batch_o();
+	self->vertex_offsets.push_back( 0 );
+	return self;
+}
+
+// ----------------------------------------------------------------------
+
+static void le_path_stroke_batch_destroy( le_path_stroke_batch_o* self ) {
+	for ( auto& scratch : self->scratch ) {
+		delete scratch;
+	}
+	delete self;
+}
+
+// ----------------------------------------------------------------------
+
+static void stroke_batch_tessellate_range( uint64_t range_begin, uint64_t range_end, void* user_data ) {
+	auto self = static_cast<le_path_stroke_batch_o*>( user_data );
+
+	// Each worker thread has its own scratch space, as we never yield while tessellating.
+	size_t scratch_index = size_t( le_jobs::get_current_worker_id() + 1 );
+
+	assert( scratch_index < MAX_STROKE_SCRATCH );
+
+	StrokeScratch*& scratch = self->scratch[ scratch_index ];
+
+	if ( nullptr == scratch ) {
+		scratch = new StrokeScratch{};
+	}
+
+	for ( uint64_t i = range_begin; i != range_end; i++ ) {
+		auto const& c    = self->contours[ i ];
+		auto&       tris = self->triangles[ i ];
+
+		assert( c.contour_index < c.path->contours.size() );
+
+		tris.clear();
+		tessellate_thick_contour( contour_get_commands( c.path, c.path->contours[ c.contour_index ] ), c.stroke_attributes, tris, *scratch );
+	}
+}
+
+// ----------------------------------------------------------------------
+
+static void le_path_stroke_batch_tessellate( le_path_stroke_batch_o* self, le_path_api::stroke_contour_t const* contours, size_t num_contours ) {
+
+	if ( self->triangles.size() < num_contours ) {
+		self->triangles.resize( num_contours );
+	}
+
+	self->contours = contours;
+
+	if ( num_contours > 1 && le_jobs::is_initialized() ) {
+		le_jobs::parallel_for( 0, num_contours, STROKE_BATCH_GRAIN, stroke_batch_tessellate_range, self );
+	} else {
+		// Without le_jobs - or for a single contour, which is not worth the
+		// trip to the job system - we tessellate on the calling thread.
+		stroke_batch_tessellate_range( 0, num_contours, self );
+	}
+
+	self->contours = nullptr;
+
+	// Each contour's vertices go at the sum of vertex counts of all
+	// contours which come before it.
+
+	self->vertex_offsets.resize( num_contours + 1 );
+
+	size_t offset = 0;
+
+	for ( size_t i = 0; i != num_contours; i++ ) {
+		self->vertex_offsets[ i ] = offset;
+		offset += self->triangles[ i ].size();
+	}
+
+	self->vertex_offsets[ num_contours ] = offset;
+}
+
+// ----------------------------------------------------------------------
+
+static size_t le_path_stroke_batch_get_num_vertices( le_path_stroke_batch_o* self ) {
+	return self->vertex_offsets.back();
+}
+
+// ----------------------------------------------------------------------
+
+static void stroke_batch_copy_range( uint64_t range_begin, uint64_t range_end, void* user_data ) {
+	auto self = static_cast<le_path_stroke_batch_o*>( user_data );
+
+	for ( uint64_t i = range_begin; i != range_end; i++ ) {
+		memcpy( self->copy_target + self->vertex_offsets[ i ], self->triangles[ i ].data(), sizeof( glm::vec2 ) * self->triangles[ i ].size() );
+	}
+}
+
+// ----------------------------------------------------------------------
+
+static bool le_path_stroke_batch_get_vertices( le_path_stroke_batch_o* self, glm::vec2* vertices, size_t* num_vertices, uint32_t* vertex_offsets ) {
+
+	size_t const num_contours = self->vertex_offsets.size() - 1;
+	size_t const total        = self->vertex_offsets.back();
+
+	if ( vertex_offsets ) {
+		assert( total <= std::numeric_limits<uint32_t>::max() && "too many vertices for 32 bit vertex offsets" );
+		for ( size_t i = 0; i != self->vertex_offsets.size(); i++ ) {
+			vertex_offsets[ i ] = uint32_t( self->vertex_offsets[ i ] );
+		}
+	}
+
+	bool success = false;
+
+	if ( vertices && total <= *num_vertices ) {
+		self->copy_target = vertices;
+		if ( num_contours > 1 && le_jobs::is_initialized() ) {
+			le_jobs::parallel_for( 0, num_contours, 64, stroke_batch_copy_range, self );
+		} else {
+			stroke_batch_copy_range( 0, num_contours, self );
+		}
+		self->copy_target = nullptr;
+		success           = true;
+	}
+
+	*num_vertices = total;
+
+	return success;
+}
+
+// ----------------------------------------------------------------------
+
 static void le_path_iterate_vertices_for_contour( le_path_o* self, size_t const& contour_index, le_path_api::contour_vertex_cb callback, void* user_data ) {
 
 	assert( self->contours.size() > contour_index );
 
-	auto const& s = self->contours[ contour_index ];
+	auto commands = contour_get_commands( self, self->contours[ contour_index ] );
 
-	for ( auto const& command : s.commands ) {
+	for ( auto const& command : commands ) {
 
 		switch ( command.type ) {
 		case PathCommand::eMoveTo:        // fall-through, as we're allways just issueing the vertex, ignoring control points
@@ -2197,7 +3079,7 @@ static void le_path_iterate_vertices_for_contour( le_path_o* self, size_t const&
 			callback( user_data, command.p );
 			break;
 		case PathCommand::eClosePath:
-			callback( user_data, s.commands[ 0 ].p ); // re-issue first vertex
+			callback( user_data, commands[ 0 ].p ); // re-issue first vertex
 			break;
 		case PathCommand::eUnknown:
 			assert( false );
@@ -2212,11 +3094,11 @@ static void le_path_iterate_quad_beziers_for_contour( le_path_o* self, size_t co
 
 	assert( self->contours.size() > contour_index );
 
-	auto const& s = self->contours[ contour_index ];
+	auto commands = contour_get_commands( self, self->contours[ contour_index ] );
 
 	glm::vec2 p0 = {};
 
-	for ( auto const& command : s.commands ) {
+	for ( auto const& command : commands ) {
 
 		switch ( command.type ) {
 		case PathCommand::eMoveTo:
@@ -2247,7 +3129,10 @@ static void le_path_iterate_quad_beziers_for_contour( le_path_o* self, size_t co
 // ----------------------------------------------------------------------
 // Updates `result` to the vertex position on polyline
 // at normalized position `t`
-static void le_polyline_get_at( Polyline const& polyline, float t, glm::vec2* result ) {
+static void le_polyline_get_at( PolylineBuffer const& buffer, Polyline const& polyline, float t, glm::vec2* result ) {
+
+	glm::vec2 const* vertices  = buffer.vertices.data() + polyline.vertices_offset;
+	float const*     distances = buffer.distances.data() + polyline.vertices_offset;
 
 	// -- Calculate unnormalised distance
 	float d = t * float( polyline.total_distance );
@@ -2255,12 +3140,12 @@ static void le_polyline_get_at( Polyline const& polyline, float t, glm::vec2* re
 	// find the first element in polyline which has a position larger than pos
 
 	size_t       a = 0, b = 1;
-	size_t const n = polyline.distances.size();
+	size_t const n = polyline.vertices_count;
 
 	assert( n >= 2 ); // we must have at least two elements for this to work.
 
 	for ( ; b < n - 1; ++a, ++b ) {
-		if ( polyline.distances[ b ] > d ) {
+		if ( distances[ b ] > d ) {
 			// find the second distance which is larger than our test distance
 			break;
 		}
@@ -2268,13 +3153,13 @@ static void le_polyline_get_at( Polyline const& polyline, float t, glm::vec2* re
 
 	assert( b < n ); // b must not overshoot.
 
-	float dist_start = polyline.distances[ a ];
-	float dist_end   = polyline.distances[ b ];
+	float dist_start = distances[ a ];
+	float dist_end   = distances[ b ];
 
 	float scalar = map( d, dist_start, dist_end, 0.f, 1.f );
 
-	glm::vec2 const& start_vertex = polyline.vertices[ a ];
-	glm::vec2 const& end_vertex   = polyline.vertices[ b ];
+	glm::vec2 const& start_vertex = vertices[ a ];
+	glm::vec2 const& end_vertex   = vertices[ b ];
 
 	*result = start_vertex + scalar * ( end_vertex - start_vertex );
 }
@@ -2282,14 +3167,14 @@ static void le_polyline_get_at( Polyline const& polyline, float t, glm::vec2* re
 // ----------------------------------------------------------------------
 // return calculated position on polyline
 static void le_path_get_polyline_at_pos_interpolated( le_path_o* self, size_t const& polyline_index, float t, glm::vec2* result ) {
-	assert( polyline_index < self->polylines.size() );
-	le_polyline_get_at( self->polylines[ polyline_index ], t, result );
+	assert( polyline_index < self->polylines.polylines.size() );
+	le_polyline_get_at( self->polylines, self->polylines.polylines[ polyline_index ], t, result );
 }
 
 // ----------------------------------------------------------------------
 
-static void le_polyline_resample( Polyline& polyline, float interval ) {
-	Polyline poly_resampled;
+// Resamples `polyline` from buffer `src` into a new polyline in buffer `dst`.
+static void le_polyline_resample( PolylineBuffer& dst, PolylineBuffer const& src, Polyline const& polyline, float interval ) {
 
 	// -- How many times can we fit interval into length of polyline?
 
@@ -2300,32 +3185,30 @@ static void le_polyline_resample( Polyline& polyline, float interval ) {
 	float delta = 1.f / float( n_segments );
 
 	if ( n_segments == 1 ) {
-		// we cannot resample polylines which have only one segment.
+		// we cannot resample polylines which have only one segment - we copy it as it is.
+		polyline_buffer_append_copy( dst, src, polyline );
+		dst.polylines.back().key = {}; // resampled polylines may not be re-used as traced polylines
 		return;
 	}
 
-	// reserve n vertices
-
-	poly_resampled.vertices.reserve( n_segments + 1 );
-	poly_resampled.distances.reserve( n_segments + 1 );
-	poly_resampled.tangents.reserve( n_segments + 1 );
+	polyline_begin( dst );
 
 	// Find first point
 	glm::vec2 vertex;
-	le_polyline_get_at( polyline, 0.f, &vertex );
-	trace_move_to( poly_resampled, vertex );
+	le_polyline_get_at( src, polyline, 0.f, &vertex );
+	trace_move_to( dst, vertex );
 
 	// Note that we must add an extra vertex at the end so that we
 	// capture the correct number of segments.
 	for ( size_t i = 1; i <= n_segments; ++i ) {
-		le_polyline_get_at( polyline, i * delta, &vertex );
+		le_polyline_get_at( src, polyline, i * delta, &vertex );
 		// We use trace_line_to, because this will get us more accurate distance
 		// calculations - trace_line_to updates the distances as a side-effect,
 		// effectively redrawing the polyline as if it was a series of `line_to`s.
-		trace_line_to( poly_resampled, vertex );
+		trace_line_to( dst, vertex );
 	}
 
-	std::swap( polyline, poly_resampled );
+	polyline_end( dst );
 }
 
 // ----------------------------------------------------------------------
@@ -2339,25 +3222,32 @@ static void le_path_resample( le_path_o* self, float interval ) {
 
 	// --------| invariant: subpaths exist
 
-	if ( self->polylines.empty() ) {
+	if ( self->polylines.polylines.empty() ) {
 		le_path_trace_path( self, 100 ); // We must trace path - we will do it at a fairy high resolution.
 	}
 
-	// Resample each polyline, turn by turn
+	// Resample each polyline, turn by turn, into our scratch buffer,
+	// which then becomes the path's polyline buffer.
+
+	polyline_buffer_clear( self->resample_scratch );
 
-	for ( auto& p : self->polylines ) {
-		le_polyline_resample( p, interval );
+	for ( auto const& p : self->polylines.polylines ) {
+		le_polyline_resample( self->resample_scratch, self->polylines, p, interval );
 		// -- Enforce invariant that says for closed paths:
 		// First and last vertex must be identical.
 	}
+
+	// Traced polylines go to the polyline cache; resampled polylines replace them.
+	le_path_retire_polylines( self );
+	std::swap( self->polylines, self->resample_scratch );
 }
 
 // ----------------------------------------------------------------------
 
 static void le_path_move_to( le_path_o* self, glm::vec2 const* p ) {
 	// move_to means a new subpath, unless the last command was a
-	self->contours.emplace_back(); // add empty subpath
-	self->contours.back().commands.emplace_back( PathCommand::eMoveTo, *p );
+	self->contours.push_back( { uint32_t( self->commands.size() ), 0, 0 } ); // add empty subpath
+	contour_add_command( self, PathCommand::eMoveTo, *p );
 }
 
 // ----------------------------------------------------------------------
@@ -2367,8 +3257,7 @@ static void le_path_line_to( le_path_o* self, glm::vec2 const* p ) {
 		constexpr static auto v0 = glm::vec2{};
 		le_path_move_to( self, &v0 );
 	}
-	assert( !self->contours.empty() ); // subpath must exist
-	self->contours.back().commands.emplace_back( PathCommand::eLineTo, *p );
+	contour_add_command( self, PathCommand::eLineTo, *p );
 }
 
 // ----------------------------------------------------------------------
@@ -2377,11 +3266,11 @@ static void le_path_line_to( le_path_o* self, glm::vec2 const* p ) {
 // from the command stream.
 static glm::vec2 const* le_path_get_previous_p( le_path_o* self ) {
 	assert( !self->contours.empty() );                 // Subpath must exist
-	assert( !self->contours.back().commands.empty() ); // previous command must exist
+	assert( self->contours.back().commands_count != 0 ); // previous command must exist
 
 	glm::vec2 const* p = nullptr;
 
-	auto const& c = self->contours.back().commands.back(); // fetch last command
+	auto const& c = self->commands.back(); // fetch last command
 
 	switch ( c.type ) {
 	case PathCommand::eMoveTo:        // fall-through
@@ -2405,65 +3294,33 @@ static glm::vec2 const* le_path_get_previous_p( le_path_o* self ) {
 
 // ----------------------------------------------------------------------
 
-static void le_path_line_horiz_to( le_path_o* self, float px ) {
-	assert( !self->contours.empty() );                 // Subpath must exist
-	assert( !self->contours.back().commands.empty() ); // previous command must exist
-
-	auto p = le_path_get_previous_p( self );
-
-	if ( p ) {
-		glm::vec2 p2 = *p;
-		p2.x         = px;
-		le_path_line_to( self, &p2 );
-	}
-}
-
-// ----------------------------------------------------------------------
-
-static void le_path_line_vert_to( le_path_o* self, float py ) {
-	assert( !self->contours.empty() );                 // Subpath must exist
-	assert( !self->contours.back().commands.empty() ); // previous command must exist
-
-	auto p = le_path_get_previous_p( self );
-
-	if ( p ) {
-		glm::vec2 p2 = *p;
-		p2.y         = py;
-		le_path_line_to( self, &p2 );
-	}
-}
-
-// ----------------------------------------------------------------------
-
 static void le_path_quad_bezier_to( le_path_o* self, glm::vec2 const* p, glm::vec2 const* c1 ) {
-	assert( !self->contours.empty() ); // contour must exist
-	self->contours.back().commands.emplace_back( *p, PathCommand::Data::AsQuadBezier{ *c1 } );
+	contour_add_command( self, *p, PathCommand::Data::AsQuadBezier{ *c1 } );
 }
 
 // ----------------------------------------------------------------------
 
 static void le_path_cubic_bezier_to( le_path_o* self, glm::vec2 const* p, glm::vec2 const* c1, glm::vec2 const* c2 ) {
-	assert( !self->contours.empty() ); // subpath must exist
-	self->contours.back().commands.emplace_back( *p, PathCommand::Data::AsCubicBezier{ *c1, *c2 } );
+	contour_add_command( self, *p, PathCommand::Data::AsCubicBezier{ *c1, *c2 } );
 }
 
 // ----------------------------------------------------------------------
 
 static void le_path_arc_to( le_path_o* self, glm::vec2 const* p, glm::vec2 const* radii, float phi, bool large_arc, bool sweep ) {
-	assert( !self->contours.empty() ); // subpath must exist
-	self->contours.back().commands.emplace_back( *p, PathCommand::Data::AsArc{ *radii, phi, large_arc, sweep } );
+	contour_add_command( self, *p, PathCommand::Data::AsArc{ *radii, phi, large_arc, sweep } );
 }
 
 // ----------------------------------------------------------------------
 
 static void le_path_close_path( le_path_o* self ) {
 	glm::vec2 first_point = {};
-	if ( !self->contours.back().commands.empty() ) {
-		if ( self->contours.back().commands.front().type == PathCommand::eMoveTo ) {
-			first_point = self->contours.back().commands.front().p;
+	auto      commands    = contour_get_commands( self, self->contours.back() );
+	if ( !commands.empty() ) {
+		if ( commands.front().type == PathCommand::eMoveTo ) {
+			first_point = commands.front().p;
 		}
 	}
-	self->contours.back().commands.emplace_back( PathCommand::eClosePath, first_point );
+	contour_add_command( self, PathCommand::eClosePath, first_point );
 }
 
 // ----------------------------------------------------------------------
@@ -2484,7 +3341,7 @@ static inline float rho( float a, float b ) {
 // Apply hobby algorithm for a closed path onto path commands.
 // This effectively changes all commands to type cubic bezier, and
 // will set their control points to optimise for best curvature.
-static void path_commands_apply_hobby_closed( std::vector<PathCommand>& commands ) {
+static void path_commands_apply_hobby_closed( std::span<PathCommand> commands ) {
 	// note that last command will be the close command - all other commands are legit.
 
 	// We expect a list of path commands with the following pattern:
@@ -2568,7 +3425,7 @@ static void path_commands_apply_hobby_closed( std::vector<PathCommand>& commands
 // Apply hobby algorithm for a closed path onto path commands.
 // This effectively changes all commands to type cubic bezier, and
 // will set their control points to optimise for best curvature.
-static void path_commands_apply_hobby_open( std::vector<PathCommand>& commands ) {
+static void path_commands_apply_hobby_open( std::span<PathCommand> commands ) {
 	// note that last command will be the close command - all other commands are legit.
 
 	// We expect a list of path commands with the following pattern:
@@ -2672,13 +3529,15 @@ static void le_path_apply_hobby_on_last_contour( le_path_o* self ) {
 
 	// ----------| invariant: there is a last contour
 
-	auto& commands = self->contours.back().commands;
+	auto commands = contour_get_commands( self, self->contours.back() );
 
 	if ( commands.back().type == PathCommand::Type::eClosePath ) {
 		path_commands_apply_hobby_closed( commands );
 	} else {
 		path_commands_apply_hobby_open( commands );
 	}
+
+	self->contours.back().hash = 0; // mark contour as changed
 }
 
 // ----------------------------------------------------------------------
@@ -2706,7 +3565,7 @@ static void le_path_ellipse( le_path_o* self, glm::vec2 const* centre, float r_x
 // ----------------------------------------------------------------------
 
 static size_t le_path_get_num_polylines( le_path_o* self ) {
-	return self->polylines.size();
+	return self->polylines.polylines.size();
 }
 
 static size_t le_path_get_num_contours( le_path_o* self ) {
@@ -2717,17 +3576,17 @@ static size_t le_path_get_num_contours( le_path_o* self ) {
 
 static bool le_path_get_vertices_for_polyline( le_path_o* self, size_t const& polyline_index, glm::vec2* vertices, size_t* numVertices ) {
 	bool success = false;
-	assert( polyline_index < self->polylines.size() );
+	assert( polyline_index < self->polylines.polylines.size() );
 
-	auto const& polyline = self->polylines[ polyline_index ];
+	auto const& polyline = self->polylines.polylines[ polyline_index ];
 
-	if ( polyline.vertices.size() <= *numVertices ) {
-		memcpy( vertices, polyline.vertices.data(),
-		        sizeof( decltype( polyline.vertices )::value_type ) * polyline.vertices.size() );
+	if ( polyline.vertices_count <= *numVertices ) {
+		memcpy( vertices, self->polylines.vertices.data() + polyline.vertices_offset,
+		        sizeof( glm::vec2 ) * polyline.vertices_count );
 		success = true;
 	}
 
-	*numVertices = polyline.vertices.size();
+	*numVertices = polyline.vertices_count;
 	return success;
 }
 
@@ -2735,573 +3594,506 @@ static bool le_path_get_vertices_for_polyline( le_path_o* self, size_t const& po
 
 static bool le_path_get_tangents_for_polyline( le_path_o* self, size_t const& polyline_index, glm::vec2* tangents, size_t* numTangents ) {
 	bool success = false;
-	assert( polyline_index < self->polylines.size() );
+	assert( polyline_index < self->polylines.polylines.size() );
 
-	auto const& polyline = self->polylines[ polyline_index ];
-	if ( polyline.tangents.size() <= *numTangents ) {
-		memcpy( tangents, polyline.tangents.data(),
-		        sizeof( decltype( polyline.tangents )::value_type ) * polyline.tangents.size() );
+	auto const& polyline = self->polylines.polylines[ polyline_index ];
+	if ( polyline.tangents_count <= *numTangents ) {
+		memcpy( tangents, self->polylines.tangents.data() + polyline.tangents_offset,
+		        sizeof( glm::vec2 ) * polyline.tangents_count );
 		success = true;
 	}
 
-	*numTangents = polyline.tangents.size();
+	*numTangents = polyline.tangents_count;
 	return success;
 }
 
+// ----------------------------------------------------------------------
+// SVG path data parser
+//
+// Follows the grammar for SVG path data, as defined here:
+// <https://svgwg.org/svg2-draft/paths.html#PathDataBNF>
+//
+// The parser reads from a range of characters which does not need to be
+// null-terminated, so that it may read directly from a memory-mapped file.
+// It does not allocate, other than for adding commands to the path.
 // ----------------------------------------------------------------------
 
-// Accumulates `*offset_local` into `*offset_total`.
-// Always returns true.
-static inline bool add_offsets( int offset_local, int* offset_total ) {
-	( *offset_total ) += offset_local;
-	return true;
-}
-
-// Accumulates coordinates
-// always returns true
-static inline bool set_coordinate_pair( glm::vec2* p, glm::vec2 const value ) {
-	( *p ) = value;
-	return true;
-}
+struct SvgPathParser {
+	char const* c;   // current character
+	char const* end; // one past the last character
+};
 
-// Accumulates coordinates
-// always returns true
-static inline bool update_coordinate( glm::vec2* p, glm::vec2 const offset ) {
-	( *p ) += offset;
-	// logger.info( "p: %4.2f,%4.2f", p->x, p->y );
-	return true;
-}
+// ----------------------------------------------------------------------
 
-// Accumulates float values
-// always returns true
-static bool accum_float( float* p, float const offset ) {
-	( *p ) += offset;
-	return true;
+static inline bool svg_is_whitespace( char const ch ) {
+	return ch == 0x20 || ch == 0x9 || ch == 0xA || ch == 0xC || ch == 0xD;
 }
 
-// Returns true if string c may be interpreted as
-// a number,
-// If true,
-// + increases *offset by the count of characters forming the number.
-// + sets *f to value of parsed number.
-//
-static bool is_float_number( char const* c, int* offset, float* f ) {
-	if ( *c == 0 )
-		return false;
-
-	char* num_end;
-
-	float tmp_float = strtof( c, &num_end ); // num_end will point to one after last number character
-	*offset += ( num_end - c );              // add number of number characters to offset
+// ----------------------------------------------------------------------
 
-	if ( num_end != c ) {
-		*f = tmp_float;
-		return true;
-	} // if at least one number character was extracted, we were successful
-	return false;
+static inline bool svg_is_digit( char const ch ) {
+	return ch >= '0' && ch <= '9';
 }
 
-// Returns true if needle matches c.
-// Increases *offset by 1 if true.
-static bool is_character_match( char const needle, char const* c, int* offset ) {
-	if ( *c == 0 ) {
-		return false;
-	}
-	// ---------| invarant: c is not end of string
+// ----------------------------------------------------------------------
 
-	if ( *c == needle ) {
-		++( *offset );
-		// logger.info( "Match character '%c'", *c );
-		return true;
-	} else {
-		return false;
+static inline void svg_skip_whitespace( SvgPathParser& p ) {
+	while ( p.c != p.end && svg_is_whitespace( *p.c ) ) {
+		p.c++;
 	}
 }
 
-// Returns true if character is either 0, or 1.
-// Sets *value to `true` if character is 1,
-// Sets *value to `false` if character is 0.
-// Increases *offset by 1 if returns true
-static bool is_boolean_zero_or_one( char const* c, int* offset, bool* value ) {
-	if ( *c == 0 ) {
-		return false;
-	}
-	// ---------| invarant: c is not end of string
-
-	if ( is_character_match( '0', c, offset ) ) {
-		*value = false;
-		return true;
-	}
-	if ( is_character_match( '1', c, offset ) ) {
-		*value = true;
-		return true;
+// ----------------------------------------------------------------------
+// Skips whitespace, optionally followed by one comma and more whitespace.
+static inline void svg_skip_comma_whitespace( SvgPathParser& p ) {
+	svg_skip_whitespace( p );
+	if ( p.c != p.end && *p.c == ',' ) {
+		p.c++;
+		svg_skip_whitespace( p );
 	}
-
-	// ----------| invariant: nothing found.
-
-	*value = false;
-	return false;
 }
 
-// Returns true if what c points to may be interpreted as
-// whitespace, and sets offset to the count of whitespace
-// characters.
-static bool is_whitespace( char const* c, int* offset ) {
-	if ( *c == 0 ) {
+// ----------------------------------------------------------------------
+// Returns true if the next character may start a number.
+static inline bool svg_is_number_start( SvgPathParser const& p ) {
+	if ( p.c == p.end ) {
 		return false;
 	}
-	// ---------| invarant: c is not end of string
+	char ch = *p.c;
+	return svg_is_digit( ch ) || ch == '.' || ch == '-' || ch == '+';
+}
+
+// ----------------------------------------------------------------------
+// Parses a number, and advances the parser past it. Numbers don't need
+// to be separated where this is unambiguous: "1.5.5" is two numbers, 1.5,
+// and .5, and "1-2" is two numbers, 1, and -2.
+static bool svg_parse_number( SvgPathParser& p, float* f ) {
 
-	bool found_whitespace = false;
+	char const* c = p.c;
 
-	// while c is one of possible whitespace characters
-	while ( *c == 0x20 || *c == 0x9 || *c == 0xD || *c == 0xA ) {
-		c++;
-		++( *offset );
-		found_whitespace = true;
+	if ( c != p.end && *c == '+' ) {
+		c++; // std::from_chars does not accept a leading '+'
 	}
 
-	return found_whitespace;
-}
+	// We check that there is a digit, so that std::from_chars won't accept
+	// "inf", or "nan" - these are not valid in SVG.
+
+	char const* digits = ( c != p.end && *c == '-' && c == p.c ) ? c + 1 : c;
 
-// returns true if there is a character coming,
-// increases offset if the character is whitespace
-static bool is_optional_whitespace( char const* c, int* offset ) {
-	if ( *c == 0 ) {
+	if ( digits == p.end || !( svg_is_digit( *digits ) || ( *digits == '.' && digits + 1 != p.end && svg_is_digit( digits[ 1 ] ) ) ) ) {
 		return false;
 	}
-	is_whitespace( c, offset );
-	return true;
-}
 
-static bool is_comma_or_whitespace( char const* c, int* local_offset ) {
-	return is_character_match( ',', c, local_offset ) ||
-	       is_whitespace( c, local_offset );
-}
+	// Fast path for the most common case: a short decimal number without
+	// exponent. If all digits fit into the 24 bit mantissa of a float, and
+	// the divisor is an exact power of ten, float division rounds correctly,
+	// and we get the same result as std::from_chars would give us.
 
-constexpr uint32_t PATH_PARSER_STATE_FLAG_IS_REPEATED = 0x1 << 0;
-constexpr uint32_t PATH_PARSER_STATE_FLAG_IS_ABSOLUTE = 0x1 << 1;
+	static constexpr float pow_10[] = { 1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f };
 
-static bool is_repeat_or_command_char( char const needle, char const* c, int* local_offset, uint32_t* state_flags ) {
-	bool is_absolute = false;
-	bool is_repeated = *state_flags & PATH_PARSER_STATE_FLAG_IS_REPEATED;
+	uint32_t    mantissa   = 0;
+	uint32_t    num_digits = 0;
+	uint32_t    num_frac   = 0;
+	char const* d          = digits;
 
-	// Set flag for is_repeated no matter what so that subsequent queries get it
-	*state_flags |= PATH_PARSER_STATE_FLAG_IS_REPEATED;
+	for ( ; d != p.end && svg_is_digit( *d ); d++, num_digits++ ) {
+		mantissa = mantissa * 10 + uint32_t( *d - '0' );
+	}
+	if ( d != p.end && *d == '.' ) {
+		for ( d++; d != p.end && svg_is_digit( *d ); d++, num_digits++, num_frac++ ) {
+			mantissa = mantissa * 10 + uint32_t( *d - '0' );
+		}
+	}
 
-	if ( is_repeated ) {
+	if ( num_digits <= 7 && ( d == p.end || ( *d != 'e' && *d != 'E' ) ) ) {
+		float value = float( mantissa ) / pow_10[ num_frac ];
+		*f          = ( digits != c ) ? -value : value;
+		p.c         = d;
 		return true;
-	} else {
-		// Find if this is an absolute instruction
-		is_absolute = is_character_match( toupper( needle ), c, local_offset );
-		if ( is_absolute ) {
-			*state_flags |= PATH_PARSER_STATE_FLAG_IS_ABSOLUTE;
-			return true;
-		}
 	}
 
-	return is_character_match( needle, c, local_offset );
-}
+	// ----------| invariant: number is too long for the fast path, or has an exponent
 
-// Returns true if c points to a coordinate pair.
-// In case this method returns true,
-// + `*offset` will hold the count of characters from `c` spent on the instruction.
-// + `*coord` will hold the vertex defined by the coordinate pair
-static bool is_coordinate_pair( char const* c, int* offset, glm::vec2* v ) {
-	if ( *c == 0 ) {
+	auto result = std::from_chars( c, p.end, *f );
+
+	if ( result.ec != std::errc() ) {
 		return false;
 	}
-	// ---------| invarant: c is not end of string
 
-	int       local_offset = 0;
-	glm::vec2 tmp_p        = {};
+	p.c = result.ptr;
+	return true;
+}
 
-	return is_float_number( c, &local_offset, &tmp_p.x ) &&                // note how offset is re-used
-	       is_comma_or_whitespace( c + local_offset, &local_offset ) &&    // in subsequent tests, so that
-	       is_float_number( c + local_offset, &local_offset, &tmp_p.y ) && // each test begins at the previous offset
-	       set_coordinate_pair( v, tmp_p ) &&                              // only apply coordinate update if parsing was successful
-	       add_offsets( local_offset, offset );
+// ----------------------------------------------------------------------
+// Parses `count` numbers, separated by optional commas and whitespace.
+static bool svg_parse_numbers( SvgPathParser& p, float* f, size_t count ) {
+	for ( size_t i = 0; i != count; i++ ) {
+		if ( i != 0 ) {
+			svg_skip_comma_whitespace( p );
+		}
+		if ( !svg_parse_number( p, f + i ) ) {
+			return false;
+		}
+	}
+	return true;
 }
 
-// Return true if string `c` can be evaluated as an 'm' instruction.
-// note
-// An 'm' instruction is a RELATIVE move_to instruction
-// In case this method returns true,
-// + `*offset` will hold the count of characters from `c` spent on the instruction.
-// + `*p0` will hold the value of the target point
-static bool is_m_instruction( char const* c, int* offset, glm::vec2* p0, uint32_t* state_flags ) {
-	if ( *c == 0 ) {
+// ----------------------------------------------------------------------
+// Parses an arc flag - this is a single character, '0', or '1', which
+// does not need to be separated from whatever follows.
+static bool svg_parse_flag( SvgPathParser& p, bool* flag ) {
+	svg_skip_comma_whitespace( p );
+	if ( p.c == p.end || ( *p.c != '0' && *p.c != '1' ) ) {
 		return false;
 	}
-	// ---------| invarant: c is not end of string
-
-	int       local_offset = 0;
-	glm::vec2 previous_p   = *p0;
-
-	return ( is_repeat_or_command_char( 'm', c, &local_offset, state_flags ) ) &&
-	       is_optional_whitespace( c + local_offset, &local_offset ) &&
-	       is_coordinate_pair( c + local_offset, &local_offset, p0 ) &&
-	       add_offsets( local_offset, offset ) &&
-	       ( ( *state_flags & PATH_PARSER_STATE_FLAG_IS_ABSOLUTE ) ||
-	         update_coordinate( p0, previous_p ) );
+	*flag = ( *p.c == '1' );
+	p.c++;
+	return true;
 }
 
-// Return true if string `c` can be evaluated as an 'L' instruction.
-// An 'l' instruction is an ABSOLUTE line_to instruction
-// In case this method returns true,
-// + `*offset` will hold the count of characters from `c` spent on the instruction.
-// + `*p0` will hold the value of the target point
-static bool is_l_instruction( char const* c, int* offset, glm::vec2* p0, uint32_t* state_flags ) {
-	if ( *c == 0 )
-		return false;
+// ----------------------------------------------------------------------
+// Parses SVG path data from `[data, data + length)`, and adds its contours
+// to path `self`. Relative commands at the start of `data` are relative to
+// the last point of the path.
+//
+// Returns false if the path data contains an error. In this case, as the
+// SVG spec asks for, everything up to the error is kept.
+static bool le_path_add_from_svg_path_data( le_path_o* self, char const* data, size_t length ) {
 
-	int       local_offset = 0;
-	glm::vec2 previous_p   = *p0;
+	SvgPathParser p{ data, data + length };
 
-	return ( is_repeat_or_command_char( 'l', c, &local_offset, state_flags ) ) &&
-	       is_optional_whitespace( c + local_offset, &local_offset ) &&
-	       is_coordinate_pair( c + local_offset, &local_offset, p0 ) &&
-	       add_offsets( local_offset, offset ) &&
-	       ( ( *state_flags & PATH_PARSER_STATE_FLAG_IS_ABSOLUTE ) ||
-	         update_coordinate( p0, previous_p ) );
-}
+	// Current point, and start of current subpath: relative commands
+	// are relative to the current point, and closing a subpath moves
+	// the current point back to the start of the subpath.
+	glm::vec2 current = ( !self->contours.empty() && self->contours.back().commands_count != 0 ) ? *le_path_get_previous_p( self ) : glm::vec2{};
+	glm::vec2 start   = current;
 
-// Return true if string `c` can be evaluated as an 'h' instruction.
-// A 'h' instruction is a horizontal line_to instruction
-// In case this method returns true,
-// + `*offset` will hold the count of characters from `c` spent on the instruction.
-// + `*px` will hold the value of the target point's x coordinate
-static bool is_h_instruction( char const* c, int* offset, float* px, uint32_t* state_flags ) {
-	if ( *c == 0 )
-		return false;
+	// Last control points, so that smooth curves may reflect them
+	glm::vec2 last_cubic_c2 = current;
+	glm::vec2 last_quad_c1  = current;
 
-	int   local_offset = 0;
-	float previous_p   = *px;
+	char command      = 0;     // current command, as given in data
+	char prev_command = 0;     // previous command, upper case
+	bool after_close  = false; // whether previous command was a close path
 
-	return ( is_repeat_or_command_char( 'h', c, &local_offset, state_flags ) ) &&
-	       is_optional_whitespace( c + local_offset, &local_offset ) &&
-	       is_float_number( c + local_offset, &local_offset, px ) &&
-	       add_offsets( local_offset, offset ) &&
-	       ( ( *state_flags & PATH_PARSER_STATE_FLAG_IS_ABSOLUTE ) ||
-	         accum_float( px, previous_p ) );
-}
+	for ( ;; ) {
 
-// Return true if string `c` can be evaluated as an 'l' instruction.
-// A 'v' instruction is a vertical line_to instruction
-// In case this method returns true,
-// + `*offset` will hold the count of characters from `c` spent on the instruction.
-// + `*px` will hold the value of the target point's x coordinate
-static bool is_v_instruction( char const* c, int* offset, float* py, uint32_t* state_flags ) {
-	if ( *c == 0 )
-		return false;
+		svg_skip_whitespace( p );
 
-	int   local_offset = 0;
-	float previous_p   = *py;
-
-	return ( is_repeat_or_command_char( 'v', c, &local_offset, state_flags ) ) &&
-	       is_optional_whitespace( c + local_offset, &local_offset ) &&
-	       is_float_number( c + local_offset, &local_offset, py ) &&
-	       add_offsets( local_offset, offset ) &&
-	       ( ( *state_flags & PATH_PARSER_STATE_FLAG_IS_ABSOLUTE ) ||
-	         accum_float( py, previous_p ) );
-}
-
-// Return true if string `c` can be evaluated as a 'c' instruction.
-// A 'c' instruction is a cubic bezier instruction.
-// In case this method returns true,
-// + `*offset` will hold the count of characters from `c` spent on the instruction.
-// + `*c1` will hold the value of control point 0
-// + `*c2` will hold the value of control point 1
-// + `*p1` will hold the value of the target point
-static bool is_c_instruction( char const* c, int* offset, glm::vec2* c1, glm::vec2* c2, glm::vec2* p1, uint32_t* state_flags ) {
-	if ( *c == 0 )
-		return false;
+		if ( p.c == p.end ) {
+			return true;
+		}
 
-	int       local_offset = 0;
-	glm::vec2 previous_p   = {};
-
-	glm::vec2 tmp_c1 = {};
-	glm::vec2 tmp_c2 = {};
-	glm::vec2 tmp_p1 = {};
-
-	return ( is_repeat_or_command_char( 'c', c, &local_offset, state_flags ) ) && // note this may update state_flags
-	       is_optional_whitespace( c + local_offset, &local_offset ) &&
-	       is_coordinate_pair( c + local_offset, &local_offset, &tmp_c1 ) &&
-	       is_whitespace( c + local_offset, &local_offset ) &&
-	       is_coordinate_pair( c + local_offset, &local_offset, &tmp_c2 ) &&
-	       is_whitespace( c + local_offset, &local_offset ) &&
-	       is_coordinate_pair( c + local_offset, &local_offset, &tmp_p1 ) &&
-	       ( ( *state_flags & PATH_PARSER_STATE_FLAG_IS_ABSOLUTE ) || // only set delta_p if not absolute
-	         set_coordinate_pair( &previous_p, *p1 ) ) &&             // set delta_p to previous p1
-	       set_coordinate_pair( p1, tmp_p1 + previous_p ) &&
-	       set_coordinate_pair( c1, tmp_c1 + previous_p ) &&
-	       set_coordinate_pair( c2, tmp_c2 + previous_p ) &&
-	       add_offsets( local_offset, offset );
-}
-
-// Return true if string `s` can be evaluated as a 's' instruction.
-// A 's' instruction is a smooth cubic bezier instruction.
-// the first control point is assumed to be the reflection of the second
-// control point on the previous command relative to the current point.
-// In case this method returns true,
-// + `*offset` will hold the count of characters from `s` spent on the instruction.
-// + `*c2` will hold the value of control point 1
-// + `*p1` will hold the value of the target point
-static bool is_s_instruction( char const* c, int* offset, glm::vec2* c2, glm::vec2* p1, uint32_t* state_flags ) {
-	if ( *c == 0 )
-		return false;
+		// ----------| invariant: there is something to parse
 
-	int       local_offset = 0;
-	glm::vec2 previous_p   = {};
-
-	glm::vec2 tmp_c2 = {};
-	glm::vec2 tmp_p1 = {};
-
-	return ( is_repeat_or_command_char( 's', c, &local_offset, state_flags ) ) && // note this may update state_flags
-	       is_optional_whitespace( c + local_offset, &local_offset ) &&
-	       is_coordinate_pair( c + local_offset, &local_offset, &tmp_c2 ) &&
-	       is_whitespace( c + local_offset, &local_offset ) &&
-	       is_coordinate_pair( c + local_offset, &local_offset, &tmp_p1 ) &&
-	       ( ( *state_flags & PATH_PARSER_STATE_FLAG_IS_ABSOLUTE ) || // only set delta_p if not absolute
-	         set_coordinate_pair( &previous_p, *p1 ) ) &&             // set delta_p to previous p1
-	       set_coordinate_pair( p1, tmp_p1 + previous_p ) &&
-	       set_coordinate_pair( c2, tmp_c2 + previous_p ) &&
-	       add_offsets( local_offset, offset );
-}
-
-// Return true if string `t` can be evaluated as a 't' instruction.
-// A 'q' instruction is a quadratic bezier instruction.
-// In case this method returns true,
-// + `*offset` will hold the count of characters from `t` spent on the instruction.
-// + `*p1` will hold the value of the target point
-static bool is_t_instruction( char const* c, int* offset, glm::vec2* p1, uint32_t* state_flags ) {
-	if ( *c == 0 )
-		return false;
+		if ( svg_is_number_start( p ) || *p.c == ',' ) {
+			// Parameters without a command letter repeat the previous command.
+			if ( command == 0 || command == 'Z' || command == 'z' ) {
+				return false;
+			}
+			if ( *p.c == ',' ) {
+				svg_skip_comma_whitespace( p );
+			}
+		} else {
+			command = *p.c;
+			p.c++;
+			svg_skip_whitespace( p );
+		}
 
-	int       local_offset = 0;
-	glm::vec2 previous_p   = {};
-	glm::vec2 tmp_p1       = {};
-
-	return ( is_repeat_or_command_char( 't', c, &local_offset, state_flags ) ) &&
-	       is_optional_whitespace( c + local_offset, &local_offset ) &&
-	       is_coordinate_pair( c + local_offset, &local_offset, &tmp_p1 ) &&
-	       ( ( *state_flags & PATH_PARSER_STATE_FLAG_IS_ABSOLUTE ) || // only set delta_p if not absolute
-	         set_coordinate_pair( &previous_p, *p1 ) ) &&             // set delta_p to previous p1
-	       set_coordinate_pair( p1, tmp_p1 + previous_p ) &&
-	       add_offsets( local_offset, offset );
-}
-
-// Return true if string `c` can be evaluated as a 'q' instruction.
-// A 'q' instruction is a quadratic bezier instruction.
-// In case this method returns true,
-// + `*offset` will hold the count of characters from `c` spent on the instruction.
-// + `*c1` will hold the value of the control point
-// + `*p1` will hold the value of the target point
-static bool is_q_instruction( char const* c, int* offset, glm::vec2* c1, glm::vec2* p1, uint32_t* state_flags ) {
-	if ( *c == 0 )
-		return false;
+		char const command_upper = char( command & ~0x20 ); // ascii upper case
+		bool const is_relative   = ( command != command_upper );
+		glm::vec2  origin        = is_relative ? current : glm::vec2{};
 
-	int       local_offset = 0;
-	glm::vec2 previous_p   = {};
-	glm::vec2 tmp_c1       = {};
-	glm::vec2 tmp_p1       = {};
-
-	return ( is_repeat_or_command_char( 'q', c, &local_offset, state_flags ) ) &&
-	       is_optional_whitespace( c + local_offset, &local_offset ) &&
-	       is_coordinate_pair( c + local_offset, &local_offset, &tmp_c1 ) &&
-	       is_whitespace( c + local_offset, &local_offset ) &&
-	       is_coordinate_pair( c + local_offset, &local_offset, &tmp_p1 ) &&
-	       ( ( *state_flags & PATH_PARSER_STATE_FLAG_IS_ABSOLUTE ) || // only set delta_p if not absolute
-	         set_coordinate_pair( &previous_p, *p1 ) ) &&             // set delta_p to previous p1
-	       set_coordinate_pair( p1, tmp_p1 + previous_p ) &&
-	       set_coordinate_pair( c1, tmp_c1 + previous_p ) &&
-	       add_offsets( local_offset, offset );
-}
-
-// Return true if string `c` can be evaluated as a 'a' instruction.
-// An 'a' instruction is an arc_to instruction
-// In case this method returns true,
-// + `*offset` will hold the count of characters from `c` spent on the instruction.
-// + `*radii` will hold the value of the radii
-// + `*x_axis_rotation` will hold the value of the x axis rotation of the ellipse arc
-// + `*large_arc_flag` will hold a flag indicating whether to trace the large arc(true), or the short arc(false)
-// + `*sweep_flag` will hold a flag indicating whether to trace the arc in negative direction (true), or in positive direction (false)
-// + `*p1` will hold the value of the target point
-static bool is_a_instruction( char const* c, int* offset, glm::vec2* radii, float* x_axis_rotation, bool* large_arc_flag, bool* sweep_flag, glm::vec2* p1, uint32_t* state_flags ) {
-	if ( *c == 0 )
-		return false;
+		if ( command_upper != 'M' && ( self->contours.empty() || after_close ) ) {
+			// A path must start with a moveto. After a closepath, the next
+			// subpath starts at the start of the subpath which was closed.
+			if ( self->contours.empty() ) {
+				return false;
+			}
+			if ( command_upper != 'Z' ) {
+				le_path_move_to( self, &start );
+			}
+		}
 
-	int       local_offset = 0;
-	glm::vec2 previous_p   = {};
+		after_close = false;
 
-	glm::vec2 tmp_p1 = {};
+		float f[ 7 ];
+
+		switch ( command_upper ) {
+		case 'M': {
+			if ( !svg_parse_numbers( p, f, 2 ) ) {
+				return false;
+			}
+			current = origin + glm::vec2{ f[ 0 ], f[ 1 ] };
+			start   = current;
+			le_path_move_to( self, &current );
+			// Coordinate pairs which follow a moveto are implicit lineto commands.
+			command = is_relative ? 'l' : 'L';
+		} break;
+		case 'L': {
+			if ( !svg_parse_numbers( p, f, 2 ) ) {
+				return false;
+			}
+			current = origin + glm::vec2{ f[ 0 ], f[ 1 ] };
+			le_path_line_to( self, &current );
+		} break;
+		case 'H': {
+			if ( !svg_parse_numbers( p, f, 1 ) ) {
+				return false;
+			}
+			current.x = origin.x + f[ 0 ];
+			le_path_line_to( self, &current );
+		} break;
+		case 'V': {
+			if ( !svg_parse_numbers( p, f, 1 ) ) {
+				return false;
+			}
+			current.y = origin.y + f[ 0 ];
+			le_path_line_to( self, &current );
+		} break;
+		case 'C': {
+			if ( !svg_parse_numbers( p, f, 6 ) ) {
+				return false;
+			}
+			glm::vec2 c1  = origin + glm::vec2{ f[ 0 ], f[ 1 ] };
+			last_cubic_c2 = origin + glm::vec2{ f[ 2 ], f[ 3 ] };
+			current       = origin + glm::vec2{ f[ 4 ], f[ 5 ] };
+			le_path_cubic_bezier_to( self, &current, &c1, &last_cubic_c2 );
+		} break;
+		case 'S': {
+			if ( !svg_parse_numbers( p, f, 4 ) ) {
+				return false;
+			}
+			// First control point is the reflection of the previous curve's second
+			// control point - if there was no previous cubic curve, it is the current point.
+			glm::vec2 c1  = ( prev_command == 'C' || prev_command == 'S' ) ? 2.f * current - last_cubic_c2 : current;
+			last_cubic_c2 = origin + glm::vec2{ f[ 0 ], f[ 1 ] };
+			current       = origin + glm::vec2{ f[ 2 ], f[ 3 ] };
+			le_path_cubic_bezier_to( self, &current, &c1, &last_cubic_c2 );
+		} break;
+		case 'Q': {
+			if ( !svg_parse_numbers( p, f, 4 ) ) {
+				return false;
+			}
+			last_quad_c1 = origin + glm::vec2{ f[ 0 ], f[ 1 ] };
+			current      = origin + glm::vec2{ f[ 2 ], f[ 3 ] };
+			le_path_quad_bezier_to( self, &current, &last_quad_c1 );
+		} break;
+		case 'T': {
+			if ( !svg_parse_numbers( p, f, 2 ) ) {
+				return false;
+			}
+			// Control point is the reflection of the previous curve's control
+			// point - if there was no previous quadratic curve, it is the current point.
+			last_quad_c1 = ( prev_command == 'Q' || prev_command == 'T' ) ? 2.f * current - last_quad_c1 : current;
+			current      = origin + glm::vec2{ f[ 0 ], f[ 1 ] };
+			le_path_quad_bezier_to( self, &current, &last_quad_c1 );
+		} break;
+		case 'A': {
+			bool large_arc = false;
+			bool sweep     = false;
+			if ( !svg_parse_numbers( p, f, 3 ) ||
+			     !svg_parse_flag( p, &large_arc ) ||
+			     !svg_parse_flag( p, &sweep ) ) {
+				return false;
+			}
+			svg_skip_comma_whitespace( p );
+			if ( !svg_parse_numbers( p, f + 3, 2 ) ) {
+				return false;
+			}
+			glm::vec2 radii = { fabsf( f[ 0 ] ), fabsf( f[ 1 ] ) };
+			glm::vec2 p1    = origin + glm::vec2{ f[ 3 ], f[ 4 ] };
+			if ( p1 == current ) {
+				// An arc with identical endpoints is omitted.
+			} else if ( radii.x == 0 || radii.y == 0 ) {
+				// An arc with a zero radius is a straight line.
+				le_path_line_to( self, &p1 );
+			} else {
+				le_path_arc_to( self, &p1, &radii, f[ 2 ], large_arc, sweep );
+			}
+			current = p1;
+		} break;
+		case 'Z': {
+			le_path_close_path( self );
+			current     = start;
+			after_close = true;
+		} break;
+		default:
+			// Not a command.
+			return false;
+		}
 
-	return ( is_repeat_or_command_char( 'a', c, &local_offset, state_flags ) ) &&
-	       is_optional_whitespace( c + local_offset, &local_offset ) &&
-	       is_coordinate_pair( c + local_offset, &local_offset, radii ) &&
-	       is_whitespace( c + local_offset, &local_offset ) &&
-	       is_float_number( c + local_offset, &local_offset, x_axis_rotation ) &&
-	       is_whitespace( c + local_offset, &local_offset ) &&
-	       is_boolean_zero_or_one( c + local_offset, &local_offset, large_arc_flag ) &&
-	       is_comma_or_whitespace( c + local_offset, &local_offset ) &&
-	       is_boolean_zero_or_one( c + local_offset, &local_offset, sweep_flag ) &&
-	       is_whitespace( c + local_offset, &local_offset ) &&
-	       is_coordinate_pair( c + local_offset, &local_offset, &tmp_p1 ) &&
-	       ( ( *state_flags & PATH_PARSER_STATE_FLAG_IS_ABSOLUTE ) || // only set delta_p if not absolute
-	         set_coordinate_pair( &previous_p, *p1 ) ) &&             // set delta_p to previous p1
-	       set_coordinate_pair( p1, tmp_p1 + previous_p ) &&
-	       add_offsets( local_offset, offset );
+		prev_command = command_upper;
+	}
 }
 
 // ----------------------------------------------------------------------
-// Parse string `svg` for simplified SVG instructions and adds paths
-// based on instructions found.
-//
-// Rules for similified SVG:
-//
-// - All coordinates must be absolute
-// - Commands must be repeated
-// - Allowed instruction tokens are:
-//	 - 'M', with params {  p        } (moveto),
-//	 - 'L', with params {  p        } (lineto),
-//	 - 'C', with params { c0, c1, p } (cubic bezier to),
-//	 - 'Q', with params { c0,  p,   } (quad bezier to),
-//	 - 'Z', with params {           } (close path)
-//   - 'A', with params { r, x-rot, large-arc-flag, sweep-flag, p } (arc to)
+// Parses a string holding SVG path data, e.g. the contents of the `d`
+// attribute of an SVG `<path>` element, and adds contours to the path.
 //
 // You may set up Inkscape to output simplified SVG via:
 // `Edit -> Preferences -> SVG Output ->
 // (tick) Force Repeat Commands, Path string format (select: Absolute)`
-//
-// The full grammar for SVG paths is defined here:
-// <https://svgwg.org/svg2-draft/paths.html#PathDataBNF>
-//
+// - but any valid path data, including relative commands, implicit
+// repeats, and compact numbers, is accepted.
 static void le_path_add_from_simplified_svg( le_path_o* self, char const* svg ) {
+	if ( !le_path_add_from_svg_path_data( self, svg, strlen( svg ) ) ) {
+		logger.warn( "Could not parse svg path data: '%s'", svg );
+	}
+}
 
-	char const* c = svg;
+// ----------------------------------------------------------------------
+// Returns true if `[c, end)` starts with `str`.
+static inline bool svg_starts_with( char const* c, char const* end, char const* str ) {
+	size_t len = strlen( str );
+	return size_t( end - c ) >= len && 0 == memcmp( c, str, len );
+}
 
-	glm::vec2 p                 = ( !self->contours.empty() && !self->contours.back().commands.empty() ) ? *le_path_get_previous_p( self ) : glm::vec2{};
-	glm::vec2 c1                = {};
-	glm::vec2 c2                = {};
-	glm::vec2 radii             = {};
-	float     arc_axis_rotation = {};
-	bool      arc_large{};
-	bool      arc_sweep{};
+// ----------------------------------------------------------------------
+// Creates a path for each `<path>` element in the SVG document `[data, data + length)`,
+// and hands it to `callback`. Paths are built straight from the `d` attribute
+// of each `<path>` element. Any other elements, and attributes, including
+// transforms, are ignored.
+//
+// Returns the number of paths created.
+static size_t le_path_create_from_svg( char const* data, size_t length, le_path_api::svg_path_cb callback, void* user_data ) {
 
-	int offset = 0;
+	char const* c   = data;
+	char const* end = data + length;
 
-	for ( ; c[ offset ] != 0; ) // We test for the \0 character, end of c-string
-	{
+	size_t num_paths = 0;
 
-		uint32_t state_flags;
-		c += offset;
-		offset = 0;
+	while ( c != end ) {
 
-		glm::vec2 curr_p  = p;
-		glm::vec2 prev_c1 = c1;
-		glm::vec2 prev_c2 = c2;
+		c = static_cast<char const*>( memchr( c, '<', size_t( end - c ) ) );
 
-		state_flags = 0;
-		while ( is_m_instruction( c + offset, &offset, &p, &state_flags ) ) {
-			le_path_move_to( self, &p );
-		}
-		if ( offset ) {
-			continue;
+		if ( nullptr == c ) {
+			break;
 		}
 
-		state_flags = 0;
-		while ( is_l_instruction( c + offset, &offset, &p, &state_flags ) ) {
-			le_path_line_to( self, &p );
-		}
-		if ( offset ) {
-			continue;
-		}
+		// ----------| invariant: c points at start of a tag
 
-		state_flags = 0;
-		while ( is_h_instruction( c + offset, &offset, &p.x, &state_flags ) ) {
-			le_path_line_horiz_to( self, p.x );
-		}
-		if ( offset ) {
+		if ( svg_starts_with( c, end, "<!--" ) ) {
+			// Skip comment
+			char const* comment_end = std::search( c + 4, end, "-->", "-->" + 3 );
+			c                       = ( comment_end == end ) ? end : comment_end + 3;
 			continue;
 		}
 
-		state_flags = 0;
-		while ( is_v_instruction( c + offset, &offset, &p.y, &state_flags ) ) {
-			le_path_line_vert_to( self, p.y );
-		}
-		if ( offset ) {
+		if ( !svg_starts_with( c, end, "<path" ) || c + 5 == end || !svg_is_whitespace( c[ 5 ] ) ) {
+			c++;
 			continue;
 		}
 
-		state_flags = 0;
-		while ( is_c_instruction( c + offset, &offset, &c1, &c2, &p, &state_flags ) ) {
-			le_path_cubic_bezier_to( self, &p, &c1, &c2 ); // Note that end vertex is p2 from SVG,
-			                                               // as SVG has target vertex as last vertex
-		}
-		if ( offset ) {
-			continue;
-		}
+		// ----------| invariant: c points at start of a path element
 
-		state_flags = 0;
-		while ( is_s_instruction( c + offset, &offset, &c2, &p, &state_flags ) ) {
-			// shorthand for smooth curveto
-			c1 = curr_p * 2.f - prev_c2; // calculate c2 as the reflection of previous c2 relative to the current point
-			le_path_cubic_bezier_to( self, &p, &c1, &c2 );
-			prev_c2 = c2;
-			curr_p  = p;
-		}
-		if ( offset ) {
-			continue;
-		}
+		c += 5;
 
-		state_flags = 0;
-		while ( is_q_instruction( c + offset, &offset, &c1, &p, &state_flags ) ) {
-			le_path_quad_bezier_to( self, &p, &c1 );
-		}
-		if ( offset ) {
-			continue;
-		}
+		// Find `d` attribute - attribute values may not contain '<', or '>' in
+		// well-formed SVG, which means the tag ends at the first '>'.
 
-		state_flags = 0;
-		while ( is_t_instruction( c + offset, &offset, &p, &state_flags ) ) {
-			// shorthand for smooth quadratic bezier curveto
-			c1 = curr_p * 2.f - prev_c1; // calculate c1 as a reflection of the previous control point on the previous command relative to the current point
-			le_path_quad_bezier_to( self, &p, &c1 );
-			prev_c1 = c1;
-			curr_p  = p;
-		}
-		if ( offset ) {
-			continue;
-		}
+		char const* d_begin = nullptr;
+		char const* d_end   = nullptr;
 
-		state_flags = 0;
-		while ( is_a_instruction( c + offset, &offset, &radii, &arc_axis_rotation, &arc_large, &arc_sweep, &p, &state_flags ) ) {
-			le_path_arc_to( self, &p, &radii, arc_axis_rotation, arc_large, arc_sweep ); // Note that target vertex is p1 from SVG,
+		while ( c != end && *c != '>' ) {
+			if ( svg_is_whitespace( c[ -1 ] ) && *c == 'd' ) {
+				char const* a = c + 1;
+				while ( a != end && svg_is_whitespace( *a ) ) {
+					a++;
+				}
+				if ( a != end && *a == '=' ) {
+					a++;
+					while ( a != end && svg_is_whitespace( *a ) ) {
+						a++;
+					}
+					if ( a != end && ( *a == '"' || *a == '\'' ) ) {
+						char const* value_end = static_cast<char const*>( memchr( a + 1, *a, size_t( end - a - 1 ) ) );
+						if ( value_end ) {
+							d_begin = a + 1;
+							d_end   = value_end;
+							c       = value_end;
+						}
+					}
+				}
+			} else if ( *c == '"' || *c == '\'' ) {
+				// Skip over values of other attributes
+				char const* value_end = static_cast<char const*>( memchr( c + 1, *c, size_t( end - c - 1 ) ) );
+				c                     = value_end ? value_end : end - 1;
+			}
+			c++;
 		}
-		if ( offset ) {
+
+		if ( nullptr == d_begin ) {
 			continue;
 		}
 
-		state_flags = 0;
-		while ( is_character_match( 'Z', c + offset, &offset ) ||
-		        is_character_match( 'z', c + offset, &offset ) ) {
-			// close path event.
-			le_path_close_path( self );
-		}
+		// ----------| invariant: we found path data
 
-		if ( offset ) {
-			continue;
+		le_path_o* path = le_path_create();
+
+		if ( !le_path_add_from_svg_path_data( path, d_begin, size_t( d_end - d_begin ) ) ) {
+			logger.warn( "Could not parse svg path data at byte offset %zu", size_t( d_begin - data ) );
 		}
 
-		// ----------| Invariant: None of the cases above did match
+		callback( user_data, path );
+		num_paths++;
+	}
 
-		// If none of the above cases match, the current character is
-		// invalid, or does not contribute. Most likely it is a white-
-		// space character.
+	return num_paths;
+}
 
-		++c; // Ignore current character.
+// ----------------------------------------------------------------------
+// Memory-maps the SVG file at `file_path`, and creates paths from it, see
+// `le_path_create_from_svg`. Returns false if the file could not be read.
+static bool le_path_create_from_svg_file( char const* file_path, le_path_api::svg_path_cb callback, void* user_data, size_t* num_paths ) {
+
+	size_t num_created = 0;
+	bool   success     = false;
+
+#ifdef _WIN32
+	// No mapping here - we read the file into memory instead.
+	FILE* f = fopen( file_path, "rb" );
+	if ( f ) {
+		fseek( f, 0, SEEK_END );
+		size_t            size = size_t( ftell( f ) );
+		std::vector<char> data( size );
+		fseek( f, 0, SEEK_SET );
+		if ( size == 0 || 1 == fread( data.data(), size, 1, f ) ) {
+			num_created = le_path_create_from_svg( data.data(), size, callback, user_data );
+			success     = true;
+		}
+		fclose( f );
+	}
+#else
+	int fd = open( file_path, O_RDONLY );
+	if ( fd >= 0 ) {
+		struct stat st;
+		if ( 0 == fstat( fd, &st ) ) {
+			size_t size = size_t( st.st_size );
+			void*  data = size ? mmap( nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0 ) : nullptr;
+			if ( data != MAP_FAILED ) {
+				if ( data ) {
+					madvise( data, size, MADV_SEQUENTIAL ); // we read the file once, front to back
+					num_created = le_path_create_from_svg( static_cast<char const*>( data ), size, callback, user_data );
+					munmap( data, size );
+				}
+				success = true;
+			}
+		}
+		close( fd );
+	}
+#endif
+
+	if ( !success ) {
+		logger.error( "Could not read svg file: '%s'", file_path );
+	}
+
+	if ( num_paths ) {
+		*num_paths = num_created;
 	}
-};
+
+	return success;
+}
 
 // ----------------------------------------------------------------------
 
@@ -3321,6 +4113,9 @@ LE_MODULE_REGISTER_IMPL( le_path, api ) {
 	le_path_i.ellipse = le_path_ellipse;
 
 	le_path_i.add_from_simplified_svg = le_path_add_from_simplified_svg;
+	le_path_i.add_from_svg_path_data  = le_path_add_from_svg_path_data;
+	le_path_i.create_from_svg         = le_path_create_from_svg;
+	le_path_i.create_from_svg_file    = le_path_create_from_svg_file;
 
 	le_path_i.get_num_contours                 = le_path_get_num_contours;
 	le_path_i.get_num_polylines                = le_path_get_num_polylines;
@@ -3338,4 +4133,12 @@ LE_MODULE_REGISTER_IMPL( le_path, api ) {
 	le_path_i.flatten  = le_path_flatten_path;
 	le_path_i.resample = le_path_resample;
 	le_path_i.clear    = le_path_clear;
+
+	auto& le_path_stroke_batch_i = static_cast<le_path_api*>( api )->le_path_stroke_batch_i;
+
+	le_path_stroke_batch_i.create           = le_path_stroke_batch_create;
+	le_path_stroke_batch_i.destroy          = le_path_stroke_batch_destroy;
+	le_path_stroke_batch_i.tessellate       = le_path_stroke_batch_tessellate;
+	le_path_stroke_batch_i.get_num_vertices = le_path_stroke_batch_get_num_vertices;
+	le_path_stroke_batch_i.get_vertices     = le_path_stroke_batch_get_vertices;
 }
@@ -11,6 +11,7 @@
 #include <glm/fwd.hpp> // TODO: get rid of glm as this is a cpp header.
 
 struct le_path_o;
+struct le_path_stroke_batch_o;
 
 // clang-format off
 struct le_path_api {
@@ -35,6 +36,14 @@ struct le_path_api {
 		LineCapType  line_cap_type;
 	};
 
+	// One contour to tessellate as part of a stroke batch.
+	struct stroke_contour_t {
+		le_path_o const*          path;
+		uint32_t                  contour_index;
+		stroke_attribute_t const* stroke_attributes;
+	};
+
+    typedef void svg_path_cb(void *user_data, le_path_o* path); // receives ownership of `path`
     typedef void contour_vertex_cb (void *user_data, glm::vec2 const& p);
     typedef void contour_quad_bezier_cb(void *user_data, glm::vec2 const& p0, glm::vec2 const& p1, glm::vec2 const& c);
 
@@ -58,9 +67,23 @@ struct le_path_api {
 		// Macro - style commands which resolve to a series of subcommands from above
 		void        (* ellipse                   ) ( le_path_o* self, glm::vec2 const* centre, float r_x, float r_y );
 
+		// Add contours from svg path data, as found in the `d` attribute of svg `<path>` elements.
+		// Any valid path data is accepted: absolute and relative commands, implicit repeats, compact numbers.
+		// `add_from_simplified_svg` reads a null-terminated string, and logs a warning on error.
+		// `add_from_svg_path_data` reads `length` bytes, and returns false on error.
+		// In both cases, contours up to the error are kept.
 		void        (* add_from_simplified_svg   ) ( le_path_o* self, char const* svg );
+		bool        (* add_from_svg_path_data    ) ( le_path_o* self, char const* data, size_t length );
 
-        // Generate and cache polylines for each contour per path
+		// Create one path per `<path>` element in an svg document, and hand it to `callback`, which
+		// then owns the path, and must eventually destroy it. Transforms, and styles are ignored.
+		// `create_from_svg_file` memory-maps the file; it returns false if the file could not be read.
+		size_t      (* create_from_svg           ) ( char const* data, size_t length, svg_path_cb callback, void* user_data );
+		bool        (* create_from_svg_file      ) ( char const* file_path, svg_path_cb callback, void* user_data, size_t* num_paths );
+
+        // Generate and cache polylines for each contour per path. Contours which are unchanged since the
+        // last trace (or flatten) with the same parameter re-use their polylines - this holds across `clear`,
+        // so that re-building an animated path only re-traces contours which did actually change.
 		void        (* trace                     ) ( le_path_o* self, size_t resolution );
 		void        (* flatten                   ) ( le_path_o* self, float tolerance);
 		void        (* resample                  ) ( le_path_o* self, float interval);
@@ -69,10 +92,14 @@ struct le_path_api {
         // Returns false if either given `max_count_outline_[l|r]` was less than the number of vertices needed
         // Returns true if max_count_outline_[l|r] was sufficient to hold vertices for l and r outline: also
         // writes vertex data to `outline_l_` and `outline_r_`.
+        // Outlines for the most recent call are kept with the path, so that calling again with enough space
+        // does not generate them twice.
 	    bool        (* generate_offset_outline_for_contour )(le_path_o *self, size_t contour_index, float line_weight, float tolerance, glm::vec2 *outline_l_, size_t *max_count_outline_l, glm::vec2 *outline_r_, size_t *max_count_outline_r );
 
 		/// Returns `false` if num_vertices was smaller than needed number of vertices.
 		/// Note: Upon return, `*num_vertices` will contain number of vertices needed to describe tessellated contour triangles.
+		/// Triangles for the most recent call are kept with the path, so that calling again with enough space does not
+		/// tessellate twice. To tessellate many contours in parallel, see `le_path_stroke_batch_interface_t`.
 		bool        (* tessellate_thick_contour)(le_path_o* self, size_t contour_index, struct stroke_attribute_t const * stroke_attributes, glm::vec2* vertices, size_t* num_vertices);
 
         size_t      (* get_num_contours          ) ( le_path_o* self );
@@ -94,7 +121,31 @@ struct le_path_api {
 		
 	};
 
-	le_path_interface_t       le_path_i;
+	// Tessellates thick strokes for many contours, of any number of paths, in parallel on le_jobs
+	// worker threads. If le_jobs is not initialised, contours get tessellated on the calling thread.
+	//
+	// Triangles stay with the batch until the next call to `tessellate`, so that you may query the
+	// number of vertices, allocate, and then fetch vertices without tessellating anything twice.
+	// Paths must not change while `tessellate` runs.
+	struct le_path_stroke_batch_interface_t {
+
+		le_path_stroke_batch_o* ( * create           ) ( );
+		void                    ( * destroy          ) ( le_path_stroke_batch_o* self );
+
+		void                    ( * tessellate       ) ( le_path_stroke_batch_o* self, stroke_contour_t const* contours, size_t num_contours );
+		size_t                  ( * get_num_vertices ) ( le_path_stroke_batch_o* self );
+
+		// Writes triangle vertices for all contours into `vertices`, one contour after another, so that
+		// vertices for contour `i` are at [vertex_offsets[i], vertex_offsets[i+1]). `vertex_offsets` may
+		// be nullptr, otherwise it must have space for `num_contours + 1` elements, and is always filled in -
+		// in which case the batch must not hold more than 2^32-1 vertices.
+		// Always updates `num_vertices`; returns false, and writes no vertices, if `*num_vertices` was
+		// less than the number of vertices in the batch.
+		bool                    ( * get_vertices     ) ( le_path_stroke_batch_o* self, glm::vec2* vertices, size_t* num_vertices, uint32_t* vertex_offsets );
+	};
+
+	le_path_interface_t              le_path_i;
+	le_path_stroke_batch_interface_t le_path_stroke_batch_i;
 };
 // clang-format on
 
@@ -104,8 +155,9 @@ LE_MODULE_LOAD_DEFAULT( le_path );
 #ifdef __cplusplus
 
 namespace le_path {
-static const auto& api       = le_path_api_i;
-static const auto& le_path_i = api -> le_path_i;
+static const auto& api                    = le_path_api_i;
+static const auto& le_path_i              = api -> le_path_i;
+static const auto& le_path_stroke_batch_i = api -> le_path_stroke_batch_i;
 } // namespace le_path
 
 namespace le {
@@ -163,6 +215,10 @@ class Path : NoCopy, NoMove {
 		return *this;
 	}
 
+	bool addFromSvgPathData( char const* data, size_t length ) {
+		return le_path::le_path_i.add_from_svg_path_data( self, data, length );
+	}
+
 	void hobby() {
 		le_path::le_path_i.hobby( self );
 	}
@@ -211,6 +267,36 @@ class Path : NoCopy, NoMove {
 		return self;
 	}
 };
+
+class PathStrokeBatch : NoCopy, NoMove {
+
+	le_path_stroke_batch_o* self;
+
+  public:
+	PathStrokeBatch()
+	    : self( le_path::le_path_stroke_batch_i.create() ) {
+	}
+
+	~PathStrokeBatch() {
+		le_path::le_path_stroke_batch_i.destroy( self );
+	}
+
+	void tessellate( le_path_api::stroke_contour_t const* contours, size_t numContours ) {
+		le_path::le_path_stroke_batch_i.tessellate( self, contours, numContours );
+	}
+
+	size_t getNumVertices() {
+		return le_path::le_path_stroke_batch_i.get_num_vertices( self );
+	}
+
+	bool getVertices( glm::vec2* vertices, size_t* numVertices, uint32_t* vertexOffsets = nullptr ) {
+		return le_path::le_path_stroke_batch_i.get_vertices( self, vertices, numVertices, vertexOffsets );
+	}
+
+	operator auto() {
+		return self;
+	}
+};
 } // end namespace le
 
 #endif // __cplusplus
@@ -157,7 +157,9 @@ static le_renderer_o* renderer_create() {
 	auto obj = new le_renderer_o();
 
 	if ( LE_MT > 0 ) {
-		le_jobs::initialize( LE_MT );
+		le_jobs_settings_t settings{};
+		settings.worker_thread_count = LE_MT;
+		le_jobs::initialize( &settings );
 	}
 
 	using namespace le_backend_vk;
@@ -822,11 +824,16 @@ static void renderer_update( le_renderer_o* self, le_rendergraph_o* graph_ ) {
 
 		le_jobs::counter_t* shader_counter;
 
+		// Note that all jobs which we issue here are frame-critical, as
+		// the frame can't complete before they do - this includes updating
+		// shader modules, since recording the frame waits for it.
 		le_jobs::job_t j{
 		    []( void* backend ) {
 			    vk_backend_i.update_shader_modules( static_cast<le_backend_o*>( backend ) );
 		    },
-		    self->backend };
+		    self->backend,
+		    nullptr,
+		    le_jobs::Priority::eFrameCritical };
 
 		le_jobs::run_jobs( &j, 1, &shader_counter );
 
@@ -836,18 +843,15 @@ static void renderer_update( le_renderer_o* self, le_rendergraph_o* graph_ ) {
 		};
 
 		struct record_params_t {
-			le_renderer_o*      renderer;
-			size_t              frame_index;
-			le_rendergraph_o*   rendergraph;
-			size_t              current_frame_number;
-			le_jobs::counter_t* shader_counter;
+			le_renderer_o*    renderer;
+			size_t            frame_index;
+			le_rendergraph_o* rendergraph;
+			size_t            current_frame_number;
 		};
 
 		auto record_frame_fun = []( void* param_ ) {
 			auto p = static_cast<record_params_t*>( param_ );
 			// generate an intermediary, api-agnostic, representation of the frame
-
-			le_jobs::wait_for_counter_and_free( p->shader_counter, 0 );
 			renderer_record_frame( p->renderer, p->frame_index, p->rendergraph, p->current_frame_number );
 		};
 
@@ -867,14 +871,13 @@ static void renderer_update( le_renderer_o* self, le_rendergraph_o* graph_ ) {
 			renderer_clear_frame( p->renderer, p->frame_index );
 		};
 
-		le_jobs::job_t jobs[ 3 ];
+		le_jobs::job_t jobs[ 2 ];
 
 		record_params_t record_frame_params;
 		record_frame_params.renderer             = self;
 		record_frame_params.frame_index          = ( index + 0 ) % numFrames;
 		record_frame_params.rendergraph          = graph_;
 		record_frame_params.current_frame_number = self->currentFrameNumber;
-		record_frame_params.shader_counter       = shader_counter;
 
 		frame_params_t process_frame_params;
 		process_frame_params.renderer    = self;
@@ -884,19 +887,26 @@ static void renderer_update( le_renderer_o* self, le_rendergraph_o* graph_ ) {
 		clear_frame_params.renderer    = self;
 		clear_frame_params.frame_index = ( index + 1 ) % numFrames;
 
-		jobs[ 0 ] = { process_frame_fun, &process_frame_params };
-		jobs[ 1 ] = { clear_frame_fun, &clear_frame_params };
-		jobs[ 2 ] = { record_frame_fun, &record_frame_params };
+		jobs[ 0 ] = { process_frame_fun, &process_frame_params, nullptr, le_jobs::Priority::eFrameCritical };
+		jobs[ 1 ] = { clear_frame_fun, &clear_frame_params, nullptr, le_jobs::Priority::eFrameCritical };
+
+		// Recording the frame depends on shader modules being up-to-date: we issue it
+		// as a continuation of the shader update job, so that no fiber has to block
+		// while it waits for shaders to be updated.
+		le_jobs::job_t record_job{ record_frame_fun, &record_frame_params, nullptr, le_jobs::Priority::eFrameCritical };
 
 		le_jobs::counter_t* counter;
+		le_jobs::counter_t* record_counter;
 
 		assert( self->backend );
 
-		le_jobs::run_jobs( jobs, 3, &counter );
+		le_jobs::run_jobs_after( shader_counter, &record_job, 1, &record_counter ); // takes ownership of shader_counter
+		le_jobs::run_jobs( jobs, 2, &counter );
 
 		// we could theoretically do some more work on the main thread here...
 
 		le_jobs::wait_for_counter_and_free( counter, 0 );
+		le_jobs::wait_for_counter_and_free( record_counter, 0 );
 
 	} else {
 